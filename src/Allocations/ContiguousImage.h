@@ -1,13 +1,22 @@
-// Copyright (c) 2019-2020 Broadcom. All Rights Reserved.
+// Copyright (c) 2019-2020,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
 #include <string.h>
+#include <algorithm>
+#include <cstddef>
 #include "../VirtualAddressMap.h"
 #include "Directory.h"
 namespace chap {
 namespace Allocations {
+/*
+ * This gives the image of one allocation at a time, selected by index.  When
+ * allocations are visited in increasing order, as in a sweep of the whole
+ * heap, the kernel is asked to read ahead of the current allocation within
+ * the current range of the address map, so that a core on slow storage is
+ * not read one page fault at a time, and to release what is behind it.
+ */
 template <class Offset>
 class ContiguousImage {
  public:
@@ -32,7 +41,10 @@ class ContiguousImage {
         _endIterator(_addressMap.end()),
         _regionImage(nullptr),
         _regionBase(0),
-        _regionLimit(0) {}
+        _regionLimit(0),
+        _fileImage(addressMap.GetFileImage()),
+        _sweptFrom(nullptr),
+        _readAheadTo(nullptr) {}
 
   void SetIndex(Index index) {
     if (index > _numAllocations) {
@@ -49,6 +61,7 @@ class ContiguousImage {
         Offset size = allocation->Size();
         Offset limit = address + size;
         if (_regionBase > address || address >= _regionLimit) {
+          EndSweep();
           _regionImage = nullptr;
           _regionBase = 0;
           _regionLimit = 0;
@@ -66,12 +79,14 @@ class ContiguousImage {
         if (limit <= _regionLimit) {
           _pFirstChar = _regionImage + (address - _regionBase);
           _size = size;
+          ContinueSweep(_pFirstChar + size);
         } else {
           /*
            * This is very rare on Linux but could happen in the case of
            * truncation.  It does happen even without truncation on Windows,
            * which may be supported at some point.
            */
+          EndSweep();
           memcpy(_bufferAsChars, _regionImage + (address - _regionBase),
                  _regionLimit - address);
           Offset copiedTo = _regionLimit;
@@ -127,6 +142,8 @@ class ContiguousImage {
   Offset Size() const { return _size; }
 
  private:
+  static constexpr Offset READ_AHEAD_BYTES = 0x1000000;
+  static constexpr Offset RELEASE_BYTES = 0x400000;
   const Directory<Offset> &_directory;
   const Index _numAllocations;
   Index _index;
@@ -144,6 +161,51 @@ class ContiguousImage {
   const char *_regionImage;
   Offset _regionBase;
   Offset _regionLimit;
+  const FileImage &_fileImage;
+  const char *_sweptFrom;
+  const char *_readAheadTo;
+
+  /*
+   * Keep the read ahead at least half of READ_AHEAD_BYTES past the end of
+   * the current allocation, in the current region, and release, in pieces
+   * of at least RELEASE_BYTES, what is before the start of the current
+   * allocation.  A move backwards, or forwards past the read ahead, starts a
+   * new sweep.
+   */
+  void ContinueSweep(const char *allocationLimit) {
+    if (_sweptFrom == nullptr || _pFirstChar < _sweptFrom ||
+        _pFirstChar > _readAheadTo) {
+      _sweptFrom = _pFirstChar;
+      _readAheadTo = _pFirstChar;
+    }
+    if (_readAheadTo < allocationLimit + READ_AHEAD_BYTES / 2) {
+      const char *regionImageLimit =
+          _regionImage + (_regionLimit - _regionBase);
+      if (_readAheadTo < regionImageLimit) {
+        const char *readAheadFrom = std::max(_readAheadTo, _pFirstChar);
+        _readAheadTo =
+            (regionImageLimit - allocationLimit > (ptrdiff_t)READ_AHEAD_BYTES)
+                ? allocationLimit + READ_AHEAD_BYTES
+                : regionImageLimit;
+        _fileImage.WillSweep(readAheadFrom, _readAheadTo);
+      }
+    }
+    if (_pFirstChar - _sweptFrom >= (ptrdiff_t)RELEASE_BYTES) {
+      _fileImage.Swept(_sweptFrom, _pFirstChar);
+      _sweptFrom = _pFirstChar;
+    }
+  }
+
+  /*
+   * Forget the current sweep, because the current allocation is not in the
+   * current region.  What was swept so far in the region is left for the
+   * kernel to reclaim when it chooses, because a sweep rarely ends at the
+   * end of a region but often continues in the next one.
+   */
+  void EndSweep() {
+    _sweptFrom = nullptr;
+    _readAheadTo = nullptr;
+  }
 };
 }  // namespace Allocations
 }  // namespace chap
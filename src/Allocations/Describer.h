@@ -27,11 +27,9 @@ class Describer : public chap::Describer<Offset> {
       : _inModuleDescriber(inModuleDescriber),
         _stackDescriber(stackDescriber),
         _patternDescriberRegistry(patternDescriberRegistry),
-        _signatureDirectory(processImage.GetSignatureDirectory()),
-        _anchorDirectory(processImage.GetAnchorDirectory()),
+        _processImage(processImage),
         _addressMap(processImage.GetVirtualAddressMap()),
-        _directory(processImage.GetAllocationDirectory()),
-        _graph(processImage.GetAllocationGraph()) {}
+        _directory(processImage.GetAllocationDirectory()) {}
 
   /*
    * If the address is understood, provide a description for the address,
@@ -41,9 +39,6 @@ class Describer : public chap::Describer<Offset> {
    */
   bool Describe(Commands::Context& context, Offset address, bool explain,
                 bool showAddresses) const {
-    if (_graph == 0) {
-      return false;
-    }
     AllocationIndex index = _directory.AllocationIndexOf(address);
     if (index == _directory.NumAllocations()) {
       return false;
@@ -77,11 +72,13 @@ class Describer : public chap::Describer<Offset> {
     bool isLeaked = false;
     bool isUnreferenced = false;
     bool isThreadCached = false;
+    const Graph<Offset>* graph = nullptr;
     if (allocation.IsUsed()) {
       isUsed = true;
-      if (_graph->IsLeaked(index)) {
+      graph = _processImage.GetAllocationGraph();
+      if (graph->IsLeaked(index)) {
         isLeaked = true;
-        if (_graph->IsUnreferenced(index)) {
+        if (graph->IsUnreferenced(index)) {
           isUnreferenced = true;
         }
       }
@@ -107,12 +104,14 @@ class Describer : public chap::Describer<Offset> {
     const char* image;
     (void)_addressMap.FindMappedMemoryImage(address, &image);
     bool isUnsigned = true;
+    const SignatureDirectory<Offset>& signatureDirectory =
+        _processImage.GetSignatureDirectory();
     if (size >= sizeof(Offset)) {
       Offset signature = *((Offset*)image);
-      if (_signatureDirectory.IsMapped(signature)) {
+      if (signatureDirectory.IsMapped(signature)) {
         isUnsigned = false;
         output << "... with signature " << signature;
-        std::string name = _signatureDirectory.Name(signature);
+        std::string name = signatureDirectory.Name(signature);
         if (!name.empty()) {
           output << "(" << name << ")";
         }
@@ -133,11 +132,11 @@ class Describer : public chap::Describer<Offset> {
       if (isUsed) {
         if (!isLeaked) {
           AnchorChainLister<Offset> anchorChainLister(
-              _inModuleDescriber, _stackDescriber, *_graph, _signatureDirectory,
-              _anchorDirectory, context, address);
-          _graph->VisitStaticAnchorChains(index, anchorChainLister);
-          _graph->VisitRegisterAnchorChains(index, anchorChainLister);
-          _graph->VisitStackAnchorChains(index, anchorChainLister);
+              _inModuleDescriber, _stackDescriber, *graph, signatureDirectory,
+              _processImage.GetAnchorDirectory(), context, address);
+          graph->VisitStaticAnchorChains(index, anchorChainLister);
+          graph->VisitRegisterAnchorChains(index, anchorChainLister);
+          graph->VisitStackAnchorChains(index, anchorChainLister);
         }
       }
     }
@@ -148,11 +147,9 @@ class Describer : public chap::Describer<Offset> {
   const InModuleDescriber<Offset>& _inModuleDescriber;
   const StackDescriber<Offset>& _stackDescriber;
   const PatternDescriberRegistry<Offset>& _patternDescriberRegistry;
-  const SignatureDirectory<Offset>& _signatureDirectory;
-  const AnchorDirectory<Offset>& _anchorDirectory;
+  const ProcessImage<Offset>& _processImage;
   const VirtualAddressMap<Offset>& _addressMap;
   const Directory<Offset>& _directory;
-  const Graph<Offset>* _graph;
 };
 }  // namespace Allocations
 }  // namespace chap
@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <functional>
 #include <vector>
+#include "../Parallelism.h"
+#include "PageIndex.h"
 namespace chap {
 namespace Allocations {
 template <class Offset>
@@ -103,6 +105,23 @@ class Directory {
     static constexpr Offset MAX_FINDERS = 1 << NUM_FINDER_INDEX_BITS;
   };
 
+  /*
+   * This holds, in increasing order of address, some of the allocations
+   * reported by a single finder.
+   */
+  class Batch {
+   public:
+    Batch(size_t finderIndex) : _finderIndex(finderIndex) {}
+    void Add(Offset address, Offset size, bool isUsed) {
+      _allocations.emplace_back(address, size, isUsed, _finderIndex, false);
+    }
+
+   private:
+    friend class Directory;
+    size_t _finderIndex;
+    std::vector<Allocation> _allocations;
+  };
+
   /*
    * This class is used to report a sequence of allocations just once, so
    * that information can be cached in a Directory.
@@ -118,9 +137,7 @@ class Directory {
      * Return the address of the next allocation (in increasing order of
      * address) to be reported by this finder, without advancing to the next
      * allocation.  The return value is undefined if there are no more
-     * allocations available.  Note that at the time this function is called
-     * any allocations already reported by this allocation finder have already
-     * been assigned allocation indices in the Directory.
+     * allocations available.
      */
     virtual Offset NextAddress() = 0;
     /*
@@ -145,6 +162,31 @@ class Directory {
      * in an allocation of the given size.
      */
     virtual Offset MinRequestSize(Offset size) = 0;
+    /*
+     * Return the number of parts into which the allocations not yet
+     * reported can be split, where the parts are in increasing order of
+     * address and don't overlap.
+     */
+    virtual size_t NumParts() { return 1; }
+    /*
+     * Add the allocations for the given part to the batch, in increasing
+     * order of address.  The parts of all the finders are found concurrently,
+     * so a finder that uses more than one part must keep the state for each
+     * part separate, and no finder may look at the Directory here.  Once
+     * this has been called for each part the finder is not advanced again.
+     */
+    virtual void FindAllocations(size_t /* part */, Batch& batch) {
+      while (!Finished()) {
+        batch.Add(NextAddress(), NextSize(), NextIsUsed());
+        Advance();
+      }
+    }
+    /*
+     * This is called after the allocations for all the finders have been
+     * placed in the Directory, to allow any corrections, such as to the
+     * free status of allocations, that require looking up allocations.
+     */
+    virtual void AllocationsPlaced() {}
   };
 
   typedef std::function<void()> ResolutionDoneCallback;
@@ -190,27 +232,49 @@ class Directory {
     if (_allocationBoundariesResolved) {
       abort();
     }
-    std::vector<size_t> activeFinders;
+    /*
+     * Find the allocations for all the parts of all the finders, each part
+     * in a separate batch, then merge the batches and resolve any overlaps.
+     */
+    std::vector<std::pair<size_t, size_t> > parts;
     size_t numFinders = _indexToFinder.size();
-    activeFinders.reserve(numFinders);
     for (size_t i = 0; i < numFinders; i++) {
       Finder* finder = _indexToFinder[i];
       if (!(finder->Finished())) {
-        activeFinders.push_back(i);
+        size_t numParts = finder->NumParts();
+        for (size_t part = 0; part < numParts; part++) {
+          parts.emplace_back(i, part);
+        }
       }
     }
-
-    if (!activeFinders.empty()) {
-      Offset numActiveFinders = activeFinders.size();
-      if (numActiveFinders == 1) {
-        AppendRemainingAllocationsFromFinder(activeFinders[0]);
-      } else if (numActiveFinders == 2) {
-        AppendRemainingAllocationsFromFinders(activeFinders[0],
-                                              activeFinders[1]);
-      } else {
-        AppendRemainingAllocationsFromFinders(activeFinders);
+    std::vector<Batch> batches;
+    batches.reserve(parts.size());
+    for (const auto& finderAndPart : parts) {
+      batches.emplace_back(finderAndPart.first);
+    }
+    Parallelism::ForEach(parts.size(), [&](size_t i) {
+      _indexToFinder[parts[i].first]->FindAllocations(parts[i].second,
+                                                     batches[i]);
+    });
+
+    MergeBatches(batches);
+    AllocationIndex numFound = _allocations.size();
+    AllocationIndex numKept = 0;
+    for (AllocationIndex i = 0; i < numFound; i++) {
+      const Allocation found = _allocations[i];
+      if (KeepAllocation(found, numKept)) {
+        numKept++;
       }
     }
+    _allocations.erase(_allocations.begin() + numKept, _allocations.end());
+
+    _pageIndex.Build(_allocations, [](const Allocation& allocation) {
+      return !allocation.IsWrapper();
+    });
+
+    for (Finder* finder : _indexToFinder) {
+      finder->AllocationsPlaced();
+    }
 
     _allocationBoundariesResolved = true;
     for (auto& callback : _resolutionDoneCallbacks) {
@@ -235,55 +299,40 @@ class Directory {
 
   // index is same as NumAllocations() if offset is not in any range.
   AllocationIndex AllocationIndexOf(Offset addr) const {
-    size_t limit = _allocations.size();
-    size_t base = 0;
-    while (base < limit) {
-      size_t mid = (base + limit) / 2;
-      const Allocation& allocation = _allocations[mid];
-      Offset allocationAddress = allocation.Address();
-      Offset allocationLimit = allocationAddress + allocation.Size();
-      if (addr >= allocationAddress) {
-        if (addr < allocationLimit && !allocation.IsWrapper()) {
-          return (AllocationIndex)(mid);
-        } else {
-          base = mid + 1;
-        }
-      } else {
-        limit = mid;
-      }
+    if (!_pageIndex.IsBuilt()) {
+      return SearchAllocationIndexOf(addr);
     }
-    for (const std::vector<AllocationIndex>& level : _wrappers) {
-      /*
-       * If there are any wrappers, the address might be in one of them but
-       * not in any of the wrapped allocations it contains.
-       * Search progressively outward.  The most common case is that there
-       * are no wrappers at all.  The second most is that there are no wrappers
-       * that wrap other wrappers, as can happen, for example, if python
-       * allocates something using malloc() then further subdivides that thing
-       * into allocations.
-       */
-      limit = level.size();
-      base = 0;
-      while (base < limit) {
-        size_t mid = (base + limit) / 2;
-        size_t allocationIndex = level[mid];
-        const Allocation& allocation = _allocations[allocationIndex];
-        Offset allocationAddress = allocation.Address();
-        Offset allocationLimit = allocationAddress + allocation.Size();
-        if (addr >= allocationAddress) {
-          if (addr < allocationLimit) {
-            return allocationIndex;
-          } else {
-            base = mid + 1;
-          }
-        } else {
-          limit = mid;
-        }
+    AllocationIndex base;
+    AllocationIndex limit;
+    _pageIndex.Find(addr, base, limit);
+    if (base != limit) {
+      AllocationIndex index = FindUnwrappedIndexOf(addr, base, limit);
+      if (index != limit) {
+        return index;
       }
     }
-    return _allocations.size();
+    if (_wrappers.empty()) {
+      return _allocations.size();
+    }
+    return WrapperIndexOf(addr);
   }
 
+  /*
+   * This is equivalent to AllocationIndexOf but never uses the page index,
+   * which is useful mainly for comparing the cost of the two approaches.
+   */
+  AllocationIndex SearchAllocationIndexOf(Offset addr) const {
+    AllocationIndex limit = _allocations.size();
+    AllocationIndex index = FindUnwrappedIndexOf(addr, 0, limit);
+    return (index != limit) ? index : WrapperIndexOf(addr);
+  }
+
+  /*
+   * Return true if the page index used by AllocationIndexOf was built.  It
+   * is not built if the allocations are too sparse for it to be of use.
+   */
+  bool HasPageIndex() const { return _pageIndex.IsBuilt(); }
+
   // null if index is not valid.
   const Allocation* AllocationAt(AllocationIndex index) const {
     if (index < _allocations.size()) {
@@ -370,12 +419,229 @@ class Directory {
   std::vector<std::pair<AllocationIndex, Offset> > _limits;
   std::vector<std::vector<AllocationIndex> > _wrappers;
   mutable std::vector<ResolutionDoneCallback> _resolutionDoneCallbacks;
+  PageIndex<Offset, AllocationIndex> _pageIndex;
 
-  void ConsumeCurrentAllocation(size_t finderIndex, Finder* finder) {
-    Offset address = finder->NextAddress();
-    Offset size = finder->NextSize();
+  /*
+   * Return the index of the allocation, among those with indices in
+   * [base, limit), that contains the given address and is not a wrapper, or
+   * limit if there is no such allocation.  Because allocations that are not
+   * wrappers don't overlap, any range that includes the one containing the
+   * address gives the same answer.
+   */
+  AllocationIndex FindUnwrappedIndexOf(Offset addr, AllocationIndex base,
+                                       AllocationIndex limit) const {
+    AllocationIndex notFound = limit;
+    while (base < limit) {
+      AllocationIndex mid = base + (limit - base) / 2;
+      const Allocation& allocation = _allocations[mid];
+      Offset allocationAddress = allocation.Address();
+      Offset allocationLimit = allocationAddress + allocation.Size();
+      if (addr >= allocationAddress) {
+        if (addr < allocationLimit && !allocation.IsWrapper()) {
+          return mid;
+        } else {
+          base = mid + 1;
+        }
+      } else {
+        limit = mid;
+      }
+    }
+    return notFound;
+  }
+
+  /*
+   * Return the index of the innermost wrapper that contains the given
+   * address, or NumAllocations() if there is no such wrapper.
+   */
+  AllocationIndex WrapperIndexOf(Offset addr) const {
+    for (const std::vector<AllocationIndex>& level : _wrappers) {
+      /*
+       * If there are any wrappers, the address might be in one of them but
+       * not in any of the wrapped allocations it contains.
+       * Search progressively outward.  The most common case is that there
+       * are no wrappers at all.  The second most is that there are no wrappers
+       * that wrap other wrappers, as can happen, for example, if python
+       * allocates something using malloc() then further subdivides that thing
+       * into allocations.
+       */
+      size_t limit = level.size();
+      size_t base = 0;
+      while (base < limit) {
+        size_t mid = (base + limit) / 2;
+        size_t allocationIndex = level[mid];
+        const Allocation& allocation = _allocations[allocationIndex];
+        Offset allocationAddress = allocation.Address();
+        Offset allocationLimit = allocationAddress + allocation.Size();
+        if (addr >= allocationAddress) {
+          if (addr < allocationLimit) {
+            return allocationIndex;
+          } else {
+            base = mid + 1;
+          }
+        } else {
+          limit = mid;
+        }
+      }
+    }
+    return _allocations.size();
+  }
+
+  /*
+   * Return true if the first allocation of the given batch, among those not
+   * yet merged, belongs before the first such allocation of the other batch.
+   * Allocations are ordered by address, with larger allocations first so
+   * that any wrapper precedes the allocations it wraps.
+   */
+  static bool Precedes(const Batch& batch, size_t next, size_t batchIndex,
+                       const Batch& otherBatch, size_t otherNext,
+                       size_t otherBatchIndex) {
+    const Allocation& allocation = batch._allocations[next];
+    const Allocation& other = otherBatch._allocations[otherNext];
+    Offset address = allocation.Address();
+    Offset otherAddress = other.Address();
+    if (address != otherAddress) {
+      return address < otherAddress;
+    }
+    Offset size = allocation.Size();
+    Offset otherSize = other.Size();
+    if (size != otherSize) {
+      return size > otherSize;
+    }
+    return batchIndex < otherBatchIndex;
+  }
+
+  /*
+   * Return true if the given allocation belongs before any allocation with
+   * the given address and size, or at the same place.
+   */
+  static bool PrecedesKey(const Allocation& allocation,
+                          const std::pair<Offset, Offset>& key) {
+    Offset address = allocation.Address();
+    return (address < key.first) ||
+           (address == key.first && allocation.Size() > key.second);
+  }
+
+  /*
+   * Merge the allocations from all the batches, which are each in
+   * increasing order of address, into _allocations.  The output is split
+   * into chunks at keys chosen from evenly spaced samples of the batches,
+   * so that the chunks can be merged concurrently.
+   */
+  void MergeBatches(std::vector<Batch>& batches) {
+    size_t numBatches = batches.size();
+    size_t numFound = 0;
+    for (const Batch& batch : batches) {
+      numFound += batch._allocations.size();
+    }
+    size_t numChunks = Parallelism::NumChunks(numFound);
+
+    /*
+     * Each sample is weighted by the number of allocations it stands for,
+     * and the keys split the total weight as evenly as possible.
+     */
+    std::vector<std::pair<std::pair<Offset, Offset>, size_t> > samples;
+    if (numChunks > 1) {
+      for (const Batch& batch : batches) {
+        size_t numInBatch = batch._allocations.size();
+        size_t stride = numInBatch / (4 * numChunks) + 1;
+        for (size_t i = 0; i < numInBatch; i += stride) {
+          const Allocation& allocation = batch._allocations[i];
+          samples.push_back(
+              {{allocation.Address(), allocation.Size()},
+               std::min(stride, numInBatch - i)});
+        }
+      }
+      std::sort(samples.begin(), samples.end(),
+                [](const std::pair<std::pair<Offset, Offset>, size_t>& left,
+                   const std::pair<std::pair<Offset, Offset>, size_t>& right) {
+                  return (left.first.first < right.first.first) ||
+                         (left.first.first == right.first.first &&
+                          left.first.second > right.first.second);
+                });
+    }
+    std::vector<std::pair<Offset, Offset> > keys;
+    size_t weight = 0;
+    for (const auto& sample : samples) {
+      if (weight >= (numFound * (keys.size() + 1)) / numChunks) {
+        keys.push_back(sample.first);
+        if (keys.size() + 1 == numChunks) {
+          break;
+        }
+      }
+      weight += sample.second;
+    }
+    numChunks = keys.size() + 1;
+
+    /*
+     * chunkStarts[c * numBatches + b] is the index in batch b of the first
+     * allocation for chunk c.
+     */
+    std::vector<size_t> chunkStarts((numChunks + 1) * numBatches);
+    std::vector<size_t> outputStarts(numChunks + 1, 0);
+    for (size_t b = 0; b < numBatches; b++) {
+      const std::vector<Allocation>& allocations = batches[b]._allocations;
+      chunkStarts[b] = 0;
+      for (size_t c = 1; c < numChunks; c++) {
+        chunkStarts[c * numBatches + b] =
+            std::lower_bound(allocations.begin(), allocations.end(),
+                             keys[c - 1], PrecedesKey) -
+            allocations.begin();
+        outputStarts[c] += chunkStarts[c * numBatches + b];
+      }
+      chunkStarts[numChunks * numBatches + b] = allocations.size();
+    }
+    outputStarts[numChunks] = numFound;
+
+    _allocations.resize(numFound, Allocation(0, 0, false, 0, false));
+    Parallelism::ForEach(numChunks, [&](size_t chunk) {
+      std::vector<size_t> next(chunkStarts.begin() + chunk * numBatches,
+                               chunkStarts.begin() + (chunk + 1) * numBatches);
+      const size_t* limits = chunkStarts.data() + (chunk + 1) * numBatches;
+      auto follows = [&](size_t left, size_t right) {
+        return Precedes(batches[right], next[right], right, batches[left],
+                        next[left], left);
+      };
+      std::vector<size_t> heap;
+      for (size_t b = 0; b < numBatches; b++) {
+        if (next[b] < limits[b]) {
+          heap.push_back(b);
+        }
+      }
+      std::make_heap(heap.begin(), heap.end(), follows);
+      size_t out = outputStarts[chunk];
+      while (!heap.empty()) {
+        size_t top = heap[0];
+        _allocations[out++] = batches[top]._allocations[next[top]];
+        if (++next[top] == limits[top]) {
+          std::pop_heap(heap.begin(), heap.end(), follows);
+          heap.pop_back();
+          continue;
+        }
+        /*
+         * Most of the time consecutive allocations come from the same
+         * batch, in which case the heap is still in order.
+         */
+        size_t heapSize = heap.size();
+        if ((heapSize > 1 && follows(top, heap[1])) ||
+            (heapSize > 2 && follows(top, heap[2]))) {
+          std::pop_heap(heap.begin(), heap.end(), follows);
+          std::push_heap(heap.begin(), heap.end(), follows);
+        }
+      }
+    });
+    batches.clear();
+  }
+
+  /*
+   * Keep the given allocation, which is next in order of address, at the
+   * given index, noting any wrapper that contains it, unless it overlaps
+   * some allocation already kept without being contained by it, in which
+   * case return false.
+   */
+  bool KeepAllocation(const Allocation& found, AllocationIndex index) {
+    Offset address = found.Address();
+    Offset size = found.Size();
     Offset limit = address + size;
-    bool isUsed = finder->NextIsUsed();
     bool isWrapped = false;
     while (!_limits.empty() && limit > _limits.back().second) {
       if (address < _limits.back().second) {
@@ -384,8 +650,7 @@ class Directory {
                   << ")\n... due to overlap with allocation at [0x" << std::hex
                   << _allocations[_limits.back().first].Address() << ", 0x"
                   << _limits.back().second << ")\n";
-        finder->Advance();
-        return;
+        return false;
       }
       _limits.pop_back();
     }
@@ -425,181 +690,13 @@ class Directory {
         }
       }
     }
-    _limits.emplace_back(_allocations.size(), limit);
-    _allocations.emplace_back(address, size, isUsed, finderIndex, isWrapped);
+    _limits.emplace_back(index, limit);
+    _allocations[index] = Allocation(address, size, found.IsUsed(),
+                                     found.FinderIndex(), isWrapped);
     if (_maxAllocationSize < size) {
       _maxAllocationSize = size;
     }
-    finder->Advance();
-  }
-  void AppendRemainingAllocationsFromFinder(size_t finderIndex) {
-    Finder* finder = _indexToFinder[finderIndex];
-    while (!(finder->Finished())) {
-      ConsumeCurrentAllocation(finderIndex, finder);
-    }
-  }
-  void AppendRemainingAllocationsFromFinders(size_t finderIndex0,
-                                             size_t finderIndex1) {
-    Finder* finder0 = _indexToFinder[finderIndex0];
-    Offset address0 = finder0->NextAddress();
-    Offset size0 = finder0->NextSize();
-
-    Finder* finder1 = _indexToFinder[finderIndex1];
-    Offset address1 = finder1->NextAddress();
-    Offset size1 = finder1->NextSize();
-
-    while (true) {
-      if (address0 < address1 || (address0 == address1 && size0 > size1)) {
-        ConsumeCurrentAllocation(finderIndex0, finder0);
-        if (finder0->Finished()) {
-          AppendRemainingAllocationsFromFinder(finderIndex1);
-          return;
-        }
-        address0 = finder0->NextAddress();
-        size0 = finder0->NextSize();
-      } else {
-        ConsumeCurrentAllocation(finderIndex1, finder1);
-        if (finder1->Finished()) {
-          AppendRemainingAllocationsFromFinder(finderIndex0);
-          return;
-        }
-        address1 = finder1->NextAddress();
-        size1 = finder1->NextSize();
-      }
-    }
-  }
-
-  void Place(Offset address, Offset size, size_t finderIndex,
-             std::vector<size_t>& activeFinders, size_t heapIndex) {
-    Offset heapSize = activeFinders.size();
-    Offset leftChild = 2 * heapIndex + 1;
-    Offset rightChild = leftChild + 1;
-    while (rightChild < heapSize) {
-      size_t leftFinderIndex = activeFinders[leftChild];
-      Finder* leftFinder = _indexToFinder[leftFinderIndex];
-      Offset leftAddress = leftFinder->NextAddress();
-      Offset leftSize = leftFinder->NextSize();
-      size_t rightFinderIndex = activeFinders[rightChild];
-      Finder* rightFinder = _indexToFinder[rightFinderIndex];
-      Offset rightAddress = rightFinder->NextAddress();
-      Offset rightSize = rightFinder->NextSize();
-      if (leftAddress < rightAddress ||
-          (leftAddress == rightAddress && leftSize > rightSize)) {
-        if (address < leftAddress ||
-            (address == leftAddress && address >= leftSize)) {
-          activeFinders[heapIndex] = finderIndex;
-          return;
-        }
-        activeFinders[heapIndex] = leftFinderIndex;
-        heapIndex = leftChild;
-      } else {
-        if (address < rightAddress ||
-            (address == rightAddress && address >= rightSize)) {
-          activeFinders[heapIndex] = finderIndex;
-          return;
-        }
-        activeFinders[heapIndex] = rightFinderIndex;
-        heapIndex = rightChild;
-      }
-    }
-    if (leftChild < heapSize) {
-      size_t leftFinderIndex = activeFinders[leftChild];
-      Finder* leftFinder = _indexToFinder[leftFinderIndex];
-      Offset leftAddress = leftFinder->NextAddress();
-      if ((address < leftAddress ||
-           (address == leftAddress && size > leftFinder->NextSize()))) {
-        activeFinders[heapIndex] = finderIndex;
-      } else {
-        activeFinders[heapIndex] = leftFinderIndex;
-        activeFinders[leftChild] = finderIndex;
-      }
-    } else {
-      activeFinders[heapIndex] = finderIndex;
-    }
-  }
-
-  void AppendRemainingAllocationsFromFinders(
-      std::vector<size_t>& activeFinders) {
-    size_t numActiveFinders = activeFinders.size();
-    std::make_heap(activeFinders.begin(), activeFinders.end(),
-                   [this](const size_t left, const size_t right) {
-                     Finder* leftFinder = this->_indexToFinder[left];
-                     Finder* rightFinder = this->_indexToFinder[right];
-                     Offset leftAddress = leftFinder->NextAddress();
-                     Offset rightAddress = rightFinder->NextAddress();
-                     return (leftAddress > rightAddress) ||
-                            ((leftAddress == rightAddress) &&
-                             leftFinder->NextSize() < rightFinder->NextSize());
-                   });
-    size_t topFinderIndex = activeFinders[0];
-    Finder* topFinder = _indexToFinder[topFinderIndex];
-    Offset topAddress = topFinder->NextAddress();
-    Offset topSize = topFinder->NextSize();
-
-    Finder* leftFinder = _indexToFinder[activeFinders[1]];
-    Offset leftAddress = leftFinder->NextAddress();
-    Offset leftSize = leftFinder->NextSize();
-
-    Finder* rightFinder = _indexToFinder[activeFinders[2]];
-    Offset rightAddress = rightFinder->NextAddress();
-    Offset rightSize = rightFinder->NextSize();
-
-    bool leftIsNext = (leftAddress < rightAddress) ||
-                      (leftAddress == rightAddress && leftSize >= rightSize);
-    Offset nextAddress = leftIsNext ? leftAddress : rightAddress;
-    Offset nextSize = leftIsNext ? leftSize : rightSize;
-
-    while (true) {
-      ConsumeCurrentAllocation(topFinderIndex, topFinder);
-      if (topFinder->Finished()) {
-        size_t lastFinderIndex = activeFinders[numActiveFinders - 1];
-        activeFinders.pop_back();
-        if (--numActiveFinders == 2) {
-          AppendRemainingAllocationsFromFinders(lastFinderIndex,
-                                                activeFinders[1]);
-          return;
-        }
-        activeFinders[0] = lastFinderIndex;
-        topFinderIndex = lastFinderIndex;
-        topFinder = _indexToFinder[topFinderIndex];
-      }
-      topAddress = topFinder->NextAddress();
-      topSize = topFinder->NextSize();
-      if (nextAddress < topAddress ||
-          (nextAddress == topAddress && nextSize > topSize)) {
-        /*
-         * The top finder is no longer in the correct place.  This is expected
-         * not to happen all that often because many consecutive allocations
-         * will be from the same finder.
-         */
-        Offset address = topAddress;
-        Offset size = topSize;
-        Offset finderIndex = topFinderIndex;
-        topAddress = nextAddress;
-        topSize = nextSize;
-        if (leftIsNext) {
-          topFinderIndex = activeFinders[1];
-          activeFinders[0] = topFinderIndex;
-          topFinder = leftFinder;
-          Place(address, size, finderIndex, activeFinders, 1);
-          leftFinder = _indexToFinder[activeFinders[1]];
-          leftAddress = leftFinder->NextAddress();
-          leftSize = leftFinder->NextSize();
-        } else {
-          topFinderIndex = activeFinders[2];
-          activeFinders[0] = topFinderIndex;
-          topFinder = rightFinder;
-          Place(address, size, finderIndex, activeFinders, 2);
-          rightFinder = _indexToFinder[activeFinders[2]];
-          rightAddress = rightFinder->NextAddress();
-          rightSize = rightFinder->NextSize();
-        }
-        leftIsNext = (leftAddress < rightAddress) ||
-                     (leftAddress == rightAddress && leftSize >= rightSize);
-        nextAddress = leftIsNext ? leftAddress : rightAddress;
-        nextSize = leftIsNext ? leftSize : rightSize;
-      }
-    }
+    return true;
   }
 };
 }  // namespace Allocations
@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "../AnalysisCache.h"
+namespace chap {
+namespace Allocations {
+/*
+ * This holds a non-decreasing sequence of edge indices, such as the index
+ * of the first outgoing edge for each allocation, using 32 bits per value
+ * whenever the last value fits in 32 bits and the full width of EdgeIndex
+ * otherwise.  Graphs with more than 2^32 edges are rare enough that the
+ * narrow form is nearly always used.
+ */
+template <typename EdgeIndex>
+class EdgeIndices {
+ public:
+  EdgeIndices() : _isNarrow(true) {}
+
+  /*
+   * Take the given values, leaving the vector empty.
+   */
+  void Assign(std::vector<EdgeIndex> &values) {
+    _isNarrow = values.empty() || values.back() <= (EdgeIndex)UINT32_MAX;
+    std::vector<uint32_t> narrow;
+    std::vector<EdgeIndex> wide;
+    if (_isNarrow) {
+      narrow.reserve(values.size());
+      narrow.assign(values.begin(), values.end());
+      std::vector<EdgeIndex>().swap(values);
+    } else {
+      wide.swap(values);
+    }
+    _narrow.swap(narrow);
+    _wide.swap(wide);
+  }
+
+  size_t size() const { return _isNarrow ? _narrow.size() : _wide.size(); }
+
+  EdgeIndex operator[](size_t i) const {
+    return _isNarrow ? (EdgeIndex)_narrow[i] : _wide[i];
+  }
+
+  /*
+   * Return true if the values are held in 32 bits each, in which case they
+   * are accessible by Narrow() and otherwise by Wide().
+   */
+  bool IsNarrow() const { return _isNarrow; }
+  const std::vector<uint32_t> &Narrow() const { return _narrow; }
+  const std::vector<EdgeIndex> &Wide() const { return _wide; }
+
+  void Save(CacheWriter &writer) const {
+    writer.Put((uint16_t)(_isNarrow ? 32 : 64));
+    if (_isNarrow) {
+      writer.PutVector(_narrow);
+    } else {
+      writer.PutVector(_wide);
+    }
+  }
+
+  void Restore(CacheReader &reader) {
+    uint16_t valueBits = reader.Get<uint16_t>();
+    if (valueBits == 32) {
+      reader.GetVector(_narrow);
+      _wide.clear();
+      _isNarrow = true;
+    } else if (valueBits == 64 && sizeof(EdgeIndex) == 8) {
+      reader.GetVector(_wide);
+      _narrow.clear();
+      _isNarrow = false;
+    } else {
+      throw CacheReader::Invalid();
+    }
+  }
+
+ private:
+  bool _isNarrow;
+  std::vector<uint32_t> _narrow;
+  std::vector<EdgeIndex> _wide;
+};
+}  // namespace Allocations
+}  // namespace chap
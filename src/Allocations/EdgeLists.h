@@ -0,0 +1,614 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "../AnalysisCache.h"
+#include "../Parallelism.h"
+#include "EdgeIndices.h"
+namespace chap {
+namespace Allocations {
+/*
+ * This holds the process-wide choice, set by the -z switch, of whether the
+ * lists of edges in a Graph are compressed.
+ */
+class EdgeListCompression {
+ public:
+  static bool IsEnabled() { return _isEnabled; }
+  static void SetEnabled(bool isEnabled) { _isEnabled = isEnabled; }
+
+ private:
+  static inline bool _isEnabled = false;
+};
+
+/*
+ * This holds, for each node of a graph, the sorted list of the nodes at the
+ * other ends of its edges (in one direction), where the edges are numbered
+ * consecutively across the lists.  The lists are kept either as plain
+ * indices or, if EdgeListCompression is enabled at the time they are
+ * assigned, compressed.
+ *
+ * A compressed list is stored as the difference between the first value and
+ * the node itself, followed by the differences between successive values,
+ * in the format known as Stream VByte: groups of 4 values are described by
+ * a control byte giving the number of bytes (1 to 4) used for each value,
+ * with the control bytes for a list preceding the bytes for its values.
+ * Because allocations tend to refer to nearby allocations most values take
+ * a single byte.  A group is decoded with a single SSSE3 shuffle if the CPU
+ * supports it.
+ *
+ * The lists are read through iterators, which also give the index of each
+ * edge.  Access to an edge by index alone, or to some value in the middle
+ * of a list, is slower for compressed lists, which must be decoded from the
+ * start of the list or, for a long list, from the nearest preceding skip
+ * point, where a skip point is kept for every GROUPS_PER_SKIP groups.
+ */
+template <typename Index, typename EdgeIndex>
+class EdgeLists {
+  static_assert(sizeof(Index) == sizeof(uint32_t),
+                "Compressed edge lists assume 32-bit node indices.");
+  static constexpr uint32_t VALUES_PER_GROUP = 4;
+  /*
+   * A group is decoded by loading 16 bytes at once, so the encoded lists are
+   * followed by enough padding that this never reads past the end.
+   */
+  static constexpr size_t DECODE_PADDING = 16;
+  static constexpr uint32_t GROUPS_PER_SKIP = 16;
+  static constexpr uint32_t VALUES_PER_SKIP =
+      GROUPS_PER_SKIP * VALUES_PER_GROUP;
+
+ public:
+  class const_iterator {
+   public:
+    const_iterator()
+        : _edge(0),
+          _limit(0),
+          _plain(nullptr),
+          _control(nullptr),
+          _data(nullptr),
+          _position(0),
+          _value(0) {}
+
+    Index operator*() const { return _value; }
+    EdgeIndex Edge() const { return _edge; }
+
+    const_iterator &operator++() {
+      if (++_edge != _limit) {
+        if (_plain != nullptr) {
+          _value = *(++_plain);
+        } else {
+          if (++_position == VALUES_PER_GROUP) {
+            DecodeGroup(_value);
+          }
+          _value = _values[_position];
+        }
+      }
+      return *this;
+    }
+
+    bool operator==(const const_iterator &other) const {
+      return _edge == other._edge;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return _edge != other._edge;
+    }
+
+   private:
+    friend class EdgeLists;
+    EdgeIndex _edge;
+    EdgeIndex _limit;
+    const Index *_plain;
+    const uint8_t *_control;
+    const uint8_t *_data;
+    uint32_t _position;
+    Index _value;
+    Index _values[VALUES_PER_GROUP];
+
+    /*
+     * Decode the next group of values, which follow the given value.
+     */
+    void DecodeGroup(Index previous) {
+      uint8_t control = *(_control++);
+      _data = Decode(control, _data, _values);
+      for (uint32_t i = 0; i < VALUES_PER_GROUP; i++) {
+        previous += _values[i];
+        _values[i] = previous;
+      }
+      _position = 0;
+    }
+  };
+
+  /*
+   * This allows the list for one node to be used in a range-based for loop.
+   */
+  class Range {
+   public:
+    Range() {}
+    Range(const const_iterator &begin, const const_iterator &end)
+        : _begin(begin), _end(end) {}
+    const const_iterator &begin() const { return _begin; }
+    const const_iterator &end() const { return _end; }
+    EdgeIndex size() const { return _end.Edge() - _begin.Edge(); }
+
+   private:
+    const_iterator _begin;
+    const_iterator _end;
+  };
+
+  EdgeLists() : _isCompressed(false), _numEdges(0) {}
+
+  /*
+   * Take the given lists, where the list for node i is in
+   * values[firstEdges[i], firstEdges[i + 1]), leaving both vectors empty.
+   */
+  void Assign(std::vector<EdgeIndex> &firstEdges, std::vector<Index> &values) {
+    _numEdges = values.size();
+    _isCompressed = EdgeListCompression::IsEnabled() && !firstEdges.empty();
+    std::vector<Index> plain;
+    std::vector<uint8_t> bytes;
+    if (_isCompressed) {
+      Compress(firstEdges, values, bytes);
+      std::vector<Index>().swap(values);
+    } else {
+      plain.swap(values);
+    }
+    _plain.swap(plain);
+    _bytes.swap(bytes);
+    _firstEdges.Assign(firstEdges);
+    if (_isCompressed) {
+      FindSkips();
+    }
+  }
+
+  bool IsCompressed() const { return _isCompressed; }
+
+  /*
+   * Return the number of entries in the table of first edges, which is one
+   * more than the number of nodes, or 0 if there are no nodes.
+   */
+  size_t NumFirstEdges() const { return _firstEdges.size(); }
+  EdgeIndex NumEdges() const { return _numEdges; }
+
+  EdgeIndex FirstEdge(Index node) const { return _firstEdges[node]; }
+  EdgeIndex NumEdges(Index node) const {
+    return _firstEdges[node + 1] - _firstEdges[node];
+  }
+
+  const_iterator begin(Index node) const {
+    const_iterator it;
+    it._edge = _firstEdges[node];
+    it._limit = _firstEdges[node + 1];
+    if (it._edge == it._limit) {
+      return it;
+    }
+    if (!_isCompressed) {
+      it._plain = _plain.data() + it._edge;
+      it._value = *(it._plain);
+      return it;
+    }
+    it._control = _bytes.data() + _byteStarts[node];
+    it._data = it._control +
+               (it._limit - it._edge + VALUES_PER_GROUP - 1) / VALUES_PER_GROUP;
+    uint8_t control = *(it._control++);
+    it._data = Decode(control, it._data, it._values);
+    Index previous = node + UnZigZag(it._values[0]);
+    it._values[0] = previous;
+    for (uint32_t i = 1; i < VALUES_PER_GROUP; i++) {
+      previous += it._values[i];
+      it._values[i] = previous;
+    }
+    it._value = it._values[0];
+    return it;
+  }
+
+  const_iterator end(Index node) const {
+    const_iterator it;
+    it._edge = _firstEdges[node + 1];
+    it._limit = it._edge;
+    return it;
+  }
+
+  Range GetRange(Index node) const { return Range(begin(node), end(node)); }
+
+  /*
+   * This gives the same access as EdgeLists to lists that are not
+   * compressed, given the form in which the first edges are held, so that
+   * the innermost loops of a traversal need not check either form.
+   */
+  template <typename FirstEdges>
+  class PlainView {
+   public:
+    PlainView(const FirstEdges &firstEdges, const std::vector<Index> &values)
+        : _firstEdges(firstEdges), _values(values.data()) {}
+    EdgeIndex NumEdges(Index node) const {
+      return _firstEdges[node + 1] - _firstEdges[node];
+    }
+    const Index *begin(Index node) const {
+      return _values + _firstEdges[node];
+    }
+    const Index *end(Index node) const {
+      return _values + _firstEdges[node + 1];
+    }
+
+   private:
+    const FirstEdges &_firstEdges;
+    const Index *_values;
+  };
+
+  /*
+   * Call f with either a PlainView of the lists, if they are not compressed,
+   * or the lists themselves.
+   */
+  template <typename Function>
+  void WithFastestView(Function f) const {
+    if (_isCompressed) {
+      f(*this);
+    } else if (_firstEdges.IsNarrow()) {
+      f(PlainView<std::vector<uint32_t> >(_firstEdges.Narrow(), _plain));
+    } else {
+      f(PlainView<std::vector<EdgeIndex> >(_firstEdges.Wide(), _plain));
+    }
+  }
+
+  /*
+   * Return an iterator for the edge, in the list for the given node, for
+   * which compare(value) returns 0, or the end of the list if there is no
+   * such edge.  The compare function must return a negative number for all
+   * values before any such edge and a positive number for all values after.
+   */
+  template <typename Compare>
+  const_iterator Find(Index node, Compare compare) const {
+    if (_isCompressed) {
+      const_iterator itEnd = end(node);
+      const Skip *skip = nullptr;
+      const Skip *skipsBegin;
+      const Skip *skipsEnd;
+      if (GetSkips(node, skipsBegin, skipsEnd)) {
+        /*
+         * Start from the last skip point preceded by a value that is before
+         * any match.
+         */
+        const Skip *base = skipsBegin;
+        const Skip *limit = skipsEnd;
+        while (base < limit) {
+          const Skip *mid = base + (limit - base) / 2;
+          if (compare(mid->_previous) < 0) {
+            skip = mid;
+            base = mid + 1;
+          } else {
+            limit = mid;
+          }
+        }
+      }
+      const_iterator it = (skip == nullptr)
+                              ? begin(node)
+                              : AtSkip(node, skip - skipsBegin, *skip);
+      for (; it != itEnd; ++it) {
+        int comparison = compare(*it);
+        if (comparison == 0) {
+          return it;
+        }
+        if (comparison > 0) {
+          break;
+        }
+      }
+      return itEnd;
+    }
+    EdgeIndex base = _firstEdges[node];
+    EdgeIndex limit = _firstEdges[node + 1];
+    while (base < limit) {
+      EdgeIndex mid = base + (limit - base) / 2;
+      int comparison = compare(_plain[mid]);
+      if (comparison == 0) {
+        const_iterator it = end(node);
+        it._edge = mid;
+        it._plain = _plain.data() + mid;
+        it._value = _plain[mid];
+        return it;
+      }
+      if (comparison < 0) {
+        base = mid + 1;
+      } else {
+        limit = mid;
+      }
+    }
+    return end(node);
+  }
+
+  /*
+   * Return the value for the given edge, which must be valid.
+   */
+  Index At(EdgeIndex edge) const {
+    if (!_isCompressed) {
+      return _plain[edge];
+    }
+    Index base = 0;
+    Index limit = _firstEdges.size() - 1;
+    while (limit - base > 1) {
+      Index mid = base + (limit - base) / 2;
+      if (_firstEdges[mid] <= edge) {
+        base = mid;
+      } else {
+        limit = mid;
+      }
+    }
+    const_iterator it = begin(base);
+    const Skip *skipsBegin;
+    const Skip *skipsEnd;
+    if (GetSkips(base, skipsBegin, skipsEnd)) {
+      EdgeIndex skipIndex = (edge - _firstEdges[base]) / VALUES_PER_SKIP;
+      if (skipIndex > 0) {
+        it = AtSkip(base, skipIndex - 1, skipsBegin[skipIndex - 1]);
+      }
+    }
+    while (it.Edge() != edge) {
+      ++it;
+    }
+    return *it;
+  }
+
+  void Save(CacheWriter &writer) const {
+    _firstEdges.Save(writer);
+    writer.Put(_numEdges);
+    writer.Put((uint8_t)(_isCompressed ? 1 : 0));
+    if (_isCompressed) {
+      _byteStarts.Save(writer);
+      writer.PutVector(_bytes);
+    } else {
+      writer.PutVector(_plain);
+    }
+  }
+
+  void Restore(CacheReader &reader) {
+    _firstEdges.Restore(reader);
+    _numEdges = reader.Get<EdgeIndex>();
+    _isCompressed = reader.Get<uint8_t>() != 0;
+    size_t numFirstEdges = _firstEdges.size();
+    if ((numFirstEdges == 0) ? (_numEdges != 0)
+                             : (_firstEdges[numFirstEdges - 1] != _numEdges)) {
+      throw CacheReader::Invalid();
+    }
+    if (_isCompressed) {
+      _byteStarts.Restore(reader);
+      reader.GetVector(_bytes);
+      if (_byteStarts.size() != numFirstEdges || numFirstEdges == 0 ||
+          _bytes.size() != _byteStarts[numFirstEdges - 1] + DECODE_PADDING) {
+        throw CacheReader::Invalid();
+      }
+      FindSkips();
+    } else {
+      reader.GetVector(_plain);
+      if (_plain.size() != _numEdges) {
+        throw CacheReader::Invalid();
+      }
+    }
+  }
+
+ private:
+  bool _isCompressed;
+  EdgeIndex _numEdges;
+  EdgeIndices<EdgeIndex> _firstEdges;
+  std::vector<Index> _plain;
+  EdgeIndices<uint64_t> _byteStarts;
+  std::vector<uint8_t> _bytes;
+  /*
+   * This gives the last value before a skip point and the offset from the
+   * start of the list of the data for the group at the skip point.
+   */
+  struct Skip {
+    Index _previous;
+    uint64_t _dataOffset;
+  };
+  std::vector<Skip> _skips;
+  /*
+   * This holds, for each node with skip points, in increasing order of node,
+   * the node and the index of its first skip point, followed by an entry
+   * for the number of nodes and the number of skip points.
+   */
+  std::vector<std::pair<Index, size_t> > _firstSkips;
+
+  struct DecodeTables {
+    DecodeTables() {
+      for (uint32_t control = 0; control < 256; control++) {
+        uint8_t next = 0;
+        for (uint32_t i = 0; i < VALUES_PER_GROUP; i++) {
+          uint32_t numBytes = ((control >> (2 * i)) & 3) + 1;
+          for (uint32_t j = 0; j < 4; j++) {
+            _shuffles[control][4 * i + j] =
+                (j < numBytes) ? (uint8_t)(next + j) : (uint8_t)0x80;
+          }
+          next += numBytes;
+        }
+        _groupSizes[control] = next;
+      }
+    }
+    uint8_t _shuffles[256][16];
+    uint8_t _groupSizes[256];
+  };
+
+  static const DecodeTables &GetDecodeTables() {
+    static const DecodeTables decodeTables;
+    return decodeTables;
+  }
+
+  static uint32_t ZigZag(Index value) {
+    int32_t asSigned = (int32_t)value;
+    return ((uint32_t)asSigned << 1) ^ (uint32_t)(asSigned >> 31);
+  }
+
+  static Index UnZigZag(uint32_t value) {
+    return (Index)((value >> 1) ^ (0 - (value & 1)));
+  }
+
+  static uint32_t NumBytesFor(uint32_t value) {
+    return (value < 0x100)       ? 1
+           : (value < 0x10000)   ? 2
+           : (value < 0x1000000) ? 3
+                                 : 4;
+  }
+
+  /*
+   * Decode the 4 values described by the given control byte, starting at the
+   * given data, and return the address just past the bytes used.
+   */
+  static const uint8_t *Decode(uint8_t control, const uint8_t *data,
+                               uint32_t *values) {
+    const DecodeTables &decodeTables = GetDecodeTables();
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool hasSSSE3 = __builtin_cpu_supports("ssse3");
+    if (hasSSSE3) {
+      DecodeSSSE3(data, decodeTables._shuffles[control], values);
+      return data + decodeTables._groupSizes[control];
+    }
+#endif
+    for (uint32_t i = 0; i < VALUES_PER_GROUP; i++) {
+      uint32_t numBytes = ((control >> (2 * i)) & 3) + 1;
+      uint32_t value = 0;
+      for (uint32_t j = 0; j < numBytes; j++) {
+        value |= ((uint32_t)data[j]) << (8 * j);
+      }
+      values[i] = value;
+      data += numBytes;
+    }
+    return data;
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  __attribute__((target("ssse3"))) static void DecodeSSSE3(
+      const uint8_t *data, const uint8_t *shuffle, uint32_t *values) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)data);
+    __m128i mask = _mm_loadu_si128((const __m128i *)shuffle);
+    _mm_storeu_si128((__m128i *)values, _mm_shuffle_epi8(bytes, mask));
+  }
+#endif
+
+  /*
+   * Return the value to be encoded at the given position in the list for
+   * the given node.
+   */
+  static uint32_t EncodedValue(const std::vector<Index> &values, Index node,
+                               EdgeIndex first, EdgeIndex edge) {
+    return (edge == first) ? ZigZag(values[edge] - node)
+                           : (uint32_t)(values[edge] - values[edge - 1]);
+  }
+
+  void Compress(const std::vector<EdgeIndex> &firstEdges,
+                const std::vector<Index> &values, std::vector<uint8_t> &bytes) {
+    Index numNodes = firstEdges.size() - 1;
+    std::vector<uint64_t> byteStarts(firstEdges.size(), 0);
+    Parallelism::ForEach(numNodes, [&](Index node) {
+      EdgeIndex first = firstEdges[node];
+      EdgeIndex limit = firstEdges[node + 1];
+      if (first == limit) {
+        return;
+      }
+      EdgeIndex numValues = limit - first;
+      uint64_t numGroups =
+          (numValues + VALUES_PER_GROUP - 1) / VALUES_PER_GROUP;
+      uint64_t size = numGroups * (VALUES_PER_GROUP + 1) - numValues;
+      for (EdgeIndex edge = first; edge < limit; edge++) {
+        size += NumBytesFor(EncodedValue(values, node, first, edge));
+      }
+      byteStarts[node + 1] = size;
+    });
+    Parallelism::InclusiveScan(byteStarts);
+    bytes.resize(byteStarts[numNodes] + DECODE_PADDING, 0);
+    Parallelism::ForEach(numNodes, [&](Index node) {
+      EdgeIndex first = firstEdges[node];
+      EdgeIndex limit = firstEdges[node + 1];
+      uint8_t *control = bytes.data() + byteStarts[node];
+      uint8_t *data =
+          control + (limit - first + VALUES_PER_GROUP - 1) / VALUES_PER_GROUP;
+      for (EdgeIndex groupStart = first; groupStart < limit;
+           groupStart += VALUES_PER_GROUP) {
+        uint8_t groupControl = 0;
+        for (uint32_t i = 0; i < VALUES_PER_GROUP; i++) {
+          EdgeIndex edge = groupStart + i;
+          uint32_t value =
+              (edge < limit) ? EncodedValue(values, node, first, edge) : 0;
+          uint32_t numBytes = NumBytesFor(value);
+          groupControl |= (uint8_t)((numBytes - 1) << (2 * i));
+          for (uint32_t j = 0; j < numBytes; j++) {
+            *(data++) = (uint8_t)(value >> (8 * j));
+          }
+        }
+        *(control++) = groupControl;
+      }
+    });
+    _byteStarts.Assign(byteStarts);
+  }
+
+  /*
+   * Record a skip point for every GROUPS_PER_SKIP groups of each long list,
+   * after the first such groups, so that a search of the list need not
+   * decode it from the start.
+   */
+  void FindSkips() {
+    std::vector<Skip>().swap(_skips);
+    std::vector<std::pair<Index, size_t> >().swap(_firstSkips);
+    Index numNodes = _firstEdges.size() - 1;
+    for (Index node = 0; node < numNodes; node++) {
+      EdgeIndex numEdges = NumEdges(node);
+      if (numEdges <= VALUES_PER_SKIP) {
+        continue;
+      }
+      _firstSkips.emplace_back(node, _skips.size());
+      const uint8_t *listStart = _bytes.data() + _byteStarts[node];
+      const_iterator it = begin(node);
+      for (EdgeIndex i = 1; i < numEdges; i++, ++it) {
+        if (i % VALUES_PER_SKIP == 0) {
+          /*
+           * The last group decoded ends where the next one starts.
+           */
+          _skips.push_back({*it, (uint64_t)(it._data - listStart)});
+        }
+      }
+    }
+    _firstSkips.emplace_back(numNodes, _skips.size());
+  }
+
+  /*
+   * Give the skip points for the given node, returning false if there are
+   * none.
+   */
+  bool GetSkips(Index node, const Skip *&skipsBegin,
+                const Skip *&skipsEnd) const {
+    auto it = std::lower_bound(
+        _firstSkips.begin(), _firstSkips.end(), node,
+        [](const std::pair<Index, size_t> &entry, Index value) {
+          return entry.first < value;
+        });
+    if (it == _firstSkips.end() || it->first != node) {
+      return false;
+    }
+    skipsBegin = _skips.data() + it->second;
+    skipsEnd = _skips.data() + (it + 1)->second;
+    return true;
+  }
+
+  /*
+   * Return an iterator for the first edge after the given skip point, which
+   * has the given index among the skip points for the given node.
+   */
+  const_iterator AtSkip(Index node, size_t skipIndex, const Skip &skip) const {
+    const_iterator it;
+    const uint8_t *listStart = _bytes.data() + _byteStarts[node];
+    it._edge = _firstEdges[node] + (skipIndex + 1) * VALUES_PER_SKIP;
+    it._limit = _firstEdges[node + 1];
+    it._control = listStart + (skipIndex + 1) * GROUPS_PER_SKIP;
+    it._data = listStart + skip._dataOffset;
+    it.DecodeGroup(skip._previous);
+    it._value = it._values[0];
+    return it;
+  }
+};
+}  // namespace Allocations
+}  // namespace chap
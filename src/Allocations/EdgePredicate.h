@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <mutex>
 #include <vector>
 #include "Graph.h"
 
@@ -21,38 +22,84 @@ class EdgePredicate {
     _valueByIncomingEdgeIndex.resize((size_t)_totalEdges, defaultValue);
   }
 
+  /*
+   * While allocations are being tagged, values are set only by outgoing edge,
+   * because finding the incoming edge for a given source and target requires
+   * a search of the list of sources of the target, which is linear if the
+   * edges are compressed.  SetIncomingFromOutgoing must be called once the
+   * tagging is done, before any value is read by incoming edge.
+   */
   void SetAllOutgoing(Index source, bool value) {
-    EdgeIndex firstOutgoing, pastOutgoing;
-    _graph.GetOutgoing(source, firstOutgoing, pastOutgoing);
-    for (EdgeIndex outgoing = firstOutgoing; outgoing != pastOutgoing;
-         outgoing++) {
-      EdgeIndex incoming = _graph.GetIncomingEdgeIndex(
-          source, _graph.GetTargetForOutgoing(outgoing));
-      _valueByOutgoingEdgeIndex[outgoing] = value;
-      _valueByIncomingEdgeIndex[incoming] = value;
+    std::lock_guard<std::mutex> guard(_mutex);
+    typename Graph<Offset>::EdgeRange targets = _graph.GetOutgoing(source);
+    for (auto it = targets.begin(); it != targets.end(); ++it) {
+      _valueByOutgoingEdgeIndex[it.Edge()] = value;
     }
   }
 
   void SetAllIncoming(Index target, bool value) {
-    EdgeIndex firstIncoming, pastIncoming;
-    _graph.GetIncoming(target, firstIncoming, pastIncoming);
-    for (EdgeIndex incoming = firstIncoming; incoming != pastIncoming;
-         incoming++) {
-      EdgeIndex outgoing = _graph.GetOutgoingEdgeIndex(
-          _graph.GetSourceForIncoming(incoming), target);
-      _valueByIncomingEdgeIndex[incoming] = value;
+    std::lock_guard<std::mutex> guard(_mutex);
+    typename Graph<Offset>::EdgeRange sources = _graph.GetIncoming(target);
+    for (auto it = sources.begin(); it != sources.end(); ++it) {
+      EdgeIndex outgoing = _graph.GetOutgoingEdgeIndex(*it, target);
       _valueByOutgoingEdgeIndex[outgoing] = value;
     }
   }
 
   void Set(Index source, Index target, bool value) {
-    EdgeIndex incoming = _graph.GetIncomingEdgeIndex(source, target);
-    if (incoming == _totalEdges) {
+    SetForOutgoing(_graph.GetOutgoingEdgeIndex(source, target), value);
+  }
+
+  /*
+   * Set the value for the given outgoing edge, for a caller that already has
+   * the edge from an iterator.
+   */
+  void SetForOutgoing(EdgeIndex outgoing, bool value) {
+    if (outgoing == _totalEdges) {
       return;
     }
-    _valueByIncomingEdgeIndex[incoming] = value;
-    _valueByOutgoingEdgeIndex[_graph.GetOutgoingEdgeIndex(source, target)] =
-        value;
+    std::lock_guard<std::mutex> guard(_mutex);
+    _valueByOutgoingEdgeIndex[outgoing] = value;
+  }
+
+  /*
+   * Make the values by incoming edge match the values by outgoing edge, in
+   * one pass over the outgoing edges.  The sources of the incoming edges of
+   * each target are in increasing order, so the sources are visited in the
+   * same order as the incoming edges of each target.
+   */
+  void SetIncomingFromOutgoing() {
+    Index numAllocations = _graph.GetAllocationDirectory().NumAllocations();
+    std::vector<EdgeIndex> nextIncoming;
+    nextIncoming.reserve(numAllocations);
+    for (Index target = 0; target < numAllocations; target++) {
+      nextIncoming.push_back(_graph.GetIncoming(target).begin().Edge());
+    }
+    for (Index source = 0; source < numAllocations; source++) {
+      typename Graph<Offset>::EdgeRange targets = _graph.GetOutgoing(source);
+      for (auto it = targets.begin(); it != targets.end(); ++it) {
+        _valueByIncomingEdgeIndex[nextIncoming[*it]++] =
+            _valueByOutgoingEdgeIndex[it.Edge()];
+      }
+    }
+  }
+
+  void Save(CacheWriter& writer) const {
+    writer.PutBits(_valueByOutgoingEdgeIndex);
+    writer.PutBits(_valueByIncomingEdgeIndex);
+  }
+
+  void Restore(CacheReader& reader) {
+    std::vector<bool> valueByOutgoingEdgeIndex;
+    std::vector<bool> valueByIncomingEdgeIndex;
+    reader.GetBits(valueByOutgoingEdgeIndex);
+    reader.GetBits(valueByIncomingEdgeIndex);
+    if (valueByOutgoingEdgeIndex.size() != _totalEdges ||
+        valueByIncomingEdgeIndex.size() != _totalEdges) {
+      throw CacheReader::Invalid();
+    }
+    _valueByOutgoingEdgeIndex.swap(valueByOutgoingEdgeIndex);
+    _valueByIncomingEdgeIndex.swap(valueByIncomingEdgeIndex);
   }
 
   bool For(Index source, Index target) const {
@@ -74,6 +121,12 @@ class EdgePredicate {
   const EdgeIndex _totalEdges;
   std::vector<bool> _valueByOutgoingEdgeIndex;
   std::vector<bool> _valueByIncomingEdgeIndex;
+  /*
+   * Changes are serialized because the values are packed, so that setting
+   * values for unrelated edges from different threads is safe.  Values must
+   * not be read while they may be changed by another thread.
+   */
+  std::mutex _mutex;
 };
 }  // namespace Allocations
 }  // namespace chap
@@ -33,6 +33,8 @@ class ExtendedVisitor {
  public:
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
   typedef typename Directory<Offset>::Allocation Allocation;
+  typedef typename Graph<Offset>::EdgeIterator EdgeIterator;
+  typedef typename Graph<Offset>::EdgeRange EdgeRange;
   ExtendedVisitor(
       Commands::Context& context, const ProcessImage<Offset>& processImage,
       const PatternDescriberRegistry<Offset>& patternDescriberRegistry,
@@ -49,11 +51,11 @@ class ExtendedVisitor {
         _graph(0),
         _directory(processImage.GetAllocationDirectory()),
         _addressMap(processImage.GetVirtualAddressMap()),
-        _signatureDirectory(processImage.GetSignatureDirectory()),
+        _signatureDirectory(nullptr),
         _typeInfoDirectory(processImage.GetTypeInfoDirectory()),
-        _tagHolder(processImage.GetAllocationTagHolder()),
-        _edgeIsTainted(processImage.GetEdgeIsTainted()),
-        _edgeIsFavored(processImage.GetEdgeIsFavored()),
+        _tagHolder(nullptr),
+        _edgeIsTainted(nullptr),
+        _edgeIsFavored(nullptr),
         _numAllocations(_directory.NumAllocations()),
         _visited(visited),
         _commentExtensions(false),
@@ -64,6 +66,17 @@ class ExtendedVisitor {
     size_t numAnnotateArguments = context.GetNumArguments("annotate");
     bool extensionNeeded = false;
     bool graphNeeded = false;
+    if (numExtendArguments != 0 || numAnnotateArguments != 0) {
+      /*
+       * The signatures and tags are needed only if the visitor is used, so
+       * they are not requested, and so not calculated if a command does not
+       * otherwise need them, unless /extend or /annotate is present.
+       */
+      _signatureDirectory = &processImage.GetSignatureDirectory();
+      _tagHolder = processImage.GetAllocationTagHolder();
+      _edgeIsTainted = processImage.GetEdgeIsTainted();
+      _edgeIsFavored = processImage.GetEdgeIsFavored();
+    }
     if (numExtendArguments != 0) {
       extensionNeeded = true;
       graphNeeded = true;
@@ -94,17 +107,17 @@ class ExtendedVisitor {
     ExtensionContext(AllocationIndex memberIndex, size_t ruleIndex,
                      size_t numCandidatesLeft,
                      RuleCheckProgress ruleCheckProgress,
-                     const AllocationIndex* pNextCandidate)
+                     const EdgeIterator& nextCandidate)
         : _memberIndex(memberIndex),
           _ruleIndex(ruleIndex),
           _numCandidatesLeft(numCandidatesLeft),
           _ruleCheckProgress(ruleCheckProgress),
-          _pNextCandidate(pNextCandidate) {}
+          _nextCandidate(nextCandidate) {}
     AllocationIndex _memberIndex;
     size_t _ruleIndex;
     size_t _numCandidatesLeft;
     RuleCheckProgress _ruleCheckProgress;
-    const AllocationIndex* _pNextCandidate;
+    EdgeIterator _nextCandidate;
   };
 
  public:
@@ -156,8 +169,8 @@ class ExtendedVisitor {
     size_t numCandidatesLeft = 0;
     size_t ruleIndexLimit = _stateToBase[state + 1];
     const Allocation* memberAllocation = &allocation;
-    const AllocationIndex* pNextCandidate = 0;
-    const AllocationIndex* pPastCandidates = 0;
+    EdgeIterator nextCandidate;
+    EdgeRange candidates;
     RuleCheckProgress ruleCheckProgress = RuleCheckProgress::NEW_RULE;
 
     while (true) {
@@ -171,7 +184,7 @@ class ExtendedVisitor {
           ruleIndex = extensionContext._ruleIndex;
           numCandidatesLeft = extensionContext._numCandidatesLeft;
           ruleCheckProgress = extensionContext._ruleCheckProgress;
-          pNextCandidate = extensionContext._pNextCandidate;
+          nextCandidate = extensionContext._nextCandidate;
           extensionContexts.pop();
 
           memberAllocation = _directory.AllocationAt(memberIndex);
@@ -217,16 +230,17 @@ class ExtendedVisitor {
               continue;
             }
           } else {
-            _graph->GetOutgoing(memberIndex, &pNextCandidate, &pPastCandidates);
+            candidates = _graph->GetOutgoing(memberIndex);
             ruleCheckProgress = RuleCheckProgress::NO_EDGES_CHECKED;
           }
         } else {
-          _graph->GetIncoming(memberIndex, &pNextCandidate, &pPastCandidates);
+          candidates = _graph->GetIncoming(memberIndex);
           ruleCheckProgress = RuleCheckProgress::NO_EDGES_CHECKED;
         }
       }
       if (ruleCheckProgress == RuleCheckProgress::NO_EDGES_CHECKED) {
-        numCandidatesLeft = pPastCandidates - pNextCandidate;
+        numCandidatesLeft = candidates.size();
+        nextCandidate = candidates.begin();
         if (numCandidatesLeft == 0) {
           ruleCheckProgress = RuleCheckProgress::RULE_DONE;
           continue;
@@ -236,7 +250,8 @@ class ExtendedVisitor {
 
       if (ruleCheckProgress == RuleCheckProgress::IN_PROGRESS) {
         --numCandidatesLeft;
-        candidateIndex = *(pNextCandidate++);
+        candidateIndex = *nextCandidate;
+        ++nextCandidate;
         candidateAllocation = _directory.AllocationAt(candidateIndex);
         if (numCandidatesLeft == 0) {
           ruleCheckProgress = RuleCheckProgress::RULE_DONE;
@@ -366,7 +381,7 @@ class ExtendedVisitor {
       if (ruleCheckProgress != RuleCheckProgress::RULE_DONE ||
           ruleIndex + 1 != ruleIndexLimit) {
         extensionContexts.emplace(memberIndex, ruleIndex, numCandidatesLeft,
-                                  ruleCheckProgress, pNextCandidate);
+                                  ruleCheckProgress, nextCandidate);
       }
 
       memberIndex = candidateIndex;
@@ -583,7 +598,7 @@ class ExtendedVisitor {
 
     _rules.reserve(numSpecs);
     for (size_t i = 0; i < numSpecs; i++) {
-      _rules.emplace_back(_signatureDirectory, _typeInfoDirectory,
+      _rules.emplace_back(*_signatureDirectory, _typeInfoDirectory,
                           _patternDescriberRegistry, _addressMap,
                           specifications[ruleIndexToArgumentIndex[i]]);
       Rule& rule = _rules.back();
@@ -800,7 +815,7 @@ class ExtendedVisitor {
         continue;
       }
       _signatureCheckersWithAnnotationSequences.emplace_back(
-          _signatureDirectory, _typeInfoDirectory, _patternDescriberRegistry,
+          *_signatureDirectory, _typeInfoDirectory, _patternDescriberRegistry,
           _addressMap, constraint, &annotationSequence);
 
       SignatureChecker<Offset>& signatureChecker =
@@ -964,7 +979,7 @@ class ExtendedVisitor {
   const Graph<Offset>* _graph;
   const Directory<Offset>& _directory;
   const VirtualAddressMap<Offset>& _addressMap;
-  const SignatureDirectory<Offset>& _signatureDirectory;
+  const SignatureDirectory<Offset>* _signatureDirectory;
   const CPlusPlus::TypeInfoDirectory<Offset>& _typeInfoDirectory;
   const TagHolder<Offset>* _tagHolder;
   const EdgePredicate<Offset>* _edgeIsTainted;
@@ -4,12 +4,18 @@
 
 #pragma once
 #include <algorithm>
-#include <deque>
+#include <memory>
+#include <set>
+#include <unordered_set>
+#include "../AnalysisCache.h"
+#include "../Parallelism.h"
 #include "../StackRegistry.h"
+#include "../Statistics.h"
 #include "../ThreadMap.h"
 #include "../VirtualAddressMap.h"
 #include "ContiguousImage.h"
 #include "Directory.h"
+#include "EdgeLists.h"
 #include "ExternalAnchorPointChecker.h"
 #include "IndexedDistances.h"
 #include "ObscuredReferenceChecker.h"
@@ -23,6 +29,8 @@ class Graph {
   typedef typename Directory<Offset>::Allocation Allocation;
   typedef typename Directory<Offset>::AllocationIndex Index;
   typedef Offset EdgeIndex;
+  typedef typename EdgeLists<Index, EdgeIndex>::const_iterator EdgeIterator;
+  typedef typename EdgeLists<Index, EdgeIndex>::Range EdgeRange;
   typedef typename VirtualAddressMap<Offset>::Reader Reader;
   typedef typename VirtualAddressMap<Offset>::NotMapped NotMapped;
 
@@ -60,161 +68,176 @@ class Graph {
         _registerAnchorDistances(_numAllocations),
         _externalAnchorDistances(_numAllocations) {
     FindEdges();
-    FindStaticAnchorPoints(staticAnchorLimits);
-    FindStackAnchorPoints();
-    FindRegisterAnchorPoints();
-    FindExternalAnchorPoints();
+    {
+      Statistics::Phase phase("FindAnchorPoints");
+      FindStaticAnchorPoints(staticAnchorLimits);
+      FindStackAnchorPoints();
+      FindRegisterAnchorPoints();
+      FindExternalAnchorPoints();
+    }
     MarkLeakedChunks();
   }
 
+  /*
+   * Restore a graph, previously saved by Save, for the same allocations.
+   * A CacheReader::Invalid exception is thrown if the saved graph doesn't
+   * fit the allocations.
+   */
+  Graph(const VirtualAddressMap<Offset> &addressMap,
+        const Directory<Offset> &directory, const ThreadMap<Offset> &threadMap,
+        const StackRegistry<Offset> &stackRegistry, CacheReader &reader)
+      : _directory(directory),
+        _addressMap(addressMap),
+        _threadMap(threadMap),
+        _stackRegistry(stackRegistry),
+        _externalAnchorPointChecker(nullptr),
+        _obscuredReferenceChecker(nullptr),
+        _numAllocations(directory.NumAllocations()),
+        _totalEdges(0),
+        _staticAnchorDistances(_numAllocations),
+        _stackAnchorDistances(_numAllocations),
+        _registerAnchorDistances(_numAllocations),
+        _externalAnchorDistances(_numAllocations) {
+    if (reader.Get<Index>() != _numAllocations) {
+      throw CacheReader::Invalid();
+    }
+    _totalEdges = reader.Get<EdgeIndex>();
+    _outgoing.Restore(reader);
+    _incoming.Restore(reader);
+    size_t numFirst = (_numAllocations == 0) ? 0 : _numAllocations + 1;
+    if (_outgoing.NumEdges() != _totalEdges ||
+        _incoming.NumEdges() != _totalEdges ||
+        _outgoing.NumFirstEdges() != numFirst ||
+        _incoming.NumFirstEdges() != numFirst) {
+      throw CacheReader::Invalid();
+    }
+    _staticAnchorDistances.Restore(reader);
+    _stackAnchorDistances.Restore(reader);
+    _registerAnchorDistances.Restore(reader);
+    _externalAnchorDistances.Restore(reader);
+    reader.GetBits(_leaked);
+    if (_leaked.size() != _numAllocations) {
+      throw CacheReader::Invalid();
+    }
+    RestoreAnchorPoints(reader, _staticAnchorPoints);
+    RestoreAnchorPoints(reader, _stackAnchorPoints);
+    RestoreAnchorPoints(reader, _registerAnchorPoints);
+    uint64_t numExternalAnchorPoints = reader.Get<uint64_t>();
+    for (uint64_t i = 0; i < numExternalAnchorPoints; i++) {
+      Index index = reader.Get<Index>();
+      if (index >= _numAllocations) {
+        throw CacheReader::Invalid();
+      }
+      _externalAnchorPoints[index] =
+          _externalAnchorReasons.insert(reader.GetString()).first->c_str();
+    }
+  }
+
+  /*
+   * Save everything needed to restore the graph without rescanning the
+   * allocations.
+   */
+  void Save(CacheWriter &writer) const {
+    writer.Put(_numAllocations);
+    writer.Put(_totalEdges);
+    _outgoing.Save(writer);
+    _incoming.Save(writer);
+    _staticAnchorDistances.Save(writer);
+    _stackAnchorDistances.Save(writer);
+    _registerAnchorDistances.Save(writer);
+    _externalAnchorDistances.Save(writer);
+    writer.PutBits(_leaked);
+    SaveAnchorPoints(writer, _staticAnchorPoints);
+    SaveAnchorPoints(writer, _stackAnchorPoints);
+    SaveAnchorPoints(writer, _registerAnchorPoints);
+    writer.Put((uint64_t)_externalAnchorPoints.size());
+    for (const auto &indexAndReason : _externalAnchorPoints) {
+      writer.Put(indexAndReason.first);
+      writer.PutString(indexAndReason.second);
+    }
+  }
+
   const Directory<Offset> &GetAllocationDirectory() const { return _directory; }
 
   const VirtualAddressMap<Offset> &GetAddressMap() const { return _addressMap; }
 
   EdgeIndex TotalEdges() const { return _totalEdges; }
 
-  void GetIncoming(Index target, const Index **pFirstIncoming,
-                   const Index **pPastIncoming) const {
-    if (target < _numAllocations) {
-      *pFirstIncoming = &(_incoming[_firstIncoming[target]]);
-      *pPastIncoming = &(_incoming[_firstIncoming[target + 1]]);
-    } else {
-      *pFirstIncoming = (const Index *)(0);
-      *pPastIncoming = (const Index *)(0);
-    }
-  }
-
-  void GetIncoming(Index target, EdgeIndex &firstIncoming,
-                   EdgeIndex &pastIncoming) const {
-    if (target < _numAllocations) {
-      firstIncoming = _firstIncoming[target];
-      pastIncoming = _firstIncoming[target + 1];
-    } else {
-      firstIncoming = _totalEdges;
-      pastIncoming = _totalEdges;
-    }
+  /*
+   * Return the sources of the incoming edges for the given target, in
+   * increasing order, where the iterators also give the index of each edge.
+   */
+  EdgeRange GetIncoming(Index target) const {
+    return (target < _numAllocations) ? _incoming.GetRange(target)
+                                      : EdgeRange();
   }
 
   EdgeIndex GetIncomingEdgeIndex(Index source, Index target) const {
     if (source >= _numAllocations || target >= _numAllocations) {
       return _totalEdges;
     }
-    EdgeIndex base = _firstIncoming[target];
-    EdgeIndex limit = _firstIncoming[target + 1];
-
-    while (base < limit) {
-      size_t mid = (base + limit) / 2;
-      Index edgeSource = _incoming[mid];
-      if (source >= edgeSource) {
-        if (source == edgeSource) {
-          return mid;
-        } else {
-          base = mid + 1;
-        }
-      } else {
-        limit = mid;
-      }
-    }
-    return _totalEdges;
+    EdgeIterator it = _incoming.Find(target, [source](Index edgeSource) {
+      return (source > edgeSource) ? -1 : (source < edgeSource) ? 1 : 0;
+    });
+    return (it != _incoming.end(target)) ? it.Edge() : _totalEdges;
   }
 
+  /*
+   * Return the source of the given incoming edge.  This is slower than
+   * getting the source from an iterator if the edges are compressed.
+   */
   Index GetSourceForIncoming(EdgeIndex incoming) const {
-    return (incoming < _totalEdges) ? _incoming[incoming] : _numAllocations;
+    return (incoming < _totalEdges) ? _incoming.At(incoming) : _numAllocations;
   }
 
   Index SourceAllocationIndex(Index target, Offset addr) const {
     if (target < _numAllocations) {
-      EdgeIndex base = _firstIncoming[target];
-      EdgeIndex limit = _firstIncoming[target + 1];
-      while (base < limit) {
-        size_t mid = (base + limit) / 2;
-        Index source = _incoming[mid];
-        const Allocation &allocation = *(_directory.AllocationAt(source));
-        if (addr >= allocation.Address()) {
-          if (addr < allocation.Address() + allocation.Size()) {
-            return source;
-          } else {
-            base = mid + 1;
-          }
-        } else {
-          limit = mid;
-        }
+      EdgeIterator it = _incoming.Find(target, [this, addr](Index source) {
+        return CompareToAllocation(addr, source);
+      });
+      if (it != _incoming.end(target)) {
+        return *it;
       }
     }
     return _numAllocations;
   }
 
-  void GetOutgoing(Index source, const Index **pFirstOutgoing,
-                   const Index **pPastOutgoing) const {
-    if (source < _numAllocations) {
-      *pFirstOutgoing = &(_outgoing[_firstOutgoing[source]]);
-      *pPastOutgoing = &(_outgoing[_firstOutgoing[source + 1]]);
-    } else {
-      *pFirstOutgoing = (const Index *)(0);
-      *pPastOutgoing = (const Index *)(0);
-    }
-  }
-
-  void GetOutgoing(Index source, EdgeIndex &firstOutgoing,
-                   EdgeIndex &pastOutgoing) const {
-    if (source < _numAllocations) {
-      firstOutgoing = _firstOutgoing[source];
-      pastOutgoing = _firstOutgoing[source + 1];
-    } else {
-      firstOutgoing = _totalEdges;
-      pastOutgoing = _totalEdges;
-    }
+  /*
+   * Return the targets of the outgoing edges for the given source, in
+   * increasing order, where the iterators also give the index of each edge.
+   */
+  EdgeRange GetOutgoing(Index source) const {
+    return (source < _numAllocations) ? _outgoing.GetRange(source)
+                                      : EdgeRange();
   }
 
   EdgeIndex GetOutgoingEdgeIndex(Index source, Index target) const {
     if (source >= _numAllocations || target >= _numAllocations) {
       return _totalEdges;
     }
-    EdgeIndex base = _firstOutgoing[source];
-    EdgeIndex limit = _firstOutgoing[source + 1];
-
-    while (base < limit) {
-      size_t mid = (base + limit) / 2;
-      Index edgeTarget = _outgoing[mid];
-      if (target >= edgeTarget) {
-        if (target == edgeTarget) {
-          return mid;
-        } else {
-          base = mid + 1;
-        }
-      } else {
-        limit = mid;
-      }
-    }
-    return _totalEdges;
+    EdgeIterator it = _outgoing.Find(source, [target](Index edgeTarget) {
+      return (target > edgeTarget) ? -1 : (target < edgeTarget) ? 1 : 0;
+    });
+    return (it != _outgoing.end(source)) ? it.Edge() : _totalEdges;
   }
 
+  /*
+   * Return the target of the given outgoing edge.  This is slower than
+   * getting the target from an iterator if the edges are compressed.
+   */
   Index GetTargetForOutgoing(EdgeIndex outgoing) const {
-    return (outgoing < _totalEdges) ? _outgoing[outgoing] : _numAllocations;
+    return (outgoing < _totalEdges) ? _outgoing.At(outgoing) : _numAllocations;
   }
 
   bool HasNoOutgoing(Index source) const {
-    return (source >= _numAllocations) ||
-           (_firstOutgoing[source] == _firstOutgoing[source + 1]);
+    return (source >= _numAllocations) || (_outgoing.NumEdges(source) == 0);
   }
 
   Index TargetAllocationIndex(Index source, Offset addr) const {
     if (source < _numAllocations) {
-      EdgeIndex base = _firstOutgoing[source];
-      EdgeIndex limit = _firstOutgoing[source + 1];
-      while (base < limit) {
-        size_t mid = (base + limit) / 2;
-        Index target = _outgoing[mid];
-        const Allocation &allocation = *(_directory.AllocationAt(target));
-        if (addr >= allocation.Address()) {
-          if (addr < allocation.Address() + allocation.Size()) {
-            return target;
-          } else {
-            base = mid + 1;
-          }
-        } else {
-          limit = mid;
-        }
+      EdgeIterator it = FindTarget(source, addr);
+      if (it != _outgoing.end(source)) {
+        return *it;
       }
     }
     return _numAllocations;
@@ -222,21 +245,9 @@ class Graph {
 
   EdgeIndex TargetEdgeIndex(Index source, Offset addr) const {
     if (source < _numAllocations) {
-      EdgeIndex base = _firstOutgoing[source];
-      EdgeIndex limit = _firstOutgoing[source + 1];
-      while (base < limit) {
-        size_t mid = (base + limit) / 2;
-        Index target = _outgoing[mid];
-        const Allocation &allocation = *(_directory.AllocationAt(target));
-        if (addr >= allocation.Address()) {
-          if (addr < allocation.Address() + allocation.Size()) {
-            return mid;
-          } else {
-            base = mid + 1;
-          }
-        } else {
-          limit = mid;
-        }
+      EdgeIterator it = FindTarget(source, addr);
+      if (it != _outgoing.end(source)) {
+        return it.Edge();
       }
     }
     return _totalEdges;
@@ -380,6 +391,7 @@ class Graph {
 
   bool VisitStaticAnchorChains(Index index, AnchorChainVisitor &visitor) const {
     return VisitAnchorChains(index, visitor, _staticAnchorDistances,
+                             _staticAnchorParents,
                              &Graph::VisitStaticAnchorPoint);
   }
 
@@ -399,6 +411,7 @@ class Graph {
 
   bool VisitStackAnchorChains(Index index, AnchorChainVisitor &visitor) const {
     return VisitAnchorChains(index, visitor, _stackAnchorDistances,
+                             _stackAnchorParents,
                              &Graph::VisitStackAnchorPoint);
   }
 
@@ -431,6 +444,7 @@ class Graph {
   bool VisitRegisterAnchorChains(Index index,
                                  AnchorChainVisitor &visitor) const {
     return VisitAnchorChains(index, visitor, _registerAnchorDistances,
+                             _registerAnchorParents,
                              &Graph::VisitRegisterAnchorPoint);
   }
 
@@ -452,6 +466,7 @@ class Graph {
   bool VisitExternalAnchorChains(Index index,
                                  AnchorChainVisitor &visitor) const {
     return VisitAnchorChains(index, visitor, _externalAnchorDistances,
+                             _externalAnchorParents,
                              &Graph::VisitExternalAnchorPoint);
   }
 
@@ -471,8 +486,18 @@ class Graph {
                                        allocation->Size(), image);
   }
 
+  /*
+   * Visit the anchor chains, of the kind associated with the given distances
+   * and parents, that lead to the given allocation.  The first chain is the
+   * one given by the parents, so it is found in time proportional to its
+   * length.  Only if the visitor asks for more chains are the other shortest
+   * chains searched for, in the same depth first order that would have found
+   * that first chain, and in that case only the allocations closer to the
+   * anchor points than the given allocation are visited.
+   */
   bool VisitAnchorChains(Index index, AnchorChainVisitor &visitor,
                          const IndexedDistances<Index> &distances,
+                         std::vector<Index> &parents,
                          LocalVisitor anchorPointVisitor) const {
     if (index >= _numAllocations || _leaked[index]) {
       return false;
@@ -486,98 +511,91 @@ class Graph {
     if (allocation == 0 || !allocation->IsUsed()) {
       return false;
     }
-    if (distance == 1 &&
-        CallAnchorChainVisitor(index, visitor, anchorPointVisitor)) {
+    if (distance == 1) {
       // Under the given anchor type imposed by the distances argument, the
-      // allocation to explain was directly anchored, so there is normally no
-      // need to explain any indirect anchoring.
-      return true;
+      // allocation to explain is directly anchored, so there is no shorter
+      // indirect anchoring to explain.
+      return CallAnchorChainVisitor(index, visitor, anchorPointVisitor);
     }
-    // At this point the starting allocation is not directly anchored under
-    // the given anchor type so we are interested in whether there is any
-    // indirect anchoring.
-    EdgeIndex edgeIndex = _firstIncoming[index];
-    if (edgeIndex != _firstIncoming[index + 1]) {
-      // There is at least one incoming edge.
-      std::vector<bool> visited;
-      visited.reserve(_numAllocations);
-      visited.resize(_numAllocations, false);
-      for (Index freeIndex = 0; freeIndex < _numAllocations; freeIndex++) {
-        if (!_directory.AllocationAt(freeIndex)->IsUsed()) {
-          visited[freeIndex] = true;
-        }
-      }
+    FindAnchorParents(distances, parents);
 
-      // The edge target is already considered visited.
-      visited[index] = true;
-      std::vector<std::pair<Index, EdgeIndex> > edgesToVisit;
-      edgesToVisit.emplace_back(index, edgeIndex - 1);
-      while (!edgesToVisit.empty()) {
-        edgeIndex = ++(edgesToVisit.back().second);
-        Index targetIndex = edgesToVisit.back().first;
-
-        if (edgeIndex >= _firstIncoming[targetIndex + 1]) {
-          // We have checked for any anchor paths that involve the
-          // allocation corresponding to the target index as the target
-          // of an edge.
-          edgesToVisit.pop_back();
-          continue;
-        }
+    std::vector<Index> chain;
+    chain.reserve(distance - 1);
+    for (Index link = index; distances.GetDistance(link) > 1;
+         link = parents[link]) {
+      chain.push_back(link);
+    }
+    Index anchorPoint = parents[chain.back()];
+    if (CallAnchorChainVisitor(anchorPoint, visitor, anchorPointVisitor) ||
+        VisitChainLinks(chain.rbegin(), chain.rend(), visitor,
+                        [](Index link) { return link; })) {
+      return true;
+    }
 
-        Index sourceIndex = _incoming[edgeIndex];
-        if (visited[sourceIndex]) {
-          continue;
-        } else {
-          // The graph has both used and free nodes but here we are only
-          // interested in paths involving used nodes.
-          visited[sourceIndex] = true;
-          const Allocation *allocation = _directory.AllocationAt(sourceIndex);
-          if (allocation == 0 || !allocation->IsUsed()) {
-            continue;
-          }
-        }
+    /*
+     * Recreate the state that the depth first search below would have had
+     * on finding the first chain, where each edge before the one to the
+     * parent has been checked, so that any further chains are found in the
+     * same order as if the search had found the first one.
+     */
+    std::unordered_set<Index> visited;
+    std::vector<std::pair<Index, EdgeIterator> > edgesToVisit;
+    edgesToVisit.reserve(distance);
+    for (Index target : chain) {
+      visited.insert(target);
+      EdgeIterator nextEdge = _incoming.begin(target);
+      for (; *nextEdge != parents[target]; ++nextEdge) {
+        visited.insert(*nextEdge);
+      }
+      edgesToVisit.emplace_back(target, ++nextEdge);
+    }
+    visited.insert(anchorPoint);
+    edgesToVisit.emplace_back(anchorPoint, _incoming.begin(anchorPoint));
+
+    while (!edgesToVisit.empty()) {
+      Index targetIndex = edgesToVisit.back().first;
+      EdgeIterator &nextEdge = edgesToVisit.back().second;
+
+      if (nextEdge == _incoming.end(targetIndex)) {
+        // We have checked for any anchor paths that involve the
+        // allocation corresponding to the target index as the target
+        // of an edge.
+        edgesToVisit.pop_back();
+        continue;
+      }
 
-        Index sourceAnchorDistance = distances.GetDistance(sourceIndex);
-        Index targetAnchorDistance = distances.GetDistance(targetIndex);
-        if ((sourceAnchorDistance == 0) ||                    // leaked
-            (sourceAnchorDistance > targetAnchorDistance) ||  // wrong way
-            ((sourceAnchorDistance == targetAnchorDistance) &&
-             (targetAnchorDistance != 0xFF))) {
-          continue;
-        }
-        if (sourceAnchorDistance == 1) {
-          // The source is an anchor point of the type associated with the
-          // distances argument.
-          if (CallAnchorChainVisitor(sourceIndex, visitor,
-                                     anchorPointVisitor)) {
-            return true;
-          }
+      Index sourceIndex = *nextEdge;
+      ++nextEdge;
+      if (!visited.insert(sourceIndex).second) {
+        continue;
+      }
+      // The graph has both used and free nodes but here we are only
+      // interested in paths involving used nodes.
+      const Allocation *allocation = _directory.AllocationAt(sourceIndex);
+      if (allocation == 0 || !allocation->IsUsed()) {
+        continue;
+      }
 
-          for (typename std::vector<
-                   std::pair<Index, EdgeIndex> >::const_reverse_iterator it =
-                   edgesToVisit.rbegin();
-               it != edgesToVisit.rend(); ++it) {
-            Offset linkIndex = it->first;
-            const Allocation *allocation = _directory.AllocationAt(linkIndex);
-            if (allocation == 0 || !allocation->IsUsed()) {
-              break;
-            }
-            const char *image;
-            Offset numBytesFound = _addressMap.FindMappedMemoryImage(
-                allocation->Address(), &image);
-            if (numBytesFound < sizeof(Offset)) {
-              break;
-            }
-            if (visitor.VisitChainLink(allocation->Address(),
-                                       allocation->Size(), image)) {
-              return true;
-            }
-          }
+      Index sourceAnchorDistance = distances.GetDistance(sourceIndex);
+      if ((sourceAnchorDistance == 0) ||  // leaked
+          (sourceAnchorDistance + 1 !=
+           distances.GetDistance(targetIndex))) {  // not on a shortest chain
+        continue;
+      }
+      if (sourceAnchorDistance == 1) {
+        // The source is an anchor point of the type associated with the
+        // distances argument.
+        if (CallAnchorChainVisitor(sourceIndex, visitor, anchorPointVisitor) ||
+            VisitChainLinks(
+                edgesToVisit.rbegin(), edgesToVisit.rend(), visitor,
+                [](const std::pair<Index, EdgeIterator> &link) {
+                  return link.first;
+                })) {
+          return true;
         }
-
-        edgeIndex = _firstIncoming[sourceIndex];
-        edgesToVisit.emplace_back(sourceIndex, edgeIndex - 1);
       }
+
+      edgesToVisit.emplace_back(sourceIndex, _incoming.begin(sourceIndex));
     }
     return false;
   }
@@ -585,12 +603,9 @@ class Graph {
   bool IsUnreferenced(Index index) const {
     bool isUnreferenced = false;
     if (index < _numAllocations && _leaked[index]) {
-      const Index *pFirstIncomingIndex = &(_incoming[_firstIncoming[index]]);
-      const Index *pPastIncomingIndex = &(_incoming[_firstIncoming[index + 1]]);
       isUnreferenced = true;
-      for (const Index *pIncomingIndex = pFirstIncomingIndex;
-           pIncomingIndex != pPastIncomingIndex; pIncomingIndex++) {
-        if (_directory.AllocationAt((*pIncomingIndex))->IsUsed()) {
+      for (Index source : _incoming.GetRange(index)) {
+        if (_directory.AllocationAt(source)->IsUsed()) {
           isUnreferenced = false;
           break;
         }
@@ -614,19 +629,134 @@ class Graph {
   const ObscuredReferenceChecker<Offset> *_obscuredReferenceChecker;
   Index _numAllocations;
   EdgeIndex _totalEdges;
-  std::vector<Index> _outgoing;
-  std::vector<Index> _incoming;
-  std::vector<EdgeIndex> _firstOutgoing;
-  std::vector<EdgeIndex> _firstIncoming;
+  EdgeLists<Index, EdgeIndex> _outgoing;
+  EdgeLists<Index, EdgeIndex> _incoming;
   IndexedDistances<Index> _staticAnchorDistances;
   IndexedDistances<Index> _stackAnchorDistances;
   IndexedDistances<Index> _registerAnchorDistances;
   IndexedDistances<Index> _externalAnchorDistances;
+  /*
+   * For each kind of anchor point, and for each allocation that is reached
+   * from such an anchor point but is not one, this gives the first source,
+   * in the order of the incoming edges, that is one step closer to such an
+   * anchor point.  Each of these is filled in from the distances the first
+   * time an anchor chain of that kind is visited, which allows the cost to
+   * be paid just by sessions that explain allocations, whether the graph
+   * was calculated or restored from the cache.
+   */
+  mutable std::vector<Index> _staticAnchorParents;
+  mutable std::vector<Index> _stackAnchorParents;
+  mutable std::vector<Index> _registerAnchorParents;
+  mutable std::vector<Index> _externalAnchorParents;
   std::vector<bool> _leaked;
   AnchorPointMap _staticAnchorPoints;
   AnchorPointMap _stackAnchorPoints;
   AnchorPointMap _registerAnchorPoints;
   std::map<Index, const char *> _externalAnchorPoints;
+  /*
+   * This holds the reasons for external anchor points restored from a
+   * cache, because the map refers to reasons that must not go away.
+   */
+  std::set<std::string> _externalAnchorReasons;
+
+  /*
+   * Return a negative number, 0 or a positive number, if the given
+   * allocation is before, contains or is after the given address,
+   * respectively.
+   */
+  int CompareToAllocation(Offset addr, Index index) const {
+    const Allocation &allocation = *(_directory.AllocationAt(index));
+    if (addr < allocation.Address()) {
+      return 1;
+    }
+    return (addr < allocation.Address() + allocation.Size()) ? 0 : -1;
+  }
+
+  EdgeIterator FindTarget(Index source, Offset addr) const {
+    return _outgoing.Find(source, [this, addr](Index target) {
+      return CompareToAllocation(addr, target);
+    });
+  }
+
+  /*
+   * Fill in the given parents, if that has not already been done, from the
+   * given distances.
+   */
+  void FindAnchorParents(const IndexedDistances<Index> &distances,
+                         std::vector<Index> &parents) const {
+    if (!parents.empty()) {
+      return;
+    }
+    Statistics::Phase phase("FindAnchorParents");
+    parents.resize(_numAllocations, 0);
+    _incoming.WithFastestView([&](const auto &incoming) {
+      Parallelism::ForEachChunk(
+          _numAllocations, Parallelism::NumChunks(_numAllocations),
+          [&](size_t, Index base, Index limit) {
+            for (Index target = base; target < limit; target++) {
+              Index distance = distances.GetDistance(target);
+              if (distance < 2) {
+                continue;
+              }
+              // Only used allocations are given distances.
+              auto itEnd = incoming.end(target);
+              for (auto it = incoming.begin(target); it != itEnd; ++it) {
+                if (distances.GetDistance(*it) == distance - 1) {
+                  parents[target] = *it;
+                  break;
+                }
+              }
+            }
+          });
+    });
+  }
+
+  /*
+   * Visit the links of an anchor chain, from the one just after the anchor
+   * point to the allocation being explained, returning true if the visitor
+   * asks to stop.
+   */
+  template <typename LinkIterator, typename GetIndex>
+  bool VisitChainLinks(LinkIterator it, LinkIterator itEnd,
+                       AnchorChainVisitor &visitor, GetIndex getIndex) const {
+    for (; it != itEnd; ++it) {
+      const Allocation *allocation = _directory.AllocationAt(getIndex(*it));
+      if (allocation == 0 || !allocation->IsUsed()) {
+        break;
+      }
+      const char *image;
+      Offset numBytesFound =
+          _addressMap.FindMappedMemoryImage(allocation->Address(), &image);
+      if (numBytesFound < sizeof(Offset)) {
+        break;
+      }
+      if (visitor.VisitChainLink(allocation->Address(), allocation->Size(),
+                                 image)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void SaveAnchorPoints(CacheWriter &writer,
+                               const AnchorPointMap &anchorPoints) {
+    writer.Put((uint64_t)anchorPoints.size());
+    for (const auto &indexAndAnchors : anchorPoints) {
+      writer.Put(indexAndAnchors.first);
+      writer.PutVector(indexAndAnchors.second);
+    }
+  }
+
+  void RestoreAnchorPoints(CacheReader &reader, AnchorPointMap &anchorPoints) {
+    uint64_t numAnchorPoints = reader.Get<uint64_t>();
+    for (uint64_t i = 0; i < numAnchorPoints; i++) {
+      Index index = reader.Get<Index>();
+      if (index >= _numAllocations) {
+        throw CacheReader::Invalid();
+      }
+      reader.GetVector(anchorPoints[index]);
+    }
+  }
 
   /*
    * Attempt to interpret the given target candidate as a reference to
@@ -642,209 +772,295 @@ class Graph {
     return targetIndex;
   }
 
+  /*
+   * Pages that are known to hold only 0, such as holes in a sparse core,
+   * are skipped by the scans for edges and anchor points.
+   */
+  static constexpr Offset ZERO_SKIP_SIZE = 0x1000;
+
+  /*
+   * Append to the given vector, in increasing order and without duplicates,
+   * the indices of all the allocations referenced by the allocation with the
+   * given index, returning the number of indices appended.  Note that we find
+   * all the edges, regardless of whether the source or target is used or
+   * free.  Code that uses the graph is expected to check the source and/or
+   * the target when one particular usage status is required.
+   */
+  EdgeIndex AppendTargets(Index source,
+                          ContiguousImage<Offset> &contiguousImage,
+                          std::vector<Index> &targets) {
+    size_t numBefore = targets.size();
+    contiguousImage.SetIndex(source);
+    Index prevTarget = _numAllocations;
+    const Offset *offsetLimit = contiguousImage.OffsetLimit();
+    const Offset *check = contiguousImage.FirstOffset();
+    bool mayHaveKnownZeros =
+        _addressMap.HasKnownZeros() &&
+        (offsetLimit - check) * sizeof(Offset) >= 2 * ZERO_SKIP_SIZE;
+    while (check < offsetLimit) {
+      const Offset *scanLimit = offsetLimit;
+      if (mayHaveKnownZeros) {
+        check = (const Offset *)_addressMap.SkipKnownZeros(
+            (const char *)check, (const char *)offsetLimit);
+        scanLimit = (const Offset *)(((uintptr_t)check + ZERO_SKIP_SIZE) &
+                                     ~(uintptr_t)(ZERO_SKIP_SIZE - 1));
+        if (scanLimit > offsetLimit) {
+          scanLimit = offsetLimit;
+        }
+      }
+      for (; check < scanLimit; check++) {
+        Index target = EdgeTargetIndex(*check);
+        if (target != _numAllocations && target != source &&
+            target != prevTarget) {
+          targets.push_back(target);
+          prevTarget = target;
+        }
+      }
+    }
+    typename std::vector<Index>::iterator itFirst = targets.begin() + numBefore;
+    if (targets.size() - numBefore > 1) {
+      std::sort(itFirst, targets.end());
+      targets.erase(std::unique(itFirst, targets.end()), targets.end());
+    }
+    return targets.size() - numBefore;
+  }
+
+  /*
+   * Find all the edges, scanning each allocation just once.  The allocations
+   * are split into chunks that may be scanned concurrently, each by a thread
+   * with its own ContiguousImage.  The edges are the same, and are stored in
+   * the same order, regardless of the number of threads.
+   */
   void FindEdges() {
+    Statistics::Phase phase("FindEdges");
     if (_numAllocations == 0) {
       return;
     }
 
-    Offset maxAllocationSize = _directory.MaxAllocationSize();
-    std::vector<Index> targets;
-    targets.reserve(maxAllocationSize);
-
-    _firstIncoming.reserve(_numAllocations + 1);
-    _firstIncoming.resize(_numAllocations + 1, 0);
-    _firstOutgoing.reserve(_numAllocations + 1);
-    _firstOutgoing.resize(_numAllocations + 1, 0);
+    std::vector<EdgeIndex> firstIncoming(_numAllocations + 1, 0);
+    std::vector<EdgeIndex> firstOutgoing(_numAllocations + 1, 0);
+    std::vector<Index> outgoing;
+    std::vector<Index> incoming;
 
     /*
-     * Count all the edges, but don't store them yet.  At the end of this
-     * first pass, _firstOutgoing[i] will be set correctly to the index of
-     * the first outgoing edge for allocation i in the array _outgoing,
-     * but _firstIncoming[i] will have a temporary value of the number
-     * of incoming edges for allocation i, rather than the correct index
-     * into _incoming.
+     * Gather the sorted outgoing targets for each source, keeping one
+     * vector of targets per chunk.  At the end of this pass,
+     * firstOutgoing[i + 1] is the number of outgoing edges for allocation i.
      */
-    ContiguousImage<Offset> contiguousImage(_addressMap, _directory);
-    Reader reader(_addressMap);
-    for (Index i = 0; i < _numAllocations; i++) {
-      contiguousImage.SetIndex(i);
-      _firstOutgoing[i] = _totalEdges;
-      // const Allocation *allocation = _directory.AllocationAt(i);
-
-      /*
-       * Note that we find all the edges, regardless of whether the source
-       * or target is used or free.  Code that uses the graph is expected to
-       * check the source and/or the target when one particular usage status
-       * is required.
-       */
-      targets.clear();
-      Index prevTarget = _numAllocations;
-      const Offset *offsetLimit = contiguousImage.OffsetLimit();
-      for (const Offset *check = contiguousImage.FirstOffset();
-           check < offsetLimit; check++) {
-        Index target = EdgeTargetIndex(*check);
-        if (target != _numAllocations && target != i && target != prevTarget) {
-          targets.push_back(target);
-          prevTarget = target;
-        }
-      }
-      if (!targets.empty()) {
-        if (targets.size() > 1) {
-          std::sort(targets.begin(), targets.end());
-        }
-        Index prevTarget = _numAllocations;
-        for (Offset target : targets) {
-          if (target != prevTarget) {
-            _firstIncoming[target]++;
-            _totalEdges++;
-            prevTarget = target;
+    size_t numChunks = Parallelism::NumChunks(_numAllocations);
+    std::vector<std::vector<Index> > chunkTargets(numChunks);
+    Parallelism::ForEachChunk(
+        _numAllocations, numChunks,
+        [this]() {
+          return std::make_unique<ContiguousImage<Offset> >(_addressMap,
+                                                            _directory);
+        },
+        [&](std::unique_ptr<ContiguousImage<Offset> > &contiguousImage,
+            size_t chunk, Index base, Index limit) {
+          std::vector<Index> &targets = chunkTargets[chunk];
+          uint64_t bytesScanned = 0;
+          for (Index i = base; i < limit; i++) {
+            firstOutgoing[i + 1] = AppendTargets(i, *contiguousImage, targets);
+            bytesScanned += _directory.AllocationAt(i)->Size();
           }
-        }
-      }
-    }
-    _firstOutgoing[_numAllocations] = _totalEdges;
+          targets.shrink_to_fit();
+          Statistics::AddToCounter("bytesScannedForEdges", bytesScanned);
+        });
 
     /*
-     * Convert values in _firstIncoming from incoming edge counts to offsets
-     * just after incoming edges.
+     * Convert the counts to offsets of the first outgoing edge for each
+     * allocation then move the targets for each chunk into place.
      */
-
-    for (Index i = 0; i < _numAllocations; i++) {
-      _firstIncoming[i + 1] = _firstIncoming[i] + _firstIncoming[i + 1];
-    }
-    _outgoing.reserve(_totalEdges);
-    _outgoing.resize(_totalEdges, 0);
-    _incoming.reserve(_totalEdges);
-    _incoming.resize(_totalEdges, 0);
+    Parallelism::InclusiveScan(firstOutgoing);
+    _totalEdges = firstOutgoing[_numAllocations];
+    outgoing.reserve(_totalEdges);
+    outgoing.resize(_totalEdges, 0);
+    Parallelism::ForEachChunk(
+        _numAllocations, numChunks, [&](size_t chunk, Index base, Index) {
+          std::vector<Index> targets;
+          targets.swap(chunkTargets[chunk]);
+          std::copy(targets.begin(), targets.end(),
+                    outgoing.begin() + firstOutgoing[base]);
+        });
 
     /*
-     * Fill in the outgoing and incoming edges and convert values in
-     * _firstIncoming to indicate the index of the first incoming edge
-     * for the corresponding node in _incoming.  Go backwards in the
-     * sources so that the incoming edges in _incoming have subranges
-     * in increasing order of target, where the values in each subrange
-     * are the sources in increasing order.
+     * Count the incoming edges for each allocation then convert those counts
+     * to offsets just after the incoming edges for the corresponding
+     * allocation in incoming.
      */
+    Parallelism::ForEach(_totalEdges, [&](EdgeIndex edgeIndex) {
+      __atomic_fetch_add(&(firstIncoming[outgoing[edgeIndex]]), 1,
+                         __ATOMIC_RELAXED);
+    });
+    Parallelism::InclusiveScan(firstIncoming);
+    incoming.reserve(_totalEdges);
+    incoming.resize(_totalEdges, 0);
 
-    for (Index i = _numAllocations; i > 0;) {
-      contiguousImage.SetIndex(--i);
-      /*
-       * Note that we find all the edges, regardless of whether the source
-       * or target is used or free.  Code that uses the graph is expected to
-       * check the source and/or the target when one particular usage status
-       * is required.
-       */
-      targets.clear();
-      Index prevTarget = _numAllocations;
-      const Offset *offsetLimit = contiguousImage.OffsetLimit();
-      for (const Offset *check = contiguousImage.FirstOffset();
-           check < offsetLimit; check++) {
-        Index target = EdgeTargetIndex(*check);
-        if (target != _numAllocations && target != i && target != prevTarget) {
-          targets.push_back(target);
-          prevTarget = target;
-        }
-      }
-      if (!targets.empty()) {
-        if (targets.size() > 1) {
-          std::sort(targets.begin(), targets.end());
-        }
-        Index prevTarget = _numAllocations;
-        EdgeIndex nextOutgoing = _firstOutgoing[i];
-        for (Offset target : targets) {
-          if (target != prevTarget) {
-            _incoming[--_firstIncoming[target]] = i;
-            _outgoing[nextOutgoing++] = target;
-            prevTarget = target;
+    /*
+     * Fill in the incoming edges and convert values in firstIncoming to
+     * indicate the index of the first incoming edge for the corresponding
+     * allocation in incoming.  The sources for any given target must end up
+     * in increasing order.  Going backwards through the sources assures this
+     * if there is just one thread and otherwise the subranges are sorted
+     * afterwards.
+     */
+    Parallelism::ForEachChunk(
+        _numAllocations, numChunks, [&](size_t, Index base, Index limit) {
+          for (Index i = limit; i > base;) {
+            --i;
+            EdgeIndex edgeLimit = firstOutgoing[i + 1];
+            for (EdgeIndex edgeIndex = firstOutgoing[i];
+                 edgeIndex < edgeLimit; edgeIndex++) {
+              incoming[__atomic_sub_fetch(
+                  &(firstIncoming[outgoing[edgeIndex]]), 1,
+                  __ATOMIC_RELAXED)] = i;
+            }
           }
-        }
-      }
+        });
+    if (numChunks > 1) {
+      Parallelism::ForEach(_numAllocations, [&](Index i) {
+        std::sort(incoming.begin() + firstIncoming[i],
+                  incoming.begin() + firstIncoming[i + 1]);
+      });
     }
+    _outgoing.Assign(firstOutgoing, outgoing);
+    _incoming.Assign(firstIncoming, incoming);
   }
 
-  void MarkAnchoredChunks(AnchorPointMap &anchorPoints,
-                          IndexedDistances<Index> &anchorDistance) {
-    std::vector<bool> visited;
-    visited.reserve(_numAllocations);
-    visited.resize(_numAllocations, false);
-    for (Index index = 0; index < _numAllocations; index++) {
-      if (!_directory.AllocationAt(index)->IsUsed()) {
-        visited[index] = true;
-      }
-    }
-    std::deque<Index> toVisit;
-    AnchorPointMapConstIterator itEnd = anchorPoints.end();
-    for (AnchorPointMapConstIterator it = anchorPoints.begin(); it != itEnd;
-         ++it) {
-      Index index = it->first;
-      visited[index] = true;
-      _leaked[index] = false;
-      anchorDistance.SetDistance(index, 1);
-      toVisit.push_back(index);
-    }
-    while (!toVisit.empty()) {
-      Index sourceIndex = toVisit.front();
-      Index newDistance = anchorDistance.GetDistance(sourceIndex) + 1;
-      toVisit.pop_front();
-      EdgeIndex edgeLimit = _firstOutgoing[sourceIndex + 1];
-      for (EdgeIndex edgeIndex = _firstOutgoing[sourceIndex];
-           edgeIndex < edgeLimit; edgeIndex++) {
-        Index targetIndex = _outgoing[edgeIndex];
-        if (!visited[targetIndex]) {
-          visited[targetIndex] = true;
-          _leaked[targetIndex] = false;
-          anchorDistance.SetDistance(targetIndex, newDistance);
-          toVisit.push_back(targetIndex);
-        }
-      }
+  /*
+   * A level of the traversal from anchor points is handled by checking the
+   * sources of every allocation not yet reached, rather than by following
+   * the outgoing edges from the level, when the level has more than this
+   * fraction of the edges to allocations not yet reached.
+   */
+  static constexpr EdgeIndex BOTTOM_UP_EDGE_RATIO = 14;
+
+  static bool IsBitSet(const std::vector<uint64_t> &bits, Index index) {
+    return (bits[index >> 6] & (1ULL << (index & 63))) != 0;
+  }
+
+  static void SetBit(std::vector<uint64_t> &bits, Index index) {
+    bits[index >> 6] |= 1ULL << (index & 63);
+  }
+
+  template <class AnchorMap>
+  static std::vector<Index> AnchorIndices(const AnchorMap &anchorPoints) {
+    std::vector<Index> anchors;
+    anchors.reserve(anchorPoints.size());
+    for (const auto &indexAndAnchors : anchorPoints) {
+      anchors.push_back(indexAndAnchors.first);
     }
+    return anchors;
+  }
+
+  /*
+   * Set the distance, for each allocation reachable from the given anchor
+   * points without passing through a free allocation, from the closest of
+   * those anchor points, where an anchor point is at distance 1.  Bits are
+   * set in isFree for the free allocations and for any indices past the last
+   * allocation.  The traversal is done one level at a time, so the distances
+   * don't depend on the order in which allocations on a level are visited.
+   */
+  void MarkAnchoredChunks(const std::vector<Index> &anchors,
+                          const std::vector<uint64_t> &isFree,
+                          IndexedDistances<Index> &anchorDistance) const {
+    _outgoing.WithFastestView([&](const auto &outgoing) {
+      _incoming.WithFastestView([&](const auto &incoming) {
+        MarkAnchoredChunks(anchors, isFree, anchorDistance, outgoing,
+                           incoming);
+      });
+    });
   }
 
-  void MarkAnchoredChunks(std::map<Index, const char *> &anchorPoints,
-                          IndexedDistances<Index> &anchorDistance) {
-    std::vector<bool> visited;
-    visited.reserve(_numAllocations);
-    visited.resize(_numAllocations, false);
-    for (Index index = 0; index < _numAllocations; index++) {
-      if (!_directory.AllocationAt(index)->IsUsed()) {
-        visited[index] = true;
+  /*
+   * This does the traversal for MarkAnchoredChunks, with the edges passed
+   * in the fastest form available for the way in which they are held, to
+   * keep the inner loops free of any checks of that form.
+   */
+  template <typename OutgoingLists, typename IncomingLists>
+  void MarkAnchoredChunks(const std::vector<Index> &anchors,
+                          const std::vector<uint64_t> &isFree,
+                          IndexedDistances<Index> &anchorDistance,
+                          const OutgoingLists &outgoing,
+                          const IncomingLists &incoming) const {
+    std::vector<uint64_t> visited(isFree);
+    std::vector<uint64_t> onFrontier;
+    std::vector<Index> frontier;
+    std::vector<Index> nextFrontier;
+    EdgeIndex unreachedEdges = 0;
+    for (Index i = 0; i < _numAllocations; i++) {
+      if (!IsBitSet(visited, i)) {
+        unreachedEdges += incoming.NumEdges(i);
       }
     }
-    std::deque<Index> toVisit;
-    typename std::map<Index, const char *>::const_iterator itEnd =
-        anchorPoints.end();
-    for (typename std::map<Index, const char *>::const_iterator it =
-             anchorPoints.begin();
-         it != itEnd; ++it) {
-      Index index = it->first;
-      visited[index] = true;
-      _leaked[index] = false;
+    for (Index index : anchors) {
+      if (!IsBitSet(visited, index)) {
+        SetBit(visited, index);
+        unreachedEdges -= incoming.NumEdges(index);
+      }
       anchorDistance.SetDistance(index, 1);
-      toVisit.push_back(index);
-    }
-    while (!toVisit.empty()) {
-      Index sourceIndex = toVisit.front();
-      Index newDistance = anchorDistance.GetDistance(sourceIndex) + 1;
-      toVisit.pop_front();
-      EdgeIndex edgeLimit = _firstOutgoing[sourceIndex + 1];
-      for (EdgeIndex edgeIndex = _firstOutgoing[sourceIndex];
-           edgeIndex < edgeLimit; edgeIndex++) {
-        Index targetIndex = _outgoing[edgeIndex];
-        if (!visited[targetIndex]) {
-          visited[targetIndex] = true;
-          _leaked[targetIndex] = false;
-          anchorDistance.SetDistance(targetIndex, newDistance);
-          toVisit.push_back(targetIndex);
+      frontier.push_back(index);
+    }
+    for (Index distance = 2; !frontier.empty() && unreachedEdges != 0;
+         distance++) {
+      EdgeIndex frontierEdges = 0;
+      for (Index source : frontier) {
+        frontierEdges += outgoing.NumEdges(source);
+      }
+      nextFrontier.clear();
+      if (frontierEdges > unreachedEdges / BOTTOM_UP_EDGE_RATIO) {
+        onFrontier.assign(visited.size(), 0);
+        for (Index source : frontier) {
+          SetBit(onFrontier, source);
         }
+        for (size_t word = 0; word < visited.size(); word++) {
+          for (uint64_t unvisited = ~visited[word]; unvisited != 0;
+               unvisited &= unvisited - 1) {
+            Index target = (Index)((word << 6) + __builtin_ctzll(unvisited));
+            auto itEnd = incoming.end(target);
+            for (auto it = incoming.begin(target); it != itEnd; ++it) {
+              if (IsBitSet(onFrontier, *it)) {
+                nextFrontier.push_back(target);
+                break;
+              }
+            }
+          }
+        }
+        for (Index target : nextFrontier) {
+          SetBit(visited, target);
+        }
+      } else {
+        for (Index source : frontier) {
+          auto itEnd = outgoing.end(source);
+          for (auto it = outgoing.begin(source); it != itEnd; ++it) {
+            Index target = *it;
+            if (!IsBitSet(visited, target)) {
+              SetBit(visited, target);
+              nextFrontier.push_back(target);
+            }
+          }
+        }
+      }
+      for (Index target : nextFrontier) {
+        anchorDistance.SetDistance(target, distance);
+        unreachedEdges -= incoming.NumEdges(target);
       }
+      frontier.swap(nextFrontier);
     }
   }
 
   void FindAnchorPoints(Offset rangeBase, Offset rangeEnd,
                         AnchorPointMap &anchorPoints) {
     Reader reader(_addressMap);
+    bool hasKnownZeros = _addressMap.HasKnownZeros();
     for (Offset anchor = rangeBase; anchor < rangeEnd;
          anchor += sizeof(Offset)) {
+      if (hasKnownZeros && (anchor & (ZERO_SKIP_SIZE - 1)) == 0) {
+        anchor = _addressMap.SkipKnownZeros(anchor, rangeEnd);
+        if (anchor >= rangeEnd) {
+          break;
+        }
+      }
       try {
         Offset candidateTarget = reader.ReadOffset(anchor);
         Index targetIndex = EdgeTargetIndex(candidateTarget);
@@ -928,18 +1144,44 @@ class Graph {
     }
   }
 
+  /*
+   * Find the distances from each kind of anchor point, with the four
+   * traversals done concurrently if threads are available, then consider
+   * leaked any used allocation not reached by any of the traversals.
+   */
   void MarkLeakedChunks() {
-    _leaked.reserve(_numAllocations);
-    _leaked.resize(_numAllocations, true);
+    Statistics::Phase phase("MarkLeakedChunks");
+    std::vector<uint64_t> isFree((_numAllocations + 63) / 64, 0);
     for (Index i = 0; i < _numAllocations; i++) {
       if (!_directory.AllocationAt(i)->IsUsed()) {
-        _leaked[i] = false;
+        SetBit(isFree, i);
       }
     }
-    MarkAnchoredChunks(_staticAnchorPoints, _staticAnchorDistances);
-    MarkAnchoredChunks(_stackAnchorPoints, _stackAnchorDistances);
-    MarkAnchoredChunks(_registerAnchorPoints, _registerAnchorDistances);
-    MarkAnchoredChunks(_externalAnchorPoints, _externalAnchorDistances);
+    if ((_numAllocations & 63) != 0) {
+      isFree.back() |= ~0ULL << (_numAllocations & 63);
+    }
+    std::vector<Index> anchors[4] = {
+        AnchorIndices(_staticAnchorPoints), AnchorIndices(_stackAnchorPoints),
+        AnchorIndices(_registerAnchorPoints),
+        AnchorIndices(_externalAnchorPoints)};
+    IndexedDistances<Index> *distances[4] = {
+        &_staticAnchorDistances, &_stackAnchorDistances,
+        &_registerAnchorDistances, &_externalAnchorDistances};
+    Parallelism::ForEachChunk((size_t)4, (size_t)4,
+                              [&](size_t chunk, size_t, size_t) {
+                                MarkAnchoredChunks(anchors[chunk], isFree,
+                                                   *(distances[chunk]));
+                              });
+
+    _leaked.reserve(_numAllocations);
+    _leaked.resize(_numAllocations, false);
+    for (Index i = 0; i < _numAllocations; i++) {
+      _leaked[i] = !IsBitSet(isFree, i) &&
+                   _staticAnchorDistances.GetDistance(i) == 0 &&
+                   _stackAnchorDistances.GetDistance(i) == 0 &&
+                   _registerAnchorDistances.GetDistance(i) == 0 &&
+                   _externalAnchorDistances.GetDistance(i) == 0;
+    }
   }
 };
 }  // namespace Allocations
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include "../AnalysisCache.h"
 namespace chap {
 namespace Allocations {
 template <typename Index>
@@ -55,6 +56,45 @@ class IndexedDistances {
     }
   }
 
+  void Save(CacheWriter &writer) const {
+    writer.Put(_distanceBits);
+    if (_distanceBits == 8) {
+      writer.PutVector(_distances8);
+    } else if (_distanceBits == 16) {
+      writer.PutVector(_distances16);
+    } else {
+      writer.PutVector(_distances32);
+    }
+  }
+
+  void Restore(CacheReader &reader) {
+    uint16_t distanceBits = reader.Get<uint16_t>();
+    size_t numDistances;
+    if (distanceBits == 8) {
+      reader.GetVector(_distances8);
+      numDistances = _distances8.size();
+      _maxDistance = 0xFF;
+    } else if (distanceBits == 16) {
+      reader.GetVector(_distances16);
+      numDistances = _distances16.size();
+      _maxDistance = 0xFFFF;
+      std::vector<uint8_t> distances8;
+      distances8.swap(_distances8);
+    } else if (distanceBits == 32) {
+      reader.GetVector(_distances32);
+      numDistances = _distances32.size();
+      _maxDistance = 0xFFFFFFFF;
+      std::vector<uint8_t> distances8;
+      distances8.swap(_distances8);
+    } else {
+      throw CacheReader::Invalid();
+    }
+    if (numDistances != _numIndices) {
+      throw CacheReader::Invalid();
+    }
+    _distanceBits = distanceBits;
+  }
+
   Index GetDistance(Index index) const {
     if (_distanceBits == 8) {
       return _distances8[index];
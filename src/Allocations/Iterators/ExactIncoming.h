@@ -96,7 +96,7 @@ class ExactIncoming {
   };
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
   typedef typename Directory<Offset>::Allocation Allocation;
-  typedef typename Graph<Offset>::EdgeIndex EdgeIndex;
+  typedef typename Graph<Offset>::EdgeIterator EdgeIterator;
 
   ExactIncoming(const Directory<Offset>& directory, const Graph<Offset>& graph,
                 const VirtualAddressMap<Offset>& addressMap,
@@ -116,12 +116,15 @@ class ExactIncoming {
         _edgeIsFavored(*edgeIsFavored),
         _skipUnfavoredReferences(skipUnfavoredReferences) {
     _target = _directory.AllocationAt(index)->Address();
-    _graph.GetIncoming(index, _nextIncoming, _pastIncoming);
+    typename Graph<Offset>::EdgeRange edges = _graph.GetIncoming(index);
+    _nextIncoming = edges.begin();
+    _pastIncoming = edges.end();
   }
 
   AllocationIndex Next() {
-    for (; _nextIncoming != _pastIncoming; _nextIncoming++) {
-      if (_skipTaintedReferences && _edgeIsTainted.ForIncoming(_nextIncoming)) {
+    for (; _nextIncoming != _pastIncoming; ++_nextIncoming) {
+      if (_skipTaintedReferences &&
+          _edgeIsTainted.ForIncoming(_nextIncoming.Edge())) {
         continue;
       }
       /*
@@ -130,10 +133,10 @@ class ExactIncoming {
        * not to support favored references.
        */
       if (_skipUnfavoredReferences &&
-          !_edgeIsFavored.ForIncoming(_nextIncoming)) {
+          !_edgeIsFavored.ForIncoming(_nextIncoming.Edge())) {
         continue;
       }
-      AllocationIndex index = _graph.GetSourceForIncoming(_nextIncoming);
+      AllocationIndex index = *_nextIncoming;
       const Allocation* allocation = _directory.AllocationAt(index);
       if (allocation == nullptr) {
         abort();
@@ -145,7 +148,7 @@ class ExactIncoming {
         for (const Offset* nextOffset = firstOffset; nextOffset != offsetLimit;
              nextOffset++) {
           if (_target == *nextOffset) {
-            _nextIncoming++;
+            ++_nextIncoming;
             return index;
           }
         }
@@ -165,8 +168,8 @@ class ExactIncoming {
   bool _skipTaintedReferences;
   const EdgePredicate<Offset>& _edgeIsFavored;
   bool _skipUnfavoredReferences;
-  EdgeIndex _nextIncoming;
-  EdgeIndex _pastIncoming;
+  EdgeIterator _nextIncoming;
+  EdgeIterator _pastIncoming;
   Offset _target;
 };
 }  // namespace Iterators
@@ -91,7 +91,7 @@ class FreeOutgoing {
   };
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
   typedef typename Directory<Offset>::Allocation Allocation;
-  typedef typename Graph<Offset>::EdgeIndex EdgeIndex;
+  typedef typename Graph<Offset>::EdgeIterator EdgeIterator;
   FreeOutgoing(const Directory<Offset>& directory, const Graph<Offset>& graph,
                AllocationIndex index, AllocationIndex numAllocations,
                const EdgePredicate<Offset>* edgeIsTainted,
@@ -102,12 +102,15 @@ class FreeOutgoing {
         _numAllocations(numAllocations),
         _edgeIsTainted(*edgeIsTainted),
         _skipTaintedReferences(skipTaintedReferences) {
-    _graph.GetOutgoing(index, _nextOutgoing, _pastOutgoing);
+    typename Graph<Offset>::EdgeRange edges = _graph.GetOutgoing(index);
+    _nextOutgoing = edges.begin();
+    _pastOutgoing = edges.end();
   }
 
   AllocationIndex Next() {
-    for (; _nextOutgoing != _pastOutgoing; _nextOutgoing++) {
-      if (_skipTaintedReferences && _edgeIsTainted.ForOutgoing(_nextOutgoing)) {
+    for (; _nextOutgoing != _pastOutgoing; ++_nextOutgoing) {
+      if (_skipTaintedReferences &&
+          _edgeIsTainted.ForOutgoing(_nextOutgoing.Edge())) {
         continue;
       }
       /*
@@ -115,13 +118,13 @@ class FreeOutgoing {
        * allocation isn't tagged, so an edge for which the target is a free
        * allocation is neither favored nor unfavored.
        */
-      AllocationIndex index = _graph.GetTargetForOutgoing(_nextOutgoing);
+      AllocationIndex index = *_nextOutgoing;
       const Allocation* allocation = _directory.AllocationAt(index);
       if (allocation == nullptr) {
         abort();
       }
       if (!allocation->IsUsed()) {
-        _nextOutgoing++;
+        ++_nextOutgoing;
         return index;
       }
     }
@@ -135,8 +138,8 @@ class FreeOutgoing {
   AllocationIndex _numAllocations;
   const EdgePredicate<Offset>& _edgeIsTainted;
   bool _skipTaintedReferences;
-  EdgeIndex _nextOutgoing;
-  EdgeIndex _pastOutgoing;
+  EdgeIterator _nextOutgoing;
+  EdgeIterator _pastOutgoing;
 };
 }  // namespace Iterators
 }  // namespace Allocations
@@ -94,7 +94,7 @@ class Incoming {
   };
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
   typedef typename Directory<Offset>::Allocation Allocation;
-  typedef typename Graph<Offset>::EdgeIndex EdgeIndex;
+  typedef typename Graph<Offset>::EdgeIterator EdgeIterator;
 
   Incoming(const Directory<Offset>& directory, const Graph<Offset>& graph,
            AllocationIndex index, AllocationIndex numAllocations,
@@ -110,11 +110,14 @@ class Incoming {
         _skipTaintedReferences(skipTaintedReferences),
         _edgeIsFavored(*edgeIsFavored),
         _skipUnfavoredReferences(skipUnfavoredReferences) {
-    _graph.GetIncoming(index, _nextIncoming, _pastIncoming);
+    typename Graph<Offset>::EdgeRange edges = _graph.GetIncoming(index);
+    _nextIncoming = edges.begin();
+    _pastIncoming = edges.end();
   }
   AllocationIndex Next() {
-    for (; _nextIncoming != _pastIncoming; _nextIncoming++) {
-      if (_skipTaintedReferences && _edgeIsTainted.ForIncoming(_nextIncoming)) {
+    for (; _nextIncoming != _pastIncoming; ++_nextIncoming) {
+      if (_skipTaintedReferences &&
+          _edgeIsTainted.ForIncoming(_nextIncoming.Edge())) {
         continue;
       }
       /*
@@ -122,16 +125,16 @@ class Incoming {
        * determined not to support favored references.
        */
       if (_skipUnfavoredReferences &&
-          !_edgeIsFavored.ForIncoming(_nextIncoming)) {
+          !_edgeIsFavored.ForIncoming(_nextIncoming.Edge())) {
         continue;
       }
-      AllocationIndex index = _graph.GetSourceForIncoming(_nextIncoming);
+      AllocationIndex index = *_nextIncoming;
       const Allocation* allocation = _directory.AllocationAt(index);
       if (allocation == nullptr) {
         abort();
       }
       if (allocation->IsUsed()) {
-        _nextIncoming++;
+        ++_nextIncoming;
         return index;
       }
     }
@@ -147,8 +150,8 @@ class Incoming {
   bool _skipTaintedReferences;
   const EdgePredicate<Offset>& _edgeIsFavored;
   bool _skipUnfavoredReferences;
-  EdgeIndex _nextIncoming;
-  EdgeIndex _pastIncoming;
+  EdgeIterator _nextIncoming;
+  EdgeIterator _pastIncoming;
 };
 }  // namespace Iterators
 }  // namespace Allocations
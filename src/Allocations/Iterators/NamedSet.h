@@ -0,0 +1,75 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include "../../Commands/Runner.h"
+#include "../../Commands/Subcommand.h"
+#include "../Directory.h"
+#include "../SetCache.h"
+namespace chap {
+namespace Allocations {
+namespace Iterators {
+/*
+ * This visits the members of a set saved by "set save" or by one of the
+ * other forms of the "set" command.  The set is specified as "@" followed
+ * by its name, so all the named sets share one subcommand per command.
+ */
+template <class Offset>
+class NamedSet {
+ public:
+  class Factory {
+   public:
+    Factory() : _setName("@") {}
+    NamedSet* MakeIterator(Commands::Context& context,
+                           const ProcessImage<Offset>& /* processImage */,
+                           const Directory<Offset>& directory,
+                           const SetCache<Offset>& setCache) {
+      std::string name = context.Positional(1).substr(1);
+      const PackedSet<Offset>* packedSet = setCache.FindNamedSet(name);
+      if (packedSet == nullptr) {
+        context.GetError() << "There is no set named \"" << name << "\".\n";
+        return nullptr;
+      }
+      return new NamedSet(directory.NumAllocations(), *packedSet);
+    }
+    // TODO: allow adding taints
+    const std::string& GetSetName() const { return _setName; }
+    size_t GetNumArguments() { return 0; }
+    const std::vector<std::string>& GetTaints() const { return _taints; }
+    void ShowHelpMessage(Commands::Context& context) {
+      Commands::Output& output = context.GetOutput();
+      output << "Use \"@<name>\" to specify a set saved with that name by"
+                " the \"set\" command.\n";
+    }
+
+   private:
+    const std::vector<std::string> _taints;
+    const std::string _setName;
+  };
+  typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
+
+  NamedSet(AllocationIndex numAllocations, const PackedSet<Offset>& packedSet)
+      : _index(0), _numAllocations(numAllocations), _members(numAllocations) {
+    packedSet.Unpack(_members);
+  }
+  AllocationIndex Next() {
+    if (_index == _numAllocations) {
+      return _numAllocations;
+    }
+    _index = _members.NextUsed(_index);
+    AllocationIndex next = _index;
+    if (_index != _numAllocations) {
+      ++_index;
+    }
+    return next;
+  }
+
+ private:
+  AllocationIndex _index;
+  AllocationIndex _numAllocations;
+  Set<Offset> _members;
+};
+}  // namespace Iterators
+}  // namespace Allocations
+}  // namespace chap
@@ -86,7 +86,7 @@ class Outgoing {
   };
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
   typedef typename Directory<Offset>::Allocation Allocation;
-  typedef typename Graph<Offset>::EdgeIndex EdgeIndex;
+  typedef typename Graph<Offset>::EdgeIterator EdgeIterator;
 
   Outgoing(const Directory<Offset>& directory, const Graph<Offset>& graph,
            AllocationIndex index, AllocationIndex numAllocations,
@@ -104,18 +104,21 @@ class Outgoing {
         _skipTaintedReferences(skipTaintedReferences),
         _edgeIsFavored(*edgeIsFavored),
         _skipUnfavoredReferences(skipUnfavoredReferences) {
-    _graph.GetOutgoing(index, _nextOutgoing, _pastOutgoing);
+    typename Graph<Offset>::EdgeRange edges = _graph.GetOutgoing(index);
+    _nextOutgoing = edges.begin();
+    _pastOutgoing = edges.end();
   }
 
   AllocationIndex Next() {
-    for (; _nextOutgoing != _pastOutgoing; _nextOutgoing++) {
-      if (_skipTaintedReferences && _edgeIsTainted.ForOutgoing(_nextOutgoing)) {
+    for (; _nextOutgoing != _pastOutgoing; ++_nextOutgoing) {
+      if (_skipTaintedReferences &&
+          _edgeIsTainted.ForOutgoing(_nextOutgoing.Edge())) {
         continue;
       }
-      AllocationIndex index = _graph.GetTargetForOutgoing(_nextOutgoing);
+      AllocationIndex index = *_nextOutgoing;
       if (_skipUnfavoredReferences &&
           _tagHolder.SupportsFavoredReferences(index) &&
-          !_edgeIsFavored.ForOutgoing(_nextOutgoing)) {
+          !_edgeIsFavored.ForOutgoing(_nextOutgoing.Edge())) {
         continue;
       }
       const Allocation* allocation = _directory.AllocationAt(index);
@@ -123,7 +126,7 @@ class Outgoing {
         abort();
       }
       if (allocation->IsUsed()) {
-        _nextOutgoing++;
+        ++_nextOutgoing;
         return index;
       }
     }
@@ -140,8 +143,8 @@ class Outgoing {
   bool _skipTaintedReferences;
   const EdgePredicate<Offset>& _edgeIsFavored;
   bool _skipUnfavoredReferences;
-  EdgeIndex _nextOutgoing;
-  EdgeIndex _pastOutgoing;
+  EdgeIterator _nextOutgoing;
+  EdgeIterator _pastOutgoing;
 };
 }  // namespace Iterators
 }  // namespace Allocations
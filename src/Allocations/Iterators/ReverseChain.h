@@ -112,15 +112,13 @@ class ReverseChain {
       }
       if (target->Size() >= _targetOffset) {
         Offset targetAddress = target->Address();
-        const AllocationIndex* pNextIncoming;
-        const AllocationIndex* pPastIncoming;
-        _graph.GetIncoming(_index, &pNextIncoming, &pPastIncoming);
+        typename Graph<Offset>::EdgeRange incoming =
+            _graph.GetIncoming(_index);
 
         _index = _numAllocations;
         bool suitableIncomingFound = false;
         typename VirtualAddressMap<Offset>::Reader reader(_addressMap);
-        while (pNextIncoming != pPastIncoming) {
-          AllocationIndex index = *(pNextIncoming++);
+        for (AllocationIndex index : incoming) {
           const Allocation* source = _directory.AllocationAt(index);
           if (source == ((Allocation*)(0))) {
             abort();
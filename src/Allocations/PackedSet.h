@@ -0,0 +1,151 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "../AnalysisCache.h"
+#include "Directory.h"
+#include "Set.h"
+namespace chap {
+namespace Allocations {
+/*
+ * This is a compact copy of a Set, used for sets that are kept for a long
+ * time, such as named sets.  As in a roaring bitmap, the allocation indices
+ * are split into blocks of 2^16 and each block that has any members is
+ * held either as the sorted low 16 bits of the members, if there are few
+ * enough of them, or as a bitmap, so that a sparse set takes about two
+ * bytes per member and a dense one takes little more than the Set would.
+ */
+template <class Offset>
+class PackedSet {
+ public:
+  typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
+
+  PackedSet() : _numAllocations(0), _count(0) {}
+
+  PackedSet(const Set<Offset>& set)
+      : _numAllocations(set.NumAllocations()), _count(0) {
+    const uint64_t* words = set.GetWords();
+    AllocationIndex numWords = set.NumWords();
+    for (AllocationIndex base = 0; base < numWords; base += WORDS_PER_BLOCK) {
+      AllocationIndex limit = base + WORDS_PER_BLOCK;
+      if (limit > numWords) {
+        limit = numWords;
+      }
+      uint32_t numMembers = 0;
+      for (AllocationIndex i = base; i < limit; i++) {
+        numMembers += (uint32_t)__builtin_popcountll(words[i]);
+      }
+      if (numMembers == 0) {
+        continue;
+      }
+      _count += numMembers;
+      Block block;
+      block._block = base / WORDS_PER_BLOCK;
+      block._numMembers = numMembers;
+      if (numMembers <= MAX_LOWS_PER_BLOCK) {
+        block._start = _lows.size();
+        for (AllocationIndex i = base; i < limit; i++) {
+          for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+            _lows.push_back((uint16_t)((i - base) * 64 +
+                                       __builtin_ctzll(word)));
+          }
+        }
+      } else {
+        block._start = _bitmaps.size();
+        _bitmaps.insert(_bitmaps.end(), words + base, words + limit);
+        _bitmaps.resize(block._start + WORDS_PER_BLOCK, 0);
+      }
+      _blocks.push_back(block);
+    }
+  }
+
+  AllocationIndex NumAllocations() const { return _numAllocations; }
+  AllocationIndex Count() const { return _count; }
+
+  /*
+   * Replace the contents of the given set, which must be for the same
+   * number of allocations, by the members of this one.
+   */
+  void Unpack(Set<Offset>& set) const {
+    set.Clear();
+    uint64_t* words = set.GetWords();
+    AllocationIndex numWords = set.NumWords();
+    for (const Block& block : _blocks) {
+      AllocationIndex base = block._block * WORDS_PER_BLOCK;
+      if (block._numMembers <= MAX_LOWS_PER_BLOCK) {
+        const uint16_t* lows = _lows.data() + block._start;
+        for (uint32_t i = 0; i < block._numMembers; i++) {
+          AllocationIndex wordIndex = base + lows[i] / 64;
+          if (wordIndex < numWords) {
+            words[wordIndex] |= (uint64_t)(1) << (lows[i] & 63);
+          }
+        }
+      } else {
+        AllocationIndex limit = base + WORDS_PER_BLOCK;
+        if (limit > numWords) {
+          limit = numWords;
+        }
+        const uint64_t* bitmap = _bitmaps.data() + block._start;
+        for (AllocationIndex i = base; i < limit; i++) {
+          words[i] = *bitmap++;
+        }
+      }
+    }
+  }
+
+  void Save(CacheWriter& writer) const {
+    writer.Put((uint64_t)_numAllocations);
+    writer.PutVector(_blocks);
+    writer.PutVector(_lows);
+    writer.PutVector(_bitmaps);
+  }
+
+  /*
+   * Restore a set saved by Save, throwing CacheReader::Invalid if it does
+   * not fit the given number of allocations.
+   */
+  void Restore(CacheReader& reader, AllocationIndex numAllocations) {
+    if (reader.Get<uint64_t>() != numAllocations) {
+      throw CacheReader::Invalid();
+    }
+    _numAllocations = numAllocations;
+    reader.GetVector(_blocks);
+    reader.GetVector(_lows);
+    reader.GetVector(_bitmaps);
+    AllocationIndex numBlocks =
+        (numAllocations + WORDS_PER_BLOCK * 64 - 1) / (WORDS_PER_BLOCK * 64);
+    _count = 0;
+    for (const Block& block : _blocks) {
+      uint64_t limit =
+          block._start + ((block._numMembers <= MAX_LOWS_PER_BLOCK)
+                              ? block._numMembers
+                              : WORDS_PER_BLOCK);
+      if (block._block >= numBlocks || block._numMembers == 0 ||
+          limit > ((block._numMembers <= MAX_LOWS_PER_BLOCK)
+                       ? _lows.size()
+                       : _bitmaps.size())) {
+        throw CacheReader::Invalid();
+      }
+      _count += block._numMembers;
+    }
+  }
+
+ private:
+  static constexpr AllocationIndex WORDS_PER_BLOCK = (1 << 16) / 64;
+  static constexpr uint32_t MAX_LOWS_PER_BLOCK = 4096;
+  struct Block {
+    uint32_t _block;
+    uint32_t _numMembers;
+    uint64_t _start;
+  };
+  AllocationIndex _numAllocations;
+  AllocationIndex _count;
+  std::vector<Block> _blocks;
+  std::vector<uint16_t> _lows;
+  std::vector<uint64_t> _bitmaps;
+};
+}  // namespace Allocations
+}  // namespace chap
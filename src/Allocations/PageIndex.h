@@ -0,0 +1,181 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+namespace chap {
+namespace Allocations {
+/*
+ * This maps each page that overlaps at least one allocation to the range of
+ * allocation indices that may contain an address in that page, so that
+ * finding the allocation containing an address normally requires a few table
+ * loads plus a very short search, rather than a binary search over all the
+ * allocations.  Pages that don't overlap any allocation map to an empty range,
+ * which provides a fast rejection of values that don't point to allocations.
+ *
+ * The table has three levels: one entry per 1 GB region in the range of
+ * addresses that includes all the allocations, one entry per 2 MB region in
+ * each 1 GB region that has any allocations, and one entry per page in each 2
+ * MB region that has any allocations.  Block 0 and leaf 0 are reserved to be
+ * empty so that a lookup never needs to check for missing levels.
+ */
+template <class Offset, class Index>
+class PageIndex {
+ public:
+  PageIndex() : _isBuilt(false) {}
+
+  /*
+   * Build the table from allocations sorted by increasing address, where
+   * only allocations for which isIndexed returns true are considered.  The
+   * table is not built if it would be too large relative to the number of
+   * allocations (for example, if there are just a few huge allocations)
+   * because the binary search is fine for that case.
+   */
+  template <class Allocation, class IsIndexed>
+  void Build(const std::vector<Allocation> &allocations, IsIndexed isIndexed) {
+    Clear();
+    Index numAllocations = allocations.size();
+    size_t numLeaves = 1;
+    size_t numBlocks = 1;
+    Offset prevLeafKey = ~((Offset)0);
+    Offset prevBlockKey = ~((Offset)0);
+    Offset maxAddress = 0;
+    for (Index i = 0; i < numAllocations; i++) {
+      const Allocation &allocation = allocations[i];
+      if (allocation.Size() == 0 || !isIndexed(allocation)) {
+        continue;
+      }
+      Offset address = allocation.Address();
+      Offset lastAddress = address + allocation.Size() - 1;
+      Offset leafKey = address >> LEAF_SHIFT;
+      if (leafKey == prevLeafKey) {
+        leafKey++;
+      }
+      Offset lastLeafKey = lastAddress >> LEAF_SHIFT;
+      for (; leafKey <= lastLeafKey; leafKey++) {
+        numLeaves++;
+        Offset blockKey = leafKey >> BLOCK_SHIFT_IN_LEAVES;
+        if (blockKey != prevBlockKey) {
+          numBlocks++;
+          prevBlockKey = blockKey;
+        }
+      }
+      prevLeafKey = lastLeafKey;
+      maxAddress = lastAddress;
+    }
+    if (numLeaves == 1) {
+      return;
+    }
+    size_t tableBytes = numLeaves * ENTRIES_PER_LEAF * sizeof(PageEntry) +
+                        numBlocks * LEAVES_PER_BLOCK * sizeof(uint32_t);
+    if (tableBytes > MAX_BYTES_PER_ALLOCATION * numAllocations + MIN_BYTES) {
+      return;
+    }
+
+    _blockForRegion.resize((maxAddress >> REGION_SHIFT) + 1, 0);
+    _leafForBlockSlot.reserve(numBlocks * LEAVES_PER_BLOCK);
+    _leafForBlockSlot.resize(LEAVES_PER_BLOCK, 0);
+    _pageEntries.reserve(numLeaves * ENTRIES_PER_LEAF);
+    _pageEntries.resize(ENTRIES_PER_LEAF);
+    for (Index i = 0; i < numAllocations; i++) {
+      const Allocation &allocation = allocations[i];
+      if (allocation.Size() == 0 || !isIndexed(allocation)) {
+        continue;
+      }
+      Offset address = allocation.Address();
+      Offset lastAddress = address + allocation.Size() - 1;
+      for (Offset page = address >> PAGE_SHIFT;
+           page <= (lastAddress >> PAGE_SHIFT); page++) {
+        PageEntry &entry = EntryForPage(page);
+        if (entry._past == 0) {
+          entry._first = i;
+        }
+        entry._past = i + 1;
+      }
+    }
+    _isBuilt = true;
+  }
+
+  void Clear() {
+    _isBuilt = false;
+    _blockForRegion.clear();
+    _leafForBlockSlot.clear();
+    _pageEntries.clear();
+  }
+
+  bool IsBuilt() const { return _isBuilt; }
+
+  /*
+   * Set [first, past) to the range of indices of indexed allocations that
+   * may contain the given address.  The range is empty if no indexed
+   * allocation contains the address.  This must be called only if the table
+   * is built.
+   */
+  void Find(Offset address, Index &first, Index &past) const {
+    Offset region = address >> REGION_SHIFT;
+    if (region >= _blockForRegion.size()) {
+      first = 0;
+      past = 0;
+      return;
+    }
+    uint32_t leaf =
+        _leafForBlockSlot[((size_t)(_blockForRegion[region])
+                           << BLOCK_SHIFT_IN_LEAVES) |
+                          ((address >> LEAF_SHIFT) & (LEAVES_PER_BLOCK - 1))];
+    const PageEntry &entry =
+        _pageEntries[((size_t)leaf << LEAF_SHIFT_IN_PAGES) |
+                     ((address >> PAGE_SHIFT) & (ENTRIES_PER_LEAF - 1))];
+    first = entry._first;
+    past = entry._past;
+  }
+
+ private:
+  static constexpr int PAGE_SHIFT = 12;
+  static constexpr int LEAF_SHIFT_IN_PAGES = 9;
+  static constexpr int LEAF_SHIFT = PAGE_SHIFT + LEAF_SHIFT_IN_PAGES;
+  static constexpr int BLOCK_SHIFT_IN_LEAVES = 9;
+  static constexpr int REGION_SHIFT = LEAF_SHIFT + BLOCK_SHIFT_IN_LEAVES;
+  static constexpr size_t ENTRIES_PER_LEAF = 1 << LEAF_SHIFT_IN_PAGES;
+  static constexpr size_t LEAVES_PER_BLOCK = 1 << BLOCK_SHIFT_IN_LEAVES;
+  static constexpr size_t MAX_BYTES_PER_ALLOCATION = 16;
+  static constexpr size_t MIN_BYTES = 1 << 24;
+
+  struct PageEntry {
+    PageEntry() : _first(0), _past(0) {}
+    Index _first;
+    Index _past;
+  };
+
+  /*
+   * Return the entry for the given page, adding a block and leaf as needed.
+   */
+  PageEntry &EntryForPage(Offset page) {
+    Offset region = page >> (REGION_SHIFT - PAGE_SHIFT);
+    uint32_t block = _blockForRegion[region];
+    if (block == 0) {
+      block = _leafForBlockSlot.size() / LEAVES_PER_BLOCK;
+      _blockForRegion[region] = block;
+      _leafForBlockSlot.resize(_leafForBlockSlot.size() + LEAVES_PER_BLOCK, 0);
+    }
+    uint32_t &leaf =
+        _leafForBlockSlot[((size_t)block << BLOCK_SHIFT_IN_LEAVES) |
+                          ((page >> LEAF_SHIFT_IN_PAGES) &
+                           (LEAVES_PER_BLOCK - 1))];
+    if (leaf == 0) {
+      leaf = _pageEntries.size() / ENTRIES_PER_LEAF;
+      _pageEntries.resize(_pageEntries.size() + ENTRIES_PER_LEAF);
+    }
+    return _pageEntries[((size_t)leaf << LEAF_SHIFT_IN_PAGES) |
+                        (page & (ENTRIES_PER_LEAF - 1))];
+  }
+
+  bool _isBuilt;
+  std::vector<uint32_t> _blockForRegion;
+  std::vector<uint32_t> _leafForBlockSlot;
+  std::vector<PageEntry> _pageEntries;
+};
+}  // namespace Allocations
+}  // namespace chap
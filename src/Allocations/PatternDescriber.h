@@ -18,9 +18,7 @@ class PatternDescriber {
         _processImage(processImage),
         _addressMap(processImage.GetVirtualAddressMap()),
         _directory(processImage.GetAllocationDirectory()),
-        _graph(processImage.GetAllocationGraph()),
-        _moduleDirectory(processImage.GetModuleDirectory()),
-        _tagHolder(*(processImage.GetAllocationTagHolder())) {}
+        _moduleDirectory(processImage.GetModuleDirectory()) {}
 
   const std::string& GetName() const { return _name; }
 
@@ -36,9 +34,18 @@ class PatternDescriber {
   const ProcessImage<Offset>& _processImage;
   const VirtualAddressMap<Offset>& _addressMap;
   const Directory<Offset>& _directory;
-  const Graph<Offset>* _graph;
   const ModuleDirectory<Offset>& _moduleDirectory;
-  const Allocations::TagHolder<Offset>& _tagHolder;
+
+  /*
+   * The graph and the tags are looked up on each use, rather than when the
+   * describer is created, because they are found only when first needed.
+   */
+  const Graph<Offset>& GetGraph() const {
+    return *(_processImage.GetAllocationGraph());
+  }
+  const Allocations::TagHolder<Offset>& GetTagHolder() const {
+    return *(_processImage.GetAllocationTagHolder());
+  }
 };
 }  // namespace Allocations
 }  // namespace chap
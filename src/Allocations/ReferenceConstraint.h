@@ -22,7 +22,6 @@ class ReferenceConstraint {
  public:
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
   typedef typename Directory<Offset>::Allocation Allocation;
-  typedef typename Graph<Offset>::EdgeIndex EdgeIndex;
   enum BoundaryType { MINIMUM, MAXIMUM };
   enum ReferenceType { INCOMING, OUTGOING };
   ReferenceConstraint(
@@ -58,9 +57,6 @@ class ReferenceConstraint {
   bool Check(AllocationIndex index) const {
     size_t numMatchingEdges = 0;
     if (_referenceType == INCOMING) {
-      EdgeIndex firstIncoming;
-      EdgeIndex pastIncoming;
-      _graph.GetIncoming(index, firstIncoming, pastIncoming);
       bool skipUnfavoredReferences = _skipUnfavoredReferences;
       if (!_tagHolder.SupportsFavoredReferences(index)) {
         /*
@@ -69,17 +65,15 @@ class ReferenceConstraint {
          */
         skipUnfavoredReferences = false;
       }
-      for (EdgeIndex nextIncoming = firstIncoming; nextIncoming != pastIncoming;
-           nextIncoming++) {
-        if (_skipTaintedReferences &&
-            _edgeIsTainted.ForIncoming(nextIncoming)) {
+      typename Graph<Offset>::EdgeRange incoming = _graph.GetIncoming(index);
+      for (auto it = incoming.begin(); it != incoming.end(); ++it) {
+        if (_skipTaintedReferences && _edgeIsTainted.ForIncoming(it.Edge())) {
           continue;
         }
-        if (skipUnfavoredReferences &&
-            !_edgeIsFavored.ForIncoming(nextIncoming)) {
+        if (skipUnfavoredReferences && !_edgeIsFavored.ForIncoming(it.Edge())) {
           continue;
         }
-        AllocationIndex sourceIndex = _graph.GetSourceForIncoming(nextIncoming);
+        AllocationIndex sourceIndex = *it;
         const Allocation& allocation = *(_directory.AllocationAt(sourceIndex));
         if ((allocation.IsUsed() == _wantUsed) &&
             (_signatureChecker.Check(sourceIndex, allocation))) {
@@ -87,19 +81,15 @@ class ReferenceConstraint {
         }
       }
     } else {
-      EdgeIndex firstOutgoing;
-      EdgeIndex pastOutgoing;
-      _graph.GetOutgoing(index, firstOutgoing, pastOutgoing);
-      for (EdgeIndex nextOutgoing = firstOutgoing; nextOutgoing != pastOutgoing;
-           nextOutgoing++) {
-        if (_skipTaintedReferences &&
-            _edgeIsTainted.ForOutgoing(nextOutgoing)) {
+      typename Graph<Offset>::EdgeRange outgoing = _graph.GetOutgoing(index);
+      for (auto it = outgoing.begin(); it != outgoing.end(); ++it) {
+        if (_skipTaintedReferences && _edgeIsTainted.ForOutgoing(it.Edge())) {
           continue;
         }
-        AllocationIndex targetIndex = _graph.GetTargetForOutgoing(nextOutgoing);
+        AllocationIndex targetIndex = *it;
         if (_skipUnfavoredReferences &&
             _tagHolder.SupportsFavoredReferences(targetIndex) &&
-            !_edgeIsFavored.ForOutgoing(nextOutgoing)) {
+            !_edgeIsFavored.ForOutgoing(it.Edge())) {
           continue;
         }
         const Allocation& allocation = *(_directory.AllocationAt(targetIndex));
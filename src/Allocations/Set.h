@@ -1,13 +1,23 @@
-// Copyright (c) 2020 Broadcom. All Rights Reserved.
+// Copyright (c) 2020,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <stdint.h>
 #include <string.h>
 #include <memory>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 #include "Directory.h"
 namespace chap {
 namespace Allocations {
+/*
+ * This is a set of allocations, as one bit per allocation index.  The
+ * operations that combine two sets work a word at a time or, if the CPU
+ * supports AVX2, as checked at run time so that chap need not be built for
+ * a particular CPU, four words at a time.
+ */
 template <class Offset>
 class Set {
  public:
@@ -53,27 +63,126 @@ class Set {
     return retVal;
   }
 
-  void Assign(const Set<Offset> &other) {
-    uint64_t *to = _asU64.get();
-    const uint64_t *from = other._asU64.get();
+  void Assign(const Set<Offset> &other) { Combine<AssignOperation>(other); }
+  void Subtract(const Set<Offset> &other) {
+    Combine<SubtractOperation>(other);
+  }
+  void Union(const Set<Offset> &other) { Combine<UnionOperation>(other); }
+  void Intersect(const Set<Offset> &other) {
+    Combine<IntersectOperation>(other);
+  }
+
+  /*
+   * Replace the set by the set of all the allocations, used or free, that
+   * it does not contain.
+   */
+  void Complement() {
+    uint64_t *words = _asU64.get();
     for (AllocationIndex i = 0; i < _numU64; i++) {
-      *to++ = *from++;
+      words[i] = ~words[i];
+    }
+    AllocationIndex numInLastWord = _numAllocations & (AllocationIndex)(63);
+    if (numInLastWord != 0) {
+      words[_numU64 - 1] &= ((uint64_t)(1) << numInLastWord) - 1;
     }
   }
-  void Subtract(const Set<Offset> &other) {
-    uint64_t *to = _asU64.get();
-    const uint64_t *from = other._asU64.get();
+
+  AllocationIndex Count() const {
+    AllocationIndex count = 0;
+    const uint64_t *words = _asU64.get();
     for (AllocationIndex i = 0; i < _numU64; i++) {
-      *to++ &= ~(*from++);
+      count += (AllocationIndex)__builtin_popcountll(words[i]);
     }
+    return count;
   }
 
+  AllocationIndex NumAllocations() const { return _numAllocations; }
+  AllocationIndex NumWords() const { return _numU64; }
+  uint64_t *GetWords() { return _asU64.get(); }
+  const uint64_t *GetWords() const { return _asU64.get(); }
+
  private:
   AllocationIndex _numAllocations;
   AllocationIndex _numU64;
   AllocationIndex _numU8;
 
   std::unique_ptr<uint64_t[]> _asU64;
+
+  struct AssignOperation {
+    static uint64_t Apply(uint64_t, uint64_t from) { return from; }
+#if defined(__x86_64__)
+    __attribute__((target("avx2"))) static __m256i Apply(__m256i,
+                                                         __m256i from) {
+      return from;
+    }
+#endif
+  };
+  struct SubtractOperation {
+    static uint64_t Apply(uint64_t to, uint64_t from) { return to & ~from; }
+#if defined(__x86_64__)
+    __attribute__((target("avx2"))) static __m256i Apply(__m256i to,
+                                                         __m256i from) {
+      return _mm256_andnot_si256(from, to);
+    }
+#endif
+  };
+  struct UnionOperation {
+    static uint64_t Apply(uint64_t to, uint64_t from) { return to | from; }
+#if defined(__x86_64__)
+    __attribute__((target("avx2"))) static __m256i Apply(__m256i to,
+                                                         __m256i from) {
+      return _mm256_or_si256(to, from);
+    }
+#endif
+  };
+  struct IntersectOperation {
+    static uint64_t Apply(uint64_t to, uint64_t from) { return to & from; }
+#if defined(__x86_64__)
+    __attribute__((target("avx2"))) static __m256i Apply(__m256i to,
+                                                         __m256i from) {
+      return _mm256_and_si256(to, from);
+    }
+#endif
+  };
+
+  template <typename Operation>
+  void Combine(const Set<Offset> &other) {
+    uint64_t *to = _asU64.get();
+    const uint64_t *from = other._asU64.get();
+    AllocationIndex i = 0;
+#if defined(__x86_64__)
+    if (HasAVX2()) {
+      i = CombineWithAVX2<Operation>(to, from);
+    }
+#endif
+    for (; i < _numU64; i++) {
+      to[i] = Operation::Apply(to[i], from[i]);
+    }
+  }
+
+#if defined(__x86_64__)
+  static bool HasAVX2() {
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    return hasAVX2;
+  }
+
+  /*
+   * Combine as many whole groups of four words as there are, returning the
+   * number of words done.
+   */
+  template <typename Operation>
+  __attribute__((target("avx2"))) AllocationIndex CombineWithAVX2(
+      uint64_t *to, const uint64_t *from) {
+    AllocationIndex i = 0;
+    for (; i + 4 <= _numU64; i += 4) {
+      __m256i toWords = _mm256_loadu_si256((const __m256i *)(to + i));
+      __m256i fromWords = _mm256_loadu_si256((const __m256i *)(from + i));
+      _mm256_storeu_si256((__m256i *)(to + i),
+                          Operation::Apply(toWords, fromWords));
+    }
+    return i;
+  }
+#endif
 };
 }  // namespace Allocations
 }  // namespace chap
@@ -1,28 +1,153 @@
-// Copyright (c) 2020 Broadcom. All Rights Reserved.
+// Copyright (c) 2020,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <map>
 #include <memory>
+#include <string>
+#include "../AnalysisCache.h"
+#include "../FileImage.h"
 #include "Directory.h"
+#include "PackedSet.h"
 #include "Set.h"
 namespace chap {
 namespace Allocations {
 template <class Offset>
 class SetCache {
  public:
-  SetCache(typename Directory<Offset>::AllocationIndex numAllocations)
-      : _numAllocations(numAllocations),
-        _visited(numAllocations),
-        _derived(numAllocations) {}
+  typedef std::map<std::string, PackedSet<Offset> > NamedSets;
+  SetCache(const Directory<Offset>& directory, const FileImage& coreImage)
+      : _directory(directory),
+        _coreImage(coreImage),
+        _numAllocations(directory.NumAllocations()),
+        _visited(_numAllocations),
+        _derived(_numAllocations),
+        _namedSetsLoaded(false) {}
   Set<Offset>& GetVisited() { return _visited; }
   Set<Offset>& GetDerived() { return _derived; }
   const Set<Offset>& GetDerived() const { return _derived; }
 
+  /*
+   * The named sets are kept, packed, in a file alongside the core (the path
+   * to the core with ".chapsets" appended) so that they survive from one run
+   * of chap to the next.  The file is read the first time any named set is
+   * used, and is ignored if the core or the allocations have changed.
+   * Because other runs of chap, such as other sessions of "chap -serve", may
+   * change the file in the meantime, it is read again just before each
+   * change, so that sets saved or deleted by those runs are not undone.
+   */
+  const NamedSets& GetNamedSets() const {
+    LoadNamedSets();
+    return _namedSets;
+  }
+
+  const PackedSet<Offset>* FindNamedSet(const std::string& name) const {
+    LoadNamedSets();
+    typename NamedSets::const_iterator it = _namedSets.find(name);
+    return (it == _namedSets.end()) ? nullptr : &(it->second);
+  }
+
+  /*
+   * Save a copy of the given set under the given name, replacing any set
+   * already of that name, then rewrite the file of named sets.  Return
+   * false if the file could not be written, in which case the set is still
+   * available for the rest of the run.
+   */
+  bool SaveNamedSet(const std::string& name, const Set<Offset>& set) {
+    ReloadNamedSets();
+    _namedSets[name] = PackedSet<Offset>(set);
+    return WriteNamedSets();
+  }
+
+  bool DeleteNamedSet(const std::string& name, bool& fileWritten) {
+    ReloadNamedSets();
+    if (_namedSets.erase(name) == 0) {
+      return false;
+    }
+    fileWritten = WriteNamedSets();
+    return true;
+  }
+
+  const std::string& GetNamedSetsPath() const {
+    LoadNamedSets();
+    return _namedSetsFile->GetPath();
+  }
+
  private:
+  const Directory<Offset>& _directory;
+  const FileImage& _coreImage;
   typename Directory<Offset>::AllocationIndex _numAllocations;
   Set<Offset> _visited;
   Set<Offset> _derived;
+  mutable bool _namedSetsLoaded;
+  mutable NamedSets _namedSets;
+  mutable std::unique_ptr<AnalysisCache> _namedSetsFile;
+
+  void LoadNamedSets() const {
+    if (_namedSetsLoaded) {
+      return;
+    }
+    _namedSetsLoaded = true;
+    /*
+     * The headers of the core are not checked because the allocations
+     * themselves, along with the size and modification time of the core,
+     * are enough to tell whether the sets still apply.
+     */
+    _namedSetsFile.reset(
+        new AnalysisCache(_coreImage, 0, _directory, ".chapsets"));
+    ReadNamedSets();
+  }
+
+  /*
+   * Add the sets from the file, returning false if there is no valid file
+   * of named sets for this core.
+   */
+  bool ReadNamedSets() const {
+    CacheReader* reader = _namedSetsFile->Open();
+    if (reader == nullptr) {
+      return false;
+    }
+    try {
+      uint64_t numSets = reader->Get<uint64_t>();
+      for (uint64_t i = 0; i < numSets; i++) {
+        std::string name = reader->GetString();
+        _namedSets[name].Restore(*reader, _numAllocations);
+      }
+    } catch (CacheReader::Invalid&) {
+      std::cerr << "Warning: ignoring invalid set file "
+                << _namedSetsFile->GetPath() << ".\n";
+      _namedSets.clear();
+      return false;
+    }
+    return true;
+  }
+
+  /*
+   * Replace the named sets with those in the file, if it can be read, or
+   * otherwise keep the ones already known.
+   */
+  void ReloadNamedSets() {
+    if (!_namedSetsLoaded) {
+      LoadNamedSets();
+      return;
+    }
+    NamedSets namedSets;
+    namedSets.swap(_namedSets);
+    if (!ReadNamedSets()) {
+      _namedSets.swap(namedSets);
+    }
+  }
+
+  bool WriteNamedSets() const {
+    CacheWriter writer;
+    writer.Put((uint64_t)_namedSets.size());
+    for (const auto& nameAndSet : _namedSets) {
+      writer.PutString(nameAndSet.first);
+      nameAndSet.second.Save(writer);
+    }
+    return _namedSetsFile->Write(writer);
+  }
 };
 }  // namespace Allocations
 }  // namespace chap
@@ -0,0 +1,210 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <ctype.h>
+#include <functional>
+#include <string>
+#include "../Commands/Runner.h"
+#include "Set.h"
+#include "SetCache.h"
+namespace chap {
+namespace Allocations {
+/*
+ * This saves, combines and lists named allocation sets, which can then be
+ * used by any set based command as "@<name>", so that the result of an
+ * expensive query, such as one with a long chain of extensions, can be
+ * reused without being recalculated.
+ */
+template <class Offset>
+class SetCommand : public Commands::Command {
+ public:
+  SetCommand(SetCache<Offset>& setCache) : _name("set"), _setCache(setCache) {}
+
+  void ShowHelpMessage(Commands::Context& context) {
+    Commands::Output& output = context.GetOutput();
+    output << "Use \"set save <name>\" to save the derived set (see "
+              "/setOperation) as a named set.\n"
+              "Use \"set load <name>\" to make a named set the derived set.\n"
+              "Use \"set union <name> <set> <set>\", \"set intersect <name> "
+              "<set> <set>\" or\n\"set subtract <name> <set> <set>\" to "
+              "save a combination of two sets, or\n\"set complement <name> "
+              "<set>\" to save the set of all allocations, used or\nfree, "
+              "that are not in the given set, where each <set> is the name "
+              "of a named\nset or \"derived\".\n"
+              "Use \"set delete <name>\" to remove a named set.\n"
+              "Use \"set list\" to list the named sets.\n"
+              "A named set can be used with any command that takes a set as "
+              "\"@<name>\", for\nexample \"count @<name>\".  Named sets are "
+              "kept in a file alongside the core\nso that they are available "
+              "to later runs of chap against the same core.\n";
+  }
+  const std::string& GetName() const { return _name; }
+
+  void GetSecondTokenCompletions(
+      const std::string& prefix,
+      std::function<void(const std::string&)> cb) const {
+    static const char* operations[] = {"complement", "delete", "intersect",
+                                       "list",       "load",   "save",
+                                       "subtract",   "union"};
+    for (const char* operation : operations) {
+      if (!std::string(operation).compare(0, prefix.size(), prefix)) {
+        cb(operation);
+      }
+    }
+  }
+
+  void Run(Commands::Context& context) {
+    Commands::Error& error = context.GetError();
+    size_t numPositionals = context.GetNumPositionals();
+    if (numPositionals < 2) {
+      ShowHelpMessage(context);
+      return;
+    }
+    const std::string& operation = context.Positional(1);
+    size_t numOperands = 0;
+    if (operation == "list") {
+      numOperands = 0;
+    } else if (operation == "save" || operation == "load" ||
+               operation == "delete") {
+      numOperands = 1;
+    } else if (operation == "complement") {
+      numOperands = 2;
+    } else if (operation == "union" || operation == "intersect" ||
+               operation == "subtract") {
+      numOperands = 3;
+    } else {
+      error << "Unknown set operation \"" << operation << "\".\n";
+      return;
+    }
+    if (numPositionals != 2 + numOperands) {
+      error << "\"set " << operation << "\" takes " << numOperands
+            << " argument" << ((numOperands == 1) ? "" : "s") << ".\n";
+      return;
+    }
+    if (operation == "list") {
+      List(context);
+      return;
+    }
+
+    std::string name = context.Positional(2);
+    if (!name.empty() && name[0] == '@') {
+      name = name.substr(1);
+    }
+    if (operation == "load") {
+      if (!GetOperand(context, name, _setCache.GetDerived())) {
+        return;
+      }
+      context.GetOutput() << "The derived set now has " << std::dec
+                          << _setCache.GetDerived().Count()
+                          << " allocations.\n";
+      return;
+    }
+    if (!IsValidName(name)) {
+      error << "A set name must be made of letters, digits, \"_\", \".\" "
+               "and \"-\" and\nmust not be \"derived\".\n";
+      return;
+    }
+    if (operation == "delete") {
+      bool fileWritten = true;
+      if (!_setCache.DeleteNamedSet(name, fileWritten)) {
+        error << "There is no set named \"" << name << "\".\n";
+      } else if (!fileWritten) {
+        WarnNotWritten(context);
+      }
+      return;
+    }
+
+    Set<Offset> result(_setCache.GetDerived().NumAllocations());
+    if (operation == "save") {
+      result.Assign(_setCache.GetDerived());
+    } else {
+      if (!GetOperand(context, context.Positional(3), result)) {
+        return;
+      }
+      if (operation == "complement") {
+        result.Complement();
+      } else {
+        Set<Offset> other(result.NumAllocations());
+        if (!GetOperand(context, context.Positional(4), other)) {
+          return;
+        }
+        if (operation == "union") {
+          result.Union(other);
+        } else if (operation == "intersect") {
+          result.Intersect(other);
+        } else {
+          result.Subtract(other);
+        }
+      }
+    }
+    if (!_setCache.SaveNamedSet(name, result)) {
+      WarnNotWritten(context);
+    }
+    context.GetOutput() << "Set " << name << " has " << std::dec
+                        << result.Count() << " allocations.\n";
+  }
+
+ private:
+  const std::string _name;
+  SetCache<Offset>& _setCache;
+
+  static bool IsValidName(const std::string& name) {
+    if (name.empty() || name == "derived") {
+      return false;
+    }
+    for (char c : name) {
+      if (!isalnum((unsigned char)c) && c != '_' && c != '.' && c != '-') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*
+   * Fill the given set from the named set or from the derived set, as
+   * specified by the given operand.
+   */
+  bool GetOperand(Commands::Context& context, const std::string& operand,
+                  Set<Offset>& set) {
+    if (operand == "derived") {
+      if (&set != &_setCache.GetDerived()) {
+        set.Assign(_setCache.GetDerived());
+      }
+      return true;
+    }
+    std::string name =
+        (!operand.empty() && operand[0] == '@') ? operand.substr(1) : operand;
+    const PackedSet<Offset>* packedSet = _setCache.FindNamedSet(name);
+    if (packedSet == nullptr) {
+      context.GetError() << "There is no set named \"" << name << "\".\n";
+      return false;
+    }
+    packedSet->Unpack(set);
+    return true;
+  }
+
+  void List(Commands::Context& context) {
+    Commands::Output& output = context.GetOutput();
+    const typename SetCache<Offset>::NamedSets& namedSets =
+        _setCache.GetNamedSets();
+    if (namedSets.empty()) {
+      output << "There are no named sets.\n";
+      return;
+    }
+    for (const auto& nameAndSet : namedSets) {
+      output << nameAndSet.first << " has " << std::dec
+             << nameAndSet.second.Count() << " allocations.\n";
+    }
+  }
+
+  void WarnNotWritten(Commands::Context& context) {
+    context.GetError() << "Warning: failed to write "
+                       << _setCache.GetNamedSetsPath()
+                       << "; the named sets will not be available to later "
+                          "runs.\n";
+  }
+};
+}  // namespace Allocations
+}  // namespace chap
@@ -5,6 +5,7 @@
 #pragma once
 #include <map>
 #include <set>
+#include "../AnalysisCache.h"
 
 /*
  * This keeps mappings from signature to name and name to set of signatures.
@@ -145,6 +146,31 @@ class SignatureDirectory {
     }
   }
 
+  void Save(CacheWriter& writer) const {
+    writer.Put(_multipleSignaturesPerName);
+    writer.Put((uint64_t)_signatureToName.size());
+    for (const auto& signatureNameAndStatus : _signatureToName) {
+      writer.Put(signatureNameAndStatus.first);
+      writer.PutString(signatureNameAndStatus.second.first);
+      writer.Put((uint32_t)signatureNameAndStatus.second.second);
+    }
+  }
+
+  void Restore(CacheReader& reader) {
+    bool multipleSignaturesPerName = reader.Get<bool>();
+    uint64_t numSignatures = reader.Get<uint64_t>();
+    for (uint64_t i = 0; i < numSignatures; i++) {
+      Offset signature = reader.Get<Offset>();
+      std::string name = reader.GetString();
+      uint32_t status = reader.Get<uint32_t>();
+      if (status > VTABLE_WITH_NAME_FROM_BINDEFS) {
+        throw CacheReader::Invalid();
+      }
+      MapSignatureNameAndStatus(signature, name, (Status)status);
+    }
+    _multipleSignaturesPerName = multipleSignaturesPerName;
+  }
+
   SignatureNameAndStatusConstIterator BeginSignatures() const {
     return _signatureToName.begin();
   }
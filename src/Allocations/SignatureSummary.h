@@ -4,13 +4,22 @@
 
 #pragma once
 #include <algorithm>
-#include <map>
-#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "Directory.h"
 #include "SignatureDirectory.h"
 #include "TagHolder.h"
+#include "TallyTable.h"
 namespace chap {
 namespace Allocations {
+/*
+ * This tallies allocations by signature or by tag, with subtotals by size
+ * for tagged and unsigned allocations.  The tallies are kept in a hash
+ * table, keyed by signature or by tag and size, and are grouped by name
+ * only when the summary is requested, so that a summary can be filled by
+ * one thread per part of the allocations then merged with the others.
+ */
 template <class Offset>
 class SignatureSummary {
  public:
@@ -25,22 +34,8 @@ class SignatureSummary {
     Offset _count;
     Offset _bytes;
   };
-  typedef std::map<Offset, Offset> SizeToCount;
-  struct TallyWithSizeSubtotals {
-    Tally _tally;
-    SizeToCount _sizeToCount;
-    void Bump(Offset size) {
-      _tally.Bump(size);
-      ++(_sizeToCount.try_emplace(size, 0).first->second);
-    }
-  };
-  typedef std::map<Offset, Tally> OffsetToTally;
-  typedef typename OffsetToTally::iterator OffsetToTallyIterator;
-  typedef typename OffsetToTally::const_iterator OffsetToTallyConstIterator;
-  typedef std::map<std::string, Tally> NameToTally;
-  typedef typename NameToTally::iterator NameToTallyIterator;
-  typedef typename NameToTally::const_iterator NameToTallyConstIterator;
   typedef typename Directory<Offset>::AllocationIndex AllocationIndex;
+  typedef typename TagHolder<Offset>::TagIndex TagIndex;
   struct Item {
     std::string _name;
     Tally _totals;
@@ -52,130 +47,141 @@ class SignatureSummary {
 
   SignatureSummary(const SignatureDirectory<Offset>& directory,
                    const TagHolder<Offset>& tagHolder)
-      : _directory(directory), _tagHolder(tagHolder) {}
+      : _directory(directory), _tagHolder(tagHolder) {
+    /*
+     * Tags with the same name share a group, so that they are summarized
+     * together.
+     */
+    size_t numTags = tagHolder.GetNumTags();
+    _tagIndexToGroup.reserve(numTags);
+    for (size_t i = 0; i < numTags; i++) {
+      const std::string& name = tagHolder.GetTagNameFromIndex((TagIndex)i);
+      _tagIndexToGroup.push_back(
+          name.empty() ? 0
+                       : FIRST_TAG_GROUP +
+                             *(tagHolder.GetTagIndices(name)->begin()));
+    }
+  }
 
   bool AdjustTally(AllocationIndex index, Offset size, const char* image) {
-    const std::string& tagName = _tagHolder.GetTagName(index);
-    if (!tagName.empty()) {
+    Offset tagGroup = _tagIndexToGroup[_tagHolder.GetTagIndex(index)];
+    if (tagGroup != 0) {
       /*
        * Tags take precedent over any signature.
        */
-      _talliesWithSizeSubtotals[tagName].Bump(size);
+      _tallies.Bump(tagGroup, size, size);
     } else {
       Offset signature = 0;
       if (size >= sizeof(Offset)) {
         signature = *((Offset*)image);
       }
       if (_directory.IsMapped(signature)) {
-        TallyBySignature(signature, size);
-        std::string name = _directory.Name(signature);
-        if (!name.empty()) {
-          TallyByName(name, size);
-        }
+        _tallies.Bump(SIGNATURE_GROUP, signature, size);
       } else {
-        _unsignedTallyWithSizeSubtotals.Bump(size);
+        _tallies.Bump(UNSIGNED_GROUP, size, size);
       }
     }
     return false;
   }
 
-  void SummarizeByCount(std::vector<Item>& items) const {
-    FillItems(items);
-    for (auto& item : items) {
-      if (item._subtotals.size() > 1) {
-        std::sort(item._subtotals.begin(), item._subtotals.end(),
-                  CompareSubtotalsByCount());
-      }
-    }
-    std::sort(items.begin(), items.end(), CompareItemsByCount());
+  /*
+   * Add the tallies from another summary, which must use the same signature
+   * directory and tags.
+   */
+  void Merge(const SignatureSummary& other) { _tallies.Merge(other._tallies); }
+
+  /*
+   * Fill in the items in order of decreasing count, keeping only the first
+   * maxItems of them, and return the number of items there would be with
+   * no such limit.
+   */
+  size_t SummarizeByCount(std::vector<Item>& items,
+                          size_t maxItems = ~((size_t)0)) const {
+    return Summarize(items, maxItems, CompareItemsByCount(),
+                     CompareSubtotalsByCount());
   }
 
-  void SummarizeByBytes(std::vector<Item>& items) const {
-    FillItems(items);
-    for (auto& item : items) {
-      if (item._subtotals.size() > 1) {
-        std::sort(item._subtotals.begin(), item._subtotals.end(),
-                  CompareSubtotalsByBytes());
-      }
-    }
-    std::sort(items.begin(), items.end(), CompareItemsByBytes());
+  /*
+   * Fill in the items in order of decreasing bytes, keeping only the first
+   * maxItems of them, and return the number of items there would be with
+   * no such limit.
+   */
+  size_t SummarizeByBytes(std::vector<Item>& items,
+                          size_t maxItems = ~((size_t)0)) const {
+    return Summarize(items, maxItems, CompareItemsByBytes(),
+                     CompareSubtotalsByBytes());
   }
 
  private:
+  static constexpr Offset SIGNATURE_GROUP = 0;
+  static constexpr Offset UNSIGNED_GROUP = 1;
+  static constexpr Offset FIRST_TAG_GROUP = 2;
   const SignatureDirectory<Offset>& _directory;
   const TagHolder<Offset>& _tagHolder;
-  OffsetToTally _signatureToTally;
-  NameToTally _nameToTally;
-  TallyWithSizeSubtotals _unsignedTallyWithSizeSubtotals;
-  std::unordered_map<std::string, TallyWithSizeSubtotals>
-      _talliesWithSizeSubtotals;
-
-  void TallyBySignature(Offset signature, Offset size) {
-    Tally& tally = _signatureToTally.try_emplace(signature).first->second;
-    tally._count++;
-    tally._bytes += size;
-  }
+  std::vector<Offset> _tagIndexToGroup;
+  TallyTable<Offset> _tallies;
 
-  void TallyByName(std::string name, Offset size) {
-    Tally& tally = _nameToTally.try_emplace(name).first->second;
-    tally._count++;
-    tally._bytes += size;
-  }
-
-  void FillItems(std::vector<Item>& items) const {
-    items.clear();
-    if (_unsignedTallyWithSizeSubtotals._tally._count > 0) {
-      Item& item = items.emplace_back();
-      item._name = "?";
-      item._totals = _unsignedTallyWithSizeSubtotals._tally;
-      for (const auto& sizeAndCount :
-           _unsignedTallyWithSizeSubtotals._sizeToCount) {
-        item.AddSubtotal(sizeAndCount.first,
-                         Tally(sizeAndCount.second,
-                               sizeAndCount.first * sizeAndCount.second));
-      }
-    }
-    for (const auto nameAndTally : _talliesWithSizeSubtotals) {
-      Item& item = items.emplace_back();
-      item._name = nameAndTally.first;
-      TallyWithSizeSubtotals tallyWithSizeSubtotals = nameAndTally.second;
-      item._totals = tallyWithSizeSubtotals._tally;
-      for (const auto& sizeAndCount : tallyWithSizeSubtotals._sizeToCount) {
-        item.AddSubtotal(sizeAndCount.first,
-                         Tally(sizeAndCount.second,
-                               sizeAndCount.first * sizeAndCount.second));
-      }
+  template <typename CompareItems, typename CompareSubtotals>
+  size_t Summarize(std::vector<Item>& items, size_t maxItems,
+                   CompareItems compareItems,
+                   CompareSubtotals compareSubtotals) const {
+    FillItems(items);
+    size_t numItems = items.size();
+    if (maxItems < numItems) {
+      std::partial_sort(items.begin(), items.begin() + maxItems, items.end(),
+                        compareItems);
+      items.resize(maxItems);
+    } else {
+      std::sort(items.begin(), items.end(), compareItems);
     }
-    FillUnnamedSignatures(items);
-    FillNamedSignatures(items);
-  }
-
-  void FillUnnamedSignatures(std::vector<Item>& items) const {
-    for (const auto& signatureAndTally: _signatureToTally) {
-      std::string name = _directory.Name(signatureAndTally.first);
-      if (name.empty()) {
-        Item& item = items.emplace_back();
-        item._totals = signatureAndTally.second;
-        item.AddSubtotal(signatureAndTally.first, signatureAndTally.second);
+    for (auto& item : items) {
+      if (item._subtotals.size() > 1) {
+        std::sort(item._subtotals.begin(), item._subtotals.end(),
+                  compareSubtotals);
       }
     }
+    return numItems;
   }
-  void FillNamedSignatures(std::vector<Item>& items) const {
-    for (NameToTallyConstIterator it = _nameToTally.begin();
-         it != _nameToTally.end(); ++it) {
-      const std::string& name = it->first;
-      Item& item = items.emplace_back();
-      item._name = name;
-      item._totals = it->second;
 
-      for (Offset signature: _directory.Signatures(name)) {
-        OffsetToTallyConstIterator itTally = _signatureToTally.find(signature);
-        if (itTally != _signatureToTally.end()) {
-          item.AddSubtotal(signature, itTally->second);
+  void FillItems(std::vector<Item>& items) const {
+    items.clear();
+    std::unordered_map<std::string, size_t> nameToItem;
+    std::unordered_map<Offset, size_t> groupToItem;
+    _tallies.ForEach([&](const typename TallyTable<Offset>::Entry& entry) {
+      Tally tally(entry._count, entry._bytes);
+      size_t itemIndex;
+      if (entry._group == SIGNATURE_GROUP) {
+        const std::string& name = _directory.Name(entry._value);
+        if (name.empty()) {
+          itemIndex = items.size();
+          items.emplace_back();
+        } else {
+          auto it = nameToItem.try_emplace(name, items.size()).first;
+          itemIndex = it->second;
+          if (itemIndex == items.size()) {
+            items.emplace_back();
+            items.back()._name = name;
+          }
+        }
+      } else {
+        auto it = groupToItem.try_emplace(entry._group, items.size()).first;
+        itemIndex = it->second;
+        if (itemIndex == items.size()) {
+          items.emplace_back();
+          items.back()._name =
+              (entry._group == UNSIGNED_GROUP)
+                  ? "?"
+                  : _tagHolder.GetTagNameFromIndex(
+                        (TagIndex)(entry._group - FIRST_TAG_GROUP));
         }
       }
-    }
+      Item& item = items[itemIndex];
+      item._totals._count += tally._count;
+      item._totals._bytes += tally._bytes;
+      item.AddSubtotal(entry._value, tally);
+    });
   }
+
   struct CompareSubtotalsByCount {
     bool operator()(const std::pair<Offset, Tally>& left,
                     const std::pair<Offset, Tally>& right) {
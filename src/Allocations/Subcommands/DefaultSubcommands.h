@@ -20,6 +20,7 @@
 #include "../Iterators/FreeOutgoing.h"
 #include "../Iterators/Incoming.h"
 #include "../Iterators/Leaked.h"
+#include "../Iterators/NamedSet.h"
 #include "../Iterators/Outgoing.h"
 #include "../Iterators/RegisterAnchorPoints.h"
 #include "../Iterators/RegisterAnchored.h"
@@ -36,6 +37,7 @@
 #include "../Iterators/Used.h"
 #include "../PatternDescriberRegistry.h"
 #include "../SetCache.h"
+#include "../SetCommand.h"
 #include "../Visitors/DefaultVisitorFactories.h"
 #include "SubcommandsForOneIterator.h"
 namespace chap {
@@ -50,7 +52,8 @@ class DefaultSubcommands {
       const PatternDescriberRegistry<Offset> &patternDescriberRegistry,
       const AnnotatorRegistry<Offset> &annotatorRegistry)
       : _defaultVisitorFactories(describer),
-        _setCache(processImage.GetAllocationDirectory().NumAllocations()),
+        _setCache(processImage.GetAllocationDirectory(),
+                  processImage.GetVirtualAddressMap().GetFileImage()),
         _singleAllocationSubcommands(
             processImage, _singleAllocationIteratorFactory,
             _defaultVisitorFactories, patternDescriberRegistry,
@@ -145,7 +148,11 @@ class DefaultSubcommands {
                                  _setCache),
         _derivedSubcommands(processImage, _derivedIteratorFactory,
                             _defaultVisitorFactories, patternDescriberRegistry,
-                            annotatorRegistry, _setCache) {}
+                            annotatorRegistry, _setCache),
+        _namedSetSubcommands(processImage, _namedSetIteratorFactory,
+                             _defaultVisitorFactories, patternDescriberRegistry,
+                             annotatorRegistry, _setCache),
+        _setCommand(_setCache) {}
 
   void RegisterSubcommands(Commands::Runner &runner) {
     _singleAllocationSubcommands.RegisterSubcommands(runner);
@@ -174,6 +181,8 @@ class DefaultSubcommands {
     _chainSubcommands.RegisterSubcommands(runner);
     _reverseChainSubcommands.RegisterSubcommands(runner);
     _derivedSubcommands.RegisterSubcommands(runner);
+    _namedSetSubcommands.RegisterSubcommands(runner);
+    runner.AddCommand(_setCommand);
   }
 
  private:
@@ -312,6 +321,12 @@ class DefaultSubcommands {
   typedef typename Iterators::Derived<Offset> DerivedIterator;
   typename DerivedIterator::Factory _derivedIteratorFactory;
   SubcommandsForOneIterator<Offset, DerivedIterator> _derivedSubcommands;
+
+  typedef typename Iterators::NamedSet<Offset> NamedSetIterator;
+  typename NamedSetIterator::Factory _namedSetIteratorFactory;
+  SubcommandsForOneIterator<Offset, NamedSetIterator> _namedSetSubcommands;
+
+  SetCommand<Offset> _setCommand;
 };
 }  // namespace Subcommands
 }  // namespace Allocations
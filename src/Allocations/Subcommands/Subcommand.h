@@ -58,8 +58,6 @@ class Subcommand : public Commands::Subcommand {
     size_t numPositionals = context.GetNumPositionals();
     size_t nextPositional = 2 + _iteratorFactory.GetNumArguments();
 
-    const SignatureDirectory<Offset>& signatureDirectory =
-        _processImage.GetSignatureDirectory();
     const CPlusPlus::TypeInfoDirectory<Offset>& typeInfoDirectory =
         _processImage.GetTypeInfoDirectory();
     const VirtualAddressMap<Offset>& addressMap =
@@ -91,9 +89,17 @@ class Subcommand : public Commands::Subcommand {
     }
 
     bool signatureOrPatternError = false;
-    SignatureChecker<Offset> signatureChecker(
-        signatureDirectory, typeInfoDirectory, _patternDescriberRegistry,
-        addressMap, signatureString);
+    /*
+     * The signatures are requested from the process image only if there is
+     * a signature or pattern to check, so that commands that do not need
+     * them do not cause them to be calculated.
+     */
+    std::unique_ptr<SignatureChecker<Offset> > signatureChecker;
+    if (!signatureString.empty()) {
+      signatureChecker.reset(new SignatureChecker<Offset>(
+          _processImage.GetSignatureDirectory(), typeInfoDirectory,
+          _patternDescriberRegistry, addressMap, signatureString));
+    }
     bool switchError = false;
     bool allowMissingSignatures = false;
     if (!context.ParseBooleanSwitch("allowMissingSignatures",
@@ -101,14 +107,14 @@ class Subcommand : public Commands::Subcommand {
       switchError = true;
     }
 
-    if (signatureChecker.UnrecognizedSignature()) {
+    if (signatureChecker && signatureChecker->UnrecognizedSignature()) {
       if (!allowMissingSignatures) {
         error << "Signature \"" << signatureString << "\" is not recognized.\n";
         signatureOrPatternError = true;
       }
     }
-    if (signatureChecker.UnrecognizedPattern()) {
-      error << "Pattern \"" << signatureChecker.GetPatternName()
+    if (signatureChecker && signatureChecker->UnrecognizedPattern()) {
+      error << "Pattern \"" << signatureChecker->GetPatternName()
             << "\" is not recognized.\n";
       signatureOrPatternError = true;
     }
@@ -204,12 +210,6 @@ class Subcommand : public Commands::Subcommand {
     Set<Offset>& visited = _setCache.GetVisited();
 
     std::vector<ReferenceConstraint<Offset> > referenceConstraints;
-    const Graph<Offset>* graph = _processImage.GetAllocationGraph();
-    const EdgePredicate<Offset>* edgeIsTainted =
-        _processImage.GetEdgeIsTainted();
-    const EdgePredicate<Offset>* edgeIsFavored =
-        _processImage.GetEdgeIsFavored();
-    const TagHolder<Offset>* tagHolder = _processImage.GetAllocationTagHolder();
 
     size_t numMinIncoming = context.GetNumArguments("minincoming");
     size_t numMaxIncoming = context.GetNumArguments("maxincoming");
@@ -221,12 +221,21 @@ class Subcommand : public Commands::Subcommand {
                                      numMinFreeOutgoing;
     if (numReferenceConstraints > 0) {
       referenceConstraints.reserve(numReferenceConstraints);
+      const Graph<Offset>* graph = _processImage.GetAllocationGraph();
       if (graph == 0) {
         std::cerr
             << "Constraints were placed on incoming or outgoing references\n"
                "but it was not possible to calculate the graph.";
         return;
       }
+      const SignatureDirectory<Offset>& signatureDirectory =
+          _processImage.GetSignatureDirectory();
+      const EdgePredicate<Offset>* edgeIsTainted =
+          _processImage.GetEdgeIsTainted();
+      const EdgePredicate<Offset>* edgeIsFavored =
+          _processImage.GetEdgeIsFavored();
+      const TagHolder<Offset>* tagHolder =
+          _processImage.GetAllocationTagHolder();
 
       switchError =
           switchError |
@@ -321,7 +330,7 @@ class Subcommand : public Commands::Subcommand {
         continue;
       }
 
-      if (!signatureChecker.Check(index, *allocation)) {
+      if (signatureChecker && !signatureChecker->Check(index, *allocation)) {
         continue;
       }
 
@@ -15,7 +15,7 @@ class SummarizeSignatures : public Commands::Subcommand {
  public:
   SummarizeSignatures(const ProcessImage<Offset>& processImage)
       : Commands::Subcommand("summarize", "signatures"),
-        _signatureDirectory(processImage.GetSignatureDirectory()) {}
+        _processImage(processImage) {}
 
   void ShowHelpMessage(Commands::Context& context) {
     context.GetOutput()
@@ -24,15 +24,17 @@ class SummarizeSignatures : public Commands::Subcommand {
 
   void Run(Commands::Context& context) {
     Commands::Output& output = context.GetOutput();
+    const SignatureDirectory<Offset>& signatureDirectory =
+        _processImage.GetSignatureDirectory();
     Offset numSignatures = 0;
     std::vector<size_t> counts;
     counts.resize(SignatureDirectory<Offset>::VTABLE_WITH_NAME_FROM_BINDEFS + 1,
                   0);
     typename SignatureDirectory<Offset>::SignatureNameAndStatusConstIterator
-        itEnd = _signatureDirectory.EndSignatures();
+        itEnd = signatureDirectory.EndSignatures();
     for (typename SignatureDirectory<
              Offset>::SignatureNameAndStatusConstIterator it =
-             _signatureDirectory.BeginSignatures();
+             signatureDirectory.BeginSignatures();
          it != itEnd; ++it) {
       typename SignatureDirectory<Offset>::Status status = it->second.second;
       counts[status]++;
@@ -92,7 +94,7 @@ class SummarizeSignatures : public Commands::Subcommand {
   }
 
  private:
-  const SignatureDirectory<Offset>& _signatureDirectory;
+  const ProcessImage<Offset>& _processImage;
 };
 }  // namespace Subcommands
 }  // namespace Allocations
@@ -80,6 +80,48 @@ class TagHolder {
     return false;
   }
 
+  /*
+   * Save the tags, each in the fewest bytes that can hold any registered
+   * tag index.
+   */
+  void Save(CacheWriter& writer) const {
+    writer.Put((uint64_t)_indexToName.size());
+    for (const std::string& name : _indexToName) {
+      writer.PutString(name);
+    }
+    if (_indexToName.size() <= 0x100) {
+      SaveTags<uint8_t>(writer);
+    } else if (_indexToName.size() <= 0x10000) {
+      SaveTags<uint16_t>(writer);
+    } else {
+      SaveTags<uint32_t>(writer);
+    }
+  }
+
+  /*
+   * Restore the tags saved by Save, returning false without changing any
+   * tags if the saved tags don't match the ones registered so far.
+   */
+  bool Restore(CacheReader& reader) {
+    uint64_t numTags = reader.Get<uint64_t>();
+    bool tagsMatch = (numTags == _indexToName.size());
+    for (uint64_t i = 0; i < numTags; i++) {
+      if (reader.GetString() != (tagsMatch ? _indexToName[i] : "")) {
+        tagsMatch = false;
+      }
+    }
+    switch (reader.Get<uint8_t>()) {
+      case sizeof(uint8_t):
+        return RestoreTags<uint8_t>(reader, tagsMatch, numTags);
+      case sizeof(uint16_t):
+        return RestoreTags<uint16_t>(reader, tagsMatch, numTags);
+      case sizeof(uint32_t):
+        return RestoreTags<uint32_t>(reader, tagsMatch, numTags);
+      default:
+        return false;
+    }
+  }
+
   TagIndex GetTagIndex(AllocationIndex allocationIndex) const {
     if (allocationIndex >= _numAllocations) {
       std::cerr << "Invalid allocation index " << allocationIndex << "\n";
@@ -96,6 +138,10 @@ class TagHolder {
     return _indexToName[_tags[allocationIndex]];
   }
 
+  const std::string& GetTagNameFromIndex(TagIndex tagIndex) const {
+    return _indexToName[tagIndex];
+  }
+
   const TagIndices* GetTagIndices(std::string tagName) const {
     std::unordered_map<std::string, TagIndices>::const_iterator it =
         _nameToTagIndices.find(tagName);
@@ -123,6 +169,29 @@ class TagHolder {
   std::vector<bool> _tagIsStrong;
   std::vector<bool> _tagSupportsFavoredReferences;
   std::unordered_map<std::string, TagIndices> _nameToTagIndices;
+
+  template <typename T>
+  void SaveTags(CacheWriter& writer) const {
+    writer.Put((uint8_t)sizeof(T));
+    std::vector<T> tags(_tags.begin(), _tags.end());
+    writer.PutVector(tags);
+  }
+
+  template <typename T>
+  bool RestoreTags(CacheReader& reader, bool tagsMatch, uint64_t numTags) {
+    std::vector<T> tags;
+    reader.GetVector(tags);
+    if (!tagsMatch || tags.size() != _numAllocations) {
+      return false;
+    }
+    for (AllocationIndex i = 0; i < _numAllocations; i++) {
+      if (tags[i] >= numTags) {
+        return false;
+      }
+    }
+    _tags.assign(tags.begin(), tags.end());
+    return true;
+  }
 };
 }  // namespace Allocations
 }  // namespace chap
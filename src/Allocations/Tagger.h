@@ -56,6 +56,20 @@ class Tagger {
                                  Phase phase, const Allocation& allocation,
                                  bool isUnsigned) = 0;
 
+  /*
+   * Return false only if TagFromAllocation would have no effect for the
+   * given allocation in any phase, regardless of how any allocations have
+   * been tagged.  This may be called concurrently for different allocations
+   * before the first pass, so it must not change the state of the tagger
+   * and must read memory only by the given reader.
+   */
+  virtual bool MayTagFromAllocation(
+      const ContiguousImage<Offset>& /* contiguousImage */,
+      Reader& /* reader */, AllocationIndex /* index */,
+      const Allocation& /* allocation */, bool /* isUnsigned */) const {
+    return true;
+  }
+
   /*
    * Look the allocation to figure out if the contents of this allocation
    * can be used to resolve information about referenced allocations.
@@ -72,12 +86,18 @@ class Tagger {
 
   /*
    * If any targets of the given allocation still need to be marked as
-   * favored, do so.
+   * favored, do so.  For each pointer-sized word of the allocation, the
+   * target and outgoing edge are given, or the number of allocations and the
+   * number of edges if the word is not a reference that may be favored.  This
+   * may be called concurrently for different allocations, so it must not
+   * change tags or the state of the tagger and may mark edges only by
+   * EdgePredicate::SetForOutgoing.
    */
   virtual void MarkFavoredReferences(
       const ContiguousImage<Offset>& /* contiguousImage */,
       Reader& /* reader */, AllocationIndex /* index */,
       const Allocation& /* allocation */,
+      const AllocationIndex* /* outgoingTargets */,
       const EdgeIndex* /* outgoingEdgeIndices */) {}
 };
 }  // namespace Allocations
@@ -3,6 +3,10 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include "../Parallelism.h"
 #include "ContiguousImage.h"
 #include "Directory.h"
 #include "Graph.h"
@@ -20,6 +24,13 @@ namespace Allocations {
  * and/or possibly tagging allocations reached from that allocation by following
  * references.  An attempt here is to avoid the most expensive checks when
  * possible and to pick the best match when there is some minor ambiguity.
+ *
+ * The results of tagging depend on the order in which allocations are
+ * visited, and the taggers keep state between phases, so the two passes are
+ * always made in address order on a single thread.  When more threads are
+ * available, they are used to rule out in advance allocations that none of
+ * the taggers could use on a given pass.  Marking of favored references
+ * doesn't depend on order and so is split among the threads.
  */
 template <typename Offset>
 class TaggerRunner {
@@ -72,6 +83,24 @@ class TaggerRunner {
   std::vector<bool> _finishedWithPass;
   size_t _numFinishedWithPass;
 
+  /*
+   * This holds what each thread needs to look at allocations independently
+   * of the other threads.
+   */
+  struct ChunkState {
+    ChunkState(const VirtualAddressMap<Offset>& addressMap,
+               const Directory<Offset>& directory)
+        : _contiguousImage(addressMap, directory), _reader(addressMap) {
+      _outgoingTargets.reserve(directory.MaxAllocationSize());
+      _outgoingEdgeIndices.reserve(directory.MaxAllocationSize());
+    }
+    ContiguousImage<Offset> _contiguousImage;
+    Reader _reader;
+    std::vector<std::pair<AllocationIndex, EdgeIndex> > _markable;
+    std::vector<AllocationIndex> _outgoingTargets;
+    std::vector<EdgeIndex> _outgoingEdgeIndices;
+  };
+
   /*
    * For each used allocation, attempt to tag it and any referenced
    * allocations for which the tag is implied directly as a result
@@ -79,10 +108,14 @@ class TaggerRunner {
    */
 
   void TagFromAllocations() {
+    std::vector<uint8_t> mayTag;
+    if (Parallelism::NumThreads() > 1) {
+      FindMayTagFromAllocation(mayTag);
+    }
     Reader reader(_addressMap);
     for (AllocationIndex i = 0; i < _numAllocations; i++) {
       const Allocation* allocation = _directory.AllocationAt(i);
-      if (!allocation->IsUsed()) {
+      if (!allocation->IsUsed() || (!mayTag.empty() && mayTag[i] == 0)) {
         continue;
       }
       _contiguousImage.SetIndex(i);
@@ -91,14 +124,7 @@ class TaggerRunner {
         _finishedWithPass[taggersIndex] = false;
       }
       _numFinishedWithPass = 0;
-      bool isUnsigned = true;
-      if (allocation->Size() >= sizeof(Offset)) {
-        Offset signatureCandidate =
-            reader.ReadOffset(allocation->Address(), 0xbad);
-        if (_signatureDirectory.IsMapped(signatureCandidate)) {
-          isUnsigned = false;
-        }
-      }
+      bool isUnsigned = IsUnsigned(reader, *allocation);
       if (!RunTagFromAllocationPhase(reader, i, Phase::QUICK_INITIAL_CHECK,
                                      *allocation, isUnsigned) &&
           !RunTagFromAllocationPhase(reader, i, Phase::MEDIUM_CHECK,
@@ -111,6 +137,50 @@ class TaggerRunner {
     }
   }
 
+  bool IsUnsigned(Reader& reader, const Allocation& allocation) const {
+    if (allocation.Size() >= sizeof(Offset)) {
+      Offset signatureCandidate =
+          reader.ReadOffset(allocation.Address(), 0xbad);
+      if (_signatureDirectory.IsMapped(signatureCandidate)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*
+   * Set mayTag[i] to 1 for each used allocation that at least one tagger
+   * might tag from on the first pass, and to 0 otherwise, using all the
+   * available threads.
+   */
+  void FindMayTagFromAllocation(std::vector<uint8_t>& mayTag) const {
+    mayTag.resize(_numAllocations, 0);
+    Parallelism::ForEachChunk(
+        _numAllocations, Parallelism::NumChunks(_numAllocations),
+        [this]() {
+          return std::make_unique<ChunkState>(_addressMap, _directory);
+        },
+        [&](std::unique_ptr<ChunkState>& state, size_t, AllocationIndex base,
+            AllocationIndex limit) {
+          for (AllocationIndex i = base; i < limit; i++) {
+            const Allocation* allocation = _directory.AllocationAt(i);
+            if (!allocation->IsUsed()) {
+              continue;
+            }
+            state->_contiguousImage.SetIndex(i);
+            bool isUnsigned = IsUnsigned(state->_reader, *allocation);
+            for (auto tagger : _taggers) {
+              if (tagger->MayTagFromAllocation(state->_contiguousImage,
+                                               state->_reader, i, *allocation,
+                                               isUnsigned)) {
+                mayTag[i] = 1;
+                break;
+              }
+            }
+          }
+        });
+  }
+
   /*
    * For each used allocation, regardless of whether it has already been
    * tagged, use the contents of that allocation to attempt to tag any
@@ -118,12 +188,17 @@ class TaggerRunner {
    */
 
   void TagFromReferenced() {
+    std::vector<uint8_t> hasUnresolved;
+    if (Parallelism::NumThreads() > 1) {
+      FindHasUnresolvedOutgoing(hasUnresolved);
+    }
     Reader reader(_addressMap);
     std::vector<AllocationIndex> unresolvedOutgoing;
     unresolvedOutgoing.reserve(_directory.MaxAllocationSize());
     for (AllocationIndex i = 0; i < _numAllocations; i++) {
       const Allocation* allocation = _directory.AllocationAt(i);
-      if (!allocation->IsUsed()) {
+      if (!allocation->IsUsed() ||
+          (!hasUnresolved.empty() && hasUnresolved[i] == 0)) {
         continue;
       }
       _contiguousImage.SetIndex(i);
@@ -163,6 +238,27 @@ class TaggerRunner {
     }
   }
 
+  /*
+   * Set hasUnresolved[i] to 1 for each used allocation that references at
+   * least one allocation that is not yet strongly tagged, and to 0 otherwise,
+   * using all the available threads.  Because a strong tag is never replaced,
+   * an allocation for which this is 0 need not be visited on the second pass.
+   */
+  void FindHasUnresolvedOutgoing(std::vector<uint8_t>& hasUnresolved) const {
+    hasUnresolved.resize(_numAllocations, 0);
+    Parallelism::ForEach(_numAllocations, [&](AllocationIndex i) {
+      if (!_directory.AllocationAt(i)->IsUsed()) {
+        return;
+      }
+      for (AllocationIndex target : _graph.GetOutgoing(i)) {
+        if (!_tagHolder.IsStronglyTagged(target)) {
+          hasUnresolved[i] = 1;
+          return;
+        }
+      }
+    });
+  }
+
   bool RunTagFromAllocationPhase(Reader& reader, AllocationIndex index,
                                  Phase phase, const Allocation& allocation,
                                  bool isUnsigned) {
@@ -205,53 +301,78 @@ class TaggerRunner {
     return false;
   }
 
+  /*
+   * Give each tagger the chance to mark references as favored.  The outgoing
+   * edges of each allocation are decoded just once, so that the target and
+   * edge for each pointer in the allocation can be found by a binary search
+   * even if the edges are compressed.
+   */
   void MarkFavoredReferences() {
-    Reader reader(_addressMap);
-    std::vector<EdgeIndex> outgoingEdgeIndices;
     EdgeIndex totalEdges = _graph.TotalEdges();
-    outgoingEdgeIndices.reserve(_directory.MaxAllocationSize());
-    for (AllocationIndex i = 0; i < _numAllocations; i++) {
-      const Allocation* allocation = _directory.AllocationAt(i);
-      if (!allocation->IsUsed()) {
-        continue;
-      }
-      bool hasMarkableOutgoing = false;
-      EdgeIndex nextOutgoing;
-      EdgeIndex pastOutgoing;
-
-      for (_graph.GetOutgoing(i, nextOutgoing, pastOutgoing);
-           !hasMarkableOutgoing && (nextOutgoing < pastOutgoing);
-           ++nextOutgoing) {
-        if (!_edgeIsTainted.ForOutgoing(nextOutgoing) &&
-            _tagHolder.SupportsFavoredReferences(
-                _graph.GetTargetForOutgoing(nextOutgoing))) {
-          hasMarkableOutgoing = true;
-          break;
-        }
-      }
-      if (!hasMarkableOutgoing) {
-        continue;
-      }
-      _contiguousImage.SetIndex(i);
-      outgoingEdgeIndices.clear();
-      const Offset* offsetLimit = _contiguousImage.OffsetLimit();
-      for (const Offset* check = _contiguousImage.FirstOffset();
-           check < offsetLimit; check++) {
-        EdgeIndex edgeIndex = _graph.TargetEdgeIndex(i, *check);
-        if (edgeIndex != totalEdges) {
-          if (_edgeIsTainted.ForOutgoing(edgeIndex) ||
-              !_tagHolder.SupportsFavoredReferences(
-                  _graph.GetTargetForOutgoing(edgeIndex))) {
-            edgeIndex = totalEdges;
+    Parallelism::ForEachChunk(
+        _numAllocations, Parallelism::NumChunks(_numAllocations),
+        [this]() {
+          return std::make_unique<ChunkState>(_addressMap, _directory);
+        },
+        [&](std::unique_ptr<ChunkState>& state, size_t, AllocationIndex base,
+            AllocationIndex limit) {
+          ContiguousImage<Offset>& contiguousImage = state->_contiguousImage;
+          std::vector<std::pair<AllocationIndex, EdgeIndex> >& markable =
+              state->_markable;
+          std::vector<AllocationIndex>& outgoingTargets =
+              state->_outgoingTargets;
+          std::vector<EdgeIndex>& outgoingEdgeIndices =
+              state->_outgoingEdgeIndices;
+          for (AllocationIndex i = base; i < limit; i++) {
+            const Allocation* allocation = _directory.AllocationAt(i);
+            if (!allocation->IsUsed()) {
+              continue;
+            }
+            markable.clear();
+            typename Graph<Offset>::EdgeRange outgoing = _graph.GetOutgoing(i);
+            for (auto it = outgoing.begin(); it != outgoing.end(); ++it) {
+              if (!_edgeIsTainted.ForOutgoing(it.Edge()) &&
+                  _tagHolder.SupportsFavoredReferences(*it)) {
+                markable.emplace_back(*it, it.Edge());
+              }
+            }
+            if (markable.empty()) {
+              continue;
+            }
+            contiguousImage.SetIndex(i);
+            outgoingTargets.clear();
+            outgoingEdgeIndices.clear();
+            const Offset* offsetLimit = contiguousImage.OffsetLimit();
+            for (const Offset* check = contiguousImage.FirstOffset();
+                 check < offsetLimit; check++) {
+              AllocationIndex target = _numAllocations;
+              EdgeIndex edgeIndex = totalEdges;
+              auto it = std::upper_bound(
+                  markable.begin(), markable.end(), *check,
+                  [this](Offset addr,
+                         const std::pair<AllocationIndex, EdgeIndex>& entry) {
+                    return addr <
+                           _directory.AllocationAt(entry.first)->Address();
+                  });
+              if (it != markable.begin()) {
+                --it;
+                const Allocation* candidate =
+                    _directory.AllocationAt(it->first);
+                if (*check < candidate->Address() + candidate->Size()) {
+                  target = it->first;
+                  edgeIndex = it->second;
+                }
+              }
+              outgoingTargets.push_back(target);
+              outgoingEdgeIndices.push_back(edgeIndex);
+            }
+            for (auto tagger : _taggers) {
+              tagger->MarkFavoredReferences(
+                  contiguousImage, state->_reader, i, *allocation,
+                  &(outgoingTargets[0]), &(outgoingEdgeIndices[0]));
+            }
           }
-        }
-        outgoingEdgeIndices.push_back(edgeIndex);
-      }
-      for (auto tagger : _taggers) {
-        tagger->MarkFavoredReferences(_contiguousImage, reader, i, *allocation,
-                                      &(outgoingEdgeIndices[0]));
-      }
-    }
+        });
   }
 };
 }  // namespace Allocations
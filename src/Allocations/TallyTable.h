@@ -0,0 +1,112 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+namespace chap {
+namespace Allocations {
+/*
+ * This is a table of counts and byte totals keyed by a group and a value
+ * within that group, for example a signature or an allocation size.  It uses
+ * open addressing with linear probing, rather than a tree, because a summary
+ * of a large process image may do hundreds of millions of updates but
+ * typically has few distinct keys, and because one table per thread can be
+ * filled independently then merged.  An entry with a count of 0 is unused.
+ */
+template <class Offset>
+class TallyTable {
+ public:
+  struct Entry {
+    Offset _group;
+    Offset _value;
+    Offset _count;
+    Offset _bytes;
+  };
+
+  TallyTable() : _entries(MIN_CAPACITY, Entry{0, 0, 0, 0}), _numUsed(0) {}
+
+  void Bump(Offset group, Offset value, Offset count, Offset bytes) {
+    if (2 * (_numUsed + 1) > _entries.size()) {
+      Grow();
+    }
+    Entry& entry = Probe(group, value);
+    if (entry._count == 0) {
+      entry._group = group;
+      entry._value = value;
+      _numUsed++;
+    }
+    entry._count += count;
+    entry._bytes += bytes;
+  }
+
+  void Bump(Offset group, Offset value, Offset size) {
+    Bump(group, value, 1, size);
+  }
+
+  /*
+   * Return the entry for the given key, or nullptr if that key has never
+   * been bumped.
+   */
+  const Entry* Find(Offset group, Offset value) const {
+    const Entry& entry = const_cast<TallyTable*>(this)->Probe(group, value);
+    return (entry._count == 0) ? nullptr : &entry;
+  }
+
+  void Merge(const TallyTable& other) {
+    for (const Entry& entry : other._entries) {
+      if (entry._count != 0) {
+        Bump(entry._group, entry._value, entry._count, entry._bytes);
+      }
+    }
+  }
+
+  /*
+   * Call visitor(entry) for each used entry, in no particular order.
+   */
+  template <typename Visitor>
+  void ForEach(Visitor visitor) const {
+    for (const Entry& entry : _entries) {
+      if (entry._count != 0) {
+        visitor(entry);
+      }
+    }
+  }
+
+  size_t Size() const { return _numUsed; }
+
+ private:
+  static constexpr size_t MIN_CAPACITY = 64;
+  std::vector<Entry> _entries;
+  size_t _numUsed;
+
+  static size_t Hash(Offset group, Offset value) {
+    uint64_t hash = ((uint64_t)value * 0x9e3779b97f4a7c15ULL) ^
+                    ((uint64_t)group * 0xc2b2ae3d27d4eb4fULL);
+    return (size_t)(hash ^ (hash >> 29));
+  }
+
+  Entry& Probe(Offset group, Offset value) {
+    size_t mask = _entries.size() - 1;
+    for (size_t i = Hash(group, value) & mask;; i = (i + 1) & mask) {
+      Entry& entry = _entries[i];
+      if (entry._count == 0 ||
+          (entry._group == group && entry._value == value)) {
+        return entry;
+      }
+    }
+  }
+
+  void Grow() {
+    std::vector<Entry> oldEntries(_entries.size() * 2, Entry{0, 0, 0, 0});
+    oldEntries.swap(_entries);
+    for (const Entry& entry : oldEntries) {
+      if (entry._count != 0) {
+        Probe(entry._group, entry._value) = entry;
+      }
+    }
+  }
+};
+}  // namespace Allocations
+}  // namespace chap
@@ -1,4 +1,4 @@
-// Copyright (c) 2017,2020 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2020,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -6,6 +6,7 @@
 #include "../../Commands/Runner.h"
 #include "../../Commands/Subcommand.h"
 #include "../Directory.h"
+#include "RecordWriter.h"
 namespace chap {
 namespace Allocations {
 namespace Visitors {
@@ -19,7 +20,11 @@ class Enumerator {
     Factory() : _commandName("enumerate") {}
     Enumerator* MakeVisitor(Commands::Context& context,
                             const ProcessImage<Offset>& /* processImage */) {
-      return new Enumerator(context);
+      Commands::OutputFormat format = Commands::TEXT_FORMAT;
+      if (!context.ParseFormatSwitch(format)) {
+        return nullptr;
+      }
+      return new Enumerator(context, format);
     }
     const std::string& GetCommandName() const { return _commandName; }
     // TODO: allow adding taints
@@ -27,7 +32,10 @@ class Enumerator {
     void ShowHelpMessage(Commands::Context& context) {
       Commands::Output& output = context.GetOutput();
       output << "In this case \"enumerate\" means show the address of "
-                "each allocation in the set.\n";
+                "each allocation in the set.\n"
+                "Use \"/format jsonl\" or \"/format binary\" to write the "
+                "addresses in a form\nmeant for other programs.  See "
+                "USERGUIDE.md for details.\n";
     }
 
    private:
@@ -35,13 +43,22 @@ class Enumerator {
     const std::vector<std::string> _taints;
   };
 
-  Enumerator(Commands::Context& context) : _context(context) {}
+  Enumerator(Commands::Context& context, Commands::OutputFormat format)
+      : _context(context),
+        _format(format),
+        _recordWriter(context.GetOutput(), format, nullptr) {}
   void Visit(AllocationIndex /* index */, const Allocation& allocation) {
+    if (_format != Commands::TEXT_FORMAT) {
+      _recordWriter.WriteAddress(allocation.Address());
+      return;
+    }
     _context.GetOutput() << std::hex << allocation.Address() << "\n";
   }
 
  private:
   Commands::Context& _context;
+  const Commands::OutputFormat _format;
+  RecordWriter<Offset> _recordWriter;
 };
 }  // namespace Visitors
 }  // namespace Allocations
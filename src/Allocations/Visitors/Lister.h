@@ -1,4 +1,4 @@
-// Copyright (c) 2017,2020 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2020,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -8,6 +8,7 @@
 #include "../../SizedTally.h"
 #include "../Directory.h"
 #include "../SignatureDirectory.h"
+#include "RecordWriter.h"
 namespace chap {
 namespace Allocations {
 namespace Visitors {
@@ -21,8 +22,12 @@ class Lister {
     Factory() : _commandName("list") {}
     Lister* MakeVisitor(Commands::Context& context,
                         const ProcessImage<Offset>& processImage) {
+      Commands::OutputFormat format = Commands::TEXT_FORMAT;
+      if (!context.ParseFormatSwitch(format)) {
+        return nullptr;
+      }
       return new Lister(context, processImage.GetSignatureDirectory(),
-                        processImage.GetVirtualAddressMap());
+                        processImage.GetVirtualAddressMap(), format);
     }
     const std::string& GetCommandName() const { return _commandName; }
     // TODO: allow adding taints
@@ -31,7 +36,10 @@ class Lister {
       Commands::Output& output = context.GetOutput();
       output << "In this case \"list\" means show the address, size,"
                 " used/free status\n"
-                "and type if known.\n";
+                "and type if known.\n"
+                "Use \"/format jsonl\" or \"/format binary\" to write one "
+                "record per allocation\nin a form meant for other programs.  "
+                "See USERGUIDE.md for details.\n";
     }
 
    private:
@@ -41,14 +49,25 @@ class Lister {
 
   Lister(Commands::Context& context,
          const SignatureDirectory<Offset>& signatureDirectory,
-         const VirtualAddressMap<Offset>& addressMap)
+         const VirtualAddressMap<Offset>& addressMap,
+         Commands::OutputFormat format)
       : _context(context),
         _signatureDirectory(signatureDirectory),
         _addressMap(addressMap),
-        _sizedTally(context, "allocations") {}
+        _format(format),
+        _recordWriter(context.GetOutput(), format, &signatureDirectory),
+        _sizedTally(context, "allocations", format == Commands::TEXT_FORMAT) {
+  }
   void Visit(AllocationIndex /* index */, const Allocation& allocation) {
     size_t size = allocation.Size();
     _sizedTally.AdjustTally(size);
+    if (_format != Commands::TEXT_FORMAT) {
+      const char* image;
+      Offset numBytesFound =
+          _addressMap.FindMappedMemoryImage(allocation.Address(), &image);
+      _recordWriter.WriteAllocation(allocation, image, numBytesFound, false);
+      return;
+    }
     Commands::Output& output = _context.GetOutput();
     if (allocation.IsUsed()) {
       output << "Used allocation at ";
@@ -77,6 +96,8 @@ class Lister {
   Commands::Context& _context;
   const SignatureDirectory<Offset>& _signatureDirectory;
   const VirtualAddressMap<Offset>& _addressMap;
+  const Commands::OutputFormat _format;
+  RecordWriter<Offset> _recordWriter;
   SizedTally<Offset> _sizedTally;
 };
 }  // namespace Visitors
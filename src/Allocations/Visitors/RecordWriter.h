@@ -0,0 +1,114 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include "../../Commands/Runner.h"
+#include "../Directory.h"
+#include "../SignatureDirectory.h"
+namespace chap {
+namespace Allocations {
+namespace Visitors {
+/*
+ * This writes one record per allocation, for the commands that accept
+ * "/format jsonl" or "/format binary", so that other tools can consume the
+ * results without parsing text meant for people.
+ *
+ * A JSON lines record is an object on a line of its own, with "address" and,
+ * for a signed allocation, "signature" given as hexadecimal strings, "size"
+ * as a number, "used" as a boolean, "name" as the name of the signature, if
+ * known, and "contents" as a string of two hexadecimal digits per byte.
+ *
+ * A binary record is a sequence of native words of the size of an address in
+ * the process image.  It is just the address, for "enumerate", or else the
+ * address, the size, the flags (1 if used, 2 if signed) and the signature, or
+ * 0, followed, for "show", by the number of bytes of contents then the
+ * contents themselves, padded with zeros to a whole number of words.
+ */
+template <class Offset>
+class RecordWriter {
+ public:
+  typedef typename Directory<Offset>::Allocation Allocation;
+  enum Flags { USED = 1, SIGNED = 2 };
+
+  /*
+   * The signature directory is needed only for WriteAllocation, so that
+   * "enumerate" does not force the signatures to be found.
+   */
+  RecordWriter(Commands::Output& output, Commands::OutputFormat format,
+               const SignatureDirectory<Offset>* signatureDirectory)
+      : _output(output),
+        _format(format),
+        _signatureDirectory(signatureDirectory) {}
+
+  void WriteAddress(Offset address) {
+    if (_format == Commands::BINARY_FORMAT) {
+      _output.Write(&address, sizeof(Offset));
+    } else {
+      _output << "{\"address\":\"0x" << std::hex << address << "\"}\n";
+    }
+  }
+
+  /*
+   * Write the record for the given allocation, where the image holds the
+   * given number of bytes of the allocation and the contents are written
+   * only if requested.
+   */
+  void WriteAllocation(const Allocation& allocation, const char* image,
+                       Offset numBytesFound, bool withContents) {
+    Offset address = allocation.Address();
+    Offset size = allocation.Size();
+    Offset signature = 0;
+    if (numBytesFound >= sizeof(Offset) && size >= sizeof(Offset)) {
+      signature = *((Offset*)image);
+      if (!_signatureDirectory->IsMapped(signature)) {
+        signature = 0;
+      }
+    }
+    if (numBytesFound > size) {
+      numBytesFound = size;
+    }
+    if (_format == Commands::BINARY_FORMAT) {
+      Offset header[4] = {
+          address, size,
+          (Offset)((allocation.IsUsed() ? USED : 0) |
+                   ((signature != 0) ? SIGNED : 0)),
+          signature};
+      _output.Write(header, sizeof(header));
+      if (withContents) {
+        _output.Write(&numBytesFound, sizeof(Offset));
+        _output.Write(image, numBytesFound);
+        Offset padding = (sizeof(Offset) - 1) & (0 - numBytesFound);
+        if (padding != 0) {
+          Offset zero = 0;
+          _output.Write(&zero, padding);
+        }
+      }
+      return;
+    }
+    _output << "{\"address\":\"0x" << std::hex << address
+            << "\",\"size\":" << std::dec << size << ",\"used\":"
+            << (allocation.IsUsed() ? "true" : "false");
+    if (signature != 0) {
+      _output << ",\"signature\":\"0x" << std::hex << signature << "\"";
+      std::string name = _signatureDirectory->Name(signature);
+      if (!name.empty()) {
+        _output << ",\"name\":";
+        _output.WriteJsonString(name);
+      }
+    }
+    if (withContents) {
+      _output << ",\"contents\":";
+      _output.WriteJsonHexBytes(image, numBytesFound);
+    }
+    _output << "}\n";
+  }
+
+ private:
+  Commands::Output& _output;
+  const Commands::OutputFormat _format;
+  const SignatureDirectory<Offset>* _signatureDirectory;
+};
+}  // namespace Visitors
+}  // namespace Allocations
+}  // namespace chap
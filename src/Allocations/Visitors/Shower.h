@@ -1,4 +1,4 @@
-// Copyright (c) 2017,2020 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2020,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -8,6 +8,7 @@
 #include "../../SizedTally.h"
 #include "../Directory.h"
 #include "../SignatureDirectory.h"
+#include "RecordWriter.h"
 namespace chap {
 namespace Allocations {
 namespace Visitors {
@@ -22,11 +23,14 @@ class Shower {
     Shower* MakeVisitor(Commands::Context& context,
                         const ProcessImage<Offset>& processImage) {
       bool showAscii = false;
-      if (!context.ParseBooleanSwitch("showAscii", showAscii)) {
+      Commands::OutputFormat format = Commands::TEXT_FORMAT;
+      if (!context.ParseBooleanSwitch("showAscii", showAscii) ||
+          !context.ParseFormatSwitch(format)) {
         return nullptr;
       }
       return new Shower(context, processImage.GetSignatureDirectory(),
-                        processImage.GetVirtualAddressMap(), showAscii);
+                        processImage.GetVirtualAddressMap(), showAscii,
+                        format);
     }
     const std::string& GetCommandName() const { return _commandName; }
     // TODO: allow adding taints
@@ -37,7 +41,11 @@ class Shower {
                 " type if known, and contents of\n"
                 "each allocation in the set.  For this process image,"
                 " an allocation is shown as\nunsigned "
-             << std::dec << (sizeof(Offset) * 8) << "-bit words.\n";
+             << std::dec << (sizeof(Offset) * 8)
+             << "-bit words.\n"
+                "Use \"/format jsonl\" or \"/format binary\" to write one "
+                "record per allocation,\nwith the contents, in a form meant "
+                "for other programs.  See USERGUIDE.md for\ndetails.\n";
     }
 
    private:
@@ -47,15 +55,26 @@ class Shower {
 
   Shower(Commands::Context& context,
          const SignatureDirectory<Offset>& signatureDirectory,
-         const VirtualAddressMap<Offset>& addressMap, bool showAscii)
+         const VirtualAddressMap<Offset>& addressMap, bool showAscii,
+         Commands::OutputFormat format)
       : _context(context),
         _signatureDirectory(signatureDirectory),
         _addressMap(addressMap),
         _showAscii(showAscii),
-        _sizedTally(context, "allocations") {}
+        _format(format),
+        _recordWriter(context.GetOutput(), format, &signatureDirectory),
+        _sizedTally(context, "allocations", format == Commands::TEXT_FORMAT) {
+  }
   void Visit(AllocationIndex /* index */, const Allocation& allocation) {
     size_t size = allocation.Size();
     _sizedTally.AdjustTally(size);
+    if (_format != Commands::TEXT_FORMAT) {
+      const char* image;
+      Offset numBytesFound =
+          _addressMap.FindMappedMemoryImage(allocation.Address(), &image);
+      _recordWriter.WriteAllocation(allocation, image, numBytesFound, true);
+      return;
+    }
     Commands::Output& output = _context.GetOutput();
 
     if (allocation.IsUsed()) {
@@ -95,6 +114,8 @@ class Shower {
   const SignatureDirectory<Offset>& _signatureDirectory;
   const VirtualAddressMap<Offset>& _addressMap;
   const bool _showAscii;
+  const Commands::OutputFormat _format;
+  RecordWriter<Offset> _recordWriter;
   SizedTally<Offset> _sizedTally;
 };
 }  // namespace Visitors
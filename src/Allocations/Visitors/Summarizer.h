@@ -3,8 +3,13 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <stdlib.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include "../../Commands/Runner.h"
 #include "../../Commands/Subcommand.h"
+#include "../../Parallelism.h"
 #include "../../SizedTally.h"
 #include "../Directory.h"
 #include "../SignatureSummary.h"
@@ -41,9 +46,27 @@ class Summarizer {
           }
         }
       }
-      return new Summarizer(context, processImage.GetSignatureDirectory(),
+      size_t maxItems = ~((size_t)0);
+      size_t numTop = context.GetNumArguments("top");
+      if (numTop > 0) {
+        if (numTop > 1) {
+          context.GetError() << "At most one /top switch is allowed.\n";
+          return (Summarizer*)(0);
+        }
+        const std::string& topString = context.Argument("top", 0);
+        char* end;
+        maxItems = strtoul(topString.c_str(), &end, 10);
+        if (topString.empty() || *end != '\000' || maxItems == 0) {
+          context.GetError() << "Invalid decimal /top argument \""
+                             << topString << "\"\n";
+          return (Summarizer*)(0);
+        }
+      }
+      return new Summarizer(context, processImage.GetAllocationDirectory(),
+                            processImage.GetSignatureDirectory(),
                             *(processImage.GetAllocationTagHolder()),
-                            processImage.GetVirtualAddressMap(), sortByCount);
+                            processImage.GetVirtualAddressMap(), sortByCount,
+                            maxItems);
     }
     const std::string& GetCommandName() const { return _commandName; }
     // TODO: allow adding taints
@@ -56,6 +79,8 @@ class Summarizer {
                 "separate tally and byte count for unsigned allocations.\n";
       output << "Use \"/sortby bytes\" to sort summary by total bytes "
                 "rather than allocation count\n";
+      output << "Use \"/top <n>\" to show just the first n entries of the"
+                " summary, where n is\ndecimal.\n";
     }
 
    private:
@@ -63,43 +88,117 @@ class Summarizer {
     const std::vector<std::string> _taints;
   };
 
-  Summarizer(Commands::Context& context,
+  Summarizer(Commands::Context& context, const Directory<Offset>& directory,
              const SignatureDirectory<Offset>& signatureDirectory,
              const TagHolder<Offset>& tagHolder,
-             const VirtualAddressMap<Offset>& addressMap, bool sortByCount)
+             const VirtualAddressMap<Offset>& addressMap, bool sortByCount,
+             size_t maxItems)
       : _context(context),
+        _directory(directory),
+        _signatureDirectory(signatureDirectory),
+        _tagHolder(tagHolder),
         _signatureSummary(signatureDirectory, tagHolder),
         _addressMap(addressMap),
         _sizedTally(context, "allocations"),
-        _sortByCount(sortByCount) {}
+        _sortByCount(sortByCount),
+        _maxItems(maxItems) {}
   ~Summarizer() {
+    if (!_pending.empty()) {
+      TallyPending();
+    }
+    for (const auto& partial : _partials) {
+      _signatureSummary.Merge(partial->_summary);
+      _sizedTally.AddToTally(partial->_count, partial->_bytes);
+    }
     std::vector<SummaryItem> items;
+    size_t numItems;
     if (_sortByCount) {
-      _signatureSummary.SummarizeByCount(items);
+      numItems = _signatureSummary.SummarizeByCount(items, _maxItems);
     } else {
-      _signatureSummary.SummarizeByBytes(items);
+      numItems = _signatureSummary.SummarizeByBytes(items, _maxItems);
     }
     DumpSummaryItems(items);
+    if (numItems > items.size()) {
+      _context.GetOutput() << std::dec << (numItems - items.size())
+                           << " more entries are not shown.\n";
+    }
   }
   void Visit(AllocationIndex index, const Allocation& allocation) {
-    size_t size = allocation.Size();
-    const char* image;
-    Offset numBytesFound =
-        _addressMap.FindMappedMemoryImage(allocation.Address(), &image);
-    if (numBytesFound < size) {
-      // This is not expected to happen on Linux.
-      size = numBytesFound;
+    if (Parallelism::NumThreads() > 1) {
+      /*
+       * The tallies are done in batches, with one partial summary per
+       * thread, and the partial summaries are merged at the end.
+       */
+      _pending.push_back(index);
+      if (_pending.size() == BATCH_SIZE) {
+        TallyPending();
+      }
+      return;
     }
+    const char* image;
+    Offset size = MappedSize(allocation, &image);
     _sizedTally.AdjustTally(size);
     _signatureSummary.AdjustTally(index, size, image);
   }
 
  private:
+  static constexpr size_t BATCH_SIZE = 1 << 20;
+  struct Partial {
+    Partial(const SignatureDirectory<Offset>& signatureDirectory,
+            const TagHolder<Offset>& tagHolder)
+        : _summary(signatureDirectory, tagHolder), _count(0), _bytes(0) {}
+    SignatureSummary<Offset> _summary;
+    Offset _count;
+    Offset _bytes;
+  };
   Commands::Context& _context;
+  const Directory<Offset>& _directory;
+  const SignatureDirectory<Offset>& _signatureDirectory;
+  const TagHolder<Offset>& _tagHolder;
   SignatureSummary<Offset> _signatureSummary;
   const VirtualAddressMap<Offset>& _addressMap;
   SizedTally<Offset> _sizedTally;
   bool _sortByCount;
+  size_t _maxItems;
+  std::vector<AllocationIndex> _pending;
+  std::vector<std::unique_ptr<Partial> > _partials;
+
+  Offset MappedSize(const Allocation& allocation, const char** image) const {
+    Offset size = allocation.Size();
+    Offset numBytesFound =
+        _addressMap.FindMappedMemoryImage(allocation.Address(), image);
+    if (numBytesFound < size) {
+      // This is not expected to happen on Linux.
+      size = numBytesFound;
+    }
+    return size;
+  }
+
+  void TallyPending() {
+    if (_partials.empty()) {
+      for (size_t i = 0; i < Parallelism::NumThreads(); i++) {
+        _partials.emplace_back(
+            std::make_unique<Partial>(_signatureDirectory, _tagHolder));
+      }
+    }
+    std::atomic<size_t> nextPartial(0);
+    size_t numPending = _pending.size();
+    Parallelism::ForEachChunk(
+        numPending, Parallelism::NumChunks(numPending),
+        [&]() { return _partials[nextPartial++].get(); },
+        [&](Partial* partial, size_t, size_t base, size_t limit) {
+          for (size_t i = base; i < limit; i++) {
+            AllocationIndex index = _pending[i];
+            const char* image;
+            Offset size = MappedSize(*(_directory.AllocationAt(index)), &image);
+            partial->_count++;
+            partial->_bytes += size;
+            partial->_summary.AdjustTally(index, size, image);
+          }
+        });
+    _pending.clear();
+  }
+
   static std::string InDecimalWithCommas(Offset n) {  // treat as positive
     if (n == 0) {
       return "0";
@@ -0,0 +1,326 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+#include <stdint.h>
+#include <string.h>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Allocations/Directory.h"
+#include "FileImage.h"
+
+namespace chap {
+/*
+ * This is used to append values to the body of an analysis cache.
+ */
+class CacheWriter {
+ public:
+  template <typename T>
+  void Put(T value) {
+    _bytes.append((const char *)&value, sizeof(T));
+  }
+
+  template <typename T>
+  void PutVector(const std::vector<T> &values) {
+    Put((uint64_t)values.size());
+    _bytes.append((const char *)values.data(), values.size() * sizeof(T));
+  }
+
+  void PutBits(const std::vector<bool> &bits) {
+    Put((uint64_t)bits.size());
+    uint8_t byte = 0;
+    for (size_t i = 0; i < bits.size(); i++) {
+      if (bits[i]) {
+        byte |= (1 << (i & 7));
+      }
+      if ((i & 7) == 7) {
+        Put(byte);
+        byte = 0;
+      }
+    }
+    if ((bits.size() & 7) != 0) {
+      Put(byte);
+    }
+  }
+
+  void PutString(const std::string &value) {
+    Put((uint64_t)value.size());
+    _bytes.append(value);
+  }
+
+  const std::string &GetBytes() const { return _bytes; }
+
+ private:
+  std::string _bytes;
+};
+
+/*
+ * This is used to read back, in the same order, the values appended by a
+ * CacheWriter.  Any attempt to read past the end of the body results in a
+ * CacheReader::Invalid exception, as does any value found to be inconsistent
+ * with the analysis being restored.
+ */
+class CacheReader {
+ public:
+  struct Invalid {};
+
+  CacheReader(const char *image, size_t size)
+      : _next(image), _limit(image + size) {}
+
+  template <typename T>
+  T Get() {
+    T value;
+    memcpy(&value, Take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  void GetVector(std::vector<T> &values) {
+    uint64_t numValues = Get<uint64_t>();
+    if (numValues > (uint64_t)(_limit - _next) / sizeof(T)) {
+      throw Invalid();
+    }
+    const char *image = Take(numValues * sizeof(T));
+    values.resize(numValues);
+    memcpy((char *)values.data(), image, numValues * sizeof(T));
+  }
+
+  void GetBits(std::vector<bool> &bits) {
+    uint64_t numBits = Get<uint64_t>();
+    if (numBits / 8 > (uint64_t)(_limit - _next)) {
+      throw Invalid();
+    }
+    const uint8_t *image = (const uint8_t *)Take((numBits + 7) / 8);
+    bits.resize(numBits);
+    for (size_t i = 0; i < numBits; i++) {
+      bits[i] = (image[i >> 3] & (1 << (i & 7))) != 0;
+    }
+  }
+
+  std::string GetString() {
+    uint64_t size = Get<uint64_t>();
+    if (size > (uint64_t)(_limit - _next)) {
+      throw Invalid();
+    }
+    return std::string(Take(size), size);
+  }
+
+ private:
+  const char *_next;
+  const char *_limit;
+
+  const char *Take(size_t numBytes) {
+    if (numBytes > (size_t)(_limit - _next)) {
+      throw Invalid();
+    }
+    const char *image = _next;
+    _next += numBytes;
+    return image;
+  }
+};
+
+/*
+ * This manages the optional sidecar file (the path to the core with
+ * ".chapcache" appended) that holds the results of the expensive parts of
+ * the analysis of a core, so that opening the same core again can skip that
+ * work.  The file is used only if it was written for a core with the same
+ * size, modification time and ELF headers, and for the same allocations.
+ * The allocations are still found on each run, because doing so has side
+ * effects on the rest of the analysis, but this is cheap relative to the
+ * work saved.
+ */
+class AnalysisCache {
+ public:
+  static bool IsEnabled() { return _isEnabled; }
+  static void SetEnabled(bool isEnabled) { _isEnabled = isEnabled; }
+
+  /*
+   * The suffix allows other files that depend on the same core and
+   * allocations, such as saved allocation sets, to be checked in the same
+   * way.
+   */
+  template <class Offset>
+  AnalysisCache(const FileImage &coreImage, uint64_t headersSize,
+                const Allocations::Directory<Offset> &directory,
+                const char *suffix = ".chapcache")
+      : _path(coreImage.GetFileName() + suffix) {
+    memset(&_key, 0, sizeof(_key));
+    memcpy(_key._magic, MAGIC, sizeof(_key._magic));
+    _key._version = VERSION;
+    _key._offsetSize = sizeof(Offset);
+    _key._coreSize = coreImage.GetFileSize();
+    struct stat statBuf;
+    if (fstat(coreImage._fd, &statBuf) == 0) {
+      _key._coreModificationSeconds = statBuf.st_mtim.tv_sec;
+      _key._coreModificationNanoseconds = statBuf.st_mtim.tv_nsec;
+    }
+    if (headersSize > coreImage.GetFileSize()) {
+      headersSize = coreImage.GetFileSize();
+    }
+    _key._headersHash = Hash(coreImage.GetImage(), headersSize);
+    _key._allocationsHash = HashAllocations(directory);
+  }
+
+  const std::string &GetPath() const { return _path; }
+
+  /*
+   * Return a reader for the body of the cache, or nullptr if there is
+   * no cache file or it doesn't match the core and allocations.
+   */
+  CacheReader *Open() {
+    try {
+      _image.reset(new FileImage(_path.c_str(), false));
+    } catch (...) {
+      return nullptr;
+    }
+    uint64_t fileSize = _image->GetFileSize();
+    const char *image = _image->GetImage();
+    Header header;
+    if (fileSize < sizeof(Header)) {
+      _image.reset();
+      return nullptr;
+    }
+    memcpy(&header, image, sizeof(Header));
+    if (memcmp(&header._key, &_key, sizeof(Key)) != 0 ||
+        header._bodySize != fileSize - sizeof(Header) ||
+        header._bodyHash !=
+            Hash(image + sizeof(Header), (size_t)header._bodySize)) {
+      _image.reset();
+      return nullptr;
+    }
+    _reader.reset(
+        new CacheReader(image + sizeof(Header), (size_t)header._bodySize));
+    return _reader.get();
+  }
+
+  /*
+   * Replace the cache file with one that has the given body.  The new
+   * file is written under a unique temporary name then renamed, so that a
+   * concurrent run of chap never sees a partially written cache and two
+   * runs writing at once do not write the same temporary file.
+   */
+  bool Write(const CacheWriter &writer) const {
+    const std::string &body = writer.GetBytes();
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    header._key = _key;
+    header._bodySize = body.size();
+    header._bodyHash = Hash(body.data(), body.size());
+    std::vector<char> tempPath(_path.begin(), _path.end());
+    static const char tempSuffix[] = ".XXXXXX";
+    tempPath.insert(tempPath.end(), tempSuffix,
+                    tempSuffix + sizeof(tempSuffix));
+    int fd = mkstemp(tempPath.data());
+    if (fd < 0) {
+      return false;
+    }
+    // mkstemp allows access only by the owner, unlike the usual file mode.
+    mode_t mask = umask(0);
+    umask(mask);
+    bool written = fchmod(fd, 0666 & ~mask) == 0 &&
+                   WriteAll(fd, (const char *)&header, sizeof(Header)) &&
+                   WriteAll(fd, body.data(), body.size());
+    if (close(fd) != 0 || !written ||
+        rename(tempPath.data(), _path.c_str()) != 0) {
+      (void)unlink(tempPath.data());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  /*
+   * The version must be changed whenever the format of the body changes or
+   * chap changes in a way that would affect any of the cached results.
+   */
+  static constexpr uint32_t VERSION = 4;
+  static constexpr char MAGIC[8] = {'c', 'h', 'a', 'p', 'c', 'a', 'c', 'h'};
+  static inline bool _isEnabled = false;
+
+  struct Key {
+    char _magic[8];
+    uint32_t _version;
+    uint32_t _offsetSize;
+    uint64_t _coreSize;
+    int64_t _coreModificationSeconds;
+    int64_t _coreModificationNanoseconds;
+    uint64_t _headersHash;
+    uint64_t _allocationsHash;
+  };
+
+  struct Header {
+    Key _key;
+    uint64_t _bodySize;
+    uint64_t _bodyHash;
+  };
+
+  std::string _path;
+  Key _key;
+  std::unique_ptr<FileImage> _image;
+  std::unique_ptr<CacheReader> _reader;
+
+  static bool WriteAll(int fd, const char *chars, size_t numChars) {
+    while (numChars > 0) {
+      ssize_t numWritten = write(fd, chars, numChars);
+      if (numWritten < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      chars += numWritten;
+      numChars -= numWritten;
+    }
+    return true;
+  }
+
+  static uint64_t Mix(uint64_t hash, uint64_t value) {
+    hash ^= value;
+    hash *= 0x100000001b3ULL;
+    return hash ^ (hash >> 29);
+  }
+
+  static uint64_t Hash(const char *image, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+    size_t numWords = size / sizeof(uint64_t);
+    for (size_t i = 0; i < numWords; i++) {
+      uint64_t word;
+      memcpy(&word, image + i * sizeof(uint64_t), sizeof(uint64_t));
+      hash = Mix(hash, word);
+    }
+    for (size_t i = numWords * sizeof(uint64_t); i < size; i++) {
+      hash = Mix(hash, (uint8_t)image[i]);
+    }
+    return hash;
+  }
+
+  template <class Offset>
+  static uint64_t HashAllocations(
+      const Allocations::Directory<Offset> &directory) {
+    typedef typename Allocations::Directory<Offset>::AllocationIndex Index;
+    Index numAllocations = directory.NumAllocations();
+    uint64_t hash = Mix(0xcbf29ce484222325ULL, numAllocations);
+    for (Index i = 0; i < numAllocations; i++) {
+      const typename Allocations::Directory<Offset>::Allocation *allocation =
+          directory.AllocationAt(i);
+      hash = Mix(hash, allocation->Address());
+      hash = Mix(hash, allocation->Size());
+      hash = Mix(hash, (allocation->IsUsed() ? 1 : 0) |
+                           (allocation->IsThreadCached() ? 2 : 0) |
+                           (allocation->IsWrapper() ? 4 : 0) |
+                           (allocation->IsWrapped() ? 8 : 0) |
+                           (allocation->FinderIndex() << 4));
+    }
+    return hash;
+  }
+};
+}  // namespace chap
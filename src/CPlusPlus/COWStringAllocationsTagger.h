@@ -120,6 +120,21 @@ class COWStringAllocationsTagger : public Allocations::Tagger<Offset> {
                                        allocation);
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& contiguousImage,
+                            Reader& /* reader */, AllocationIndex /* index */,
+                            const Allocation& allocation,
+                            bool isUnsigned) const {
+    Offset size = allocation.Size();
+    Offset overhead = 3 * sizeof(Offset) + 1;
+    if (!_enabled || !isUnsigned || size < overhead) {
+      return false;
+    }
+    const Offset* firstOffset = contiguousImage.FirstOffset();
+    Offset capacity = firstOffset[1];
+    return capacity != 0 && capacity <= size - overhead &&
+           firstOffset[0] <= capacity;
+  }
+
   bool TagFromReferenced(const ContiguousImage& contiguousImage,
                          Reader& /* reader */, AllocationIndex /* index */,
                          Phase phase, const Allocation& allocation,
@@ -133,15 +148,15 @@ class COWStringAllocationsTagger : public Allocations::Tagger<Offset> {
   }
 
   void MarkFavoredReferences(const ContiguousImage& contiguousImage,
-                             Reader& /* reader */, AllocationIndex index,
+                             Reader& /* reader */, AllocationIndex /* index */,
                              const Allocation& /* allocation */,
+                             const AllocationIndex* outgoingTargets,
                              const EdgeIndex* outgoingEdgeIndices) {
     const Offset* checkLimit = contiguousImage.OffsetLimit();
     const Offset* firstCheck = contiguousImage.FirstOffset();
 
     for (const Offset* check = firstCheck; check < checkLimit; check++) {
-      EdgeIndex edgeIndex = outgoingEdgeIndices[check - firstCheck];
-      AllocationIndex charsIndex = _graph.GetTargetForOutgoing(edgeIndex);
+      AllocationIndex charsIndex = outgoingTargets[check - firstCheck];
       if (charsIndex == _numAllocations) {
         continue;
       }
@@ -150,7 +165,8 @@ class COWStringAllocationsTagger : public Allocations::Tagger<Offset> {
       }
       if ((_directory.AllocationAt(charsIndex)->Address() +
            3 * sizeof(Offset)) == *check) {
-        _edgeIsFavored.Set(index, charsIndex, true);
+        _edgeIsFavored.SetForOutgoing(outgoingEdgeIndices[check - firstCheck],
+                                     true);
       }
     }
   }
@@ -58,6 +58,19 @@ class DequeAllocationsTagger : public Allocations::Tagger<Offset> {
     return TagAnchorPointDequeMap(reader, index, phase, allocation);
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& /* contiguousImage */,
+                            Reader& /* reader */, AllocationIndex index,
+                            const Allocation& allocation,
+                            bool /* isUnsigned */) const {
+    /*
+     * A deque map is recognized on the first pass only if it is an anchor
+     * point.
+     */
+    return allocation.Size() >= 2 * sizeof(Offset) &&
+           (_graph.IsStaticAnchorPoint(index) ||
+            _graph.IsStackAnchorPoint(index));
+  }
+
   bool TagFromReferenced(const ContiguousImage& contiguousImage,
                          Reader& /* reader */, AllocationIndex index,
                          Phase phase, const Allocation& allocation,
@@ -32,9 +32,9 @@ class DequeMapDescriber : public Allocations::PatternDescriber<Offset> {
     Offset allocationAddress = allocation.Address();
     Offset allocationLimit = allocationAddress + allocationSize;
     FindDeques(InStaticMemory, allocationAddress, allocationLimit,
-               Base::_graph->GetStaticAnchors(index), deques);
+               Base::GetGraph().GetStaticAnchors(index), deques);
     FindDeques(OnStack, allocationAddress, allocationLimit,
-               Base::_graph->GetStackAnchors(index), deques);
+               Base::GetGraph().GetStackAnchors(index), deques);
     FindDeques(allocationAddress, allocationLimit, index, deques);
     if (deques.size() == 1) {
       const DequeInfo& dequeInfo = deques[0];
@@ -173,14 +173,9 @@ class DequeMapDescriber : public Allocations::PatternDescriber<Offset> {
   }
   void FindDeques(Offset mapAddress, Offset mapLimit, AllocationIndex index,
                   std::vector<DequeInfo>& deques) const {
-    const AllocationIndex* pFirstIncoming;
-    const AllocationIndex* pPastIncoming;
-    Base::_graph->GetIncoming(index, &pFirstIncoming, &pPastIncoming);
-
-    for (const AllocationIndex* pNextIncoming = pFirstIncoming;
-         pNextIncoming < pPastIncoming; pNextIncoming++) {
+    for (AllocationIndex incomingIndex : Base::GetGraph().GetIncoming(index)) {
       const Allocation* incoming =
-          Base::_directory.AllocationAt(*pNextIncoming);
+          Base::_directory.AllocationAt(incomingIndex);
       if (incoming == 0) {
         abort();
       }
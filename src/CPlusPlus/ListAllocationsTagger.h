@@ -51,6 +51,21 @@ class ListAllocationsTagger : public Allocations::Tagger<Offset> {
     return TagFromListNode(contiguousImage, index, phase, allocation);
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& contiguousImage,
+                            Reader& reader, AllocationIndex /* index */,
+                            const Allocation& allocation,
+                            bool isUnsigned) const {
+    const Offset* firstOffset = contiguousImage.FirstOffset();
+    if (!isUnsigned || contiguousImage.OffsetLimit() - firstOffset < 3) {
+      return false;
+    }
+    Offset next = firstOffset[0];
+    Offset prev = firstOffset[1];
+    return next != 0 && (next & (sizeof(Offset) - 1)) == 0 && prev != 0 &&
+           (prev & (sizeof(Offset) - 1)) == 0 &&
+           reader.ReadOffset(prev, 0) == allocation.Address();
+  }
+
   TagIndex GetNodeTagIndex() const { return _nodeTagIndex; }
   TagIndex GetUnknownHeadNodeTagIndex() const {
     return _unknownHeadNodeTagIndex;
@@ -360,13 +375,9 @@ class ListAllocationsTagger : public Allocations::Tagger<Offset> {
   bool HasExtraPointerToStartFromAllocation(AllocationIndex index, Offset node,
                                             Offset next, Offset prev,
                                             Reader& refReader) {
-    const AllocationIndex* pFirstIncoming;
-    const AllocationIndex* pPastIncoming;
-    _graph.GetIncoming(index, &pFirstIncoming, &pPastIncoming);
-    for (const AllocationIndex* pNextIncoming = pFirstIncoming;
-         pNextIncoming != pPastIncoming; ++pNextIncoming) {
+    for (AllocationIndex incomingIndex : _graph.GetIncoming(index)) {
       const Allocation* incomingAllocation =
-          _directory.AllocationAt(*pNextIncoming);
+          _directory.AllocationAt(incomingIndex);
       Offset incomingAddress = incomingAllocation->Address();
       if (incomingAddress == next || incomingAddress == prev) {
         continue;
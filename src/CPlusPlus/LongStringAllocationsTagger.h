@@ -125,6 +125,22 @@ class LongStringAllocationsTagger : public Allocations::Tagger<Offset> {
                                          allocation);
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& contiguousImage,
+                            Reader& /* reader */, AllocationIndex index,
+                            const Allocation& allocation,
+                            bool isUnsigned) const {
+    if (!_enabled || allocation.Size() <= 2 * sizeof(Offset) ||
+        (!isUnsigned && *(contiguousImage.FirstChar()) == (const char)(0))) {
+      return false;
+    }
+    /*
+     * The characters for a long string are recognized on the first pass
+     * only if they are an anchor point.
+     */
+    return _graph.IsStaticAnchorPoint(index) ||
+           _graph.IsStackAnchorPoint(index);
+  }
+
   bool TagFromReferenced(const ContiguousImage& contiguousImage,
                          Reader& /* reader */, AllocationIndex index,
                          Phase phase, const Allocation& allocation,
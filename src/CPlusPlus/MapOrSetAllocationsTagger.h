@@ -52,6 +52,22 @@ class MapOrSetAllocationsTagger : public Allocations::Tagger<Offset> {
     return TagFromRootNode(contiguousImage, index, phase, allocation);
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& contiguousImage,
+                            Reader& reader, AllocationIndex /* index */,
+                            const Allocation& allocation,
+                            bool /* isUnsigned */) const {
+    const Offset* firstOffset = contiguousImage.FirstOffset();
+    if (((contiguousImage.OffsetLimit() - firstOffset) <
+         MIN_NODE_SIZE_IN_OFFSETS) ||
+        ((firstOffset[0] & 0xfe) != 0)) {
+      return false;
+    }
+    Offset pseudoNode = firstOffset[NUM_OFFSETS_BEFORE_PARENT];
+    return pseudoNode != 0 && (pseudoNode & (sizeof(Offset) - 1)) == 0 &&
+           reader.ReadOffset(pseudoNode + ROOT_IN_PSEUDONODE, 0xbad) ==
+               allocation.Address();
+  }
+
   TagIndex GetNodeTagIndex() const { return _nodeTagIndex; }
 
  private:
@@ -25,9 +25,7 @@ class SSOStringAnnotator : public Annotator<Offset> {
         _processImage(processImage),
         _addressMap(processImage.GetVirtualAddressMap()),
         _directory(processImage.GetAllocationDirectory()),
-        _numAllocations(_directory.NumAllocations()),
-        _tagHolder(*(processImage.GetAllocationTagHolder())),
-        _tagIndices(_tagHolder.GetTagIndices("%LongString")) {}
+        _numAllocations(_directory.NumAllocations()) {}
 
   /*
    * Provide the actual annotation lines, excluding the information about the
@@ -99,9 +97,14 @@ class SSOStringAnnotator : public Annotator<Offset> {
 
     if (index != _numAllocations) {
       // This check is deferred to this point because it is relatively
-      // expensive.
-      if ((_tagIndices == nullptr) || (_tagIndices->find(_tagHolder.GetTagIndex(
-                                           index)) == _tagIndices->end())) {
+      // expensive, and may require the allocations to be tagged first.
+      const Allocations::TagHolder<Offset>& tagHolder =
+          *(_processImage.GetAllocationTagHolder());
+      const typename Allocations::TagHolder<Offset>::TagIndices* tagIndices =
+          tagHolder.GetTagIndices("%LongString");
+      if ((tagIndices == nullptr) ||
+          (tagIndices->find(tagHolder.GetTagIndex(index)) ==
+           tagIndices->end())) {
         return address;
       }
     }
@@ -136,8 +139,6 @@ class SSOStringAnnotator : public Annotator<Offset> {
   const VirtualAddressMap<Offset>& _addressMap;
   const Directory& _directory;
   AllocationIndex _numAllocations;
-  const Allocations::TagHolder<Offset>& _tagHolder;
-  const typename Allocations::TagHolder<Offset>::TagIndices* _tagIndices;
 };
 }  // namespace CPlusPlus
 }  // namespace chap
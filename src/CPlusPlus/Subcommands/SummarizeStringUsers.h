@@ -31,7 +31,7 @@ class SummarizeStringUsers : public Commands::Subcommand {
       : Commands::Subcommand("summarize", "stringusers"),
         _processImage(processImage),
         _directory(processImage.GetAllocationDirectory()),
-        _signatureDirectory(processImage.GetSignatureDirectory()),
+        _signatureDirectory(nullptr),
         _virtualAddressMap(processImage.GetVirtualAddressMap()),
         _contiguousImage(_virtualAddressMap, _directory) {}
 
@@ -82,6 +82,7 @@ class SummarizeStringUsers : public Commands::Subcommand {
     }
     const AllocationIndex numAllocations = _directory.NumAllocations();
     const TagHolder& tagHolder = *(_processImage.GetAllocationTagHolder());
+    _signatureDirectory = &(_processImage.GetSignatureDirectory());
     const TagIndices* longStringTagIndices =
         tagHolder.GetTagIndices("%LongString");
     if (longStringTagIndices == nullptr) {
@@ -150,7 +151,7 @@ class SummarizeStringUsers : public Commands::Subcommand {
       bool isUnsigned = true;
       Offset signature = *firstOffset;
 
-      if (_signatureDirectory.IsMapped(signature)) {
+      if (_signatureDirectory->IsMapped(signature)) {
         isUnsigned = false;
       }
 
@@ -164,7 +165,8 @@ class SummarizeStringUsers : public Commands::Subcommand {
           continue;
         }
         EdgeIndex edgeIndex = graph->TargetEdgeIndex(i, pointerCandidate);
-        AllocationIndex targetIndex = graph->GetTargetForOutgoing(edgeIndex);
+        AllocationIndex targetIndex =
+            graph->TargetAllocationIndex(i, pointerCandidate);
         if (targetIndex == numAllocations) {
           // The pointer candidate is not to a different allocation.
           if (pointerCandidate !=
@@ -302,7 +304,7 @@ class SummarizeStringUsers : public Commands::Subcommand {
     for (auto const& signatureAndMap : stringStatsForSignature) {
       Offset signature = signatureAndMap.first;
       output << "String usage for signature 0x" << std::hex << signature;
-      std::string signatureName = _signatureDirectory.Name(signature);
+      std::string signatureName = _signatureDirectory->Name(signature);
       if (!signatureName.empty()) {
         output << " (" << signatureName << ")";
       }
@@ -357,7 +359,7 @@ class SummarizeStringUsers : public Commands::Subcommand {
  private:
   const ProcessImage<Offset>& _processImage;
   const Allocations::Directory<Offset>& _directory;
-  const SignatureDirectory& _signatureDirectory;
+  const SignatureDirectory* _signatureDirectory;
   const VirtualAddressMap<Offset>& _virtualAddressMap;
   ContiguousImage _contiguousImage;
 };
@@ -4,6 +4,7 @@
 
 #pragma once
 #include <string.h>
+#include <list>
 #include <vector>
 
 namespace chap {
@@ -122,6 +122,23 @@ class UnorderedMapOrSetAllocationsTagger : public Allocations::Tagger<Offset> {
     return false;
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& contiguousImage,
+                            Reader& /* reader */, AllocationIndex index,
+                            const Allocation& /* allocation */,
+                            bool isUnsigned) const {
+    const Offset* firstOffset = contiguousImage.FirstOffset();
+    if (!isUnsigned || contiguousImage.OffsetLimit() - firstOffset < 2 ||
+        (*firstOffset & (sizeof(Offset) - 1)) != 0) {
+      return false;
+    }
+    /*
+     * A buckets array or first item is recognized on the first pass only if
+     * it is an anchor point.
+     */
+    return _graph.IsStaticAnchorPoint(index) ||
+           _graph.IsStackAnchorPoint(index);
+  }
+
   bool TagFromReferenced(const ContiguousImage& contiguousImage, Reader& reader,
                          AllocationIndex index, Phase phase,
                          const Allocation& allocation,
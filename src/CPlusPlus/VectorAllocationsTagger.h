@@ -109,6 +109,19 @@ class VectorAllocationsTagger : public Allocations::Tagger<Offset> {
     return false;
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& /* contiguousImage */,
+                            Reader& /* reader */, AllocationIndex index,
+                            const Allocation& allocation,
+                            bool /* isUnsigned */) const {
+    /*
+     * A vector body is recognized on the first pass only if it is an anchor
+     * point.
+     */
+    return allocation.Size() >= 2 * sizeof(Offset) &&
+           (_graph.IsStaticAnchorPoint(index) ||
+            _graph.IsStackAnchorPoint(index));
+  }
+
   bool TagFromReferenced(const ContiguousImage& contiguousImage,
                          Reader& /* reader */, AllocationIndex index,
                          Phase phase, const Allocation& allocation,
@@ -30,15 +30,10 @@ class VectorBodyDescriber : public Allocations::PatternDescriber<Offset> {
     Offset allocationAddress = allocation.Address();
     Offset allocationLimit = allocationAddress + allocationSize;
 
-    const AllocationIndex* pFirstIncoming;
-    const AllocationIndex* pPastIncoming;
-    Base::_graph->GetIncoming(index, &pFirstIncoming, &pPastIncoming);
-
     std::vector<VectorInfo> vectors;
-    for (const AllocationIndex* pNextIncoming = pFirstIncoming;
-         pNextIncoming < pPastIncoming; pNextIncoming++) {
+    for (AllocationIndex incomingIndex : Base::GetGraph().GetIncoming(index)) {
       const Allocation* incoming =
-          Base::_directory.AllocationAt(*pNextIncoming);
+          Base::_directory.AllocationAt(incomingIndex);
       if (incoming == 0) {
         abort();
       }
@@ -73,9 +68,9 @@ class VectorBodyDescriber : public Allocations::PatternDescriber<Offset> {
     }
 
     FindVectors(InStaticMemory, allocationAddress, allocationLimit,
-                Base::_graph->GetStaticAnchors(index), vectors);
+                Base::GetGraph().GetStaticAnchors(index), vectors);
     FindVectors(OnStack, allocationAddress, allocationLimit,
-                Base::_graph->GetStackAnchors(index), vectors);
+                Base::GetGraph().GetStackAnchors(index), vectors);
 
     if (vectors.empty()) {
       return;
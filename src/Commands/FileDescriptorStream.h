@@ -0,0 +1,122 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+};
+#include <algorithm>
+#include <cerrno>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+namespace chap {
+namespace Commands {
+/*
+ * This is a stream that writes to a file descriptor that it owns, through a
+ * large buffer that is written with write(2), so that a command that writes
+ * gigabytes of results makes few system calls and none of the per-character
+ * calls that a std::ofstream can make.
+ */
+class FileDescriptorStream : public std::ostream {
+ public:
+  FileDescriptorStream(int fd) : std::ostream(nullptr), _buffer(fd) {
+    rdbuf(&_buffer);
+  }
+
+  ~FileDescriptorStream() { flush(); }
+
+  /*
+   * Open the given path for writing, truncating it if it already exists,
+   * and return a stream that writes to it, or nullptr on failure, in which
+   * case errno is set.
+   */
+  static FileDescriptorStream* Open(const std::string& path) {
+    int fd =
+        ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      return nullptr;
+    }
+    return new FileDescriptorStream(fd);
+  }
+
+ private:
+  class Buffer : public std::streambuf {
+   public:
+    Buffer(int fd) : _fd(fd), _chars(BUFFER_SIZE) {
+      setp(_chars.data(), _chars.data() + _chars.size());
+    }
+
+    ~Buffer() {
+      sync();
+      ::close(_fd);
+    }
+
+   protected:
+    int_type overflow(int_type c) {
+      if (!WritePending()) {
+        return traits_type::eof();
+      }
+      if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+      }
+      return traits_type::not_eof(c);
+    }
+
+    /*
+     * Copy everything through the buffer, even when there is more than the
+     * buffer holds, rather than writing it directly, because the characters
+     * may be in a paged image, which the kernel cannot fault in (see
+     * PagedImage).
+     */
+    std::streamsize xsputn(const char* chars, std::streamsize numChars) {
+      std::streamsize numCopied = 0;
+      while (numCopied < numChars) {
+        if (pptr() == epptr() && !WritePending()) {
+          return numCopied;
+        }
+        std::streamsize numToCopy =
+            std::min(numChars - numCopied, (std::streamsize)(epptr() - pptr()));
+        traits_type::copy(pptr(), chars + numCopied, numToCopy);
+        pbump((int)numToCopy);
+        numCopied += numToCopy;
+      }
+      return numChars;
+    }
+
+    int sync() { return WritePending() ? 0 : -1; }
+
+   private:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+    int _fd;
+    std::vector<char> _chars;
+
+    bool WritePending() {
+      bool written = WriteAll(pbase(), pptr() - pbase());
+      setp(_chars.data(), _chars.data() + _chars.size());
+      return written;
+    }
+
+    bool WriteAll(const char* chars, std::streamsize numChars) {
+      while (numChars > 0) {
+        ssize_t numWritten = ::write(_fd, chars, numChars);
+        if (numWritten < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          return false;
+        }
+        chars += numWritten;
+        numChars -= numWritten;
+      }
+      return true;
+    }
+  };
+
+  Buffer _buffer;
+};
+}  // namespace Commands
+}  // namespace chap
@@ -3,6 +3,16 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+extern "C" {
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+};
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -11,8 +21,13 @@
 #include <sstream>
 #include <stack>
 #include <string>
+#include <type_traits>
 #include <vector>
+#include "../Parallelism.h"
+#include "../Statistics.h"
+#include "FileDescriptorStream.h"
 #include "LineInfo.h"
+#include "SessionSocket.h"
 
 #include <replxx.h>
 
@@ -22,11 +37,18 @@ namespace Commands {
 struct CommandInterruptedException {};
 
 typedef std::vector<LineInfo> ScriptContext;
+
+/*
+ * This is the form in which a command that supports the /format switch
+ * writes its results.
+ */
+enum OutputFormat { TEXT_FORMAT, JSONL_FORMAT, BINARY_FORMAT };
 typedef std::vector<std::string> Tokens;
 
 class Input {
  public:
-  Input(ScriptContext& scriptContext) : _scriptContext(scriptContext) {
+  Input(ScriptContext& scriptContext)
+      : _scriptContext(scriptContext), _isInteractive(true) {
     _inputStack.push(&std::cin);
   }
   ~Input() {}
@@ -54,8 +76,14 @@ class Input {
     }
     _scriptContext.clear();
   }
+  /*
+   * Read standard input without line editing or a prompt, as is needed when
+   * it is not a terminal but the socket for a session.
+   */
+  void SetInteractive(bool isInteractive) { _isInteractive = isInteractive; }
+
   bool ReadLine(std::istream& is, std::string& out) {
-    if (IsInScript()) {
+    if (IsInScript() || !_isInteractive) {
       return !std::getline(is, out, '\n').fail();
     }
 
@@ -166,6 +194,7 @@ class Input {
  private:
   ScriptContext& _scriptContext;
   std::stack<std::istream*> _inputStack;
+  bool _isInteractive;
 };
 
 class Output {
@@ -173,11 +202,8 @@ class Output {
   Output() { _outputStack.push(&std::cout); }
   ~Output() {}
   bool PushTarget(const std::string& outputPath) {
-    std::ofstream* output = new std::ofstream();
-
-    output->open(outputPath.c_str());
-    if (output->fail()) {
-      delete output;
+    std::ostream* output = FileDescriptorStream::Open(outputPath);
+    if (output == nullptr) {
       return false;
     }
     _outputStack.push(output);
@@ -193,92 +219,107 @@ class Output {
 
   void HexDump(const uint64_t* image, uint64_t numBytes,
                bool showTrailingAscii) {
-    int headerWidth = 0;
-    if (numBytes > 0x20) {
-      headerWidth = 1;
-      for (size_t widthLimit = 0x10; numBytes > widthLimit; widthLimit <<= 4) {
-        headerWidth++;
-      }
-    }
-    int offset = 0;
+    HexDumpWords(image, numBytes, showTrailingAscii);
+  }
+
+  void HexDump(const uint32_t* image, uint32_t numBytes,
+               bool showTrailingAscii) {
+    HexDumpWords(image, numBytes, showTrailingAscii);
+  }
+
+  /*
+   * Write the given integer in the base selected for the top stream.  The
+   * digits are formatted here, rather than by the stream, unless a width or
+   * a flag other than the base is in effect, because formatting through the
+   * stream dominates the cost of commands that write many numbers.
+   */
+  template <typename T>
+  void WriteInteger(T value) {
     std::ostream& topStream = *_outputStack.top();
-    topStream << std::hex;
-    for (const uint64_t* limit =
-             image + ((numBytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
-         image < limit; image++) {
-      if ((offset & 0x1f) == 0 && headerWidth != 0) {
-        topStream.width(headerWidth);
-        topStream << offset << ": ";
-      }
-      topStream.width(sizeof(uint64_t) * 2);
-      topStream << *image;
-      offset += sizeof(uint64_t);
-      if (offset & 0x1f) {
-        topStream << " ";
-      } else {
-        if (showTrailingAscii) {
-          ShowTrailingAscii(topStream, 3, ((const char*)(image + 1)) - 0x20,
-                            0x20);
-        }
-        topStream << std::endl;
-      }
+    std::ios_base::fmtflags flags = topStream.flags();
+    std::ios_base::fmtflags base = flags & std::ios_base::basefield;
+    if (topStream.width() != 0 || base == std::ios_base::oct ||
+        (flags & (std::ios_base::showbase | std::ios_base::showpos |
+                  std::ios_base::uppercase)) != 0) {
+      topStream << value;
+      return;
     }
-    size_t trailing = offset & 0x1f;
-    if (trailing != 0) {
-      if (showTrailingAscii) {
-        size_t missing =
-            (0x20 - trailing) / sizeof(uint64_t) * (2 * sizeof(uint64_t) + 1) +
-            2;
-        ShowTrailingAscii(topStream, missing, ((const char*)(image)) - trailing,
-                          trailing);
-      }
-      topStream << std::endl;
+    typedef typename std::make_unsigned<T>::type Unsigned;
+    char digits[24];
+    char* limit = digits + sizeof(digits);
+    char* first;
+    if (base == std::ios_base::hex) {
+      // As with the stream, a negative value is shown in two's complement.
+      first = FormatHex((Unsigned)value, limit);
+    } else if (IsNegative(value)) {
+      first = FormatDecimal((Unsigned)(0 - (Unsigned)value), limit);
+      *--first = '-';
+    } else {
+      first = FormatDecimal((Unsigned)value, limit);
     }
+    topStream.rdbuf()->sputn(first, limit - first);
   }
 
-  void HexDump(const uint32_t* image, uint32_t numBytes,
-               bool showTrailingAscii) {
-    int headerWidth = 0;
-    if (numBytes > 0x20) {
-      headerWidth = 1;
-      for (size_t widthLimit = 0x10; numBytes > widthLimit; widthLimit <<= 4) {
-        headerWidth++;
-      }
+  /*
+   * Write the given bytes as they are, as is needed for results written
+   * with "/format binary".  The bytes are copied first, because they may be
+   * in a paged image, which the kernel cannot fault in if the stream passes
+   * them straight to write(2) (see PagedImage).
+   */
+  void Write(const void* bytes, size_t numBytes) {
+    std::streambuf& buffer = *(_outputStack.top()->rdbuf());
+    const char* chars = (const char*)bytes;
+    char copy[0x1000];
+    while (numBytes > 0) {
+      size_t numInChunk = std::min(numBytes, sizeof(copy));
+      memcpy(copy, chars, numInChunk);
+      buffer.sputn(copy, numInChunk);
+      chars += numInChunk;
+      numBytes -= numInChunk;
     }
-    int offset = 0;
-    std::ostream& topStream = *_outputStack.top();
-    topStream << std::hex;
-    for (const uint32_t* limit =
-             image + ((numBytes + sizeof(uint32_t) - 1) / sizeof(uint32_t));
-         image < limit; image++) {
-      if ((offset & 0x1f) == 0 && headerWidth != 0) {
-        topStream.width(headerWidth);
-        topStream << offset << ": ";
-      }
-      topStream.width(sizeof(uint32_t) * 2);
-      topStream << *image;
-      offset += sizeof(uint32_t);
-      if (offset & 0x1f) {
-        topStream << " ";
+  }
+
+  /*
+   * Write the given string as a quoted JSON string.
+   */
+  void WriteJsonString(const std::string& chars) {
+    std::streambuf& buffer = *(_outputStack.top()->rdbuf());
+    buffer.sputc('"');
+    for (char c : chars) {
+      if (c == '"' || c == '\\') {
+        buffer.sputc('\\');
+        buffer.sputc(c);
+      } else if ((unsigned char)c < ' ') {
+        char escape[7] = "\\u0000";
+        escape[4] = HEX_DIGITS[(c >> 4) & 0xf];
+        escape[5] = HEX_DIGITS[c & 0xf];
+        buffer.sputn(escape, 6);
       } else {
-        if (showTrailingAscii) {
-          ShowTrailingAscii(topStream, 3, ((const char*)(image + 1)) - 0x20,
-                            0x20);
-        }
-        topStream << std::endl;
+        buffer.sputc(c);
       }
     }
-    size_t trailing = offset & 0x1f;
-    if (trailing != 0) {
-      if (showTrailingAscii) {
-        size_t missing =
-            (0x20 - trailing) / sizeof(uint32_t) * (2 * sizeof(uint32_t) + 1) +
-            2;
-        ShowTrailingAscii(topStream, missing, ((const char*)(image)) - trailing,
-                          trailing);
+    buffer.sputc('"');
+  }
+
+  /*
+   * Write the given bytes as a quoted JSON string of two hexadecimal digits
+   * per byte, in the order in which the bytes appear in memory.
+   */
+  void WriteJsonHexBytes(const char* bytes, size_t numBytes) {
+    std::streambuf& buffer = *(_outputStack.top()->rdbuf());
+    buffer.sputc('"');
+    char pairs[256];
+    while (numBytes > 0) {
+      size_t numInChunk = std::min(numBytes, sizeof(pairs) / 2);
+      for (size_t i = 0; i < numInChunk; i++) {
+        pairs[2 * i] = HEX_DIGITS[(bytes[i] >> 4) & 0xf];
+        pairs[2 * i + 1] = HEX_DIGITS[bytes[i] & 0xf];
       }
-      topStream << std::endl;
+      buffer.sputn(pairs, 2 * numInChunk);
+      bytes += numInChunk;
+      numBytes -= numInChunk;
     }
+    buffer.sputc('"');
   }
 
   /*
@@ -287,33 +328,121 @@ class Output {
    */
   void ShowEscapedAscii(const char* chars, size_t numBytes) {
     std::ostream& topStream = *_outputStack.top();
+    std::streambuf& buffer = *(topStream.rdbuf());
     const char* limit = chars + numBytes;
     while (chars < limit) {
       char c = *(chars++);
       if ((c < ' ' || c > '~') && (c != '\t') && (c != '\r') && (c != '\n')) {
-        topStream << "\\x";
-        topStream << std::hex << (((int)(c >> 4)) & 0xf);
-        topStream << std::hex << (((int)(c)) & 0xf);
+        topStream.setf(std::ios_base::hex, std::ios_base::basefield);
+        char escape[4] = {'\\', 'x', HEX_DIGITS[(c >> 4) & 0xf],
+                          HEX_DIGITS[c & 0xf]};
+        buffer.sputn(escape, 4);
       } else {
-        topStream << c;
+        buffer.sputc(c);
       }
     }
   }
 
  private:
+  static constexpr const char* HEX_DIGITS = "0123456789abcdef";
   std::stack<std::ostream*> _outputStack;
-  void ShowTrailingAscii(std::ostream& topStream, size_t numBlanks,
-                         const char* chars, size_t numBytes) {
-    for (size_t i = 0; i < numBlanks; i++) {
-      topStream << ' ';
+
+  template <typename T>
+  static bool IsNegative(T value) {
+    return std::is_signed<T>::value && !(value > 0) && value != 0;
+  }
+
+  /*
+   * Format the given value, ending just before the given limit, and return
+   * the start of the digits.
+   */
+  template <typename Unsigned>
+  static char* FormatHex(Unsigned value, char* limit) {
+    do {
+      *--limit = HEX_DIGITS[value & 0xf];
+      value >>= 4;
+    } while (value != 0);
+    return limit;
+  }
+
+  template <typename Unsigned>
+  static char* FormatDecimal(Unsigned value, char* limit) {
+    do {
+      *--limit = (char)('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    return limit;
+  }
+
+  /*
+   * Show the given image as hexadecimal words, 0x20 bytes to a line, with
+   * each line formatted in a local buffer and written at once.  The words
+   * are right aligned, padded with blanks, and each line after the first of
+   * an image larger than 0x20 bytes starts with the offset of the line.
+   */
+  template <typename Word>
+  void HexDumpWords(const Word* image, uint64_t numBytes,
+                    bool showTrailingAscii) {
+    int headerWidth = 0;
+    if (numBytes > 0x20) {
+      headerWidth = 1;
+      for (size_t widthLimit = 0x10; numBytes > widthLimit; widthLimit <<= 4) {
+        headerWidth++;
+      }
     }
-    const char* limit = chars + numBytes;
-    while (chars < limit) {
-      char c = *(chars++);
-      if (c < ' ' || c > '~') {
-        c = '.';
+    std::ostream& topStream = *_outputStack.top();
+    topStream << std::hex;
+    std::streambuf& buffer = *(topStream.rdbuf());
+    const size_t wordsPerLine = 0x20 / sizeof(Word);
+    const size_t digitsPerWord = 2 * sizeof(Word);
+    // header, words with separators, trailing ascii and newline
+    char line[24 + 0x20 / sizeof(Word) * (2 * sizeof(Word) + 1) + 3 + 0x20 + 1];
+    size_t numWords = (numBytes + sizeof(Word) - 1) / sizeof(Word);
+    for (size_t lineStart = 0; lineStart < numWords;
+         lineStart += wordsPerLine) {
+      char* next = line;
+      if (headerWidth != 0) {
+        char digits[24];
+        char* limit = digits + sizeof(digits);
+        char* first = FormatHex(lineStart * sizeof(Word), limit);
+        for (int i = limit - first; i < headerWidth; i++) {
+          *next++ = ' ';
+        }
+        while (first < limit) {
+          *next++ = *first++;
+        }
+        *next++ = ':';
+        *next++ = ' ';
       }
-      topStream << c;
+      size_t lineLimit = std::min(numWords, lineStart + wordsPerLine);
+      for (size_t i = lineStart; i < lineLimit; i++) {
+        char* wordLimit = next + digitsPerWord;
+        char* first = FormatHex(image[i], wordLimit);
+        while (next < first) {
+          *next++ = ' ';
+        }
+        next = wordLimit;
+        if (i + 1 < lineStart + wordsPerLine) {
+          *next++ = ' ';
+        }
+      }
+      if (showTrailingAscii) {
+        size_t numBytesOnLine = (lineLimit - lineStart) * sizeof(Word);
+        size_t numMissingWords = wordsPerLine - (lineLimit - lineStart);
+        size_t numBlanks = (numMissingWords == 0)
+                               ? 3
+                               : (numMissingWords * (digitsPerWord + 1) + 2);
+        for (size_t i = 0; i < numBlanks; i++) {
+          *next++ = ' ';
+        }
+        const char* chars = (const char*)(image + lineStart);
+        for (size_t i = 0; i < numBytesOnLine; i++) {
+          char c = chars[i];
+          *next++ = (c < ' ' || c > '~') ? '.' : c;
+        }
+      }
+      *next++ = '\n';
+      buffer.sputn(line, next - line);
     }
   }
 };
@@ -324,6 +453,41 @@ Output& operator<<(Output& output, T v) {
   return output;
 }
 
+/*
+ * Integers, which make up much of the output of most commands, are formatted
+ * by the Output itself.  Narrower types are left to the stream, because
+ * characters must be shown as characters.
+ */
+inline Output& operator<<(Output& output, int v) {
+  output.WriteInteger(v);
+  return output;
+}
+
+inline Output& operator<<(Output& output, unsigned int v) {
+  output.WriteInteger(v);
+  return output;
+}
+
+inline Output& operator<<(Output& output, long v) {
+  output.WriteInteger(v);
+  return output;
+}
+
+inline Output& operator<<(Output& output, unsigned long v) {
+  output.WriteInteger(v);
+  return output;
+}
+
+inline Output& operator<<(Output& output, long long v) {
+  output.WriteInteger(v);
+  return output;
+}
+
+inline Output& operator<<(Output& output, unsigned long long v) {
+  output.WriteInteger(v);
+  return output;
+}
+
 class Error {
  public:
   Error(const ScriptContext& scriptContext)
@@ -367,57 +531,26 @@ class Context {
  public:
   Context(Input& input, Output& output, Error& error,
           const std::string& redirectPrefix)
-      : _input(input),
-        _output(output),
+      : _output(output),
         _error(error),
         _redirectPrefix(redirectPrefix),
         _hasIllFormedSwitch(false) {
-    _input.GetTokens(_tokens);
-    _error.SetContextWritePending();
-    std::string switchName;
-    size_t argNum = 0;
-    for (std::vector<std::string>::const_iterator it = _tokens.begin();
-         it != _tokens.end(); ++it) {
-      const std::string& token = *it;
-      if (token.find('/') == 0) {
-        if (!switchName.empty()) {
-          /*
-           * For now all switches are expected to take an
-           * argument.  If at some point this needs to be changed
-           * we can add some way to declare switches that don't take
-           * arguments.
-           */
-          _error << "Expected argument for switch " << switchName << "\n";
-          _hasIllFormedSwitch = true;
-        } else if (argNum == 0) {
-          _error << "No switches are allowed before the command name.\n";
-          _hasIllFormedSwitch = true;
-        }
-        switchName = token.substr(1);
-        if (switchName.empty()) {
-          _error << "An unexpected empty switch name was found.\n";
-          _hasIllFormedSwitch = true;
-        }
-      } else {
-        if (switchName.empty()) {
-          _positionalArguments.push_back(token);
-        } else {
-          _switchedArguments[switchName].push_back(token);
-          switchName = "";
-        }
-      }
-      argNum++;
-    }
-    if (!switchName.empty()) {
-      /*
-       * For now all switches are expected to take an
-       * argument.  If at some point this needs to be changed
-       * we can add some way to declare switches that don't take
-       * arguments.
-       */
-      _error << "Expected argument for switch " << switchName << "\n";
-      _hasIllFormedSwitch = true;
-    }
+    input.GetTokens(_tokens);
+    ParseTokens();
+  }
+
+  /*
+   * This form is for a command for which the tokens were already read,
+   * as is the case in batch mode.
+   */
+  Context(const Tokens& tokens, Output& output, Error& error,
+          const std::string& redirectPrefix)
+      : _output(output),
+        _error(error),
+        _redirectPrefix(redirectPrefix),
+        _hasIllFormedSwitch(false),
+        _tokens(tokens) {
+    ParseTokens();
   }
 
   ~Context() {
@@ -486,6 +619,7 @@ class Context {
   }
 
   size_t GetNumTokens() const { return _tokens.size(); }
+  const Tokens& GetTokens() const { return _tokens; }
   const std::string& TokenAt(size_t tokenIndex) const {
     if (tokenIndex < _tokens.size()) {
       return _tokens[tokenIndex];
@@ -657,14 +791,92 @@ class Context {
     return true;
   }
 
+  /*
+   * If the /format switch is not present, do nothing, leaving the format
+   * as is and return true.  Otherwise, if there is just one such switch,
+   * with argument "text", "jsonl" or "binary", set the format accordingly
+   * and return true.  In all other cases put an error to standard error,
+   * return false and leave the format untouched.
+   */
+  bool ParseFormatSwitch(OutputFormat& format) {
+    size_t numFormats = GetNumArguments("format");
+    if (numFormats == 0) {
+      return true;
+    }
+    if (numFormats > 1) {
+      _error << "At most one /format switch is allowed.\n";
+      return false;
+    }
+    const std::string& formatName = Argument("format", 0);
+    if (formatName == "text") {
+      format = TEXT_FORMAT;
+    } else if (formatName == "jsonl") {
+      format = JSONL_FORMAT;
+    } else if (formatName == "binary") {
+      format = BINARY_FORMAT;
+    } else {
+      _error << "Unknown /format argument \"" << formatName
+             << "\"; expected \"text\", \"jsonl\" or \"binary\".\n";
+      return false;
+    }
+    return true;
+  }
+
   bool IsRedirected() { return !_redirectPath.empty(); }
   Output& GetOutput() { return _output; }
   Error& GetError() { return _error; }
   bool HasIllFormedSwitch() const { return _hasIllFormedSwitch; }
 
  private:
+  void ParseTokens() {
+    _error.SetContextWritePending();
+    std::string switchName;
+    size_t argNum = 0;
+    for (std::vector<std::string>::const_iterator it = _tokens.begin();
+         it != _tokens.end(); ++it) {
+      const std::string& token = *it;
+      if (token.find('/') == 0) {
+        if (!switchName.empty()) {
+          /*
+           * For now all switches are expected to take an
+           * argument.  If at some point this needs to be changed
+           * we can add some way to declare switches that don't take
+           * arguments.
+           */
+          _error << "Expected argument for switch " << switchName << "\n";
+          _hasIllFormedSwitch = true;
+        } else if (argNum == 0) {
+          _error << "No switches are allowed before the command name.\n";
+          _hasIllFormedSwitch = true;
+        }
+        switchName = token.substr(1);
+        if (switchName.empty()) {
+          _error << "An unexpected empty switch name was found.\n";
+          _hasIllFormedSwitch = true;
+        }
+      } else {
+        if (switchName.empty()) {
+          _positionalArguments.push_back(token);
+        } else {
+          _switchedArguments[switchName].push_back(token);
+          switchName = "";
+        }
+      }
+      argNum++;
+    }
+    if (!switchName.empty()) {
+      /*
+       * For now all switches are expected to take an
+       * argument.  If at some point this needs to be changed
+       * we can add some way to declare switches that don't take
+       * arguments.
+       */
+      _error << "Expected argument for switch " << switchName << "\n";
+      _hasIllFormedSwitch = true;
+    }
+  }
+
   ScriptContext _scriptContext;
-  Input& _input;
   Output& _output;
   Error& _error;
   const std::string& _redirectPrefix;
@@ -695,6 +907,36 @@ class Command {
   const std::string _name;
 };
 
+/*
+ * This writes, when it goes away, the cost of a command that was run with
+ * "/timing true".
+ */
+class CommandTimer {
+ public:
+  CommandTimer(Context& context, bool isEnabled)
+      : _context(context),
+        _isEnabled(isEnabled),
+        _start(isEnabled ? Statistics::Now() : Statistics::Usage()) {}
+  ~CommandTimer() {
+    if (_isEnabled) {
+      Statistics::PhaseRecord record;
+      Statistics::Usage finish = Statistics::Now();
+      record._name = "Command";
+      record._depth = 0;
+      record._wallSeconds = finish._wallSeconds - _start._wallSeconds;
+      record._cpuSeconds = finish._cpuSeconds - _start._cpuSeconds;
+      record._peakRSSGrowthKB = finish._peakRSSKB - _start._peakRSSKB;
+      Statistics::WritePhase(_context.GetOutput().GetTopOutputStream(),
+                             record);
+    }
+  }
+
+ private:
+  Context& _context;
+  bool _isEnabled;
+  Statistics::Usage _start;
+};
+
 typedef std::function<size_t(Context&,  // command context
                              bool)>     // check only
     CommandCallback;
@@ -706,7 +948,8 @@ class Runner {
         _redirect(false),
         _input(_scriptContext),
         _error(_scriptContext),
-        _preCommandCallback(nullptr) {}
+        _preCommandCallback(nullptr),
+        _prepareAllCallback(nullptr) {}
 
   void CompletionHook(char const* pref,
                       int /* ctx - commented out to avoid compiler warnings */,
@@ -831,6 +1074,16 @@ class Runner {
     _preCommandCallback = callback;
   }
 
+  /*
+   * Set the function that does, up front, all the analysis that any command
+   * may need, which is otherwise done only when first needed.  This is
+   * called before the process image is copied to child processes, so that
+   * the analysis is not repeated in each child.
+   */
+  void SetPrepareAllCallback(std::function<void()> callback) {
+    _prepareAllCallback = callback;
+  }
+
   void RunCommands() {
     replxx_install_window_change_handler();
     replxx_set_completion_callback(
@@ -839,102 +1092,461 @@ class Runner {
         },
         this);
     while (true) {
-      try {
-        Context context(_input, _output, _error, _redirectPrefix);
-        bool hasIllFormedSwitch = context.HasIllFormedSwitch();
-        if (context.HasIllFormedSwitch()) {
-          if (context.TokenAt(0).find('/') == 0) {
-            continue;
-          }
+      Context context(_input, _output, _error, _redirectPrefix);
+      if (context.TokenAt(0).empty()) {
+        // There are no more commands to execute, but perhaps only in
+        // the current script.
+        if (_input.IsDone()) {
+          // There is no more input at all.  Leave the last prompt on
+          // its own line.
+          _error << "\n";
+          break;
+        } else {
+          // A script just finished.
+          continue;
         }
-        std::string command = context.TokenAt(0);
-        if (command.empty()) {
-          // There are no more commands to execute, but perhaps only in
-          // the current script.
-          if (_input.IsDone()) {
-            // There is no more input at all.  Leave the last prompt on
-            // its own line.
-            _error << "\n";
-            return;
-          } else {
-            // A script just finished.
-            continue;
-          }
+      }
+      RunCommand(context);
+    }
+    replxx_history_free();
+  }
+
+  /*
+   * Run the commands from the given script, without reading anything from
+   * standard input.  The commands are run in up to Parallelism::NumThreads()
+   * child processes at a time, each of which gets a private copy of the
+   * process image, for which all the analysis is done first, and of all the
+   * command state, such as the derived set, by copy-on-write.  The output of
+   * each command is written in script order, after the commands before it
+   * have finished.
+   *
+   * A command that uses or changes the derived set or a named set depends
+   * on the last earlier such command, so it is run after that one in the
+   * same child.
+   * The "redirect" and "source" commands are applied as the script is read.
+   * Return false if the script could not be read.
+   */
+  bool RunBatch(const std::string& scriptPath) {
+    if (!_input.StartScript(scriptPath)) {
+      return false;
+    }
+    std::vector<BatchCommand> commands;
+    std::vector<std::vector<size_t> > jobs;
+    size_t derivedSetJob = NO_JOB;
+    while (true) {
+      Context context(_input, _output, _error, _redirectPrefix);
+      const std::string& command = context.TokenAt(0);
+      if (command.empty()) {
+        if (_input.IsInScript()) {
+          continue;
         }
-        size_t numTokens = context.GetNumTokens();
-        if (command == "help") {
-          HandleHelpCommand(context);
-        } else if (command == "redirect") {
-          HandleRedirectCommand(context);
-        } else if (command == "source") {
-          HandleSourceCommand(context);
+        break;
+      }
+      if (command == "redirect") {
+        HandleRedirectCommand(context);
+        continue;
+      }
+      if (command == "source") {
+        HandleSourceCommand(context);
+        continue;
+      }
+      bool usesDerivedSet = context.GetNumArguments("setOperation") != 0 ||
+                            command == "set";
+      for (const auto& token : context.GetTokens()) {
+        if (token == "derived" || (!token.empty() && token[0] == '@')) {
+          usesDerivedSet = true;
+        }
+      }
+      size_t job = jobs.size();
+      if (usesDerivedSet) {
+        if (derivedSetJob == NO_JOB) {
+          derivedSetJob = job;
         } else {
-          bool redirectStarted = false;
-          std::map<std::string, std::list<CommandCallback> >::iterator it =
-              _commandCallbacks.find(command);
-          if (it != _commandCallbacks.end()) {
-            size_t mostTokensAccepted = 0;
-            std::list<CommandCallback>::iterator itBest = it->second.end();
-            for (std::list<CommandCallback>::iterator itCheck =
-                     it->second.begin();
-                 itCheck != it->second.end(); ++itCheck) {
-              size_t numTokensAccepted = (*itCheck)(context, true);
-              if (numTokensAccepted > mostTokensAccepted) {
-                mostTokensAccepted = numTokensAccepted;
-                itBest = itCheck;
-              }
-            }
-            if (mostTokensAccepted == 0) {
-              _error << "unknown command " << command << "\n";
-              _input.TerminateAllScripts();
+          job = derivedSetJob;
+        }
+      }
+      if (job == jobs.size()) {
+        jobs.emplace_back();
+      }
+      jobs[job].push_back(commands.size());
+      commands.emplace_back(context.GetTokens(), _scriptContext, _redirect,
+                            job);
+    }
+    _scriptContext.clear();
+    if (commands.empty()) {
+      return true;
+    }
+
+    /*
+     * Do all the analysis that the commands may need just once, before the
+     * process image is copied, rather than in each child that needs it.
+     */
+    if (_prepareAllCallback != nullptr) {
+      _prepareAllCallback();
+    }
+    if (_preCommandCallback != nullptr) {
+      _preCommandCallback();
+    }
+    std::cout.flush();
+    std::cerr.flush();
+
+    /*
+     * The children must be waited for, which is not possible if SIGCHLD
+     * was inherited as ignored.
+     */
+    sighandler_t oldSigchldHandler = signal(SIGCHLD, SIG_DFL);
+    std::vector<pid_t> pids(jobs.size(), 0);
+    std::vector<bool> jobDone(jobs.size(), false);
+    size_t numRunning = 0;
+    size_t nextJob = 0;
+    size_t nextToWrite = 0;
+    size_t maxRunning = Parallelism::NumThreads();
+    while (nextToWrite < commands.size()) {
+      while (nextJob < jobs.size() && numRunning < maxRunning) {
+        pids[nextJob] = StartBatchJob(commands, jobs[nextJob]);
+        if (pids[nextJob] > 0) {
+          numRunning++;
+        } else {
+          jobDone[nextJob] = true;
+        }
+        nextJob++;
+      }
+      while (nextToWrite < commands.size() &&
+             jobDone[commands[nextToWrite]._job]) {
+        WriteBatchCommandResults(commands[nextToWrite++]);
+      }
+      if (numRunning == 0) {
+        continue;
+      }
+      int status;
+      pid_t pid = waitpid(-1, &status, 0);
+      if (pid < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        /*
+         * The results of the jobs can no longer be trusted, but the output
+         * so far of each command is still written, with a notice for each
+         * job that did not finish.
+         */
+        std::cerr << "Failed to wait for batch processes.\n"
+                  << strerror(errno) << "\n";
+        for (size_t job = 0; job < jobs.size(); job++) {
+          if (!jobDone[job]) {
+            jobDone[job] = true;
+            if (job < nextJob) {
+              commands[jobs[job].back()]._failed = true;
             } else {
-              if (_redirect) {
-                /*
-                 * Redirect for the duration of the command context.  Note
-                 * that we don't bother supporting /redirectSuffix for the
-                 * old style command callbacks because they are deprecated
-                 * and typically were written before switched arguments were
-                 * handled separately, so they generally not work as
-                 * currently
-                 * written if the switch were supplied.
-                 */
-                redirectStarted = true;
-                context.StartRedirect();
-              }
-              if (mostTokensAccepted == numTokens || mostTokensAccepted >= 2) {
-                (*itBest)(context, false);
-                continue;
-              }
+              commands[jobs[job].front()]._failed = true;
             }
           }
-          Command* c = FindCommand(command);
-          if (c == (Command*)(0)) {
-            _error << "Command " << command << " is not recognized\n";
-            _error << "Type \"help\" to get help.\n";
+        }
+        nextJob = jobs.size();
+        numRunning = 0;
+        continue;
+      }
+      for (size_t job = 0; job < jobs.size(); job++) {
+        if (pids[job] == pid) {
+          jobDone[job] = true;
+          numRunning--;
+          if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            commands[jobs[job].back()]._failed = true;
+          }
+          break;
+        }
+      }
+    }
+    signal(SIGCHLD, oldSigchldHandler);
+    return true;
+  }
+
+  /*
+   * Accept sessions on a Unix domain socket at the given path, until this
+   * process is killed, returning false only if the socket could not be set
+   * up.  Any lazy analysis is done first, then each session is run in its
+   * own child process, so that all sessions share, by copy-on-write, the
+   * already built process image, but each has its own command state, such as
+   * the redirect setting and the derived set, and any number of sessions can
+   * run at once.  Named sets are shared through the file alongside the core,
+   * which a session reads again each time before it changes that file.
+   */
+  bool Serve(const std::string& socketPath) {
+    int listenFd = SessionSocket::Listen(socketPath);
+    if (listenFd < 0) {
+      return false;
+    }
+    if (_prepareAllCallback != nullptr) {
+      _prepareAllCallback();
+    }
+    if (_preCommandCallback != nullptr) {
+      _preCommandCallback();
+    }
+    // Let finished sessions be reaped without waiting for them.
+    signal(SIGCHLD, SIG_IGN);
+    std::cout << "Serving " << _redirectPrefix << " on " << socketPath
+              << "\n";
+    std::cout.flush();
+    std::cerr.flush();
+    while (true) {
+      int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        std::cerr << "Failed to accept a session.\n" << strerror(errno)
+                  << "\n";
+        return false;
+      }
+      pid_t pid = fork();
+      if (pid == 0) {
+        signal(SIGCHLD, SIG_DFL);
+        close(listenFd);
+        if (dup2(fd, STDIN_FILENO) < 0 || dup2(fd, STDOUT_FILENO) < 0 ||
+            dup2(fd, STDERR_FILENO) < 0) {
+          _exit(1);
+        }
+        close(fd);
+        RunSession();
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(0);
+      }
+      if (pid < 0) {
+        std::cerr << "Failed to start a process to run a session.\n";
+      }
+      close(fd);
+    }
+  }
+
+  /*
+   * Run a single command for which the context was already created.
+   */
+  void RunCommand(Context& context) {
+    try {
+      bool hasIllFormedSwitch = context.HasIllFormedSwitch();
+      if (context.HasIllFormedSwitch()) {
+        if (context.TokenAt(0).find('/') == 0) {
+          return;
+        }
+      }
+      std::string command = context.TokenAt(0);
+      size_t numTokens = context.GetNumTokens();
+      if (command == "help") {
+        HandleHelpCommand(context);
+      } else if (command == "redirect") {
+        HandleRedirectCommand(context);
+      } else if (command == "source") {
+        HandleSourceCommand(context);
+      } else {
+        bool showTiming = false;
+        if (!context.ParseBooleanSwitch("timing", showTiming)) {
+          return;
+        }
+        bool redirectStarted = false;
+        std::map<std::string, std::list<CommandCallback> >::iterator it =
+            _commandCallbacks.find(command);
+        if (it != _commandCallbacks.end()) {
+          size_t mostTokensAccepted = 0;
+          std::list<CommandCallback>::iterator itBest = it->second.end();
+          for (std::list<CommandCallback>::iterator itCheck =
+                   it->second.begin();
+               itCheck != it->second.end(); ++itCheck) {
+            size_t numTokensAccepted = (*itCheck)(context, true);
+            if (numTokensAccepted > mostTokensAccepted) {
+              mostTokensAccepted = numTokensAccepted;
+              itBest = itCheck;
+            }
+          }
+          if (mostTokensAccepted == 0) {
+            _error << "unknown command " << command << "\n";
+            _input.TerminateAllScripts();
           } else {
-            if ((_redirect || !context.Argument("redirectSuffix", 0).empty()) &&
-                !redirectStarted) {
-              // Redirect for the duration of the command context.
+            if (_redirect) {
+              /*
+               * Redirect for the duration of the command context.  Note
+               * that we don't bother supporting /redirectSuffix for the
+               * old style command callbacks because they are deprecated
+               * and typically were written before switched arguments were
+               * handled separately, so they generally not work as
+               * currently
+               * written if the switch were supplied.
+               */
               redirectStarted = true;
               context.StartRedirect();
             }
-            if (!hasIllFormedSwitch) {
-              if (_preCommandCallback != nullptr) {
-                _preCommandCallback();
-              }
-              c->Run(context);
+            if (mostTokensAccepted == numTokens || mostTokensAccepted >= 2) {
+              CommandTimer timer(context, showTiming);
+              (*itBest)(context, false);
+              return;
             }
           }
         }
-      } catch (CommandInterruptedException& e) {
-        // TODO: support SIG_INT to interrupt long running commands
-        _error << "\nThe command was interrupted.\n";
-        _input.TerminateAllScripts();
+        Command* c = FindCommand(command);
+        if (c == (Command*)(0)) {
+          _error << "Command " << command << " is not recognized\n";
+          _error << "Type \"help\" to get help.\n";
+        } else {
+          if ((_redirect || !context.Argument("redirectSuffix", 0).empty()) &&
+              !redirectStarted) {
+            // Redirect for the duration of the command context.
+            redirectStarted = true;
+            context.StartRedirect();
+          }
+          if (!hasIllFormedSwitch) {
+            CommandTimer timer(context, showTiming);
+            if (_preCommandCallback != nullptr) {
+              _preCommandCallback();
+            }
+            c->Run(context);
+          }
+        }
       }
+    } catch (CommandInterruptedException& e) {
+      // TODO: support SIG_INT to interrupt long running commands
+      _error << "\nThe command was interrupted.\n";
+      _input.TerminateAllScripts();
+    }
+  }
+
+ private:
+  static constexpr size_t NO_JOB = ~((size_t)0);
+
+  /*
+   * This is a command read in batch mode, with what is needed to run it
+   * later and to hold its results until they can be written in order.
+   */
+  struct BatchCommand {
+    BatchCommand(const Tokens& tokens, const ScriptContext& scriptContext,
+                 bool redirect, size_t job)
+        : _tokens(tokens),
+          _scriptContext(scriptContext),
+          _redirect(redirect),
+          _job(job),
+          _output(nullptr),
+          _error(nullptr),
+          _failed(false) {}
+    Tokens _tokens;
+    ScriptContext _scriptContext;
+    bool _redirect;
+    size_t _job;
+    FILE* _output;
+    FILE* _error;
+    bool _failed;
+  };
+
+  /*
+   * Start a child process to run the given commands in order, with the
+   * standard output and standard error of each command going to temporary
+   * files.  Return the process id of the child, or 0 if no child could be
+   * started.
+   */
+  pid_t StartBatchJob(std::vector<BatchCommand>& commands,
+                      const std::vector<size_t>& job) {
+    for (size_t index : job) {
+      BatchCommand& command = commands[index];
+      command._output = tmpfile();
+      command._error = tmpfile();
+      if (command._output == nullptr || command._error == nullptr) {
+        std::cerr << "Failed to create a temporary file for batch output.\n";
+        command._failed = true;
+        return 0;
+      }
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "Failed to start a process to run batch commands.\n";
+      commands[job.front()]._failed = true;
+      return 0;
+    }
+    if (pid > 0) {
+      return pid;
+    }
+    /*
+     * Each child runs just its own commands, so there is no point in
+     * further splitting the work of any one of them across threads.
+     */
+    Parallelism::SetNumThreads(1);
+    for (size_t index : job) {
+      BatchCommand& command = commands[index];
+      std::cout.flush();
+      std::cerr.flush();
+      if (dup2(fileno(command._output), STDOUT_FILENO) < 0 ||
+          dup2(fileno(command._error), STDERR_FILENO) < 0) {
+        _exit(1);
+      }
+      _scriptContext = command._scriptContext;
+      _redirect = command._redirect;
+      Context context(command._tokens, _output, _error, _redirectPrefix);
+      RunCommand(context);
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    _exit(0);
+  }
+
+  /*
+   * Run the commands of a session, reading from standard input, which is the
+   * socket, until the client shuts down its end.  The session itself
+   * understands "prompt on|off", which the client uses to ask for a prompt
+   * before each command when a person is typing the commands.
+   */
+  void RunSession() {
+    _input.SetInteractive(false);
+    bool showPrompt = false;
+    while (true) {
+      if (showPrompt && !_input.IsInScript()) {
+        std::cout << "chap> ";
+      }
+      std::cout.flush();
+      Context context(_input, _output, _error, _redirectPrefix);
+      const std::string& command = context.TokenAt(0);
+      if (command.empty()) {
+        if (_input.IsDone()) {
+          break;
+        }
+        continue;
+      }
+      if (command == "prompt") {
+        const std::string& argument = context.TokenAt(1);
+        if (context.GetNumTokens() != 2 ||
+            !(argument == "on" || argument == "off")) {
+          _error << "usage:  prompt on|off\n";
+        } else {
+          showPrompt = (argument == "on");
+        }
+        continue;
+      }
+      RunCommand(context);
+    }
+  }
+
+  void WriteBatchCommandResults(BatchCommand& command) {
+    CopyToStream(command._output, std::cout);
+    CopyToStream(command._error, std::cerr);
+    if (command._failed) {
+      _scriptContext = command._scriptContext;
+      _error.SetContextWritePending();
+      _error << "The batch process running this command failed.\n";
+      _scriptContext.clear();
     }
-    replxx_history_free();
   }
 
+  static void CopyToStream(FILE*& file, std::ostream& stream) {
+    if (file == nullptr) {
+      return;
+    }
+    rewind(file);
+    char buffer[0x10000];
+    size_t numRead;
+    while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      stream.write(buffer, numRead);
+    }
+    stream.flush();
+    fclose(file);
+    file = nullptr;
+  }
+
+ public:
   ScriptContext _scriptContext;
   const std::string _redirectPrefix;
   bool _redirect;
@@ -944,6 +1556,7 @@ class Runner {
   std::map<std::string, std::list<CommandCallback> > _commandCallbacks;
   std::map<std::string, Command*> _commands;
   std::function<void()> _preCommandCallback;
+  std::function<void()> _prepareAllCallback;
 };
 
 }  // namespace Commands
@@ -0,0 +1,165 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+};
+#include <cerrno>
+#include <iostream>
+#include <string>
+namespace chap {
+namespace Commands {
+/*
+ * This sets up both ends of the Unix domain socket used by "chap -serve" and
+ * "chap -connect".  A session is just a stream of command lines, in the same
+ * syntax as at the interactive prompt, from the client, and the output and
+ * errors of those commands, from the server.  The server closes the session
+ * after the client shuts down its end and the last command has finished.
+ */
+class SessionSocket {
+ public:
+  /*
+   * Return a socket listening at the given path, or -1, after reporting the
+   * problem, if that is not possible.  A socket left at that path by a server
+   * that is no longer running is replaced.
+   */
+  static int Listen(const std::string& path) {
+    sockaddr_un address;
+    if (!SetAddress(path, address)) {
+      return -1;
+    }
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+      int fd = Connect(address);
+      if (fd >= 0) {
+        close(fd);
+        std::cerr << "Some server is already listening on \"" << path
+                  << "\".\n";
+        return -1;
+      }
+      (void)unlink(path.c_str());
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (const sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+      std::cerr << "Cannot listen on \"" << path << "\".\n"
+                << strerror(errno) << "\n";
+      if (fd >= 0) {
+        close(fd);
+      }
+      return -1;
+    }
+    return fd;
+  }
+
+  /*
+   * Run a session against the server listening at the given path, passing
+   * standard input to the server and what the server writes to standard
+   * output, and return the exit code for the client.  If standard input is
+   * a terminal, the server is asked to prompt for each command.
+   */
+  static int RunClient(const std::string& path) {
+    sockaddr_un address;
+    if (!SetAddress(path, address)) {
+      return 1;
+    }
+    int fd = Connect(address);
+    if (fd < 0) {
+      std::cerr << "Cannot connect to \"" << path << "\".\n"
+                << strerror(errno) << "\n";
+      return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    static const char promptOn[] = "prompt on\n";
+    if (isatty(STDIN_FILENO) &&
+        !WriteAll(fd, promptOn, sizeof(promptOn) - 1)) {
+      close(fd);
+      return 1;
+    }
+    pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {fd, POLLIN, 0}};
+    char buffer[0x10000];
+    while (true) {
+      if (poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      if (fds[0].revents != 0) {
+        ssize_t numRead = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (numRead > 0) {
+          if (!WriteAll(fd, buffer, numRead)) {
+            break;
+          }
+        } else if (numRead == 0 || errno != EINTR) {
+          // Let the server finish the commands it already has.
+          (void)shutdown(fd, SHUT_WR);
+          fds[0].fd = -1;
+        }
+      }
+      if (fds[1].revents != 0) {
+        ssize_t numRead = read(fd, buffer, sizeof(buffer));
+        if (numRead == 0) {
+          close(fd);
+          return 0;
+        }
+        if ((numRead < 0 && errno != EINTR) ||
+            (numRead > 0 && !WriteAll(STDOUT_FILENO, buffer, numRead))) {
+          break;
+        }
+      }
+    }
+    std::cerr << "The session with \"" << path << "\" failed.\n";
+    close(fd);
+    return 1;
+  }
+
+ private:
+  static bool SetAddress(const std::string& path, sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+      std::cerr << "\"" << path << "\" cannot be used as a socket path.\n";
+      return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+  }
+
+  static int Connect(const sockaddr_un& address) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 &&
+        connect(fd, (const sockaddr*)&address, sizeof(address)) != 0) {
+      int connectErrno = errno;
+      close(fd);
+      errno = connectErrno;
+      return -1;
+    }
+    return fd;
+  }
+
+  static bool WriteAll(int fd, const char* chars, size_t numChars) {
+    while (numChars > 0) {
+      ssize_t numWritten = write(fd, chars, numChars);
+      if (numWritten < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      chars += numWritten;
+      numChars -= numWritten;
+    }
+    return true;
+  }
+};
+}  // namespace Commands
+}  // namespace chap
@@ -39,13 +39,12 @@ class SetBasedCommand : public Command {
       return;
     }
     const std::string& setName = context.Positional(1);
-    std::map<std::string, Subcommand*>::iterator it =
-        _subcommands.find(setName);
-    if (it == _subcommands.end()) {
+    Subcommand* subcommand = FindSubcommand(setName);
+    if (subcommand == nullptr) {
       error << "It is currently not defined how to " << GetName() << " "
             << setName << ".\n";
     } else {
-      it->second->Run(context);
+      subcommand->Run(context);
     }
   }
 
@@ -70,13 +69,12 @@ class SetBasedCommand : public Command {
     size_t numPositionals = context.GetNumPositionals();
     if (numPositionals >= 3) {
       const std::string& setName = context.Positional(2);
-      std::map<std::string, Subcommand*>::iterator it =
-          _subcommands.find(setName);
-      if (it == _subcommands.end()) {
+      Subcommand* subcommand = FindSubcommand(setName);
+      if (subcommand == nullptr) {
         context.GetOutput() << "No help is available for \"" << GetName() << " "
                             << setName << "\".\n";
       } else {
-        it->second->ShowHelpMessage(context);
+        subcommand->ShowHelpMessage(context);
         return;
       }
     }
@@ -96,6 +94,19 @@ class SetBasedCommand : public Command {
 
  private:
   std::map<std::string, Subcommand*> _subcommands;
+
+  /*
+   * A set name that starts with "@" is the name of a set saved by the user,
+   * all of which are handled by the subcommand registered as "@".
+   */
+  Subcommand* FindSubcommand(const std::string& setName) const {
+    std::map<std::string, Subcommand*>::const_iterator it =
+        _subcommands.find(setName);
+    if (it == _subcommands.end() && setName.size() > 1 && setName[0] == '@') {
+      it = _subcommands.find("@");
+    }
+    return (it == _subcommands.end()) ? nullptr : it->second;
+  }
 };
 
 }  // namespace Commands
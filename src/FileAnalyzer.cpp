@@ -1,4 +1,4 @@
-// Copyright (c) 2017,2021 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2021,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -12,22 +12,57 @@ extern "C" {
 #include <iostream>
 #include <memory>
 #include <regex>
+#include "Allocations/EdgeLists.h"
+#include "AnalysisCache.h"
 #include "Commands/Runner.h"
+#include "Commands/SessionSocket.h"
 #include "FileImage.h"
 #include "Linux/ELFCore32FileAnalyzerFactory.h"
 #include "Linux/ELFCore64FileAnalyzerFactory.h"
+#include "Parallelism.h"
+#include "Statistics.h"
 
 namespace chap {
 using namespace std;
 
 FileAnalyzer::FileAnalyzer() {}
 void FileAnalyzer::AddCommandCallbacks(Commands::Runner & /* r */) {}
+bool FileAnalyzer::WriteTrimmedCopy(const std::string & /* path */) {
+  cerr << "Trimming is not supported for this file format.\n";
+  return false;
+}
 
 void PrintUsageAndExit(int exitCode,
                        const vector<string> supportedFileFormats) {
-  cerr << "Usage: chap [-t] <file>\n\n"
+  cerr << "Usage: chap [-t] [-j <num-threads>] [-c] [-z] [-stats] "
+          "[-b <script>] <file>\n"
+          "       chap [-j <num-threads>] [-z] [-stats] [-b <script>] "
+          "-p <pid>\n"
+          "       chap -trim <trimmed-core> <core>\n"
+          "       chap [-j <num-threads>] [-z] [-stats] -serve <socket> "
+          "<file>\n"
+          "       chap -connect <socket>\n\n"
           "-t means to just do truncation check then stop\n"
           "   0 exit code means no truncation was found\n\n"
+          "-j means to use up to the given number of threads to analyze\n"
+          "   the file (default 1)\n\n"
+          "-c means to save the results of the analysis in <file>.chapcache\n"
+          "   and to use them on later runs against the same file\n\n"
+          "-z means to compress the references between allocations, which\n"
+          "   uses less memory for very large cores but is a bit slower\n\n"
+          "-stats means to report the time and memory used by each phase\n"
+          "   of the analysis of the file as soon as it has finished\n\n"
+          "-b means to run the commands from the given script, rather than\n"
+          "   from standard input, running independent commands at the same\n"
+          "   time in up to <num-threads> processes\n\n"
+          "-p means to analyze the given live 64-bit process in place, as if\n"
+          "   it were a core, keeping the process stopped until chap exits\n\n"
+          "-trim means to write a copy of the core that leaves out module\n"
+          "   code and pages of zeros, then stop\n\n"
+          "-serve means to analyze the file once then run commands for any\n"
+          "   number of sessions at once on the given Unix domain socket\n\n"
+          "-connect means to run a session against a chap -serve process,\n"
+          "   sending commands from standard input\n\n"
           "Supported file types include the following:\n\n";
   for (vector<string>::const_iterator it = supportedFileFormats.begin();
        it != supportedFileFormats.end(); ++it) {
@@ -61,16 +96,67 @@ int main(int argc, char **argv, char ** /* envp */) {
     supportedFileFormats.push_back((*it)->GetSupportedFileFormat());
   }
 
-  string path(argv[argc - 1]);
-  if ((argc < 2) || (argc > 3) || ((argc == 3) && (strcmp(argv[1], "-t"))) ||
-      (path[0] == '-')) {
+  bool truncationCheckOnly = false;
+  string batchScriptPath;
+  string trimPath;
+  string servePath;
+  pid_t pid = 0;
+  int argIndex = 1;
+  for (; argIndex < argc && argv[argIndex][0] == '-'; argIndex++) {
+    if (!strcmp(argv[argIndex], "-t")) {
+      truncationCheckOnly = true;
+    } else if (!strcmp(argv[argIndex], "-j") && argIndex + 1 < argc) {
+      char *numThreadsEnd;
+      unsigned long numThreads = strtoul(argv[++argIndex], &numThreadsEnd, 0);
+      if (*numThreadsEnd != '\0' || numThreads == 0) {
+        PrintUsageAndExit(1, supportedFileFormats);
+      }
+      Parallelism::SetNumThreads(numThreads);
+    } else if (!strcmp(argv[argIndex], "-c")) {
+      AnalysisCache::SetEnabled(true);
+    } else if (!strcmp(argv[argIndex], "-stats")) {
+      Statistics::SetEnabled(true);
+    } else if (!strcmp(argv[argIndex], "-z")) {
+      Allocations::EdgeListCompression::SetEnabled(true);
+    } else if (!strcmp(argv[argIndex], "-b") && argIndex + 1 < argc) {
+      batchScriptPath = argv[++argIndex];
+    } else if (!strcmp(argv[argIndex], "-connect") && argIndex + 2 == argc) {
+      exit(Commands::SessionSocket::RunClient(argv[argIndex + 1]));
+    } else if (!strcmp(argv[argIndex], "-serve") && argIndex + 1 < argc) {
+      servePath = argv[++argIndex];
+    } else if (!strcmp(argv[argIndex], "-trim") && argIndex + 1 < argc) {
+      trimPath = argv[++argIndex];
+    } else if (!strcmp(argv[argIndex], "-p") && argIndex + 1 < argc) {
+      char *pidEnd;
+      long pidArg = strtol(argv[++argIndex], &pidEnd, 10);
+      if (*pidEnd != '\0' || pidArg <= 0) {
+        PrintUsageAndExit(1, supportedFileFormats);
+      }
+      pid = (pid_t)pidArg;
+    } else {
+      PrintUsageAndExit(1, supportedFileFormats);
+    }
+  }
+  if (argIndex != ((pid != 0) ? argc : argc - 1) ||
+      (!trimPath.empty() && (pid != 0 || truncationCheckOnly)) ||
+      (!servePath.empty() && (!batchScriptPath.empty() ||
+                              !trimPath.empty() || truncationCheckOnly))) {
     PrintUsageAndExit(1, supportedFileFormats);
   }
-
-  bool truncationCheckOnly = (argc == 3);
+  if (pid != 0 && AnalysisCache::IsEnabled()) {
+    /*
+     * A cache would not outlive the process and would not be valid for
+     * the next attach anyway, because the process keeps running.
+     */
+    cerr << "Warning: -c is ignored with -p.\n";
+    AnalysisCache::SetEnabled(false);
+  }
 
   try {
-    FileImage fileImage(path.c_str());
+    std::unique_ptr<FileImage> fileImagePtr(
+        (pid != 0) ? new FileImage(pid) : new FileImage(argv[argIndex]));
+    const FileImage &fileImage = *fileImagePtr;
+    const string &path = fileImage.GetFileName();
     for (vector<FileAnalyzerFactory *>::iterator it = factories.begin();
          it != factories.end(); ++it) {
       /*
@@ -100,6 +186,11 @@ int main(int argc, char **argv, char ** /* envp */) {
           exit(1);
         }
       }
+      if (!trimPath.empty()) {
+        bool trimmed = analyzer->WriteTrimmedCopy(trimPath);
+        delete analyzer;
+        exit(trimmed ? 0 : 1);
+      }
       if (!truncationCheckOnly) {
         Commands::Runner commandsRunner(path);
 
@@ -107,7 +198,15 @@ int main(int argc, char **argv, char ** /* envp */) {
         // TODO - the call to AddCommandCallbacks will become obsolete
         analyzer->AddCommandCallbacks(commandsRunner);
 
-        commandsRunner.RunCommands();
+        if (!servePath.empty()) {
+          if (!commandsRunner.Serve(servePath)) {
+            exit(1);
+          }
+        } else if (batchScriptPath.empty()) {
+          commandsRunner.RunCommands();
+        } else if (!commandsRunner.RunBatch(batchScriptPath)) {
+          exit(1);
+        }
       }
       delete analyzer;
       exit(0);
@@ -1,4 +1,4 @@
-// Copyright (c) 2017 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -53,5 +53,13 @@ class FileAnalyzer {
    */
 
   virtual void AddCommands(Commands::Runner& r) = 0;
+
+  /*
+   * Write to the given path a copy of the file that leaves out whatever is
+   * not needed to analyze it, returning false, after reporting the problem,
+   * if the copy could not be written or this is not supported for the file
+   * format.
+   */
+  virtual bool WriteTrimmedCopy(const std::string& path);
 };
 }  // namespace chap
@@ -1,4 +1,4 @@
-// Copyright (c) 2017 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -13,12 +13,19 @@ extern "C" {
 #include <time.h>
 #include <unistd.h>
 };
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Linux/LiveProcessImage.h"
+#include "PagedGzipImage.h"
 namespace chap {
 class FileImage {
  public:
   FileImage(const char *filePath, bool verboseOnFailure = true)
       : _filePath(filePath),
-        _fileSize(0)
+        _fileSize(0),
+        _releaseBehindSweeps(false)
 
   {
     _fd = open(filePath, O_RDONLY);
@@ -87,21 +94,207 @@ class FileImage {
       close(_fd);
       throw "mmap failed";
     }
+    if (PagedGzipImage::IsGzip(_image, _fileSize)) {
+      try {
+        _pagedImage.reset(new PagedGzipImage(_image, _fileSize));
+      } catch (const char *failure) {
+        if (verboseOnFailure) {
+          std::cerr << "Failed to decompress " << _filePath << ": " << failure
+                    << std::endl;
+        }
+        (void)munmap(_image, _fileSize);
+        close(_fd);
+        throw "cannot decompress file";
+      }
+    } else {
+      FindHoles();
+      /*
+       * Pages already swept are given back only if the file is too large to
+       * stay comfortably in the page cache, because otherwise later sweeps
+       * would just fault them in again for nothing.
+       */
+      long numPhysicalPages = sysconf(_SC_PHYS_PAGES);
+      _releaseBehindSweeps =
+          numPhysicalPages > 0 &&
+          _fileSize / SystemPageSize() > (uint64_t)numPhysicalPages / 2;
+    }
+  }
+
+  /*
+   * Present the memory of the given live process as if it were a core, named
+   * "process.<pid>" so that, for example, redirected output has somewhere to
+   * go.  The process is stopped for as long as the image exists.
+   */
+  FileImage(pid_t pid, bool verboseOnFailure = true)
+      : _fd(-1),
+        _filePath("process." + std::to_string(pid)),
+        _fileSize(0),
+        _image(nullptr),
+        _releaseBehindSweeps(false) {
+    try {
+      _pagedImage.reset(new Linux::LiveProcessImage(pid));
+    } catch (const char *failure) {
+      if (verboseOnFailure) {
+        std::cerr << "Cannot analyze process " << std::dec << pid << ": "
+                  << failure << "." << std::endl;
+        if (errno != 0) {
+          std::cerr << strerror(errno) << "\n";
+        }
+      }
+      throw "cannot analyze process";
+    }
   }
+
   ~FileImage() {
-    (void)munmap(_image, _fileSize);
+    _pagedImage.reset();
+    if (_image != nullptr) {
+      (void)munmap(_image, _fileSize);
+    }
     if (_fd >= 0) {
       close(_fd);
     }
   }
   int _fd;
-  const char *GetImage() const { return _image; }
-  uint64_t GetFileSize() const { return _fileSize; }
+  /*
+   * For a gzip-compressed file, the image and size are for the uncompressed
+   * contents, and for a live process they are for the equivalent core.
+   */
+  const char *GetImage() const {
+    return (_pagedImage != nullptr) ? _pagedImage->GetImage() : _image;
+  }
+  uint64_t GetFileSize() const {
+    return (_pagedImage != nullptr) ? _pagedImage->GetSize() : _fileSize;
+  }
   const std::string &GetFileName() const { return _filePath; }
 
+  /*
+   * A sparse file, such as a core written by the kernel, which leaves out
+   * pages that are all 0, may have holes, which read as 0 but need not be
+   * scanned at all.  Each hole is given as a whole number of pages.
+   */
+  bool HasHoles() const { return !_holeStarts.empty(); }
+
+  /*
+   * Return the first position in [image, limit) that is not in a hole, or
+   * limit if there is none.
+   */
+  const char *SkipHoles(const char *image, const char *limit) const {
+    size_t hole = HoleAtOrAfter(image);
+    if (hole < _holeStarts.size() && _image + _holeStarts[hole] <= image) {
+      return std::min(limit, (const char *)(_image + _holeLimits[hole]));
+    }
+    return image;
+  }
+
+  /*
+   * Return the first position in [image, limit) that is in a hole, or limit
+   * if there is none.
+   */
+  const char *FindHole(const char *image, const char *limit) const {
+    size_t hole = HoleAtOrAfter(image);
+    if (hole < _holeStarts.size()) {
+      return std::max(image,
+                      std::min(limit, (const char *)(_image +
+                                                     _holeStarts[hole])));
+    }
+    return limit;
+  }
+
+  /*
+   * Ask the kernel to start reading [image, limit) from the file, without
+   * waiting for it, because it is about to be read in order.  This does
+   * nothing unless the range is in the mapped file, rather than in a paged
+   * image, which is filled in some other way.
+   */
+  void WillSweep(const char *image, const char *limit) const {
+    if (_pagedImage == nullptr && image >= _image &&
+        limit <= _image + _fileSize && image < limit) {
+      const char *start = AlignDown(image);
+      (void)madvise((void *)start, limit - start, MADV_WILLNEED);
+    }
+  }
+
+  /*
+   * Say that the whole pages of [image, limit) have been swept and are not
+   * expected to be read again soon, so that, for a file larger than the
+   * page cache would comfortably hold, they can be reclaimed before pages
+   * that have not been read yet.  The contents are unchanged, because the
+   * file is mapped read-only, and are just read again from the file, if
+   * needed.
+   */
+  void Swept(const char *image, const char *limit) const {
+    if (_releaseBehindSweeps && _pagedImage == nullptr && image >= _image &&
+        limit <= _image + _fileSize) {
+      const char *start = AlignDown(image + SystemPageSize() - 1);
+      const char *end = AlignDown(limit);
+      if (start < end) {
+        (void)madvise((void *)start, end - start, MADV_DONTNEED);
+      }
+    }
+  }
+
  private:
+  static constexpr uint64_t HOLE_ALIGNMENT = 0x1000;
   std::string _filePath;
   uint64_t _fileSize;
   char *_image;
+  bool _releaseBehindSweeps;
+  std::unique_ptr<PagedImage> _pagedImage;
+  std::vector<uint64_t> _holeStarts;
+  std::vector<uint64_t> _holeLimits;
+
+  static uint64_t SystemPageSize() {
+    static const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    return pageSize;
+  }
+
+  static const char *AlignDown(const char *image) {
+    return (const char *)((uintptr_t)image &
+                          ~(uintptr_t)(SystemPageSize() - 1));
+  }
+
+  /*
+   * Record the holes of the file, as reported by SEEK_HOLE and SEEK_DATA.
+   * A file system that does not support them reports the whole file as
+   * data, so that no holes are found.
+   */
+  void FindHoles() {
+    off64_t offset = 0;
+    off64_t fileSize = (off64_t)_fileSize;
+    while (offset < fileSize) {
+      off64_t holeStart = lseek64(_fd, offset, SEEK_HOLE);
+      if (holeStart < 0 || holeStart >= fileSize) {
+        break;
+      }
+      off64_t holeLimit = lseek64(_fd, holeStart, SEEK_DATA);
+      if (holeLimit < 0 || holeLimit > fileSize) {
+        holeLimit = fileSize;
+      }
+      uint64_t start =
+          ((uint64_t)holeStart + HOLE_ALIGNMENT - 1) & ~(HOLE_ALIGNMENT - 1);
+      uint64_t limit = (holeLimit == fileSize)
+                           ? _fileSize
+                           : ((uint64_t)holeLimit & ~(HOLE_ALIGNMENT - 1));
+      if (start < limit) {
+        _holeStarts.push_back(start);
+        _holeLimits.push_back(limit);
+      }
+      offset = holeLimit;
+    }
+  }
+
+  /*
+   * Return the index of the first hole that ends after the given position,
+   * or the number of holes if there is none or the position is not in the
+   * image of the file.
+   */
+  size_t HoleAtOrAfter(const char *image) const {
+    if (_holeStarts.empty() || image < _image || image >= _image + _fileSize) {
+      return _holeStarts.size();
+    }
+    return std::upper_bound(_holeLimits.begin(), _holeLimits.end(),
+                            (uint64_t)(image - _image)) -
+           _holeLimits.begin();
+  }
 };
 }  // namespace chap
@@ -100,6 +100,14 @@ class AllocationsTagger : public Allocations::Tagger<Offset> {
     return false;
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& /* contiguousImage */,
+                            Reader& /* reader */, AllocationIndex /* index */,
+                            const Allocation& allocation,
+                            bool isUnsigned) const {
+    return _enabled && isUnsigned &&
+           allocation.FinderIndex() == _mappedPageRangeAllocationFinderIndex;
+  }
+
  private:
   const Allocations::Graph<Offset>& _graph;
   const Allocations::Directory<Offset>& _directory;
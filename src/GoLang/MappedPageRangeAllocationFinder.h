@@ -66,9 +66,7 @@ class MappedPageRangeAllocationFinder
    * Return the address of the next allocation (in increasing order of
    * address) to be reported by this finder, without advancing to the next
    * allocation.  The return value is undefined if there are no more
-   * allocations available.  Note that at the time this function is called
-   * any allocations already reported by this allocation finder have already
-   * been assigned allocation indices in the Directory.
+   * allocations available.
    */
   virtual Offset NextAddress() { return _allocationAddress; }
   /*
@@ -104,7 +102,6 @@ class MappedPageRangeAllocationFinder
 
     _rangeIterator->Advance();
     if (_rangeIterator->Finished()) {
-      CorrectAllocationFreeStatus();
       return;
     }
 
@@ -126,6 +123,12 @@ class MappedPageRangeAllocationFinder
     return size;
   }
 
+  /*
+   * Now that all the allocations are in the Directory, correct the free
+   * status of any that are on free lists.
+   */
+  virtual void AllocationsPlaced() { CorrectAllocationFreeStatus(); }
+
  private:
   const VirtualAddressMap<Offset>& _addressMap;
   typename VirtualAddressMap<Offset>::Reader _mspanReader;
@@ -56,9 +56,7 @@ class HeapAllocationFinder : public Allocations::Directory<Offset>::Finder {
    * Return the address of the next allocation (in increasing order of
    * address) to be reported by this finder, without advancing to the next
    * allocation.  The return value is undefined if there are no more
-   * allocations available.  Note that at the time this function is called
-   * any allocations already reported by this allocation finder have already
-   * been assigned allocation indices in the Directory.
+   * allocations available.
    */
   virtual Offset NextAddress() { return _allocationAddress; }
   /*
@@ -81,16 +79,6 @@ class HeapAllocationFinder : public Allocations::Directory<Offset>::Finder {
     if (_heapMapIterator != _heapMap.end()) {
       while (!AdvanceToNextAllocationOfHeap()) {
         if (++_heapMapIterator == _heapMap.end()) {
-          for (auto keyAndValue : _arenas) {
-            if (keyAndValue.first != _mainArenaAddress) {
-              const typename InfrastructureFinder<Offset>::Arena& arena =
-                  keyAndValue.second;
-              _fastBinFreeStatusFixer.MarkFastBinItemsAsFree(arena, false,
-                                                             _finderIndex);
-              _doublyLinkedListCorruptionChecker
-                  .CheckDoublyLinkedListCorruption(arena);
-            }
-          }
           return;
         } else {
           SkipHeaders();
@@ -106,6 +94,54 @@ class HeapAllocationFinder : public Allocations::Directory<Offset>::Finder {
     return (size <= 5 * sizeof(Offset)) ? 0 : (size - 0x1f);
   }
 
+  /*
+   * Each heap not yet finished is a separate part, so that the heaps can be
+   * walked concurrently.
+   */
+  virtual size_t NumParts() {
+    return std::distance(_heapMapIterator, _heapMap.end());
+  }
+
+  /*
+   * Walk the heap for the given part, using a copy of this finder so that
+   * the state of the walk is not shared with the walks of other heaps.  The
+   * first part continues from the allocation already found in the current
+   * heap.
+   */
+  virtual void FindAllocations(size_t part,
+                               typename Allocations::Directory<Offset>::Batch&
+                                   batch) {
+    HeapAllocationFinder walker(*this);
+    if (part == 0) {
+      batch.Add(_allocationAddress, _allocationSize, _allocationIsUsed);
+    } else {
+      std::advance(walker._heapMapIterator, part);
+      walker.SkipHeaders();
+    }
+    while (walker.AdvanceToNextAllocationOfHeap()) {
+      batch.Add(walker._allocationAddress, walker._allocationSize,
+                walker._allocationIsUsed);
+    }
+  }
+
+  /*
+   * Now that all the allocations are in the Directory, mark the ones on
+   * fast bin lists as free and check the free lists for corruption.
+   */
+  virtual void AllocationsPlaced() {
+    _heapMapIterator = _heapMap.end();
+    for (auto keyAndValue : _arenas) {
+      if (keyAndValue.first != _mainArenaAddress) {
+        const typename InfrastructureFinder<Offset>::Arena& arena =
+            keyAndValue.second;
+        _fastBinFreeStatusFixer.MarkFastBinItemsAsFree(arena, false,
+                                                       _finderIndex);
+        _doublyLinkedListCorruptionChecker.CheckDoublyLinkedListCorruption(
+            arena);
+      }
+    }
+  }
+
  private:
   const VirtualAddressMap<Offset>& _addressMap;
   typename VirtualAddressMap<Offset>::Reader _reader;
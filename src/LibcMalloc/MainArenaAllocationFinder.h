@@ -58,9 +58,7 @@ class MainArenaAllocationFinder
    * Return the address of the next allocation (in increasing order of
    * address) to be reported by this finder, without advancing to the next
    * allocation.  The return value is undefined if there are no more
-   * allocations available.  Note that at the time this function is called
-   * any allocations already reported by this allocation finder have already
-   * been assigned allocation indices in the Directory.
+   * allocations available.
    */
   virtual Offset NextAddress() { return _allocationAddress; }
   /*
@@ -83,10 +81,6 @@ class MainArenaAllocationFinder
     if (_mainArenaRunsIterator != _mainArenaRuns.end()) {
       while (!AdvanceToNextAllocationOfRun()) {
         if (++_mainArenaRunsIterator == _mainArenaRuns.end()) {
-          _fastBinFreeStatusFixer.MarkFastBinItemsAsFree(_mainArena, true,
-                                                         _finderIndex);
-          _doublyLinkedListCorruptionChecker.CheckDoublyLinkedListCorruption(
-              _mainArena);
           return;
         } else {
           StartMainArenaRun();
@@ -102,6 +96,19 @@ class MainArenaAllocationFinder
     return (size <= 5 * sizeof(Offset)) ? 0 : (size - 0x1f);
   }
 
+  /*
+   * Now that all the allocations are in the Directory, mark the ones on
+   * fast bin lists as free and check the free lists for corruption.
+   */
+  virtual void AllocationsPlaced() {
+    if (!_mainArenaRuns.empty()) {
+      _fastBinFreeStatusFixer.MarkFastBinItemsAsFree(_mainArena, true,
+                                                     _finderIndex);
+      _doublyLinkedListCorruptionChecker.CheckDoublyLinkedListCorruption(
+          _mainArena);
+    }
+  }
+
  private:
   const VirtualAddressMap<Offset>& _addressMap;
   typename VirtualAddressMap<Offset>::Reader _reader;
@@ -27,9 +27,7 @@ class MmappedAllocationFinder : public Allocations::Directory<Offset>::Finder {
    * Return the address of the next allocation (in increasing order of
    * address) to be reported by this finder, without advancing to the next
    * allocation.  The return value is undefined if there are no more
-   * allocations available.  Note that at the time this function is called
-   * any allocations already reported by this allocation finder have already
-   * been assigned allocation indices in the Directory.
+   * allocations available.
    */
   virtual Offset NextAddress() { return _itNext->first + 2 * sizeof(Offset); }
   /*
@@ -0,0 +1,250 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+};
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../ModuleDirectory.h"
+#include "../Statistics.h"
+
+namespace chap {
+namespace Linux {
+/*
+ * This writes a copy of an ELF core that leaves out what chap does not need,
+ * so that the copy is quicker to move and store but gives the same results.
+ * The ELF header, the program headers and the notes are kept, with any
+ * section headers dropped.  The image of each PT_LOAD segment is kept except
+ * for executable, non-writable segments that belong to modules, which are
+ * left as described but not present, as in a core written with a coredump
+ * filter that excludes them, because their contents can be taken from the
+ * modules themselves.  A segment that starts with an ELF header is kept even
+ * so, because that header, and in older modules the dynamic string table that
+ * follows it in the same segment, is what is used to find and name the module,
+ * and because the vdso is such a segment but has no file.  Pages of the kept
+ * images that hold only 0 are left as holes in the copy, which read as 0 but
+ * take no space.
+ */
+template <class ElfImage>
+class CoreTrimmer {
+ public:
+  typedef typename ElfImage::Offset Offset;
+  typedef typename ElfImage::ElfHeader ElfHeader;
+  typedef typename ElfImage::ProgramHeader ProgramHeader;
+
+  CoreTrimmer(const ElfImage& elfImage,
+              const ModuleDirectory<Offset>& moduleDirectory)
+      : _elfImage(elfImage),
+        _moduleDirectory(moduleDirectory),
+        _image(elfImage._image),
+        _fileImage(elfImage._fileImage),
+        _fd(-1),
+        _bytesKept(0),
+        _bytesDropped(0),
+        _bytesZero(0) {}
+
+  /*
+   * Write the trimmed copy to the given path, returning false, after
+   * reporting the problem, if it could not be written.
+   */
+  bool Write(const std::string& path) {
+    Statistics::Phase phase("CoreTrimmer::Write");
+    if (_elfImage.IsTruncated()) {
+      std::cerr << "A truncated core cannot be trimmed.\n";
+      return false;
+    }
+    const ElfHeader& elfHeader = *((const ElfHeader*)_image);
+    if (elfHeader.e_phnum == PN_XNUM) {
+      std::cerr << "A core with more than " << std::dec << (PN_XNUM - 1)
+                << " program headers cannot be trimmed.\n";
+      return false;
+    }
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (_fd < 0) {
+      std::cerr << "Cannot open \"" << path << "\" for writing.\n"
+                << strerror(errno) << "\n";
+      return false;
+    }
+
+    ElfHeader newElfHeader = elfHeader;
+    newElfHeader.e_phoff = sizeof(ElfHeader);
+    newElfHeader.e_shoff = 0;
+    newElfHeader.e_shnum = 0;
+    newElfHeader.e_shstrndx = SHN_UNDEF;
+    std::vector<ProgramHeader> programHeaders(
+        (const ProgramHeader*)(_image + elfHeader.e_phoff),
+        (const ProgramHeader*)(_image + elfHeader.e_phoff) +
+            elfHeader.e_phnum);
+    newElfHeader.e_phentsize = sizeof(ProgramHeader);
+
+    uint64_t offset =
+        sizeof(ElfHeader) + programHeaders.size() * sizeof(ProgramHeader);
+    bool written = true;
+    for (ProgramHeader& programHeader : programHeaders) {
+      if (programHeader.p_type != PT_LOAD && programHeader.p_filesz != 0) {
+        offset = AlignUp(offset, programHeader.p_align);
+        written = written && WriteImage(_image + programHeader.p_offset,
+                                        programHeader.p_filesz, offset);
+        programHeader.p_offset = offset;
+        offset += programHeader.p_filesz;
+      }
+    }
+    for (ProgramHeader& programHeader : programHeaders) {
+      if (programHeader.p_type != PT_LOAD) {
+        continue;
+      }
+      offset = AlignUp(offset, programHeader.p_align);
+      if (programHeader.p_filesz != 0 && IsModuleCode(programHeader)) {
+        _bytesDropped += programHeader.p_filesz;
+        programHeader.p_filesz = 0;
+      } else {
+        written = written && WriteImage(_image + programHeader.p_offset,
+                                        programHeader.p_filesz, offset);
+      }
+      programHeader.p_offset = offset;
+      offset += programHeader.p_filesz;
+    }
+    written = written &&
+              WriteAll((const char*)&newElfHeader, sizeof(ElfHeader), 0) &&
+              WriteAll((const char*)programHeaders.data(),
+                       programHeaders.size() * sizeof(ProgramHeader),
+                       sizeof(ElfHeader)) &&
+              ftruncate(_fd, (off_t)offset) == 0;
+    if (!written) {
+      std::cerr << "Failed to write \"" << path << "\".\n"
+                << strerror(errno) << "\n";
+    }
+    if (close(_fd) != 0 && written) {
+      std::cerr << "Failed to close \"" << path << "\".\n";
+      written = false;
+    }
+    _fd = -1;
+    return written;
+  }
+
+  /*
+   * These give the number of bytes of images written, left out as module
+   * code and left as holes because they were 0.
+   */
+  uint64_t GetBytesKept() const { return _bytesKept; }
+  uint64_t GetBytesDropped() const { return _bytesDropped; }
+  uint64_t GetBytesZero() const { return _bytesZero; }
+
+ private:
+  static constexpr uint64_t PAGE_SIZE = 0x1000;
+  static constexpr size_t COPY_SIZE = 0x100000;
+  const ElfImage& _elfImage;
+  const ModuleDirectory<Offset>& _moduleDirectory;
+  const char* _image;
+  const FileImage& _fileImage;
+  int _fd;
+  uint64_t _bytesKept;
+  uint64_t _bytesDropped;
+  uint64_t _bytesZero;
+  std::vector<char> _copy;
+
+  static uint64_t AlignUp(uint64_t offset, uint64_t alignment) {
+    if (alignment <= 1) {
+      return offset;
+    }
+    return (offset + alignment - 1) & ~(alignment - 1);
+  }
+
+  /*
+   * Return true if the image of the segment is executable but not writable,
+   * does not start with an ELF header and lies entirely within a single range
+   * of some module.
+   */
+  bool IsModuleCode(const ProgramHeader& programHeader) const {
+    if ((programHeader.p_flags & (PF_X | PF_W)) != PF_X ||
+        programHeader.p_filesz < SELFMAG ||
+        !strncmp(_image + programHeader.p_offset, ELFMAG, SELFMAG)) {
+      return false;
+    }
+    std::string name;
+    Offset base;
+    Offset size;
+    Offset relativeVirtualAddress;
+    return _moduleDirectory.Find(programHeader.p_vaddr, name, base, size,
+                                 relativeVirtualAddress) &&
+           programHeader.p_vaddr + programHeader.p_filesz <= base + size;
+  }
+
+  static bool IsZero(const char* image, uint64_t numBytes) {
+    const uint64_t* words = (const uint64_t*)image;
+    uint64_t merged = 0;
+    for (uint64_t i = 0; i < numBytes / sizeof(uint64_t); i++) {
+      merged |= words[i];
+    }
+    return merged == 0;
+  }
+
+  /*
+   * Write the given image at the given offset, copying it first, because it
+   * may be in a paged image, which the kernel cannot fault in (see
+   * PagedImage).
+   */
+  bool WriteAll(const char* image, uint64_t numBytes, uint64_t offset) {
+    _copy.resize(COPY_SIZE);
+    while (numBytes > 0) {
+      size_t numInChunk = (size_t)std::min(numBytes, (uint64_t)COPY_SIZE);
+      memcpy(_copy.data(), image, numInChunk);
+      const char* next = _copy.data();
+      const char* limit = next + numInChunk;
+      while (next < limit) {
+        ssize_t numWritten = pwrite(_fd, next, limit - next, (off_t)offset);
+        if (numWritten < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          return false;
+        }
+        next += numWritten;
+        offset += numWritten;
+      }
+      image += numInChunk;
+      numBytes -= numInChunk;
+    }
+    return true;
+  }
+
+  /*
+   * Write the given image at the given offset, skipping whole pages, with
+   * respect to the image, that hold only 0, including any that are holes
+   * in the original core, which need not even be read.
+   */
+  bool WriteImage(const char* image, uint64_t numBytes, uint64_t offset) {
+    const char* limit = image + numBytes;
+    const char* runStart = image;
+    const char* next = image;
+    while (next < limit) {
+      const char* pageLimit = std::min(limit, next + PAGE_SIZE);
+      const char* afterHole = _fileImage.SkipHoles(next, limit);
+      if (afterHole != next ||
+          (pageLimit - next == PAGE_SIZE && IsZero(next, PAGE_SIZE))) {
+        if (!WriteAll(runStart, next - runStart, offset + (runStart - image))) {
+          return false;
+        }
+        _bytesKept += next - runStart;
+        runStart = (afterHole != next) ? afterHole : pageLimit;
+        _bytesZero += runStart - next;
+        next = runStart;
+        continue;
+      }
+      next = pageLimit;
+    }
+    _bytesKept += next - runStart;
+    return WriteAll(runStart, next - runStart, offset + (runStart - image));
+  }
+};
+}  // namespace Linux
+}  // namespace chap
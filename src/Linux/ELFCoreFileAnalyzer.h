@@ -1,10 +1,11 @@
-// Copyright (c) 2017-2019 Broadcom. All Rights Reserved.
+// Copyright (c) 2017-2019,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
 #include "../FileAnalyzer.h"
 #include "../VirtualAddressMapCommandHandler.h"
+#include "CoreTrimmer.h"
 #include "ELFImage.h"
 #include "LinuxProcessImage.h"
 #include "ProcessImageCommandHandler.h"
@@ -78,9 +79,32 @@ class ELFCoreFileAnalyzer : public FileAnalyzer {
     if (_processImageCommandHandler.get() != 0) {
       _processImageCommandHandler->AddCommands(r);
     }
+    if (_processImage.get() == 0) {
+      return;
+    }
     r.SetPreCommandCallback([this]() {
       this->_processImage->RefreshSignaturesAndAnchors();
     });
+    r.SetPrepareAllCallback([this]() {
+      this->_processImage->Prepare(ProcessImage<Offset>::TAGS);
+    });
+  }
+
+  virtual bool WriteTrimmedCopy(const std::string& path) {
+    if (_processImage == nullptr) {
+      return FileAnalyzer::WriteTrimmedCopy(path);
+    }
+    CoreTrimmer<ElfImage> trimmer(_elfImage,
+                                  _processImage->GetModuleDirectory());
+    if (!trimmer.Write(path)) {
+      return false;
+    }
+    std::cout << "Wrote " << path << " with 0x" << std::hex
+              << trimmer.GetBytesKept() << " bytes of memory images, leaving "
+              << "out 0x" << trimmer.GetBytesDropped()
+              << " bytes of module code\nand 0x" << trimmer.GetBytesZero()
+              << " bytes of zeros.\n";
+    return true;
   }
 
  private:
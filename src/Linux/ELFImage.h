@@ -187,6 +187,8 @@ class ELFImage {
       }
     }
 
+    _virtualAddressMap.Freeze();
+
     // TODO: include section headers in calculation of
     // _expectedMinimumFileSize.
     _isTruncated = (_fileSize < _minimumExpectedFileSize);
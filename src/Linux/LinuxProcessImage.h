@@ -6,10 +6,12 @@
 #include <string.h>
 #include <map>
 #include <regex>
+#include "../AnalysisCache.h"
 #include "../Allocations/TaggerRunner.h"
 #include "../CPlusPlus/Unmangler.h"
 #include "../LibcMalloc/FinderGroup.h"
 #include "../ProcessImage.h"
+#include "../Statistics.h"
 #include "ELFImage.h"
 #include "ELFModuleImageFactory.h"
 #include "ModuleFinder.h"
@@ -31,7 +33,9 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
                              new ELFModuleImageFactory<ElfImage>()),
         _elfImage(elfImage),
         _firstReadableStackGuardFound(false),
-        _symdefsRead(false) {
+        _symdefsRead(false),
+        _cacheChecked(false),
+        _symreqsChecked(false) {
     if (_elfImage.GetELFType() != ET_CORE) {
       /*
        * It is the responsibilty of the caller to avoid passing in an ELFImage
@@ -45,6 +49,8 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
       return;
     }
 
+    Statistics::Phase phase("LinuxProcessImage");
+
     FindFileMappedRanges();
 
     FindModules();
@@ -55,15 +61,33 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
      * directory.
      */
 
-    _libcMallocFinderGroup.reset(new LibcMalloc::FinderGroup<Offset>(
-        Base::_virtualMemoryPartition, Base::_moduleDirectory,
-        Base::_allocationDirectory, Base::_threadMap, Base::_unfilledImages));
-
-    Base::_pythonFinderGroup.Resolve();
-    Base::_goLangFinderGroup.Resolve();
-    Base::_TCMallocFinderGroup.Resolve();
-    Base::_pThreadInfrastructureFinder.Resolve();
-    Base::_follyFibersInfrastructureFinder.Resolve();
+    {
+      Statistics::Phase phase("LibcMalloc::FinderGroup");
+      _libcMallocFinderGroup.reset(new LibcMalloc::FinderGroup<Offset>(
+          Base::_virtualMemoryPartition, Base::_moduleDirectory,
+          Base::_allocationDirectory, Base::_threadMap,
+          Base::_unfilledImages));
+    }
+    {
+      Statistics::Phase phase("Python::FinderGroup::Resolve");
+      Base::_pythonFinderGroup.Resolve();
+    }
+    {
+      Statistics::Phase phase("GoLang::FinderGroup::Resolve");
+      Base::_goLangFinderGroup.Resolve();
+    }
+    {
+      Statistics::Phase phase("TCMalloc::FinderGroup::Resolve");
+      Base::_TCMallocFinderGroup.Resolve();
+    }
+    {
+      Statistics::Phase phase("PThread::InfrastructureFinder::Resolve");
+      Base::_pThreadInfrastructureFinder.Resolve();
+    }
+    {
+      Statistics::Phase phase("FollyFibers::InfrastructureFinder::Resolve");
+      Base::_follyFibersInfrastructureFinder.Resolve();
+    }
 
     /*
      * At this point we should have identified all the stacks except the one
@@ -113,7 +137,12 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
      * Now that any allocation finders have been registered with the
      * allocaion directory, find out where all the allocations are.
      */
-    Base::_allocationDirectory.ResolveAllocationBoundaries();
+    {
+      Statistics::Phase phase("ResolveAllocationBoundaries");
+      Base::_allocationDirectory.ResolveAllocationBoundaries();
+    }
+    Statistics::SetCounter("allocations",
+                           Base::_allocationDirectory.NumAllocations());
 
     /*
      * Finding statically declared type_info structures depends on
@@ -121,7 +150,10 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
      * signatures used by allocations depends on finding the allocations
      * first.
      */
-    Base::_typeInfoDirectory.Resolve();
+    {
+      Statistics::Phase phase("TypeInfoDirectory::Resolve");
+      Base::_typeInfoDirectory.Resolve();
+    }
 
     /*
      * Static anchor ranges should be found after the allocations and modules,
@@ -137,24 +169,6 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
      */
     FindStaticAnchorRanges();
 
-    Base::_allocationGraph = new Allocations::Graph<Offset>(
-        Base::_virtualAddressMap, Base::_allocationDirectory, Base::_threadMap,
-        Base::_stackRegistry, _staticAnchorLimits, nullptr, nullptr);
-
-    /*
-     * In Linux processes the current approach is to wait until the
-     * allocations have been found, then treat pointers at the start of
-     * the allocations to read only memory as signatures.  This means
-     * that the signatures can't be identified until the allocations have
-     * been found.
-     */
-
-    FindSignaturesInAllocations();
-
-    FindSignatureNamesFromBinaries();
-
-    WriteSymreqsFileIfNeeded();
-
     /*
      * We do this after finding the allocations, because there is
      * a possiblity that the arenas may not have been aligned as
@@ -168,11 +182,10 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
 
     /*
      * Once this constructor as finished, any classification of ranges is
-     * done.
+     * done.  The graph, signatures and tags are found only as needed by
+     * commands (see ProcessImage::Prepare).
      */
     Base::_virtualMemoryPartition.ClaimUnclaimedRangesAsUnknown();
-
-    Base::TagAllocations();
   }
 
   LibcMalloc::FinderGroup<Offset>& GetLibcMallocFinderGroup() const {
@@ -180,15 +193,154 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
   }
 
   void RefreshSignaturesAndAnchors() {
-    if (!_symdefsRead) {
+    if (!_symdefsRead && Base::IsPrepared(Base::SIGNATURES)) {
       ReadSymdefsFile();
     }
   }
 
+ protected:
+  virtual void PrepareStage(typename Base::Stage stage) {
+    if (!_cacheChecked) {
+      _cacheChecked = true;
+      if (AnalysisCache::IsEnabled()) {
+        RestoreFromCache();
+      }
+    }
+    switch (stage) {
+      case Base::GRAPH:
+        if (!Base::_isPrepared[Base::GRAPH]) {
+          FindGraph();
+        }
+        break;
+      case Base::SIGNATURES:
+        if (!Base::_isPrepared[Base::SIGNATURES]) {
+          FindSignatures();
+        }
+        break;
+      default:
+        if (!Base::_isPrepared[Base::GRAPH]) {
+          FindGraph();
+        }
+        if (!Base::_isPrepared[Base::SIGNATURES]) {
+          FindSignatures();
+        }
+        if (!Base::_isPrepared[Base::TAGS]) {
+          TagAllocations(nullptr);
+        }
+        break;
+    }
+
+    if (!_symreqsChecked && Base::_isPrepared[Base::GRAPH] &&
+        Base::_isPrepared[Base::SIGNATURES]) {
+      _symreqsChecked = true;
+      WriteSymreqsFileIfNeeded();
+    }
+    RefreshSignaturesAndAnchors();
+  }
+
  private:
   std::unique_ptr<LibcMalloc::FinderGroup<Offset> > _libcMallocFinderGroup;
 
+  /*
+   * If the analysis cache matches the core and the allocations, the graph,
+   * signatures and tags are restored from the cache rather than calculated.
+   */
+  void RestoreFromCache() {
+    const FileImage& fileImage = Base::_virtualAddressMap.GetFileImage();
+    const typename ElfImage::ElfHeader* elfHeader =
+        (const typename ElfImage::ElfHeader*)(fileImage.GetImage());
+    _cache.reset(new AnalysisCache(
+        fileImage,
+        elfHeader->e_phoff +
+            (uint64_t)elfHeader->e_phnum * elfHeader->e_phentsize,
+        Base::_allocationDirectory));
+    CacheReader* cacheReader = _cache->Open();
+    if (cacheReader == nullptr) {
+      return;
+    }
+    {
+      Statistics::Phase phase("RestoreFromCache");
+      try {
+        Base::_allocationGraph = new Allocations::Graph<Offset>(
+            Base::_virtualAddressMap, Base::_allocationDirectory,
+            Base::_threadMap, Base::_stackRegistry, *cacheReader);
+        RestoreSignatures(*cacheReader);
+      } catch (CacheReader::Invalid&) {
+        std::cerr << "Warning: ignoring invalid cache " << _cache->GetPath()
+                  << ".\n";
+        if (Base::_allocationGraph != nullptr) {
+          delete Base::_allocationGraph;
+          Base::_allocationGraph = nullptr;
+        }
+        return;
+      }
+    }
+    Statistics::SetCounter("edges", Base::_allocationGraph->TotalEdges());
+    Base::_isPrepared[Base::GRAPH] = true;
+    Base::_isPrepared[Base::SIGNATURES] = true;
+    TagAllocations(cacheReader);
+  }
+
+  void FindGraph() {
+    {
+      Statistics::Phase phase("Graph");
+      Base::_allocationGraph = new Allocations::Graph<Offset>(
+          Base::_virtualAddressMap, Base::_allocationDirectory,
+          Base::_threadMap, Base::_stackRegistry, _staticAnchorLimits, nullptr,
+          nullptr);
+    }
+    Statistics::SetCounter("edges", Base::_allocationGraph->TotalEdges());
+    Base::_isPrepared[Base::GRAPH] = true;
+  }
+
+  /*
+   * In Linux processes the current approach is to wait until the
+   * allocations have been found, then treat pointers at the start of
+   * the allocations to read only memory as signatures.  This means
+   * that the signatures can't be identified until the allocations have
+   * been found.
+   */
+  void FindSignatures() {
+    FindSignaturesInAllocations();
+    FindSignatureNamesFromBinaries();
+    Base::_isPrepared[Base::SIGNATURES] = true;
+  }
+
+  /*
+   * Tag the allocations, restoring the tags from the given cache reader
+   * if possible, and write the cache if it is enabled and the tags could
+   * not be restored.
+   */
+  void TagAllocations(CacheReader* cacheReader) {
+    const SignatureDirectory& signatureDirectory =
+        (_signaturesBeforeSymdefs != nullptr) ? *_signaturesBeforeSymdefs
+                                              : Base::_signatureDirectory;
+    bool tagsRestored;
+    {
+      Statistics::Phase phase("TagAllocations");
+      try {
+        tagsRestored = Base::TagAllocations(signatureDirectory, cacheReader);
+      } catch (CacheReader::Invalid&) {
+        std::cerr << "Warning: ignoring invalid cache " << _cache->GetPath()
+                  << ".\n";
+        tagsRestored = Base::TagAllocations(signatureDirectory, nullptr);
+      }
+    }
+    Base::_isPrepared[Base::TAGS] = true;
+    if (!tagsRestored && _cache) {
+      Statistics::Phase phase("WriteCache");
+      CacheWriter writer;
+      Base::SaveToCache(writer, signatureDirectory);
+      if (!_cache->Write(writer)) {
+        std::cerr << "Warning: failed to write cache " << _cache->GetPath()
+                  << ".\n";
+      }
+    }
+    _signaturesBeforeSymdefs.reset();
+  }
+
   void FindModules() {
+    Statistics::Phase phase("FindModules");
     ModuleFinder<ElfImage> moduleFinder(Base::_virtualMemoryPartition,
                                         Base::_fileMappedRangeDirectory,
                                         Base::_moduleDirectory);
@@ -288,6 +440,7 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
   }
 
   void FindFileMappedRanges() {
+    Statistics::Phase phase("FindFileMappedRanges");
     (void)_elfImage.VisitNotes(std::bind(
         &LinuxProcessImage<ElfImage>::ProcessELIFNote, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -350,6 +503,15 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
   bool _firstReadableStackGuardFound;
   bool _symdefsRead;
   std::map<Offset, Offset> _staticAnchorLimits;
+  std::unique_ptr<AnalysisCache> _cache;
+  bool _cacheChecked;
+  bool _symreqsChecked;
+  /*
+   * Tags depend on the signatures as they were before the .symdefs file
+   * was read, so if that file is read before the tags are found, a copy of
+   * the signatures as they were before is kept here until then.
+   */
+  std::unique_ptr<SignatureDirectory> _signaturesBeforeSymdefs;
 
   bool ParseOffset(const std::string& s, Offset& value) const {
     if (!s.empty()) {
@@ -411,6 +573,10 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
     if (symDefs.fail()) {
       return false;
     }
+    if (!Base::_isPrepared[Base::TAGS] && _signaturesBeforeSymdefs == nullptr) {
+      _signaturesBeforeSymdefs.reset(
+          new SignatureDirectory(Base::_signatureDirectory));
+    }
     std::string line;
     Offset signature = 0;
     Offset anchor = 0;
@@ -481,6 +647,19 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
     return true;
   }
 
+  /*
+   * Return true if the address is in a range that was claimed for some
+   * known use.  Ranges claimed as unknown are treated as unclaimed because
+   * they are claimed that way at the end of the constructor, which may be
+   * before the signatures are found.
+   */
+  bool IsClaimedOtherThanAsUnknown(Offset address) const {
+    typename VirtualMemoryPartition<Offset>::ClaimedRangesConstIterator it =
+        Base::_virtualMemoryPartition.find(address);
+    return it != Base::_virtualMemoryPartition.end() &&
+           it->_value != Base::_virtualMemoryPartition.UNKNOWN;
+  }
+
   /*
    * Initialize the signature directory to contain an entry for each
    * read-only address seen in the pointer at the start of each allocation
@@ -488,6 +667,7 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
    */
 
   void FindSignaturesInAllocations() {
+    Statistics::Phase phase("FindSignaturesInAllocations");
     const Allocations::Directory<Offset>& directory =
         Base::_allocationDirectory;
     typename Allocations::Directory<Offset>::AllocationIndex numAllocations =
@@ -529,7 +709,7 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
          * with a module or if not it will be in an area of memory that is not
          * yet analyzed by chap.
          */
-        if (Base::_virtualMemoryPartition.IsClaimed(signature)) {
+        if (IsClaimedOtherThanAsUnknown(signature)) {
           Offset relativeSignature;
           Offset rangeBase = 0;
           Offset rangeSize = 0;
@@ -614,7 +794,32 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
     }
   }
 
+  /*
+   * Restore the signatures found by FindSignaturesInAllocations and
+   * FindSignatureNamesFromBinaries, repeating any warnings given when
+   * the signatures were found.
+   */
+  void RestoreSignatures(CacheReader& reader) {
+    SignatureDirectory signatureDirectory;
+    signatureDirectory.Restore(reader);
+    Base::_signatureDirectory = signatureDirectory;
+    typename SignatureDirectory::SignatureNameAndStatusConstIterator itEnd =
+        Base::_signatureDirectory.EndSignatures();
+    for (typename SignatureDirectory::SignatureNameAndStatusConstIterator it =
+             Base::_signatureDirectory.BeginSignatures();
+         it != itEnd; ++it) {
+      if (it->second.second ==
+          SignatureDirectory::WRITABLE_VTABLE_WITH_NAME_FROM_PROCESS_IMAGE) {
+        std::cerr << "Warning: type " << it->second.first
+                  << " has a writable vtable at 0x" << std::hex << it->first
+                  << ".\n";
+        std::cerr << "... This is a security violation.\n";
+      }
+    }
+  }
+
   void FindSignatureNamesFromBinaries() {
+    Statistics::Phase phase("FindSignatureNamesFromBinaries");
     std::string modulePath;
     std::unique_ptr<FileImage> fileImage;
     std::unique_ptr<ElfImage> elfImage;
@@ -736,10 +941,15 @@ class LinuxProcessImage : public ProcessImage<typename ElfImage::Offset> {
       }
     }
   }
-  void WriteSymreqsFileIfNeeded() {
+  std::string GetSymreqsPath() const {
     std::string symReqsPath(
         Base::_virtualAddressMap.GetFileImage().GetFileName());
     symReqsPath.append(".symreqs");
+    return symReqsPath;
+  }
+
+  void WriteSymreqsFileIfNeeded() {
+    std::string symReqsPath(GetSymreqsPath());
     std::ifstream symReqs;
     symReqs.open(symReqsPath.c_str());
     if (!symReqs.fail()) {
@@ -0,0 +1,426 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <dirent.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+};
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../PagedImage.h"
+
+namespace chap {
+namespace Linux {
+/*
+ * This presents the memory of a live 64-bit process as an ELF core image, so
+ * that the process can be analyzed in place without waiting for a core to be
+ * written.  All the threads of the process are stopped, using ptrace, for as
+ * long as the image exists, so that the image is consistent.  The headers and
+ * notes of the core are built from /proc/<pid>/maps and the registers of the
+ * threads, and each frame of the rest of the image is read from the process
+ * with process_vm_readv when it is first used, so the memory of the process
+ * is not copied unless it is actually needed.  Only x86_64 is supported,
+ * because the notes are built with the x86_64 layout of the registers.
+ */
+class LiveProcessImage : public PagedImage {
+ public:
+  /*
+   * On failure this throws a description of the failure, with errno set to
+   * the cause, or to 0 if there is no more to say.
+   */
+  LiveProcessImage(pid_t pid) : _pid(pid), _headersSize(0) {
+#if !defined(__x86_64__)
+    errno = 0;
+    throw "live processes can be analyzed only on x86_64";
+#endif
+    CheckElfClass();
+    try {
+      StopThreads();
+      FindMappings();
+      BuildHeaders();
+      uint64_t size = PlaceMappings();
+      std::vector<uint64_t> frameBases;
+      for (uint64_t base = 0; base < size; base += FRAME_SIZE) {
+        frameBases.push_back(base);
+      }
+      Reserve(size, std::move(frameBases));
+    } catch (const char *) {
+      int savedErrno = errno;
+      ResumeThreads();
+      errno = savedErrno;
+      throw;
+    }
+  }
+
+  ~LiveProcessImage() { ResumeThreads(); }
+
+ protected:
+  void FillFrame(size_t /* frame */, uint64_t base, unsigned char *out,
+                 uint64_t frameSize) const {
+    uint64_t limit = base + frameSize;
+    if (base < _headersSize) {
+      uint64_t numBytes = std::min(limit, _headersSize) - base;
+      memcpy(out, _headers.data() + base, numBytes);
+    }
+    std::vector<Mapping>::const_iterator it = std::upper_bound(
+        _mappings.begin(), _mappings.end(), base,
+        [](uint64_t offset, const Mapping &mapping) {
+          return offset < mapping._offsetInImage;
+        });
+    if (it != _mappings.begin()) {
+      --it;
+    }
+    for (; it != _mappings.end() && it->_offsetInImage < limit; ++it) {
+      if (!it->_isDumped) {
+        continue;
+      }
+      uint64_t start = std::max(base, it->_offsetInImage);
+      uint64_t stop =
+          std::min(limit, it->_offsetInImage + (it->_limit - it->_base));
+      if (start < stop) {
+        Read(it->_base + (start - it->_offsetInImage), out + (start - base),
+             stop - start);
+      }
+    }
+  }
+
+ private:
+  static constexpr uint64_t FRAME_SIZE = 0x100000;
+  /*
+   * These describe struct elf_prstatus on x86_64, which is not used directly
+   * because the headers that define it also define PAGE_SIZE as a macro.
+   */
+  static constexpr size_t PRSTATUS_SIZE = 0x150;
+  static constexpr size_t PRSTATUS_PID_OFFSET = 0x20;
+  static constexpr size_t PRSTATUS_REGISTERS_OFFSET = 0x70;
+  static constexpr size_t PRSTATUS_REGISTERS_SIZE = 0xd8;
+
+  struct Thread {
+    pid_t _tid;
+    int _pendingSignal;
+  };
+
+  struct Mapping {
+    uint64_t _base;
+    uint64_t _limit;
+    uint64_t _offsetInFile;
+    uint64_t _offsetInImage;
+    uint32_t _flags;
+    bool _isDumped;
+    std::string _path;
+  };
+
+  const pid_t _pid;
+  std::vector<Thread> _threads;
+  std::vector<Mapping> _mappings;
+  std::vector<char> _headers;
+  uint64_t _headersSize;
+
+  std::string ProcPath(const char *name) const {
+    return "/proc/" + std::to_string(_pid) + "/" + name;
+  }
+
+  void CheckElfClass() const {
+    unsigned char ident[EI_NIDENT];
+    int fd = open(ProcPath("exe").c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw "cannot open the executable of the process";
+    }
+    ssize_t numRead = read(fd, ident, EI_NIDENT);
+    close(fd);
+    if (numRead != EI_NIDENT || memcmp(ident, ELFMAG, SELFMAG) != 0 ||
+        ident[EI_CLASS] != ELFCLASS64) {
+      errno = 0;
+      throw "only 64-bit ELF processes are supported";
+    }
+  }
+
+  /*
+   * Stop every thread of the process, repeating the scan of the threads
+   * until no new ones are found, because a thread that is not yet stopped
+   * may create more.
+   */
+  void StopThreads() {
+    bool foundNewThreads = true;
+    while (foundNewThreads) {
+      foundNewThreads = false;
+      DIR *tasks = opendir(ProcPath("task").c_str());
+      if (tasks == nullptr) {
+        throw "cannot list the threads of the process";
+      }
+      std::vector<pid_t> tids;
+      while (struct dirent *entry = readdir(tasks)) {
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        if (tid > 0) {
+          tids.push_back(tid);
+        }
+      }
+      closedir(tasks);
+      for (pid_t tid : tids) {
+        if (std::find_if(_threads.begin(), _threads.end(),
+                         [tid](const Thread &thread) {
+                           return thread._tid == tid;
+                         }) == _threads.end() &&
+            StopThread(tid)) {
+          foundNewThreads = true;
+        }
+      }
+    }
+    if (_threads.empty()) {
+      throw "the process has no threads";
+    }
+    /*
+     * As in a core written by the kernel, the main thread comes first.
+     */
+    std::sort(_threads.begin(), _threads.end(),
+              [this](const Thread &left, const Thread &right) {
+                return (left._tid == _pid) ||
+                       (right._tid != _pid && left._tid < right._tid);
+              });
+  }
+
+  /*
+   * Stop the given thread, returning false if it has already exited.  A
+   * thread that is attached but cannot be stopped is detached again before
+   * the failure is thrown, because it is not in the list of threads to be
+   * resumed.
+   */
+  bool StopThread(pid_t tid) {
+    if (ptrace(PTRACE_SEIZE, tid, 0, 0) != 0) {
+      if (errno == ESRCH) {
+        return false;
+      }
+      throw "cannot attach to the process";
+    }
+    int status = 0;
+    pid_t waited = -1;
+    if (ptrace(PTRACE_INTERRUPT, tid, 0, 0) == 0) {
+      do {
+        waited = waitpid(tid, &status, __WALL);
+      } while (waited < 0 && errno == EINTR);
+    }
+    if (waited != tid || !WIFSTOPPED(status)) {
+      int savedErrno = errno;
+      if (waited == tid) {
+        // The thread exited before it could be stopped.
+        return false;
+      }
+      (void)ptrace(PTRACE_DETACH, tid, 0, 0);
+      if (savedErrno == ESRCH) {
+        return false;
+      }
+      errno = savedErrno;
+      throw "cannot stop a thread of the process";
+    }
+    /*
+     * A signal that arrived before the interrupt is delivered when the
+     * thread is resumed.
+     */
+    int stopSignal = WSTOPSIG(status);
+    bool isInterrupt = (status >> 16) == PTRACE_EVENT_STOP;
+    _threads.push_back({tid, isInterrupt ? 0 : stopSignal});
+    return true;
+  }
+
+  void ResumeThreads() {
+    for (const Thread &thread : _threads) {
+      (void)ptrace(PTRACE_DETACH, thread._tid, 0,
+                   (void *)(uintptr_t)thread._pendingSignal);
+    }
+    _threads.clear();
+  }
+
+  /*
+   * Each readable mapping is present in the image except for those, such as
+   * [vvar], that cannot be read from another process and that the kernel
+   * also leaves out of a core.
+   */
+  void FindMappings() {
+    std::ifstream maps(ProcPath("maps").c_str());
+    if (!maps.is_open()) {
+      throw "cannot read the mappings of the process";
+    }
+    std::string line;
+    while (std::getline(maps, line)) {
+      Mapping mapping;
+      char permissions[5];
+      int pathStart = 0;
+      unsigned long long base, limit, offsetInFile;
+      if (sscanf(line.c_str(), "%llx-%llx %4s %llx %*s %*u %n", &base, &limit,
+                 permissions, &offsetInFile, &pathStart) < 4) {
+        continue;
+      }
+      mapping._base = base;
+      mapping._limit = limit;
+      mapping._offsetInFile = offsetInFile;
+      mapping._path = (pathStart > 0) ? line.substr(pathStart) : "";
+      if (mapping._path == "[vsyscall]") {
+        continue;
+      }
+      mapping._flags = ((permissions[0] == 'r') ? PF_R : 0) |
+                       ((permissions[1] == 'w') ? PF_W : 0) |
+                       ((permissions[2] == 'x') ? PF_X : 0);
+      mapping._isDumped = (permissions[0] == 'r') &&
+                          mapping._path.compare(0, 5, "[vvar") != 0;
+      _mappings.push_back(mapping);
+    }
+    if (_mappings.empty()) {
+      errno = 0;
+      throw "the process has no mappings";
+    }
+    if (_mappings.size() + 1 >= PN_XNUM) {
+      errno = 0;
+      throw "the process has too many mappings";
+    }
+  }
+
+  template <class T>
+  void Append(const T &value) {
+    const char *bytes = (const char *)&value;
+    _headers.insert(_headers.end(), bytes, bytes + sizeof(T));
+  }
+
+  void AppendNote(Elf64_Word type, const std::vector<char> &description) {
+    static const char name[8] = "CORE";
+    Elf64_Nhdr noteHeader;
+    noteHeader.n_namesz = 5;
+    noteHeader.n_descsz = description.size();
+    noteHeader.n_type = type;
+    Append(noteHeader);
+    Append(name);
+    _headers.insert(_headers.end(), description.begin(), description.end());
+    _headers.resize((_headers.size() + 3) & ~3, 0);
+  }
+
+  /*
+   * Build the ELF header and notes, leaving room for the program headers.
+   */
+  void BuildHeaders() {
+    Elf64_Ehdr elfHeader;
+    memset(&elfHeader, 0, sizeof(elfHeader));
+    memcpy(elfHeader.e_ident, ELFMAG, SELFMAG);
+    elfHeader.e_ident[EI_CLASS] = ELFCLASS64;
+    elfHeader.e_ident[EI_DATA] = ELFDATA2LSB;
+    elfHeader.e_ident[EI_VERSION] = EV_CURRENT;
+    elfHeader.e_type = ET_CORE;
+    elfHeader.e_machine = EM_X86_64;
+    elfHeader.e_version = EV_CURRENT;
+    elfHeader.e_phoff = sizeof(Elf64_Ehdr);
+    elfHeader.e_ehsize = sizeof(Elf64_Ehdr);
+    elfHeader.e_phentsize = sizeof(Elf64_Phdr);
+    elfHeader.e_phnum = _mappings.size() + 1;
+    Append(elfHeader);
+    _headers.resize(elfHeader.e_phoff + elfHeader.e_phnum * sizeof(Elf64_Phdr),
+                    0);
+
+    uint64_t notesOffset = _headers.size();
+    for (const Thread &thread : _threads) {
+      std::vector<char> prStatus(PRSTATUS_SIZE, 0);
+      memcpy(prStatus.data() + PRSTATUS_PID_OFFSET, &thread._tid,
+             sizeof(pid_t));
+      struct iovec registers = {prStatus.data() + PRSTATUS_REGISTERS_OFFSET,
+                                PRSTATUS_REGISTERS_SIZE};
+      if (ptrace(PTRACE_GETREGSET, thread._tid, (void *)NT_PRSTATUS,
+                 &registers) != 0) {
+        throw "cannot get the registers of a thread";
+      }
+      AppendNote(NT_PRSTATUS, prStatus);
+    }
+    AppendNote(NT_FILE, FileNoteDescription());
+
+    Elf64_Phdr *programHeader =
+        (Elf64_Phdr *)(_headers.data() + elfHeader.e_phoff);
+    programHeader->p_type = PT_NOTE;
+    programHeader->p_offset = notesOffset;
+    programHeader->p_filesz = _headers.size() - notesOffset;
+    programHeader->p_align = 1;
+    _headersSize = _headers.size();
+  }
+
+  /*
+   * Give each dumped mapping its place in the image, after the notes, and
+   * fill in the program headers, returning the size of the image.
+   */
+  uint64_t PlaceMappings() {
+    Elf64_Phdr *programHeader =
+        (Elf64_Phdr *)(_headers.data() + sizeof(Elf64_Ehdr));
+    uint64_t offsetInImage = AlignUp(_headersSize);
+    for (Mapping &mapping : _mappings) {
+      uint64_t size = mapping._limit - mapping._base;
+      mapping._offsetInImage = offsetInImage;
+      ++programHeader;
+      programHeader->p_type = PT_LOAD;
+      programHeader->p_offset = offsetInImage;
+      programHeader->p_vaddr = mapping._base;
+      programHeader->p_memsz = size;
+      programHeader->p_flags = mapping._flags;
+      programHeader->p_align = PAGE_SIZE;
+      if (mapping._isDumped) {
+        programHeader->p_filesz = size;
+        offsetInImage += size;
+      }
+    }
+    return offsetInImage;
+  }
+
+  /*
+   * The NT_FILE note gives the count of file backed mappings and the page
+   * size, then the range and page offset of each such mapping, then the
+   * paths of those mappings.
+   */
+  std::vector<char> FileNoteDescription() const {
+    std::vector<uint64_t> words(2, 0);
+    std::string paths;
+    for (const Mapping &mapping : _mappings) {
+      if (mapping._path.empty() || mapping._path[0] != '/') {
+        continue;
+      }
+      words[0]++;
+      words.push_back(mapping._base);
+      words.push_back(mapping._limit);
+      words.push_back(mapping._offsetInFile / PAGE_SIZE);
+      paths.append(mapping._path.c_str(), mapping._path.size() + 1);
+    }
+    words[1] = PAGE_SIZE;
+    const char *bytes = (const char *)words.data();
+    std::vector<char> description(bytes, bytes + words.size() * 8);
+    description.insert(description.end(), paths.begin(), paths.end());
+    return description;
+  }
+
+  /*
+   * Read the given range from the process, leaving as 0 any pages that
+   * cannot be read, such as those of a file mapping that extends past the
+   * end of the file.
+   */
+  void Read(uint64_t address, unsigned char *out, uint64_t numBytes) const {
+    while (numBytes > 0) {
+      struct iovec local = {out, (size_t)numBytes};
+      struct iovec remote = {(void *)address, (size_t)numBytes};
+      ssize_t numRead = process_vm_readv(_pid, &local, 1, &remote, 1, 0);
+      uint64_t skip = (numRead > 0) ? (uint64_t)numRead
+                                    : AlignUp(address + 1) - address;
+      skip = std::min(skip, numBytes);
+      address += skip;
+      out += skip;
+      numBytes -= skip;
+    }
+  }
+};
+}  // namespace Linux
+}  // namespace chap
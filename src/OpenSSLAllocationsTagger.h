@@ -32,8 +32,7 @@ class OpenSSLAllocationsTagger : public Allocations::Tagger<Offset> {
                            EdgePredicate& edgeIsFavored,
                            const ModuleDirectory<Offset>& moduleDirectory,
                            const VirtualAddressMap<Offset>& addressMap)
-      : _graph(graph),
-        _tagHolder(tagHolder),
+      : _tagHolder(tagHolder),
         _edgeIsFavored(edgeIsFavored),
         _directory(graph.GetAllocationDirectory()),
         _numAllocations(_directory.NumAllocations()),
@@ -126,16 +125,30 @@ class OpenSSLAllocationsTagger : public Allocations::Tagger<Offset> {
     return false;
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& contiguousImage,
+                            Reader& /* reader */, AllocationIndex /* index */,
+                            const Allocation& /* allocation */,
+                            bool /* isUnsigned */) const {
+    const Offset* firstOffset = contiguousImage.FirstOffset();
+    if (!_enabled || contiguousImage.OffsetLimit() - firstOffset < 0x40) {
+      return false;
+    }
+    return (_candidateBase <= firstOffset[0] &&
+            firstOffset[0] < _candidateLimit) ||
+           (_candidateBase <= firstOffset[1] &&
+            firstOffset[1] < _candidateLimit);
+  }
+
   void MarkFavoredReferences(const ContiguousImage& contiguousImage,
-                             Reader& /* reader */, AllocationIndex index,
+                             Reader& /* reader */, AllocationIndex /* index */,
                              const Allocation& /* allocation */,
+                             const AllocationIndex* outgoingTargets,
                              const EdgeIndex* outgoingEdgeIndices) {
     const Offset* checkLimit = contiguousImage.OffsetLimit();
     const Offset* firstCheck = contiguousImage.FirstOffset();
 
     for (const Offset* check = firstCheck; check < checkLimit; check++) {
-      EdgeIndex edgeIndex = outgoingEdgeIndices[check - firstCheck];
-      AllocationIndex targetIndex = _graph.GetTargetForOutgoing(edgeIndex);
+      AllocationIndex targetIndex = outgoingTargets[check - firstCheck];
       if (targetIndex == _numAllocations) {
         continue;
       }
@@ -144,7 +157,8 @@ class OpenSSLAllocationsTagger : public Allocations::Tagger<Offset> {
         continue;
       }
       if (_directory.AllocationAt(targetIndex)->Address() == *check) {
-        _edgeIsFavored.Set(index, targetIndex, true);
+        _edgeIsFavored.SetForOutgoing(outgoingEdgeIndices[check - firstCheck],
+                                     true);
       }
     }
   }
@@ -153,7 +167,6 @@ class OpenSSLAllocationsTagger : public Allocations::Tagger<Offset> {
   TagIndex GetSSL_CTXTagIndex() const { return _SSL_CTXTagIndex; }
 
  private:
-  Graph& _graph;
   TagHolder& _tagHolder;
   EdgePredicate& _edgeIsFavored;
   const Directory& _directory;
@@ -0,0 +1,307 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <string.h>
+#include <zlib.h>
+};
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "PagedImage.h"
+
+namespace chap {
+/*
+ * This presents the uncompressed contents of a gzip file, possibly with
+ * multiple members as written by pigz or bgzip, as a contiguous read-only
+ * image without writing those contents anywhere.  Each frame of the image is
+ * decompressed when it is first read, and again if it is read after having
+ * been discarded.
+ *
+ * To allow decompression to start at any frame, the whole file is
+ * decompressed once when the image is created, recording at the start of each
+ * frame the position in the compressed file and the last 32 KB of
+ * uncompressed data, which deflate may refer to.
+ *
+ * Because frames are decompressed in a fault handler, zlib gets its memory
+ * for that from a scratch area allocated up front, rather than from malloc.
+ */
+class PagedGzipImage : public PagedImage {
+ public:
+  static bool IsGzip(const char *image, uint64_t size) {
+    return size >= GZIP_MIN_SIZE && (unsigned char)image[0] == 0x1f &&
+           (unsigned char)image[1] == 0x8b && image[2] == 8;
+  }
+
+  PagedGzipImage(const char *compressed, uint64_t compressedSize)
+      : _compressed((const unsigned char *)compressed),
+        _compressedLimit((const unsigned char *)compressed + compressedSize),
+        _size(0),
+        _scratch(SCRATCH_SIZE),
+        _scratchUsed(0) {
+    BuildIndex();
+    if (_size == 0) {
+      throw "no data could be decompressed";
+    }
+    /*
+     * The size of the image is the size of the uncompressed contents, which
+     * will be smaller than expected if the compressed file is truncated or
+     * corrupt.
+     */
+    std::vector<uint64_t> frameBases;
+    for (const AccessPoint &point : _points) {
+      frameBases.push_back(AlignDown(point._uncompressedOffset));
+    }
+    Reserve(_size, std::move(frameBases));
+  }
+
+ protected:
+  void FillFrame(size_t frame, uint64_t base, unsigned char *out,
+                 uint64_t frameSize) const {
+    const AccessPoint &point = _points[frame];
+    memcpy(out, point._prefix.data(), point._prefix.size());
+    Inflate(point, out + point._prefix.size(),
+            std::min(base + frameSize, _size) - point._uncompressedOffset);
+  }
+
+ private:
+  static constexpr uint64_t FRAME_SIZE = 0x400000;
+  static constexpr uInt WINDOW_SIZE = 0x8000;
+  static constexpr uInt MAX_INPUT_CHUNK = 0x40000000;
+  static constexpr uInt OUTPUT_CHUNK = 0x40000;
+  static constexpr uint64_t GZIP_MIN_SIZE = 18;
+  static constexpr uint64_t GZIP_TRAILER_SIZE = 8;
+  static constexpr int GZIP_WINDOW_BITS = 15 + 16;
+  /*
+   * This is enough for two inflate states with their windows, with room to
+   * spare, because decompressing a frame first decompresses the window for
+   * the frame with a second stream.
+   */
+  static constexpr size_t SCRATCH_SIZE = 0x40000;
+
+  /*
+   * This holds what is needed to start decompression at the start of a
+   * frame.  The first frame starts at the start of the file.  Every other
+   * frame starts at the start of a deflate block, given as a byte offset in
+   * the compressed file plus the number of bits from the previous byte.
+   * The frame is extended back to the start of the page, using the prefix.
+   */
+  struct AccessPoint {
+    uint64_t _uncompressedOffset;
+    uint64_t _compressedOffset;
+    int _bits;
+    uLongf _windowSize;
+    std::vector<unsigned char> _compressedWindow;
+    std::vector<unsigned char> _prefix;
+  };
+
+  const unsigned char *_compressed;
+  const unsigned char *_compressedLimit;
+  uint64_t _size;
+  std::vector<AccessPoint> _points;
+  mutable std::vector<unsigned char> _scratch;
+  mutable size_t _scratchUsed;
+
+  static voidpf AllocateScratch(voidpf opaque, uInt numItems, uInt itemSize) {
+    const PagedGzipImage *image = (const PagedGzipImage *)opaque;
+    size_t numBytes = ((size_t)numItems * itemSize + 0xf) & ~(size_t)0xf;
+    if (numBytes > SCRATCH_SIZE - image->_scratchUsed) {
+      return Z_NULL;
+    }
+    voidpf allocated = image->_scratch.data() + image->_scratchUsed;
+    image->_scratchUsed += numBytes;
+    return allocated;
+  }
+
+  /*
+   * Scratch memory is all given back at once, when the next frame is
+   * decompressed.
+   */
+  static void FreeScratch(voidpf /* opaque */, voidpf /* address */) {}
+
+  void UseScratch(z_stream &stream) const {
+    stream.zalloc = AllocateScratch;
+    stream.zfree = FreeScratch;
+    stream.opaque = (voidpf)this;
+  }
+
+  /*
+   * Decompress the saved window of the given access point, returning false
+   * if that is not possible.
+   */
+  bool GetWindow(const AccessPoint &point, unsigned char *window) const {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    UseScratch(stream);
+    if (inflateInit(&stream) != Z_OK) {
+      return false;
+    }
+    stream.next_in = (Bytef *)point._compressedWindow.data();
+    stream.avail_in = (uInt)point._compressedWindow.size();
+    stream.next_out = window;
+    stream.avail_out = WINDOW_SIZE;
+    bool gotWindow = inflate(&stream, Z_FINISH) == Z_STREAM_END &&
+                     stream.total_out == point._windowSize;
+    inflateEnd(&stream);
+    return gotWindow;
+  }
+
+  bool StartsMember(const unsigned char *next) const {
+    return next < _compressedLimit &&
+           IsGzip((const char *)next, _compressedLimit - next);
+  }
+
+  void RefillInput(z_stream &stream) const {
+    if (stream.avail_in == 0) {
+      stream.avail_in = (uInt)std::min(
+          (uint64_t)(_compressedLimit - stream.next_in),
+          (uint64_t)MAX_INPUT_CHUNK);
+    }
+  }
+
+  void AddAccessPoint(z_stream &stream, uint64_t uncompressedOffset,
+                      const unsigned char *recentOutput) {
+    _points.emplace_back();
+    AccessPoint &point = _points.back();
+    point._uncompressedOffset = uncompressedOffset;
+    point._compressedOffset = stream.next_in - _compressed;
+    point._bits = stream.data_type & 7;
+    uint64_t prefixSize = uncompressedOffset - AlignDown(uncompressedOffset);
+    point._prefix.assign(recentOutput + PAGE_SIZE - prefixSize,
+                         recentOutput + PAGE_SIZE);
+    unsigned char window[WINDOW_SIZE];
+    uInt windowSize = 0;
+    inflateGetDictionary(&stream, window, &windowSize);
+    point._windowSize = windowSize;
+    uLongf compressedWindowSize = compressBound(windowSize);
+    point._compressedWindow.resize(compressedWindowSize);
+    if (compress2(point._compressedWindow.data(), &compressedWindowSize,
+                  window, windowSize, 1) != Z_OK) {
+      throw "compress2 failed";
+    }
+    point._compressedWindow.resize(compressedWindowSize);
+  }
+
+  /*
+   * Decompress the whole file, recording an access point at the first
+   * block boundary after each FRAME_SIZE bytes of uncompressed data.
+   * Decompression stops quietly at the first error, which normally means
+   * that the compressed file was truncated.
+   */
+  void BuildIndex() {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, GZIP_WINDOW_BITS) != Z_OK) {
+      throw "inflateInit2 failed";
+    }
+    std::vector<unsigned char> output(OUTPUT_CHUNK);
+    /*
+     * This holds the last page of uncompressed data, preceded by zeros at
+     * the start of the file.
+     */
+    std::vector<unsigned char> recentOutput(PAGE_SIZE, 0);
+    uint64_t lastPointOffset = 0;
+    _points.emplace_back();
+    _points.back()._uncompressedOffset = 0;
+    _points.back()._compressedOffset = 0;
+    _points.back()._bits = 0;
+    _points.back()._windowSize = 0;
+    stream.next_in = (Bytef *)_compressed;
+    while (true) {
+      RefillInput(stream);
+      stream.next_out = output.data();
+      stream.avail_out = OUTPUT_CHUNK;
+      int ret = inflate(&stream, Z_BLOCK);
+      uInt numProduced = OUTPUT_CHUNK - stream.avail_out;
+      _size += numProduced;
+      if (numProduced >= PAGE_SIZE) {
+        memcpy(recentOutput.data(), output.data() + numProduced - PAGE_SIZE,
+               PAGE_SIZE);
+      } else if (numProduced > 0) {
+        memmove(recentOutput.data(), recentOutput.data() + numProduced,
+                PAGE_SIZE - numProduced);
+        memcpy(recentOutput.data() + PAGE_SIZE - numProduced, output.data(),
+               numProduced);
+      }
+      if (ret == Z_STREAM_END) {
+        if (!StartsMember(stream.next_in)) {
+          break;
+        }
+        inflateReset(&stream);
+        continue;
+      }
+      if (ret != Z_OK) {
+        break;
+      }
+      if ((stream.data_type & 128) != 0 && (stream.data_type & 64) == 0 &&
+          _size - lastPointOffset >= FRAME_SIZE) {
+        AddAccessPoint(stream, _size, recentOutput.data());
+        lastPointOffset = _size;
+      }
+    }
+    inflateEnd(&stream);
+  }
+
+  /*
+   * Decompress numBytes starting at the given access point.  If the data
+   * are corrupt, whatever could not be decompressed is left as 0.
+   */
+  void Inflate(const AccessPoint &point, unsigned char *out,
+               uint64_t numBytes) const {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    _scratchUsed = 0;
+    UseScratch(stream);
+    bool isRaw = point._compressedOffset != 0;
+    if (inflateInit2(&stream, isRaw ? -MAX_WBITS : GZIP_WINDOW_BITS) != Z_OK) {
+      return;
+    }
+    stream.next_in = (Bytef *)(_compressed + point._compressedOffset);
+    if (isRaw) {
+      if (point._bits != 0) {
+        inflatePrime(&stream, point._bits,
+                     stream.next_in[-1] >> (8 - point._bits));
+      }
+      if (point._windowSize != 0) {
+        unsigned char window[WINDOW_SIZE];
+        if (!GetWindow(point, window) ||
+            inflateSetDictionary(&stream, window, point._windowSize) != Z_OK) {
+          inflateEnd(&stream);
+          return;
+        }
+      }
+    }
+    while (numBytes != 0) {
+      RefillInput(stream);
+      stream.next_out = out;
+      stream.avail_out = (uInt)std::min(numBytes, (uint64_t)MAX_INPUT_CHUNK);
+      int ret = inflate(&stream, Z_NO_FLUSH);
+      uint64_t numProduced = stream.next_out - out;
+      out += numProduced;
+      numBytes -= numProduced;
+      if (ret == Z_STREAM_END) {
+        /*
+         * A raw stream stops at the end of the deflate data, before the
+         * trailer of the gzip member.
+         */
+        const unsigned char *next =
+            stream.next_in + (isRaw ? GZIP_TRAILER_SIZE : 0);
+        if (!StartsMember(next)) {
+          break;
+        }
+        inflateReset2(&stream, GZIP_WINDOW_BITS);
+        isRaw = false;
+        stream.next_in = (Bytef *)next;
+        stream.avail_in = 0;
+        continue;
+      }
+      if (ret != Z_OK) {
+        break;
+      }
+    }
+    inflateEnd(&stream);
+  }
+};
+}  // namespace chap
@@ -0,0 +1,294 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+};
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace chap {
+/*
+ * This presents contents that are not in any file, such as the uncompressed
+ * contents of a gzip file or the memory of a live process, as a contiguous
+ * read-only image.  The image is reserved but inaccessible at first, and the
+ * first attempt to read any part of a frame of the image causes the derived
+ * class to fill in that frame, which is then moved into place.  At most
+ * MAX_RESIDENT_BYTES worth of frames are kept, and frames are discarded in the
+ * order in which they were loaded, because reads of a frame after it is
+ * loaded cannot be seen, so that reading a discarded frame again just causes
+ * it to be filled in again.
+ *
+ * Frames are filled in from a SIGSEGV handler.  The handler takes spin locks
+ * rather than mutexes, and everything it uses is allocated before any frame
+ * is loaded, so that it never calls malloc.  Apart from the system calls that
+ * map the frame, the only work it does is FillFrame, which must also follow
+ * those rules.  The lock shared by all images is held only to find the frame
+ * and to track which frames are resident, so a thread that faults on one
+ * frame does not wait while another frame is filled in, but FillFrame is
+ * called for only one frame of a given image at a time.  A thread that faults
+ * on a frame that another thread is filling in yields and faults again until
+ * that frame is in place.
+ *
+ * A system call that is given memory of the image that is not resident
+ * fails with EFAULT rather than causing a fault, so any such memory must be
+ * copied, or at least read, before it is passed to the kernel, as is done by
+ * FileDescriptorStream, Output::Write and CoreTrimmer.
+ */
+class PagedImage {
+ public:
+  virtual ~PagedImage() {
+    if (_image != nullptr) {
+      Lock(_lock);
+      _images.erase(std::find(_images.begin(), _images.end(), this));
+      Unlock(_lock);
+      (void)munmap(_image, _imageSize);
+    }
+  }
+
+  const char *GetImage() const { return _image; }
+  uint64_t GetSize() const { return _size; }
+
+ protected:
+  static constexpr uint64_t PAGE_SIZE = 0x1000;
+  static constexpr uint64_t MAX_RESIDENT_BYTES = 0x40000000;
+
+  PagedImage()
+      : _size(0),
+        _image(nullptr),
+        _imageSize(0),
+        _firstResident(0),
+        _numResident(0),
+        _residentBytes(0) {}
+
+  static uint64_t AlignUp(uint64_t offset) {
+    return (offset + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+  }
+
+  static uint64_t AlignDown(uint64_t offset) {
+    return offset & ~(PAGE_SIZE - 1);
+  }
+
+  /*
+   * Reserve an image of the given size, split into frames that start at the
+   * given page aligned offsets, the first of which must be 0.
+   */
+  void Reserve(uint64_t size, std::vector<uint64_t> &&frameBases) {
+    _size = size;
+    _imageSize = AlignUp(size);
+    _frameBases = std::move(frameBases);
+    void *image = mmap(nullptr, _imageSize, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (image == MAP_FAILED) {
+      throw "mmap failed";
+    }
+    _image = (char *)image;
+    _frameStates.resize(_frameBases.size(), ABSENT);
+    _residentFrames.resize(_frameBases.size());
+    Lock(_lock);
+    _images.reserve(_images.size() + 1);
+    if (!_faultHandlerInstalled) {
+      struct sigaction action;
+      memset(&action, 0, sizeof(action));
+      action.sa_sigaction = HandleFault;
+      sigemptyset(&action.sa_mask);
+      action.sa_flags = SA_SIGINFO;
+      sigaction(SIGSEGV, &action, &_previousAction);
+      _faultHandlerInstalled = true;
+    }
+    _images.push_back(this);
+    Unlock(_lock);
+  }
+
+  /*
+   * Fill in the given frame, which has the given base and size in the image,
+   * in the given buffer, which is initially all 0.  This is called from the
+   * fault handler, never for two frames of the same image at once, so it
+   * must not touch any paged image, allocate memory or take any lock.
+   */
+  virtual void FillFrame(size_t frame, uint64_t base, unsigned char *out,
+                         uint64_t frameSize) const = 0;
+
+ private:
+  /*
+   * A lock is taken by spinning for a while then yielding the processor
+   * between attempts, because it may be held while a frame is filled in.
+   */
+  static constexpr int SPINS_BEFORE_YIELD = 100;
+  enum FrameState : uint8_t { ABSENT, LOADING, RESIDENT };
+
+  static inline std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+  static inline std::vector<PagedImage *> _images;
+  static inline bool _faultHandlerInstalled = false;
+  static inline struct sigaction _previousAction;
+
+  uint64_t _size;
+  char *_image;
+  uint64_t _imageSize;
+  std::vector<uint64_t> _frameBases;
+  /*
+   * The state of each frame, and the fields that follow, are guarded by
+   * _lock.  _fillLock is held while any frame of this image is filled in.
+   */
+  std::vector<FrameState> _frameStates;
+  std::atomic_flag _fillLock = ATOMIC_FLAG_INIT;
+  /*
+   * This is a ring of the resident frames, in the order they were loaded,
+   * with room for every frame, so that it never grows in the handler.
+   */
+  std::vector<size_t> _residentFrames;
+  size_t _firstResident;
+  size_t _numResident;
+  uint64_t _residentBytes;
+
+  static void Lock(std::atomic_flag &lock) {
+    for (int spins = 0; lock.test_and_set(std::memory_order_acquire);
+         spins++) {
+      if (spins >= SPINS_BEFORE_YIELD) {
+        (void)sched_yield();
+      }
+    }
+  }
+
+  static void Unlock(std::atomic_flag &lock) {
+    lock.clear(std::memory_order_release);
+  }
+
+  uint64_t FrameLimit(size_t frame) const {
+    return (frame + 1 < _frameBases.size()) ? _frameBases[frame + 1]
+                                            : _imageSize;
+  }
+
+  void DiscardFrame(size_t frame) {
+    uint64_t base = _frameBases[frame];
+    uint64_t frameSize = FrameLimit(frame) - base;
+    (void)mmap(_image + base, frameSize, PROT_NONE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    _frameStates[frame] = ABSENT;
+    _residentBytes -= frameSize;
+  }
+
+  /*
+   * Make room for the given frame, which is absent, and mark it as being
+   * loaded.  This is called with _lock held.
+   */
+  void StartLoad(size_t frame) {
+    uint64_t frameSize = FrameLimit(frame) - _frameBases[frame];
+    while (_numResident != 0 &&
+           _residentBytes + frameSize > MAX_RESIDENT_BYTES) {
+      DiscardFrame(_residentFrames[_firstResident]);
+      _firstResident = (_firstResident + 1) % _residentFrames.size();
+      _numResident--;
+    }
+    _frameStates[frame] = LOADING;
+    _residentBytes += frameSize;
+  }
+
+  /*
+   * Mark the given frame, which is being loaded, as resident if it was put
+   * in place, or as absent otherwise.  This is called with _lock held.
+   */
+  void FinishLoad(size_t frame, bool loaded) {
+    if (loaded) {
+      _frameStates[frame] = RESIDENT;
+      _residentFrames[(_firstResident + _numResident++) %
+                      _residentFrames.size()] = frame;
+    } else {
+      _frameStates[frame] = ABSENT;
+      _residentBytes -= FrameLimit(frame) - _frameBases[frame];
+    }
+  }
+
+  /*
+   * Fill in the given frame, which is being loaded, then move it into
+   * place, so that other threads never see a partially filled frame.  This
+   * is called without _lock held.
+   */
+  bool LoadFrame(size_t frame) {
+    uint64_t base = _frameBases[frame];
+    uint64_t frameSize = FrameLimit(frame) - base;
+    void *buffer = mmap(nullptr, frameSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+      return false;
+    }
+    Lock(_fillLock);
+    FillFrame(frame, base, (unsigned char *)buffer, frameSize);
+    Unlock(_fillLock);
+    if (mprotect(buffer, frameSize, PROT_READ) != 0 ||
+        mremap(buffer, frameSize, frameSize, MREMAP_MAYMOVE | MREMAP_FIXED,
+               _image + base) == MAP_FAILED) {
+      (void)munmap(buffer, frameSize);
+      return false;
+    }
+    return true;
+  }
+
+  static void HandleFault(int signalNumber, siginfo_t *info, void *context) {
+    int savedErrno = errno;
+    PagedImage *faultImage = nullptr;
+    size_t frame = 0;
+    FrameState state = ABSENT;
+    Lock(_lock);
+    const char *address = (const char *)info->si_addr;
+    for (PagedImage *image : _images) {
+      if (address >= image->_image &&
+          address < image->_image + image->_imageSize) {
+        const std::vector<uint64_t> &frameBases = image->_frameBases;
+        frame = std::upper_bound(frameBases.begin(), frameBases.end(),
+                                 (uint64_t)(address - image->_image)) -
+                frameBases.begin() - 1;
+        faultImage = image;
+        state = image->_frameStates[frame];
+        if (state == ABSENT) {
+          image->StartLoad(frame);
+        }
+        break;
+      }
+    }
+    Unlock(_lock);
+    bool loaded = false;
+    if (faultImage != nullptr) {
+      if (state == ABSENT) {
+        loaded = faultImage->LoadFrame(frame);
+        Lock(_lock);
+        faultImage->FinishLoad(frame, loaded);
+        Unlock(_lock);
+      } else {
+        /*
+         * Another thread already loaded the frame, or is loading it, so
+         * just try the access again, after letting that thread run.
+         */
+        if (state == LOADING) {
+          (void)sched_yield();
+        }
+        loaded = true;
+      }
+    }
+    errno = savedErrno;
+    if (loaded) {
+      return;
+    }
+    /*
+     * The fault is not for an image, or the frame could not be loaded, so
+     * handle it as if this handler had not been installed.
+     */
+    if ((_previousAction.sa_flags & SA_SIGINFO) != 0) {
+      _previousAction.sa_sigaction(signalNumber, info, context);
+    } else if (_previousAction.sa_handler != SIG_DFL &&
+               _previousAction.sa_handler != SIG_IGN) {
+      _previousAction.sa_handler(signalNumber);
+    } else {
+      signal(SIGSEGV, SIG_DFL);
+    }
+  }
+};
+}  // namespace chap
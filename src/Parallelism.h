@@ -0,0 +1,168 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace chap {
+/*
+ * This class holds the process-wide limit on the number of threads that
+ * chap will use for work that can be split up (for example, scanning all
+ * the allocations), and provides the few primitives used for such work.
+ * The limit is 1 unless set by the -j switch, in which case everything runs
+ * on the calling thread, in the same order as if no threads were available.
+ */
+class Parallelism {
+ public:
+  static size_t NumThreads() { return _numThreads; }
+
+  static void SetNumThreads(size_t numThreads) {
+    _numThreads = (numThreads == 0) ? 1 : numThreads;
+  }
+
+  /*
+   * Return a reasonable number of chunks into which to split the given
+   * number of items.  Using more chunks than threads helps balance the load
+   * when the cost per item is uneven, as is the case for allocations.
+   */
+  template <typename Index>
+  static size_t NumChunks(Index numItems) {
+    size_t numChunks =
+        (_numThreads == 1) ? 1 : _numThreads * CHUNKS_PER_THREAD;
+    if (numChunks > (size_t)numItems) {
+      numChunks = (numItems == 0) ? 1 : (size_t)numItems;
+    }
+    return numChunks;
+  }
+
+  /*
+   * Return the first item of the given chunk, where the chunks split the
+   * items as evenly as possible.  Chunk numChunks is past the last item.
+   */
+  template <typename Index>
+  static Index ChunkBase(Index numItems, size_t numChunks, size_t chunk) {
+    return (Index)(((uint64_t)numItems * chunk) / numChunks);
+  }
+
+  /*
+   * Call worker(state, chunk, base, limit) once per chunk, where [base, limit)
+   * is the range of items for the chunk and state is the result of calling
+   * makeState() once on the thread processing the chunk.  The chunks are
+   * processed by up to NumThreads() threads, with the calling thread being
+   * one of them.  Any exception thrown by a worker is rethrown on the calling
+   * thread after all the threads have finished.
+   */
+  template <typename Index, typename MakeState, typename Worker>
+  static void ForEachChunk(Index numItems, size_t numChunks,
+                           MakeState makeState, Worker worker) {
+    std::atomic<size_t> nextChunk(0);
+    std::exception_ptr firstException;
+    std::atomic<bool> failed(false);
+    auto runChunks = [&]() {
+      try {
+        auto state = makeState();
+        while (!failed.load(std::memory_order_relaxed)) {
+          size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+          if (chunk >= numChunks) {
+            return;
+          }
+          worker(state, chunk, ChunkBase(numItems, numChunks, chunk),
+                 ChunkBase(numItems, numChunks, chunk + 1));
+        }
+      } catch (...) {
+        if (!failed.exchange(true)) {
+          firstException = std::current_exception();
+        }
+      }
+    };
+    size_t numThreads = std::min(_numThreads, numChunks);
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t i = 1; i < numThreads; i++) {
+      threads.emplace_back(runChunks);
+    }
+    runChunks();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    if (firstException) {
+      std::rethrow_exception(firstException);
+    }
+  }
+
+  /*
+   * Call worker(chunk, base, limit) once per chunk, for work that needs no
+   * per-thread state.
+   */
+  template <typename Index, typename Worker>
+  static void ForEachChunk(Index numItems, size_t numChunks, Worker worker) {
+    ForEachChunk(
+        numItems, numChunks, []() { return 0; },
+        [&](int, size_t chunk, Index base, Index limit) {
+          worker(chunk, base, limit);
+        });
+  }
+
+  /*
+   * Call worker(i) for each i in [0, numItems), with the items split up
+   * among up to NumThreads() threads.
+   */
+  template <typename Index, typename Worker>
+  static void ForEach(Index numItems, Worker worker) {
+    ForEachChunk(numItems, NumChunks(numItems),
+                 [&](size_t, Index base, Index limit) {
+                   for (Index i = base; i < limit; i++) {
+                     worker(i);
+                   }
+                 });
+  }
+
+  /*
+   * Replace each value by the sum of it and all the values before it.
+   */
+  template <typename T>
+  static void InclusiveScan(std::vector<T> &values) {
+    size_t numValues = values.size();
+    size_t numChunks = NumChunks(numValues);
+    if (numChunks == 1) {
+      for (size_t i = 1; i < numValues; i++) {
+        values[i] += values[i - 1];
+      }
+      return;
+    }
+    std::vector<T> chunkTotals(numChunks, 0);
+    ForEachChunk(numValues, numChunks,
+                 [&](size_t chunk, size_t base, size_t limit) {
+                   for (size_t i = base + 1; i < limit; i++) {
+                     values[i] += values[i - 1];
+                   }
+                   chunkTotals[chunk] = values[limit - 1];
+                 });
+    T carry = 0;
+    for (size_t chunk = 0; chunk < numChunks; chunk++) {
+      T chunkTotal = chunkTotals[chunk];
+      chunkTotals[chunk] = carry;
+      carry += chunkTotal;
+    }
+    ForEachChunk(numValues, numChunks,
+                 [&](size_t chunk, size_t base, size_t limit) {
+                   T carry = chunkTotals[chunk];
+                   if (carry != 0) {
+                     for (size_t i = base; i < limit; i++) {
+                       values[i] += carry;
+                     }
+                   }
+                 });
+  }
+
+ private:
+  static constexpr size_t CHUNKS_PER_THREAD = 16;
+  static inline size_t _numThreads = 1;
+};
+}  // namespace chap
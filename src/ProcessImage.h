@@ -43,6 +43,16 @@ class ProcessImage {
   typedef typename AddressMap::Reader Reader;
   typedef typename AddressMap::NotMapped NotMapped;
   typedef typename VirtualAddressMap<Offset>::RangeAttributes RangeAttributes;
+
+  /*
+   * These are the parts of the analysis that are done only when first
+   * needed, because each of them may take a long time for a large process
+   * image and many commands need none of them.  The allocation graph
+   * includes the anchor points and which allocations are leaked.  Tagging
+   * depends on both the graph and the signatures.
+   */
+  enum Stage { GRAPH, SIGNATURES, TAGS, NUM_STAGES };
+
   ProcessImage(const AddressMap &virtualAddressMap,
                const ThreadMap<Offset> &threadMap,
                ModuleImageFactory<Offset> *moduleImageFactory)
@@ -55,6 +65,8 @@ class ProcessImage {
         _moduleDirectory(_virtualMemoryPartition, moduleImageFactory),
         _unfilledImages(virtualAddressMap),
         _allocationTagHolder(nullptr),
+        _edgeIsTainted(nullptr),
+        _edgeIsFavored(nullptr),
         _allocationGraph(nullptr),
         _pythonFinderGroup(_virtualMemoryPartition, _moduleDirectory,
                            _allocationDirectory, _unfilledImages),
@@ -68,7 +80,11 @@ class ProcessImage {
         _follyFibersInfrastructureFinder(
             _moduleDirectory, _virtualMemoryPartition, _stackRegistry),
         _typeInfoDirectory(_moduleDirectory, _virtualAddressMap,
-                           _allocationDirectory) {}
+                           _allocationDirectory) {
+    for (bool &isPrepared : _isPrepared) {
+      isPrepared = false;
+    }
+  }
 
   virtual ~ProcessImage() {
     if (_allocationGraph != nullptr) {
@@ -77,8 +93,29 @@ class ProcessImage {
     if (_allocationTagHolder != nullptr) {
       delete _allocationTagHolder;
     }
+    if (_edgeIsTainted != nullptr) {
+      delete _edgeIsTainted;
+    }
+    if (_edgeIsFavored != nullptr) {
+      delete _edgeIsFavored;
+    }
   }
 
+  /*
+   * Make sure that the given stage, and any stage it depends on, has been
+   * done.  This is called by the accessors for the results of each stage,
+   * so commands need to call it directly only if they hold on to those
+   * results across commands or want to pay the cost of a stage up front.
+   * Stages are expected to be prepared only by the main thread.
+   */
+  void Prepare(Stage stage) const {
+    if (!_isPrepared[stage]) {
+      const_cast<ProcessImage<Offset> *>(this)->PrepareStage(stage);
+    }
+  }
+
+  bool IsPrepared(Stage stage) const { return _isPrepared[stage]; }
+
   const AddressMap &GetVirtualAddressMap() const { return _virtualAddressMap; }
 
   const VirtualMemoryPartition<Offset> &GetVirtualMemoryPartition() const {
@@ -100,18 +137,26 @@ class ProcessImage {
   }
 
   const Allocations::SignatureDirectory<Offset> &GetSignatureDirectory() const {
+    Prepare(SIGNATURES);
     return _signatureDirectory;
   }
 
   Allocations::SignatureDirectory<Offset> &GetSignatureDirectory() {
+    Prepare(SIGNATURES);
     return _signatureDirectory;
   }
 
+  /*
+   * The names of the anchors are read from the same file as the names of
+   * the signatures, and only once the signatures are known.
+   */
   const Allocations::AnchorDirectory<Offset> &GetAnchorDirectory() const {
+    Prepare(SIGNATURES);
     return _anchorDirectory;
   }
 
   Allocations::AnchorDirectory<Offset> &GetAnchorDirectory() {
+    Prepare(SIGNATURES);
     return _anchorDirectory;
   }
 
@@ -120,22 +165,27 @@ class ProcessImage {
   }
 
   const Allocations::TagHolder<Offset> *GetAllocationTagHolder() const {
+    Prepare(TAGS);
     return _allocationTagHolder;
   }
 
   Allocations::TagHolder<Offset> *GetAllocationTagHolder() {
+    Prepare(TAGS);
     return _allocationTagHolder;
   }
 
   const Allocations::Graph<Offset> *GetAllocationGraph() const {
+    Prepare(GRAPH);
     return _allocationGraph;
   }
 
   const Allocations::EdgePredicate<Offset> *GetEdgeIsTainted() const {
+    Prepare(TAGS);
     return _edgeIsTainted;
   }
 
   const Allocations::EdgePredicate<Offset> *GetEdgeIsFavored() const {
+    Prepare(TAGS);
     return _edgeIsFavored;
   }
 
@@ -186,12 +236,35 @@ class ProcessImage {
   PThread::InfrastructureFinder<Offset> _pThreadInfrastructureFinder;
   FollyFibers::InfrastructureFinder<Offset> _follyFibersInfrastructureFinder;
   CPlusPlus::TypeInfoDirectory<Offset> _typeInfoDirectory;
+  bool _isPrepared[NUM_STAGES];
+
+  /*
+   * Do the given stage, and any stage it depends on, and mark each of them
+   * as prepared.
+   */
+  virtual void PrepareStage(Stage stage) = 0;
 
   /*
-   * Pre-tag all allocations.  This should be done just once, at the end
-   * of the constructor for the derived class.
+   * Pre-tag all allocations, using the given signatures.  This should be
+   * done just once, after the graph and the signatures are known.  If a
+   * cache reader is given, the tags are restored from the cache rather than
+   * calculated, as long as the cached tags match the registered taggers.
+   * Return true if the tags were restored.  If the cached tags are found to
+   * be invalid, CacheReader::Invalid is thrown, after which this can be
+   * called again without a cache reader, to tag from scratch.
    */
-  void TagAllocations() {
+  bool TagAllocations(
+      const Allocations::SignatureDirectory<Offset> &signatureDirectory,
+      CacheReader *cacheReader = nullptr) {
+    if (_allocationTagHolder != nullptr) {
+      delete _allocationTagHolder;
+    }
+    if (_edgeIsTainted != nullptr) {
+      delete _edgeIsTainted;
+    }
+    if (_edgeIsFavored != nullptr) {
+      delete _edgeIsFavored;
+    }
     _edgeIsTainted =
         new Allocations::EdgePredicate<Offset>(*_allocationGraph, false);
 
@@ -204,7 +277,7 @@ class ProcessImage {
 
     Allocations::TaggerRunner<Offset> runner(
         *_allocationGraph, *_allocationTagHolder, *_edgeIsTainted,
-        _signatureDirectory);
+        signatureDirectory);
 
     runner.RegisterTagger(
         new CPlusPlus::UnorderedMapOrSetAllocationsTagger<Offset>(
@@ -225,11 +298,11 @@ class ProcessImage {
 
     runner.RegisterTagger(new CPlusPlus::LongStringAllocationsTagger<Offset>(
         *_allocationGraph, *_allocationTagHolder, *_edgeIsTainted,
-        *_edgeIsFavored, _moduleDirectory, _signatureDirectory));
+        *_edgeIsFavored, _moduleDirectory, signatureDirectory));
 
     runner.RegisterTagger(new CPlusPlus::VectorAllocationsTagger<Offset>(
         *_allocationGraph, *_allocationTagHolder, *_edgeIsTainted,
-        *_edgeIsFavored, _signatureDirectory));
+        *_edgeIsFavored, signatureDirectory));
 
     runner.RegisterTagger(new CPlusPlus::COWStringAllocationsTagger<Offset>(
         *_allocationGraph, *_allocationTagHolder, *_edgeIsTainted,
@@ -250,7 +323,29 @@ class ProcessImage {
         _goLangFinderGroup.GetMappedPageRangeAllocationFinderIndex(),
         _virtualAddressMap));
 
+    if (cacheReader != nullptr &&
+        _allocationTagHolder->Restore(*cacheReader)) {
+      _edgeIsTainted->Restore(*cacheReader);
+      _edgeIsFavored->Restore(*cacheReader);
+      return true;
+    }
     runner.ResolveAllAllocationTags();
+    _edgeIsTainted->SetIncomingFromOutgoing();
+    _edgeIsFavored->SetIncomingFromOutgoing();
+    return false;
+  }
+
+  /*
+   * Save the results of the analysis that can be restored from a cache.
+   */
+  void SaveToCache(
+      CacheWriter &writer,
+      const Allocations::SignatureDirectory<Offset> &signatureDirectory) const {
+    _allocationGraph->Save(writer);
+    signatureDirectory.Save(writer);
+    _allocationTagHolder->Save(writer);
+    _edgeIsTainted->Save(writer);
+    _edgeIsFavored->Save(writer);
   }
 };
 }  // namespace chap
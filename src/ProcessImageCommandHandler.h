@@ -40,6 +40,7 @@
 #include "ModuleCommands/ListModules.h"
 #include "PThread/StackOverflowGuardDescriber.h"
 #include "ProcessImage.h"
+#include "ProcessImageCommands/PrepareCommand.h"
 #include "Python/ArenaDescriber.h"
 #include "Python/ArenaStructArrayDescriber.h"
 #include "Python/ContainerPythonObjectDescriber.h"
@@ -56,6 +57,7 @@
 #include "StackCommands/ListStacks.h"
 #include "StackCommands/SummarizeStacks.h"
 #include "StackDescriber.h"
+#include "StatisticsCommands/ShowStats.h"
 #include "VirtualAddressMapCommands/CountRanges.h"
 #include "VirtualAddressMapCommands/DescribePointers.h"
 #include "VirtualAddressMapCommands/DescribeRangeRefs.h"
@@ -66,6 +68,7 @@
 #include "VirtualAddressMapCommands/EnumerateRangeRefs.h"
 #include "VirtualAddressMapCommands/EnumerateRelRefs.h"
 #include "VirtualAddressMapCommands/ListRanges.h"
+#include "VirtualAddressMapCommands/ReversePointerIndex.h"
 #include "VirtualAddressMapCommands/SummarizeRanges.h"
 
 namespace chap {
@@ -86,6 +89,7 @@ class ProcessImageCommandHandler {
         _describeCommand(_compoundDescriber),
         _explainCommand(_compoundDescriber),
         _dumpCommand(processImage.GetVirtualAddressMap()),
+        _prepareCommand(processImage),
         _countStacksSubcommand(processImage),
         _summarizeStacksSubcommand(processImage),
         _listStacksSubcommand(processImage),
@@ -193,13 +197,16 @@ class ProcessImageCommandHandler {
             "writable ranges",
             _virtualMemoryPartition.GetClaimedWritableRanges(),
             _compoundDescriber, _virtualMemoryPartition.UNKNOWN),
-        _describePointersSubcommand(processImage, _compoundDescriber),
-        _enumeratePointersSubcommand(processImage),
+        _reversePointerIndex(processImage.GetVirtualAddressMap()),
+        _describePointersSubcommand(processImage, _compoundDescriber,
+                                    _reversePointerIndex),
+        _enumeratePointersSubcommand(processImage, _reversePointerIndex),
         _describeRelRefsSubcommand(processImage.GetVirtualAddressMap(),
                                    _compoundDescriber),
         _enumerateRelRefsSubcommand(processImage.GetVirtualAddressMap()),
-        _describeRangeRefsSubcommand(processImage, _compoundDescriber),
-        _enumerateRangeRefsSubcommand(processImage),
+        _describeRangeRefsSubcommand(processImage, _compoundDescriber,
+                                     _reversePointerIndex),
+        _enumerateRangeRefsSubcommand(processImage, _reversePointerIndex),
         _summarizeSignaturesSubcommand(processImage),
         _summarizeStringUsersSubcommand(processImage),
         _defaultAllocationsSubcommands(processImage, _allocationDescriber,
@@ -267,6 +274,7 @@ class ProcessImageCommandHandler {
     r.AddCommand(_describeCommand);
     r.AddCommand(_explainCommand);
     r.AddCommand(_dumpCommand);
+    r.AddCommand(_prepareCommand);
     RegisterSubcommand(r, _countStacksSubcommand);
     RegisterSubcommand(r, _summarizeStacksSubcommand);
     RegisterSubcommand(r, _listStacksSubcommand);
@@ -297,6 +305,7 @@ class ProcessImageCommandHandler {
     RegisterSubcommand(r, _enumerateRangeRefsSubcommand);
     RegisterSubcommand(r, _summarizeSignaturesSubcommand);
     RegisterSubcommand(r, _summarizeStringUsersSubcommand);
+    RegisterSubcommand(r, _showStatsSubcommand);
     _defaultAllocationsSubcommands.RegisterSubcommands(r);
     _annotatorRegistry.RegisterAnnotator(_SSOStringAnnotator);
     _annotatorRegistry.RegisterAnnotator(_moduleAddressAnnotator);
@@ -321,6 +330,7 @@ class ProcessImageCommandHandler {
   Commands::DescribeCommand<Offset> _describeCommand;
   Commands::ExplainCommand<Offset> _explainCommand;
   VirtualAddressMapCommands::DumpCommand<Offset> _dumpCommand;
+  ProcessImageCommands::PrepareCommand<Offset> _prepareCommand;
   StackCommands::CountStacks<Offset> _countStacksSubcommand;
   StackCommands::SummarizeStacks<Offset> _summarizeStacksSubcommand;
   StackCommands::ListStacks<Offset> _listStacksSubcommand;
@@ -347,6 +357,7 @@ class ProcessImageCommandHandler {
       _summarizeWritableSubcommand;
   VirtualAddressMapCommands::ListRanges<Offset> _listWritableSubcommand;
   VirtualAddressMapCommands::DescribeRanges<Offset> _describeWritableSubcommand;
+  VirtualAddressMapCommands::ReversePointerIndex<Offset> _reversePointerIndex;
   VirtualAddressMapCommands::DescribePointers<Offset>
       _describePointersSubcommand;
   VirtualAddressMapCommands::EnumeratePointers<Offset>
@@ -365,6 +376,8 @@ class ProcessImageCommandHandler {
   CPlusPlus::Subcommands::SummarizeStringUsers<Offset>
       _summarizeStringUsersSubcommand;
 
+  StatisticsCommands::ShowStats _showStatsSubcommand;
+
   void RegisterSubcommand(Commands::Runner& runner,
                           Commands::Subcommand& subcommand) {
     const std::string& commandName = subcommand.GetCommandName();
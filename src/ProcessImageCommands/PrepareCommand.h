@@ -0,0 +1,63 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <string>
+#include "../Commands/Runner.h"
+#include "../ProcessImage.h"
+namespace chap {
+namespace ProcessImageCommands {
+/*
+ * The graph, signatures and tags for a process image are normally
+ * calculated only when first needed by some command.  This command allows
+ * them to be calculated in advance, for example at the start of a batch
+ * job, so that the cost is not charged to whichever command happens to need
+ * them first.
+ */
+template <class Offset>
+class PrepareCommand : public Commands::Command {
+ public:
+  PrepareCommand(const ProcessImage<Offset>& processImage)
+      : _name("prepare"), _processImage(processImage) {}
+  void ShowHelpMessage(Commands::Context& context) {
+    Commands::Output& output = context.GetOutput();
+    output << "Use \"prepare\" to calculate everything that chap normally "
+              "calculates only when\nfirst needed by some command.  Use "
+              "\"prepare graph\", \"prepare signatures\" or\n\"prepare tags\" "
+              "to calculate just that part and whatever it depends on.\n";
+  }
+  const std::string& GetName() const { return _name; }
+
+  void Run(Commands::Context& context) {
+    size_t numPositionals = context.GetNumPositionals();
+    Commands::Error& error = context.GetError();
+    if (numPositionals > 2) {
+      error << "Use \"prepare [graph|signatures|tags]\".\n";
+      return;
+    }
+    if (numPositionals == 1) {
+      _processImage.Prepare(ProcessImage<Offset>::GRAPH);
+      _processImage.Prepare(ProcessImage<Offset>::SIGNATURES);
+      _processImage.Prepare(ProcessImage<Offset>::TAGS);
+      return;
+    }
+    const std::string& stageName = context.Positional(1);
+    if (stageName == "graph") {
+      _processImage.Prepare(ProcessImage<Offset>::GRAPH);
+    } else if (stageName == "signatures") {
+      _processImage.Prepare(ProcessImage<Offset>::SIGNATURES);
+    } else if (stageName == "tags") {
+      _processImage.Prepare(ProcessImage<Offset>::TAGS);
+    } else {
+      error << "Unknown part \"" << stageName
+            << "\"; use graph, signatures or tags.\n";
+    }
+  }
+
+ private:
+  const std::string _name;
+  const ProcessImage<Offset>& _processImage;
+};
+}  // namespace ProcessImageCommands
+}  // namespace chap
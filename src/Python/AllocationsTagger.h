@@ -133,16 +133,23 @@ class AllocationsTagger : public Allocations::Tagger<Offset> {
     return false;
   }
 
+  bool MayTagFromAllocation(const ContiguousImage& /* contiguousImage */,
+                            Reader& /* reader */, AllocationIndex /* index */,
+                            const Allocation& /* allocation */,
+                            bool /* isUnsigned */) const {
+    return _enabled;
+  }
+
   void MarkFavoredReferences(const ContiguousImage& contiguousImage,
-                             Reader& /* reader */, AllocationIndex index,
+                             Reader& /* reader */, AllocationIndex /* index */,
                              const Allocation& /* allocation */,
+                             const AllocationIndex* outgoingTargets,
                              const EdgeIndex* outgoingEdgeIndices) {
     const Offset* checkLimit = contiguousImage.OffsetLimit();
     const Offset* firstCheck = contiguousImage.FirstOffset();
 
     for (const Offset* check = firstCheck; check < checkLimit; check++) {
-      EdgeIndex edgeIndex = outgoingEdgeIndices[check - firstCheck];
-      AllocationIndex targetIndex = _graph.GetTargetForOutgoing(edgeIndex);
+      AllocationIndex targetIndex = outgoingTargets[check - firstCheck];
       if (targetIndex == _numAllocations) {
         continue;
       }
@@ -152,7 +159,8 @@ class AllocationsTagger : public Allocations::Tagger<Offset> {
            targetAddress == *check) ||
           (tagIndex == _containerPythonObjectTagIndex &&
            (targetAddress + _garbageCollectionHeaderSize) == *check)) {
-        _edgeIsFavored.Set(index, targetIndex, true);
+        _edgeIsFavored.SetForOutgoing(outgoingEdgeIndices[check - firstCheck],
+                                     true);
       }
     }
   }
@@ -209,11 +217,7 @@ class AllocationsTagger : public Allocations::Tagger<Offset> {
                              const Allocation& allocation) {
     if (allocation.Address() == _arenaStructArray) {
       _tagHolder.TagAllocation(index, _arenaStructArrayTagIndex);
-      const AllocationIndex* pFirstOutgoing;
-      const AllocationIndex* pPastOutgoing;
-      _graph.GetOutgoing(index, &pFirstOutgoing, &pPastOutgoing);
-      for (const AllocationIndex* pNextOutgoing = pFirstOutgoing;
-           pNextOutgoing != pPastOutgoing; pNextOutgoing++) {
+      for (AllocationIndex arenaCandidateIndex : _graph.GetOutgoing(index)) {
         /*
          * References between allocations are always to the inner-most
          * allocation that contains the referenced address.  The start
@@ -221,7 +225,6 @@ class AllocationsTagger : public Allocations::Tagger<Offset> {
          * the start of a pool is not the start of some block within
          * the pool because each pool has a header.
          */
-        AllocationIndex arenaCandidateIndex = *pNextOutgoing;
         const Allocation* allocation =
             _directory.AllocationAt(arenaCandidateIndex);
         Offset arenaCandidate = allocation->Address();
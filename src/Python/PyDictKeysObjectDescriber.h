@@ -19,8 +19,7 @@ class PyDictKeysObjectDescriber : public Allocations::PatternDescriber<Offset> {
   typedef typename Allocations::Directory<Offset>::Allocation Allocation;
   PyDictKeysObjectDescriber(const ProcessImage<Offset>& processImage)
       : Allocations::PatternDescriber<Offset>(processImage, "PyDictKeysObject"),
-        _graph(*(processImage.GetAllocationGraph())),
-        _directory(_graph.GetAllocationDirectory()),
+        _directory(processImage.GetAllocationDirectory()),
         _infrastructureFinder(processImage.GetPythonInfrastructureFinder()),
         _strType(_infrastructureFinder.StrType()),
         _cstringInStr(_infrastructureFinder.CstringInStr()),
@@ -66,14 +65,10 @@ class PyDictKeysObjectDescriber : public Allocations::PatternDescriber<Offset> {
     } else {
       // For older python, we need to obtain the capacity from the dict.
 
-      const AllocationIndex* pFirstIncoming;
-      const AllocationIndex* pPastIncoming;
-      _graph.GetIncoming(index, &pFirstIncoming, &pPastIncoming);
       Offset minDictSizeWithGCH =
           _garbageCollectionHeaderSize + _keysInDict + sizeof(Offset);
-      for (const AllocationIndex* pNextIncoming = pFirstIncoming;
-           pNextIncoming != pPastIncoming; pNextIncoming++) {
-        AllocationIndex incomingIndex = *pNextIncoming;
+      const Allocations::Graph<Offset>& graph = Base::GetGraph();
+      for (AllocationIndex incomingIndex : graph.GetIncoming(index)) {
         const Allocation* incomingAllocation =
             _directory.AllocationAt(incomingIndex);
         Offset incomingAddress = incomingAllocation->Address();
@@ -150,7 +145,6 @@ class PyDictKeysObjectDescriber : public Allocations::PatternDescriber<Offset> {
   }
 
  private:
-  const Allocations::Graph<Offset>& _graph;
   const Allocations::Directory<Offset>& _directory;
   const InfrastructureFinder<Offset>& _infrastructureFinder;
   const Offset _strType;
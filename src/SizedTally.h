@@ -1,4 +1,4 @@
-// Copyright (c) 2017 Broadcom. All Rights Reserved.
+// Copyright (c) 2017,2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
@@ -7,12 +7,21 @@ namespace chap {
 template <class Offset>
 class SizedTally {
  public:
-  SizedTally(Commands::Context& context, const std::string& itemsLabel)
+  /*
+   * The total is shown when the tally goes away unless showTotal is false,
+   * as it is for results written in a format meant for other programs.
+   */
+  SizedTally(Commands::Context& context, const std::string& itemsLabel,
+             bool showTotal = true)
       : _context(context),
         _itemsLabel(itemsLabel),
+        _showTotal(showTotal),
         _totalItems(0),
         _totalBytes(0) {}
   ~SizedTally() {
+    if (!_showTotal) {
+      return;
+    }
     Commands::Output& output = _context.GetOutput();
     output << std::dec << _totalItems << " " << _itemsLabel << " use 0x"
            << std::hex << _totalBytes << " ("
@@ -26,9 +35,15 @@ class SizedTally {
     return false;
   }
 
+  void AddToTally(Offset numItems, Offset numBytes) {
+    _totalItems += numItems;
+    _totalBytes += numBytes;
+  }
+
  private:
   Commands::Context& _context;
   const std::string _itemsLabel;
+  const bool _showTotal;
   Offset _totalItems;
   Offset _totalBytes;
 
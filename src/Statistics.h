@@ -0,0 +1,190 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+extern "C" {
+#include <sys/resource.h>
+};
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace chap {
+/*
+ * This class holds the process-wide record of how long each phase of the
+ * analysis of a process image took, and of a few counters, such as the
+ * number of allocations and edges, that help to explain those times.  The
+ * phases are always recorded, because the cost is just a few system calls
+ * per phase, so that "show stats" can report them.  If enabled, by the
+ * -stats switch, each phase is also reported on standard error as soon as
+ * it has finished, which gives some feedback while a large core is being
+ * analyzed.
+ */
+class Statistics {
+ public:
+  /*
+   * This is a point in time as seen by the process, with the peak resident
+   * set size so far.
+   */
+  struct Usage {
+    double _wallSeconds;
+    double _cpuSeconds;
+    int64_t _peakRSSKB;
+  };
+
+  /*
+   * This is the cost of one phase, where phases done as part of another
+   * phase have a greater depth.
+   */
+  struct PhaseRecord {
+    std::string _name;
+    size_t _depth;
+    double _wallSeconds;
+    double _cpuSeconds;
+    int64_t _peakRSSGrowthKB;
+  };
+
+  /*
+   * This records, for the lifetime of the object, a phase with the given
+   * name.  Phases are expected to be started only by the main thread.
+   */
+  class Phase {
+   public:
+    Phase(const char *name) : _index(_phases.size()), _start(Now()) {
+      _phases.push_back({name, _depth++, 0.0, 0.0, 0});
+    }
+    ~Phase() {
+      Usage finish = Now();
+      PhaseRecord &record = _phases[_index];
+      record._wallSeconds = finish._wallSeconds - _start._wallSeconds;
+      record._cpuSeconds = finish._cpuSeconds - _start._cpuSeconds;
+      record._peakRSSGrowthKB = finish._peakRSSKB - _start._peakRSSKB;
+      _depth--;
+      if (_isEnabled) {
+        WritePhase(std::cerr, record);
+      }
+    }
+
+   private:
+    size_t _index;
+    Usage _start;
+  };
+
+  static bool IsEnabled() { return _isEnabled; }
+  static void SetEnabled(bool isEnabled) { _isEnabled = isEnabled; }
+
+  static Usage Now() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return {std::chrono::duration<double>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count(),
+            Seconds(usage.ru_utime) + Seconds(usage.ru_stime),
+            (int64_t)usage.ru_maxrss};
+  }
+
+  static void SetCounter(const std::string &name, uint64_t value) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _counters[name] = value;
+  }
+
+  static void AddToCounter(const std::string &name, uint64_t value) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _counters[name] += value;
+  }
+
+  /*
+   * Count lookups of address ranges by readers of a VirtualAddressMap.
+   * These are counted apart from the other counters because readers are
+   * often short-lived, so this must be cheap.
+   */
+  static void AddReaderMisses(uint64_t numMisses) {
+    _readerMisses.fetch_add(numMisses, std::memory_order_relaxed);
+  }
+
+  static std::map<std::string, uint64_t> GetCounters() {
+    std::map<std::string, uint64_t> counters;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      counters = _counters;
+    }
+    counters["readerCacheMisses"] =
+        _readerMisses.load(std::memory_order_relaxed);
+    return counters;
+  }
+
+  static const std::vector<PhaseRecord> &GetPhases() { return _phases; }
+
+  static void WritePhase(std::ostream &os, const PhaseRecord &record) {
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::string(2 * record._depth, ' ') << record._name << ": "
+       << std::dec << std::fixed << std::setprecision(3)
+       << record._wallSeconds << "s wall, " << record._cpuSeconds
+       << "s cpu, peak RSS +" << record._peakRSSGrowthKB << " KB\n";
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+  /*
+   * Write the phases, in the order in which they were started, followed by
+   * the counters.
+   */
+  static void Write(std::ostream &os) {
+    for (const auto &record : _phases) {
+      WritePhase(os, record);
+    }
+    for (const auto &nameAndValue : GetCounters()) {
+      os << nameAndValue.first << ": " << std::dec << nameAndValue.second
+         << "\n";
+    }
+  }
+
+  /*
+   * Write the same information as Write, as a single JSON object.
+   */
+  static void WriteJSON(std::ostream &os) {
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << "{\"phases\": [";
+    const char *separator = "";
+    for (const auto &record : _phases) {
+      os << separator << "{\"name\": \"" << record._name
+         << "\", \"depth\": " << std::dec << record._depth
+         << ", \"wallSeconds\": " << std::fixed << std::setprecision(6)
+         << record._wallSeconds << ", \"cpuSeconds\": " << record._cpuSeconds
+         << ", \"peakRSSGrowthKB\": " << record._peakRSSGrowthKB << "}";
+      separator = ", ";
+    }
+    os << "], \"counters\": {";
+    separator = "";
+    for (const auto &nameAndValue : GetCounters()) {
+      os << separator << "\"" << nameAndValue.first
+         << "\": " << nameAndValue.second;
+      separator = ", ";
+    }
+    os << "}}\n";
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+ private:
+  static inline bool _isEnabled = false;
+  static inline size_t _depth = 0;
+  static inline std::vector<PhaseRecord> _phases;
+  static inline std::mutex _mutex;
+  static inline std::map<std::string, uint64_t> _counters;
+  static inline std::atomic<uint64_t> _readerMisses{0};
+
+  static double Seconds(const struct timeval &tv) {
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+  }
+};
+}  // namespace chap
@@ -0,0 +1,38 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include "../Commands/Runner.h"
+#include "../Commands/Subcommand.h"
+#include "../Statistics.h"
+namespace chap {
+namespace StatisticsCommands {
+class ShowStats : public Commands::Subcommand {
+ public:
+  ShowStats() : Commands::Subcommand("show", "stats") {}
+
+  void ShowHelpMessage(Commands::Context& context) {
+    context.GetOutput()
+        << "This command shows the wall time, the CPU time and the growth in"
+           " peak resident\nset size for each phase of the analysis of the"
+           " process image, followed by\ncounters such as the number of"
+           " allocations and edges.  Use \"/json true\" to\nget the same"
+           " information as a single JSON object.\n";
+  }
+
+  void Run(Commands::Context& context) {
+    bool useJSON = false;
+    if (!context.ParseBooleanSwitch("json", useJSON)) {
+      return;
+    }
+    std::ostream& output = context.GetOutput().GetTopOutputStream();
+    if (useJSON) {
+      Statistics::WriteJSON(output);
+    } else {
+      Statistics::Write(output);
+    }
+  }
+};
+}  // namespace StatisticsCommands
+}  // namespace chap
@@ -69,9 +69,7 @@ class PageMapAllocationFinder : public Allocations::Directory<Offset>::Finder {
    * Return the address of the next allocation (in increasing order of
    * address) to be reported by this finder, without advancing to the next
    * allocation.  The return value is undefined if there are no more
-   * allocations available.  Note that at the time this function is called
-   * any allocations already reported by this allocation finder have already
-   * been assigned allocation indices in the Directory.
+   * allocations available.
    */
   virtual Offset NextAddress() { return _allocationAddress; }
   /*
@@ -102,7 +100,6 @@ class PageMapAllocationFinder : public Allocations::Directory<Offset>::Finder {
 
     _pageMapIterator->Advance();
     if (_pageMapIterator->Finished()) {
-      CorrectAllocationFreeStatus();
       return;
     }
 
@@ -128,6 +125,12 @@ class PageMapAllocationFinder : public Allocations::Directory<Offset>::Finder {
     return size;
   }
 
+  /*
+   * Now that all the allocations are in the Directory, correct the free
+   * status of any that are on free lists.
+   */
+  virtual void AllocationsPlaced() { CorrectAllocationFreeStatus(); }
+
  private:
   const VirtualAddressMap<Offset>& _addressMap;
   typename VirtualAddressMap<Offset>::Reader _spanReader;
@@ -1,10 +1,12 @@
-// Copyright (c) 2017-2019,2021-2023 Broadcom. All Rights Reserved.
+// Copyright (c) 2017-2019,2021-2024 Broadcom. All Rights Reserved.
 // The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <vector>
 #include "FileImage.h"
 #include "RangeMapper.h"
+#include "Statistics.h"
 namespace chap {
 template <typename OffsetType>
 class VirtualAddressMap {
@@ -31,54 +33,45 @@ class VirtualAddressMap {
     int _flags;
   };
   typedef RangeMapper<Offset, RangeAttributes> RangeFileOffsetMapper;
-  template <class OneWayIterator>
+  /*
+   * Once all ranges have been added, the map is frozen into parallel arrays
+   * of bases, limits, images and flags, ordered by address, so that a lookup
+   * is a search of one contiguous array of limits rather than of a tree.
+   * An iterator is just an index into those arrays.
+   */
+  template <bool isReverse>
   class RangeIterator {
    public:
-    RangeIterator(OneWayIterator it, const char *fileImage)
-        : _oneWayIterator(it), _fileImage(fileImage) {}
+    RangeIterator(const VirtualAddressMap *map, size_t index)
+        : _map(map), _index(index) {}
     bool operator==(const RangeIterator &other) {
-      return other._oneWayIterator == _oneWayIterator &&
-             other._fileImage == _fileImage;
+      return other._index == _index && other._map == _map;
     }
     bool operator!=(const RangeIterator &other) {
-      return other._oneWayIterator != _oneWayIterator ||
-             other._fileImage != _fileImage;
+      return other._index != _index || other._map != _map;
     }
     RangeIterator &operator++() {
-      ++_oneWayIterator;
-      return *this;
-    }
-
-    const char *GetImage() {
-      const typename RangeFileOffsetMapper::Range &range = *_oneWayIterator;
-      if ((range._value._flags &
-           (RangeAttributes::IS_MAPPED | RangeAttributes::IS_TRUNCATED)) !=
-          RangeAttributes::IS_MAPPED) {
-        return 0;
+      if (isReverse) {
+        --_index;
       } else {
-        return _fileImage +
-               // The parenthesis matters here because in general this is
-               // counting on overflow of unsigned arithmetic to leave
-               // a potentially smaller file offset than base value.  This
-               // matters for 32 bit cores.
-               (range._base + range._value._adjustToFileOffset);
+        ++_index;
       }
+      return *this;
     }
 
-    Offset Base() { return _oneWayIterator->_base; }
-    Offset Size() { return _oneWayIterator->_size; }
-    Offset Limit() { return _oneWayIterator->_limit; }
-    int Flags() { return _oneWayIterator->_value._flags; }
+    const char *GetImage() { return _map->_images[_index]; }
+    Offset Base() { return _map->_bases[_index]; }
+    Offset Size() { return _map->_limits[_index] - _map->_bases[_index]; }
+    Offset Limit() { return _map->_limits[_index]; }
+    int Flags() { return _map->_flags[_index]; }
 
    private:
-    OneWayIterator _oneWayIterator;
-    const char *_fileImage;
+    const VirtualAddressMap *_map;
+    size_t _index;
   };
 
-  typedef RangeIterator<typename RangeFileOffsetMapper::const_iterator>
-      const_iterator;
-  typedef RangeIterator<typename RangeFileOffsetMapper::const_reverse_iterator>
-      const_reverse_iterator;
+  typedef RangeIterator<false> const_iterator;
+  typedef RangeIterator<true> const_reverse_iterator;
 
   struct NotMapped {
     NotMapped(Offset address) : _address(address) {}
@@ -93,7 +86,21 @@ class VirtualAddressMap {
           _endIterator(map.end()),
           _image((const char *)0),
           _base(0),
-          _limit(0) {}
+          _limit(0),
+          _numMisses(0) {}
+    Reader(const Reader &other)
+        : _map(other._map),
+          _iterator(other._iterator),
+          _endIterator(other._endIterator),
+          _image(other._image),
+          _base(other._base),
+          _limit(other._limit),
+          _numMisses(0) {}
+    ~Reader() {
+      if (_numMisses != 0) {
+        Statistics::AddReaderMisses(_numMisses);
+      }
+    }
     /*
      * This form, which throws an exception if the address is not mapped,
      * should be used only if the address is actually expected to be mapped,
@@ -108,6 +115,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -138,6 +146,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -168,6 +177,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -197,6 +207,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -227,6 +238,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -256,6 +268,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -285,6 +298,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -315,6 +329,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -344,6 +359,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -374,6 +390,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -403,6 +420,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -431,6 +449,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator == _endIterator) {
           return 0;
@@ -461,6 +480,7 @@ class VirtualAddressMap {
         _image = nullptr;
         _base = 0;
         _limit = 0;
+        _numMisses++;
         _iterator = _map.find(address);
         if (_iterator != _endIterator) {
           _image = _iterator.GetImage();
@@ -485,6 +505,11 @@ class VirtualAddressMap {
     const char *_image;
     Offset _base;
     Offset _limit;
+    /*
+     * This is the number of reads that needed a lookup of the range, which
+     * is reported to Statistics when the reader goes away.
+     */
+    uint64_t _numMisses;
   };
   VirtualAddressMap(const FileImage &fileImage)
       : _fileImage(fileImage), _fileSize((Offset)(fileImage.GetFileSize())) {}
@@ -493,18 +518,18 @@ class VirtualAddressMap {
 
   const FileImage &GetFileImage() const { return _fileImage; }
 
-  const_iterator begin() const {
-    return const_iterator(_ranges.begin(), _fileImage.GetImage());
-  }
-  const_iterator end() const {
-    return const_iterator(_ranges.end(), _fileImage.GetImage());
-  }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, _limits.size()); }
   const_iterator find(Offset addr) const {
-    return const_iterator(_ranges.find(addr), _fileImage.GetImage());
+    size_t index = UpperBound(addr);
+    if (index == _limits.size() || _bases[index] > addr) {
+      index = _limits.size();
+    }
+    return const_iterator(this, index);
   }
 
   const_iterator upper_bound(Offset addr) const {
-    return const_iterator(_ranges.upper_bound(addr), _fileImage.GetImage());
+    return const_iterator(this, UpperBound(addr));
   }
 
   Offset FindMappedMemoryImage(Offset addr, const char **image) const {
@@ -521,11 +546,66 @@ class VirtualAddressMap {
     return 0;
   }
 
+  /*
+   * Scans of the images of the ranges may skip any parts that are known to
+   * hold only 0, which at present are the holes in a sparse core file.
+   */
+  bool HasKnownZeros() const { return _fileImage.HasHoles(); }
+
+  /*
+   * Return the first position in [image, limit), within the image of a
+   * range, that is not known to hold 0, or limit if there is none.
+   */
+  const char *SkipKnownZeros(const char *image, const char *limit) const {
+    return _fileImage.SkipHoles(image, limit);
+  }
+
+  /*
+   * Return the first address in [address, limit) that is not known to hold
+   * 0, or limit if there is none, where address is in the image of a range.
+   */
+  Offset SkipKnownZeros(Offset address, Offset limit) const {
+    const char *image;
+    Offset numBytes = FindMappedMemoryImage(address, &image);
+    if (numBytes == 0) {
+      return address;
+    }
+    if (numBytes > limit - address) {
+      numBytes = limit - address;
+    }
+    return address +
+           (Offset)(_fileImage.SkipHoles(image, image + numBytes) - image);
+  }
+
+  /*
+   * Call visitor(image, address, size) for each part of the image of the
+   * given range that is not known to hold only 0, in increasing order.
+   */
+  template <typename Visitor>
+  void VisitPossiblyNonZeroParts(const_iterator it, Visitor visitor) const {
+    const char *rangeImage = it.GetImage();
+    if (rangeImage == nullptr) {
+      return;
+    }
+    const char *limit = rangeImage + it.Size();
+    const char *image = rangeImage;
+    while (image < limit) {
+      const char *partStart = _fileImage.SkipHoles(image, limit);
+      if (partStart == limit) {
+        break;
+      }
+      const char *partLimit = _fileImage.FindHole(partStart, limit);
+      visitor(partStart, it.Base() + (Offset)(partStart - rangeImage),
+              (Offset)(partLimit - partStart));
+      image = partLimit;
+    }
+  }
+
   const_reverse_iterator rbegin() const {
-    return const_reverse_iterator(_ranges.rbegin(), _fileImage.GetImage());
+    return const_reverse_iterator(this, _limits.size() - 1);
   }
   const_reverse_iterator rend() const {
-    return const_reverse_iterator(_ranges.rend(), _fileImage.GetImage());
+    return const_reverse_iterator(this, (size_t)(-1));
   }
 
   void AddRange(Offset rangeAddr, Offset rangeSize, Offset adjustToFileOffset,
@@ -585,6 +665,38 @@ class VirtualAddressMap {
     }
   }
 
+  /*
+   * Rebuild the arrays used for lookup and iteration from the ranges that
+   * have been added so far.  This must be called after the last call to
+   * AddRange and before the map is used.
+   */
+  void Freeze() {
+    _bases.clear();
+    _limits.clear();
+    _images.clear();
+    _flags.clear();
+    const char *fileImage = _fileImage.GetImage();
+    for (const auto &range : _ranges) {
+      _bases.push_back(range._base);
+      _limits.push_back(range._limit);
+      int flags = range._value._flags;
+      _flags.push_back(flags);
+      if ((flags & (RangeAttributes::IS_MAPPED |
+                    RangeAttributes::IS_TRUNCATED)) !=
+          RangeAttributes::IS_MAPPED) {
+        _images.push_back(nullptr);
+      } else {
+        _images.push_back(fileImage +
+                          // The parenthesis matters here because in general
+                          // this is counting on overflow of unsigned
+                          // arithmetic to leave a potentially smaller file
+                          // offset than base value.  This matters for 32 bit
+                          // cores.
+                          (range._base + range._value._adjustToFileOffset));
+      }
+    }
+  }
+
   // TODO: resolve error handling for references
   // TODO: handle 0-page omission where dump format allows it and it
   //       makes sense
@@ -593,5 +705,28 @@ class VirtualAddressMap {
   const FileImage &_fileImage;
   Offset _fileSize;
   RangeFileOffsetMapper _ranges;
+  std::vector<Offset> _bases;
+  std::vector<Offset> _limits;
+  std::vector<const char *> _images;
+  std::vector<int> _flags;
+
+  /*
+   * Return the index of the first range with limit after the given address,
+   * or the number of ranges if there is no such range.  The comparison
+   * results select the next step by conditional moves rather than by
+   * branches, which would be mispredicted about half the time.
+   */
+  size_t UpperBound(Offset addr) const {
+    const Offset *limits = _limits.data();
+    size_t index = 0;
+    size_t count = _limits.size();
+    while (count > 0) {
+      size_t half = count / 2;
+      bool isBelow = limits[index + half] <= addr;
+      index = isBelow ? index + half + 1 : index;
+      count = isBelow ? count - half - 1 : half;
+    }
+    return index;
+  }
 };
 }  // namespace chap
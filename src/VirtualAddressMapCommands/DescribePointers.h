@@ -7,6 +7,7 @@
 #include "../Commands/Subcommand.h"
 #include "../VirtualAddressMap.h"
 #include "AddressFilter.h"
+#include "ReversePointerIndex.h"
 namespace chap {
 namespace VirtualAddressMapCommands {
 template <class Offset>
@@ -14,23 +15,27 @@ class DescribePointers : public Commands::Subcommand {
  public:
   typedef VirtualAddressMap<Offset> AddressMap;
   DescribePointers(const ProcessImage<Offset>& processImage,
-                   const CompoundDescriber<Offset>& describer)
+                   const CompoundDescriber<Offset>& describer,
+                   ReversePointerIndex<Offset>& reversePointerIndex)
       : Commands::Subcommand("describe", "pointers"),
         _processImage(processImage),
-        _addressMap(processImage.GetVirtualAddressMap()),
+        _reversePointerIndex(reversePointerIndex),
         _describer(describer) {}
 
   void ShowHelpMessage(Commands::Context& context) {
-    context.GetOutput() << "Use \"describe pointers <address>\" to describe "
-                           "all pointer-aligned addresses\nthat point "
-                           "to the given address.\n";
+    context.GetOutput()
+        << "Use \"describe pointers <address> [<address> ...]\" to describe "
+           "all\npointer-aligned addresses that point to any of the given "
+           "addresses.\n"
+           "Use /fromFile <path> to also use the addresses, in hexadecimal, "
+           "from the\ngiven file.  The results are grouped by the address "
+           "pointed to, in the\norder the addresses were given.\n";
   }
 
   void Run(Commands::Context& context) {
-    Offset valueToMatch;
-    bool hasErrors = false;
-    if (context.GetNumPositionals() != 3 ||
-        !context.ParsePositional(2, valueToMatch)) {
+    std::vector<Offset> targets;
+    bool hasErrors = !PointerScanner<Offset>::GetTargets(context, 2, targets);
+    if (targets.empty()) {
       hasErrors = true;
     }
 
@@ -39,40 +44,30 @@ class DescribePointers : public Commands::Subcommand {
       hasErrors = true;
     }
     if (hasErrors) {
-      context.GetError() << "Use \"describe pointers <address>\" to describe "
-                            "all pointer-aligned addresses\nthat point "
-                            "to the given address.\n";
+      context.GetError()
+          << "Use \"describe pointers <address> [<address> ...]\" to describe "
+             "all\npointer-aligned addresses that point to any of the given "
+             "addresses.\n";
       return;
     }
     Commands::Output& output = context.GetOutput();
     bool filterIsActive = addressFilter.IsActive();
-    typename AddressMap::const_iterator itEnd = _addressMap.end();
-    for (typename AddressMap::const_iterator it = _addressMap.begin();
-         it != itEnd; ++it) {
-      Offset numCandidates = it.Size() / sizeof(Offset);
-      const char* rangeImage = it.GetImage();
-      if (rangeImage != (const char*)0) {
-        const Offset* nextCandidate = (const Offset*)(rangeImage);
-
-        for (const Offset* limit = nextCandidate + numCandidates;
-             nextCandidate < limit; nextCandidate++) {
-          if (*nextCandidate == valueToMatch) {
-            Offset pointerAddress =
-                ((it.Base()) + ((const char*)nextCandidate - rangeImage));
-            if (filterIsActive && addressFilter.Exclude(pointerAddress)) {
-              continue;
-            }
-            _describer.Describe(context, pointerAddress, false, true);
-            output << "\n";
-          }
+    std::vector<std::vector<Offset> > sources;
+    _reversePointerIndex.FindPointersTo(targets, sources);
+    for (const auto& targetSources : sources) {
+      for (Offset source : targetSources) {
+        if (filterIsActive && addressFilter.Exclude(source)) {
+          continue;
         }
+        _describer.Describe(context, source, false, true);
+        output << "\n";
       }
     }
   }
 
  private:
   const ProcessImage<Offset>& _processImage;
-  const AddressMap& _addressMap;
+  ReversePointerIndex<Offset>& _reversePointerIndex;
   const CompoundDescriber<Offset>& _describer;
 };
 }  // namespace VirtualAddressMapCommands
@@ -7,6 +7,7 @@
 #include "../Commands/Subcommand.h"
 #include "../VirtualAddressMap.h"
 #include "AddressFilter.h"
+#include "ReversePointerIndex.h"
 namespace chap {
 namespace VirtualAddressMapCommands {
 template <class Offset>
@@ -14,11 +15,13 @@ class DescribeRangeRefs : public Commands::Subcommand {
  public:
   typedef VirtualAddressMap<Offset> AddressMap;
   DescribeRangeRefs(const ProcessImage<Offset>& processImage,
-                    const CompoundDescriber<Offset>& describer)
+                    const CompoundDescriber<Offset>& describer,
+                    ReversePointerIndex<Offset>& reversePointerIndex)
       : Commands::Subcommand("describe", "rangerefs"),
         _processImage(processImage),
         _addressMap(processImage.GetVirtualAddressMap()),
-        _describer(describer) {}
+        _describer(describer),
+        _reversePointerIndex(reversePointerIndex) {}
 
   void ShowHelpMessage(Commands::Context& context) {
     context.GetOutput() << "Use \"describe rangerefs <start> <limit>\" to "
@@ -50,6 +53,31 @@ class DescribeRangeRefs : public Commands::Subcommand {
     }
     Commands::Output& output = context.GetOutput();
     bool filterIsActive = addressFilter.IsActive();
+    std::vector<Offset> refAddrs;
+    if (!_reversePointerIndex.FindPointersTo(rangeStart, rangeLimit,
+                                             refAddrs)) {
+      FindPointersTo(rangeStart, rangeLimit, refAddrs);
+    }
+    for (Offset refAddr : refAddrs) {
+      if (refAddr >= rangeStart && refAddr < rangeLimit) {
+        continue;
+      }
+      if (filterIsActive && addressFilter.Exclude(refAddr)) {
+        continue;
+      }
+      output << std::hex << refAddr << "\n";
+      _describer.Describe(context, refAddr, false, true);
+      output << "\n";
+    }
+  }
+
+ private:
+  /*
+   * Find the pointers to the given range by scanning every image, for
+   * a range that is not entirely covered by the reverse pointer index.
+   */
+  void FindPointersTo(Offset rangeStart, Offset rangeLimit,
+                      std::vector<Offset>& refAddrs) {
     typename AddressMap::const_iterator itEnd = _addressMap.end();
     for (typename AddressMap::const_iterator it = _addressMap.begin();
          it != itEnd; ++it) {
@@ -62,26 +90,18 @@ class DescribeRangeRefs : public Commands::Subcommand {
              nextCandidate < limit; nextCandidate++) {
           Offset maybeInRange = *nextCandidate;
           if (maybeInRange >= rangeStart && maybeInRange < rangeLimit) {
-            Offset refAddr =
-                it.Base() + ((const char*)nextCandidate - rangeImage);
-            if (refAddr < rangeStart || refAddr >= rangeLimit) {
-              if (filterIsActive && addressFilter.Exclude(refAddr)) {
-                continue;
-              }
-              output << std::hex << refAddr << "\n";
-              _describer.Describe(context, refAddr, false, true);
-              output << "\n";
-            }
+            refAddrs.push_back(it.Base() +
+                               ((const char*)nextCandidate - rangeImage));
           }
         }
       }
     }
   }
 
- private:
   const ProcessImage<Offset>& _processImage;
   const AddressMap& _addressMap;
   const CompoundDescriber<Offset>& _describer;
+  ReversePointerIndex<Offset>& _reversePointerIndex;
 };
 }  // namespace VirtualAddressMapCommands
 }  // namespace chap
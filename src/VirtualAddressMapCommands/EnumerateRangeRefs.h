@@ -7,16 +7,19 @@
 #include "../Commands/Subcommand.h"
 #include "../VirtualAddressMap.h"
 #include "AddressFilter.h"
+#include "ReversePointerIndex.h"
 namespace chap {
 namespace VirtualAddressMapCommands {
 template <class Offset>
 class EnumerateRangeRefs : public Commands::Subcommand {
  public:
   typedef VirtualAddressMap<Offset> AddressMap;
-  EnumerateRangeRefs(const ProcessImage<Offset>& processImage)
+  EnumerateRangeRefs(const ProcessImage<Offset>& processImage,
+                     ReversePointerIndex<Offset>& reversePointerIndex)
       : Commands::Subcommand("enumerate", "rangerefs"),
         _processImage(processImage),
-        _addressMap(processImage.GetVirtualAddressMap()) {}
+        _addressMap(processImage.GetVirtualAddressMap()),
+        _reversePointerIndex(reversePointerIndex) {}
 
   void ShowHelpMessage(Commands::Context& context) {
     context.GetOutput() << "Use \"enumerate rangerefs <start> <limit>\" to "
@@ -49,6 +52,29 @@ class EnumerateRangeRefs : public Commands::Subcommand {
     Commands::Output& output = context.GetOutput();
     bool filterIsActive = addressFilter.IsActive();
     output << std::hex;
+    std::vector<Offset> refAddrs;
+    if (!_reversePointerIndex.FindPointersTo(rangeStart, rangeLimit,
+                                             refAddrs)) {
+      FindPointersTo(rangeStart, rangeLimit, refAddrs);
+    }
+    for (Offset refAddr : refAddrs) {
+      if (refAddr >= rangeStart && refAddr < rangeLimit) {
+        continue;
+      }
+      if (filterIsActive && addressFilter.Exclude(refAddr)) {
+        continue;
+      }
+      output << std::hex << refAddr << "\n";
+    }
+  }
+
+ private:
+  /*
+   * Find the pointers to the given range by scanning every image, for
+   * a range that is not entirely covered by the reverse pointer index.
+   */
+  void FindPointersTo(Offset rangeStart, Offset rangeLimit,
+                      std::vector<Offset>& refAddrs) {
     typename AddressMap::const_iterator itEnd = _addressMap.end();
     for (typename AddressMap::const_iterator it = _addressMap.begin();
          it != itEnd; ++it) {
@@ -61,23 +87,17 @@ class EnumerateRangeRefs : public Commands::Subcommand {
              nextCandidate < limit; nextCandidate++) {
           Offset maybeInRange = *nextCandidate;
           if (maybeInRange >= rangeStart && maybeInRange < rangeLimit) {
-            Offset refAddr =
-                it.Base() + ((const char*)nextCandidate - rangeImage);
-            if (refAddr < rangeStart || refAddr >= rangeLimit) {
-              if (filterIsActive && addressFilter.Exclude(refAddr)) {
-                continue;
-              }
-              output << std::hex << refAddr << "\n";
-            }
+            refAddrs.push_back(it.Base() +
+                               ((const char*)nextCandidate - rangeImage));
           }
         }
       }
     }
   }
 
- private:
   const ProcessImage<Offset>& _processImage;
   const AddressMap& _addressMap;
+  ReversePointerIndex<Offset>& _reversePointerIndex;
 };
 }  // namespace VirtualAddressMapCommands
 }  // namespace chap
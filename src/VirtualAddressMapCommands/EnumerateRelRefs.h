@@ -35,32 +35,48 @@ class EnumerateRelRefs : public Commands::Subcommand {
     Commands::Output& output = context.GetOutput();
     output << std::hex;
     typename AddressMap::const_iterator itEnd = _addressMap.end();
+    Offset valueToMatchMinusSizeofInt = valueToMatch - sizeof(int);
     for (typename AddressMap::const_iterator it = _addressMap.begin();
          it != itEnd; ++it) {
       const char* rangeImage = it.GetImage();
-      if (rangeImage != (const char*)0) {
-        const unsigned char* nextCandidate = (const unsigned char*)(rangeImage);
-
-        Offset addr = it.Base();
-        Offset valueToMatchMinusSizeofInt = valueToMatch - sizeof(int);
-        for (const unsigned char* limit =
-                 nextCandidate + it.Size() - sizeof(int) + 1;
-             nextCandidate < limit; nextCandidate++) {
-          if (addr == valueToMatchMinusSizeofInt) {
-            addr++;
-            continue;
-          }
-          if (addr + *(int*)(nextCandidate) == valueToMatchMinusSizeofInt) {
-            output << std::hex << addr << "\n";
-          }
-          addr++;
-        }
+      if (rangeImage == (const char*)0 || it.Size() < sizeof(int)) {
+        continue;
       }
+      /*
+       * An integer that lies entirely in a part known to hold only 0 can
+       * match only at the address that is excluded anyway, so only those
+       * that overlap some other part are checked.
+       */
+      const char* rangeLimit = rangeImage + it.Size() - sizeof(int) + 1;
+      const char* checked = rangeImage;
+      _addressMap.VisitPossiblyNonZeroParts(
+          it, [&](const char* image, Offset, Offset size) {
+            const char* first = image - std::min((size_t)(image - checked),
+                                                 sizeof(int) - 1);
+            const char* limit = std::min(image + size, rangeLimit);
+            Scan(output, first, limit, it.Base() + (Offset)(first - rangeImage),
+                 valueToMatchMinusSizeofInt);
+            checked = std::max(checked, limit);
+          });
     }
   }
 
  private:
   const AddressMap& _addressMap;
+
+  void Scan(Commands::Output& output, const char* nextCandidate,
+            const char* limit, Offset addr, Offset valueToMatchMinusSizeofInt) {
+    for (; nextCandidate < limit; nextCandidate++) {
+      if (addr == valueToMatchMinusSizeofInt) {
+        addr++;
+        continue;
+      }
+      if (addr + *(int*)(nextCandidate) == valueToMatchMinusSizeofInt) {
+        output << std::hex << addr << "\n";
+      }
+      addr++;
+    }
+  }
 };
 }  // namespace VirtualAddressMapCommands
 }  // namespace chap
@@ -0,0 +1,319 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+#include "../Commands/Runner.h"
+#include "../Parallelism.h"
+#include "../VirtualAddressMap.h"
+namespace chap {
+namespace VirtualAddressMapCommands {
+/*
+ * This finds all the pointer-aligned addresses in the images of the ranges
+ * of a VirtualAddressMap that hold any of a set of target values, in a
+ * single pass over the images, with the ranges split among threads.
+ *
+ * Each word is first checked with SIMD instructions (AVX2 if the CPU has
+ * it, otherwise SSE2, otherwise plain C++) against a mask covering the span
+ * from the smallest to the largest target, which rejects nearly all words
+ * in a core.  Only the words that pass that check are looked up among the
+ * targets.
+ */
+template <class Offset>
+class PointerScanner {
+ public:
+  typedef VirtualAddressMap<Offset> AddressMap;
+
+  /*
+   * This is one match, with the address of the pointer and the target
+   * value found there.
+   */
+  struct Match {
+    Offset _value;
+    Offset _address;
+    bool operator<(const Match& other) const {
+      return (_value != other._value) ? (_value < other._value)
+                                      : (_address < other._address);
+    }
+  };
+
+  PointerScanner(const AddressMap& addressMap) : _addressMap(addressMap) {}
+
+  /*
+   * Gather the target values given as positional arguments, starting
+   * at the given position, and in the file given by any /fromFile switches.
+   * Duplicate values are dropped but the order is otherwise kept.  Return
+   * false, after reporting the problem, if any value could not be parsed.
+   */
+  static bool GetTargets(Commands::Context& context, size_t firstPositional,
+                         std::vector<Offset>& targets) {
+    bool hasErrors = false;
+    size_t numPositionals = context.GetNumPositionals();
+    for (size_t i = firstPositional; i < numPositionals; i++) {
+      Offset target;
+      if (!context.ParsePositional(i, target)) {
+        context.GetError() << "\"" << context.Positional(i)
+                           << "\" is not a valid address.\n";
+        hasErrors = true;
+        continue;
+      }
+      targets.push_back(target);
+    }
+    size_t numFromFile = context.GetNumArguments("fromFile");
+    for (size_t i = 0; i < numFromFile; i++) {
+      const std::string& path = context.Argument("fromFile", i);
+      std::ifstream input(path.c_str());
+      if (input.fail()) {
+        context.GetError() << "Failed to open \"" << path << "\".\n";
+        hasErrors = true;
+        continue;
+      }
+      std::string token;
+      while (input >> token) {
+        std::istringstream is(token);
+        Offset target;
+        is >> std::hex >> target;
+        if (is.fail() || !is.eof()) {
+          context.GetError() << "\"" << token << "\" in \"" << path
+                             << "\" is not a valid address.\n";
+          hasErrors = true;
+          break;
+        }
+        targets.push_back(target);
+      }
+    }
+    std::set<Offset> seen;
+    std::vector<Offset> unique;
+    for (Offset target : targets) {
+      if (seen.insert(target).second) {
+        unique.push_back(target);
+      }
+    }
+    targets.swap(unique);
+    return !hasErrors;
+  }
+
+  /*
+   * Return, sorted by value then by address, all the matches for the given
+   * targets.
+   */
+  std::vector<Match> FindMatches(const std::vector<Offset>& targets) const {
+    std::vector<Match> matches;
+    if (targets.empty()) {
+      return matches;
+    }
+    std::vector<Offset> sortedTargets(targets);
+    std::sort(sortedTargets.begin(), sortedTargets.end());
+    Offset minTarget = sortedTargets.front();
+    Offset span = sortedTargets.back() - minTarget;
+    Offset mask = 0;
+    while (mask < span) {
+      mask = (mask << 1) | 1;
+    }
+
+    /*
+     * Parts of the images known to hold only 0 can be skipped unless 0 is
+     * one of the targets.
+     */
+    std::vector<Piece> pieces;
+    GetPieces(_addressMap, minTarget != 0, pieces);
+
+    std::vector<std::vector<Match> > chunkMatches(
+        Parallelism::NumChunks(pieces.size()));
+    Parallelism::ForEachChunk(
+        pieces.size(), chunkMatches.size(),
+        [&](size_t chunk, size_t base, size_t limit) {
+          std::vector<Match>& found = chunkMatches[chunk];
+          for (size_t i = base; i < limit; i++) {
+            const Piece& piece = pieces[i];
+            ScanWords(piece._words, piece._numWords, minTarget, ~mask,
+                      [&](size_t index) {
+                        Offset value = piece._words[index];
+                        if ((Offset)(value - minTarget) <= span &&
+                            std::binary_search(sortedTargets.begin(),
+                                               sortedTargets.end(), value)) {
+                          found.push_back(
+                              {value, piece._base +
+                                          (Offset)(index * sizeof(Offset))});
+                        }
+                      });
+          }
+        });
+    for (const auto& found : chunkMatches) {
+      matches.insert(matches.end(), found.begin(), found.end());
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+  }
+
+  /*
+   * This is a part of the image of a range, small enough that the parts
+   * can be shared fairly evenly among threads.
+   */
+  static constexpr size_t WORDS_PER_PIECE = 0x40000;
+  struct Piece {
+    const Offset* _words;
+    Offset _base;
+    size_t _numWords;
+  };
+
+  /*
+   * Split the images of the ranges into pieces of at most WORDS_PER_PIECE
+   * words, leaving out any parts known to hold only 0 if so requested.
+   */
+  static void GetPieces(const AddressMap& addressMap, bool skipKnownZeros,
+                        std::vector<Piece>& pieces) {
+    auto addPieces = [&](const char* image, Offset base, Offset size) {
+      const Offset* words = (const Offset*)(image);
+      size_t numWords = size / sizeof(Offset);
+      for (size_t i = 0; i < numWords; i += WORDS_PER_PIECE) {
+        pieces.push_back({words + i, base + (Offset)(i * sizeof(Offset)),
+                          std::min(WORDS_PER_PIECE, numWords - i)});
+      }
+    };
+    typename AddressMap::const_iterator itEnd = addressMap.end();
+    for (typename AddressMap::const_iterator it = addressMap.begin();
+         it != itEnd; ++it) {
+      if (it.GetImage() == (const char*)0) {
+        continue;
+      }
+      if (skipKnownZeros) {
+        addressMap.VisitPossiblyNonZeroParts(it, addPieces);
+      } else {
+        addPieces(it.GetImage(), it.Base(), it.Size());
+      }
+    }
+  }
+
+ private:
+  const AddressMap& _addressMap;
+
+  /*
+   * Call candidate(i) for each i in [0, numWords) such that
+   * (words[i] - minTarget) & highMask is 0.
+   */
+  template <typename Candidate>
+  static void ScanWords(const Offset* words, size_t numWords, Offset minTarget,
+                        Offset highMask, Candidate candidate) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    if (hasAVX2) {
+      i = ScanWordsAVX2(words, numWords, minTarget, highMask, candidate);
+    }
+#if defined(__SSE2__)
+    else {
+      i = ScanWordsSSE2(words, numWords, minTarget, highMask, candidate);
+    }
+#endif
+#endif
+    for (; i < numWords; i++) {
+      if (((Offset)(words[i] - minTarget) & highMask) == 0) {
+        candidate(i);
+      }
+    }
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  /*
+   * Scan whole vectors of words, 32 bytes at a time, and return the number
+   * of words scanned.  The lanes are compared as 32 bit values, so that
+   * this works for either word size, and a word is a candidate only if all
+   * its lanes are zero after masking.
+   */
+  template <typename Candidate>
+  __attribute__((target("avx2"))) static size_t ScanWordsAVX2(
+      const Offset* words, size_t numWords, Offset minTarget, Offset highMask,
+      Candidate& candidate) {
+    constexpr size_t WORDS_PER_VECTOR = sizeof(__m256i) / sizeof(Offset);
+    __m256i minVector;
+    __m256i maskVector;
+    if constexpr (sizeof(Offset) == sizeof(uint32_t)) {
+      minVector = _mm256_set1_epi32((int)minTarget);
+      maskVector = _mm256_set1_epi32((int)highMask);
+    } else {
+      minVector = _mm256_set1_epi64x((long long)minTarget);
+      maskVector = _mm256_set1_epi64x((long long)highMask);
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    size_t numScanned = numWords - (numWords % WORDS_PER_VECTOR);
+    for (size_t i = 0; i < numScanned; i += WORDS_PER_VECTOR) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+      __m256i d;
+      if constexpr (sizeof(Offset) == sizeof(uint32_t)) {
+        d = _mm256_sub_epi32(v, minVector);
+      } else {
+        d = _mm256_sub_epi64(v, minVector);
+      }
+      __m256i isZero =
+          _mm256_cmpeq_epi32(_mm256_and_si256(d, maskVector), zero);
+      unsigned int bits = (unsigned int)_mm256_movemask_epi8(isZero);
+      if (bits != 0) {
+        ReportCandidates(bits, i, candidate);
+      }
+    }
+    return numScanned;
+  }
+
+#if defined(__SSE2__)
+  template <typename Candidate>
+  static size_t ScanWordsSSE2(const Offset* words, size_t numWords,
+                              Offset minTarget, Offset highMask,
+                              Candidate& candidate) {
+    constexpr size_t WORDS_PER_VECTOR = sizeof(__m128i) / sizeof(Offset);
+    __m128i minVector;
+    __m128i maskVector;
+    if constexpr (sizeof(Offset) == sizeof(uint32_t)) {
+      minVector = _mm_set1_epi32((int)minTarget);
+      maskVector = _mm_set1_epi32((int)highMask);
+    } else {
+      minVector = _mm_set1_epi64x((long long)minTarget);
+      maskVector = _mm_set1_epi64x((long long)highMask);
+    }
+    const __m128i zero = _mm_setzero_si128();
+    size_t numScanned = numWords - (numWords % WORDS_PER_VECTOR);
+    for (size_t i = 0; i < numScanned; i += WORDS_PER_VECTOR) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(words + i));
+      __m128i d;
+      if constexpr (sizeof(Offset) == sizeof(uint32_t)) {
+        d = _mm_sub_epi32(v, minVector);
+      } else {
+        d = _mm_sub_epi64(v, minVector);
+      }
+      __m128i isZero = _mm_cmpeq_epi32(_mm_and_si128(d, maskVector), zero);
+      unsigned int bits = (unsigned int)_mm_movemask_epi8(isZero);
+      if (bits != 0) {
+        ReportCandidates(bits, i, candidate);
+      }
+    }
+    return numScanned;
+  }
+#endif
+
+  /*
+   * Given one bit per byte of a vector, set for the bytes of the masked
+   * words that were zero, report each word for which all bits are set.
+   */
+  template <typename Candidate>
+  static void ReportCandidates(unsigned int bits, size_t firstIndex,
+                               Candidate& candidate) {
+    constexpr unsigned int WORD_BITS = (1U << sizeof(Offset)) - 1;
+    for (size_t index = firstIndex; bits != 0;
+         index++, bits >>= sizeof(Offset)) {
+      if ((bits & WORD_BITS) == WORD_BITS) {
+        candidate(index);
+      }
+    }
+  }
+#endif
+};
+}  // namespace VirtualAddressMapCommands
+}  // namespace chap
@@ -0,0 +1,297 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "../Parallelism.h"
+#include "../VirtualAddressMap.h"
+#include "PointerScanner.h"
+namespace chap {
+namespace VirtualAddressMapCommands {
+/*
+ * This is an index, for each page that overlaps the image of some range of
+ * the VirtualAddressMap, of the pointer-aligned addresses in the images of
+ * the ranges that hold a value in that page.  Pages without an image, such
+ * as large reservations, are left out to keep the index small.  The index
+ * is built the first time it is used, so that a session that never asks
+ * which addresses point to a given address or range never pays for it, and
+ * after that such a question can be answered by looking only at the
+ * addresses that point to the pages involved, rather than by scanning every
+ * image.
+ *
+ * The addresses for each page are sorted and stored as the first address
+ * followed by the differences between successive addresses, each as a
+ * variable length integer with 7 bits per byte.  Because pointers tend to
+ * be clustered, most differences take one or two bytes.
+ */
+template <class Offset>
+class ReversePointerIndex {
+ public:
+  typedef VirtualAddressMap<Offset> AddressMap;
+  ReversePointerIndex(const AddressMap& addressMap)
+      : _addressMap(addressMap), _isBuilt(false) {}
+
+  /*
+   * If every address in [start, limit) is in some page covered by the
+   * index, append to sources, in increasing order, every pointer-aligned
+   * address in the images of the ranges that holds a value in [start, limit)
+   * and return true.  Otherwise leave sources alone and return false, in
+   * which case the caller must find the addresses some other way.
+   */
+  bool FindPointersTo(Offset start, Offset limit,
+                      std::vector<Offset>& sources) {
+    if (limit <= start) {
+      return false;
+    }
+    if (!_isBuilt) {
+      Build();
+    }
+    Offset firstPage = start / PAGE_SIZE;
+    Offset lastPage = (limit - 1) / PAGE_SIZE;
+    size_t interval = IntervalOf(firstPage);
+    if (interval == NO_INTERVAL || _limitPages[interval] <= lastPage) {
+      return false;
+    }
+
+    typename AddressMap::Reader reader(_addressMap);
+    size_t firstSlot = SlotOf(interval, firstPage);
+    size_t lastSlot = firstSlot + (size_t)(lastPage - firstPage);
+    size_t numBefore = sources.size();
+    for (size_t slot = firstSlot; slot <= lastSlot; slot++) {
+      const unsigned char* next = _encoded.data() + _slotStarts[slot];
+      const unsigned char* slotLimit = _encoded.data() + _slotStarts[slot + 1];
+      Offset source = 0;
+      while (next < slotLimit) {
+        source += DecodeVarint(next);
+        Offset value = reader.ReadOffset(source, 0);
+        if (value >= start && value < limit) {
+          sources.push_back(source);
+        }
+      }
+    }
+    if (firstSlot != lastSlot) {
+      std::sort(sources.begin() + numBefore, sources.end());
+    }
+    return true;
+  }
+
+  /*
+   * For each of the given targets, fill in the corresponding entry of
+   * sources with the pointer-aligned addresses, in increasing order, that
+   * hold that target.  Any targets not covered by the index are found
+   * together in a single scan of the images.
+   */
+  void FindPointersTo(const std::vector<Offset>& targets,
+                      std::vector<std::vector<Offset> >& sources) {
+    sources.clear();
+    sources.resize(targets.size());
+    std::vector<Offset> unindexed;
+    for (size_t i = 0; i < targets.size(); i++) {
+      if (!FindPointersTo(targets[i], targets[i] + 1, sources[i])) {
+        unindexed.push_back(targets[i]);
+      }
+    }
+    if (unindexed.empty()) {
+      return;
+    }
+    typedef typename PointerScanner<Offset>::Match Match;
+    std::vector<Match> matches =
+        PointerScanner<Offset>(_addressMap).FindMatches(unindexed);
+    for (size_t i = 0; i < targets.size(); i++) {
+      Match first = {targets[i], 0};
+      for (auto it = std::lower_bound(matches.begin(), matches.end(), first);
+           it != matches.end() && it->_value == targets[i]; ++it) {
+        sources[i].push_back(it->_address);
+      }
+    }
+  }
+
+ private:
+  static constexpr Offset PAGE_SIZE = 0x1000;
+  static constexpr size_t NO_INTERVAL = ~((size_t)0);
+  typedef typename PointerScanner<Offset>::Piece Piece;
+
+  const AddressMap& _addressMap;
+  bool _isBuilt;
+  /*
+   * The covered pages are described as maximal intervals
+   * [_firstPages[i], _limitPages[i]) with the slots for the pages in
+   * interval i starting at _firstSlots[i].
+   */
+  std::vector<Offset> _firstPages;
+  std::vector<Offset> _limitPages;
+  std::vector<size_t> _firstSlots;
+  Offset _minValue;
+  Offset _maxValue;
+  /*
+   * The encoded addresses for slot s are in
+   * [_encoded[_slotStarts[s]], _encoded[_slotStarts[s + 1]]).
+   */
+  std::vector<uint64_t> _slotStarts;
+  std::vector<unsigned char> _encoded;
+
+  size_t IntervalOf(Offset page) const {
+    size_t i = std::upper_bound(_limitPages.begin(), _limitPages.end(), page) -
+               _limitPages.begin();
+    return (i == _limitPages.size() || _firstPages[i] > page) ? NO_INTERVAL
+                                                              : i;
+  }
+
+  size_t SlotOf(size_t interval, Offset page) const {
+    return _firstSlots[interval] + (size_t)(page - _firstPages[interval]);
+  }
+
+  static size_t EncodedSize(Offset value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+      value >>= 7;
+      size++;
+    }
+    return size;
+  }
+
+  static unsigned char* EncodeVarint(Offset value, unsigned char* out) {
+    while (value >= 0x80) {
+      *(out++) = (unsigned char)(value | 0x80);
+      value >>= 7;
+    }
+    *(out++) = (unsigned char)value;
+    return out;
+  }
+
+  static Offset DecodeVarint(const unsigned char*& next) {
+    Offset value = 0;
+    int shift = 0;
+    unsigned char c;
+    do {
+      c = *(next++);
+      value |= ((Offset)(c & 0x7f)) << shift;
+      shift += 7;
+    } while ((c & 0x80) != 0);
+    return value;
+  }
+
+  /*
+   * Call visitor(slot, source) for each pointer-aligned address in an image
+   * that holds a value in a covered page, with the images split up among
+   * threads.
+   */
+  template <typename Visitor>
+  void VisitPointers(const std::vector<Piece>& pieces, Visitor visitor) const {
+    Parallelism::ForEach(pieces.size(), [&](size_t i) {
+      const Piece& piece = pieces[i];
+      size_t lastInterval = 0;
+      for (size_t j = 0; j < piece._numWords; j++) {
+        Offset value = piece._words[j];
+        if (value < _minValue || value > _maxValue) {
+          continue;
+        }
+        Offset page = value / PAGE_SIZE;
+        if (page < _firstPages[lastInterval] ||
+            page >= _limitPages[lastInterval]) {
+          size_t interval = IntervalOf(page);
+          if (interval == NO_INTERVAL) {
+            continue;
+          }
+          lastInterval = interval;
+        }
+        visitor(SlotOf(lastInterval, page),
+                piece._base + (Offset)(j * sizeof(Offset)));
+      }
+    });
+  }
+
+  void Build() {
+    _isBuilt = true;
+    typename AddressMap::const_iterator itEnd = _addressMap.end();
+    for (typename AddressMap::const_iterator it = _addressMap.begin();
+         it != itEnd; ++it) {
+      if (it.GetImage() == (const char*)0) {
+        continue;
+      }
+      Offset firstPage = it.Base() / PAGE_SIZE;
+      Offset limitPage = (it.Limit() - 1) / PAGE_SIZE + 1;
+      if (!_limitPages.empty() && _limitPages.back() >= firstPage) {
+        _limitPages.back() = std::max(_limitPages.back(), limitPage);
+      } else {
+        _firstPages.push_back(firstPage);
+        _limitPages.push_back(limitPage);
+      }
+    }
+    if (_firstPages.empty()) {
+      _slotStarts.push_back(0);
+      return;
+    }
+    size_t numSlots = 0;
+    for (size_t i = 0; i < _firstPages.size(); i++) {
+      _firstSlots.push_back(numSlots);
+      numSlots += (size_t)(_limitPages[i] - _firstPages[i]);
+    }
+    _minValue = _firstPages.front() * PAGE_SIZE;
+    _maxValue = (_limitPages.back() - 1) * PAGE_SIZE + (PAGE_SIZE - 1);
+
+    /*
+     * Words that hold 0 are never in a covered page unless page 0 is.
+     */
+    std::vector<Piece> pieces;
+    PointerScanner<Offset>::GetPieces(_addressMap, _minValue != 0, pieces);
+
+    /*
+     * Count the pointers to each page, then use the counts to place the
+     * address of each pointer in the run of addresses for its page.
+     */
+    std::unique_ptr<std::atomic<uint64_t>[]> counts(
+        new std::atomic<uint64_t>[numSlots]);
+    for (size_t slot = 0; slot < numSlots; slot++) {
+      counts[slot].store(0, std::memory_order_relaxed);
+    }
+    VisitPointers(pieces, [&](size_t slot, Offset) {
+      counts[slot].fetch_add(1, std::memory_order_relaxed);
+    });
+    std::vector<uint64_t> runStarts(numSlots + 1, 0);
+    for (size_t slot = 0; slot < numSlots; slot++) {
+      runStarts[slot + 1] =
+          runStarts[slot] + counts[slot].load(std::memory_order_relaxed);
+      counts[slot].store(runStarts[slot], std::memory_order_relaxed);
+    }
+    std::vector<Offset> sources(runStarts[numSlots]);
+    VisitPointers(pieces, [&](size_t slot, Offset source) {
+      sources[counts[slot].fetch_add(1, std::memory_order_relaxed)] = source;
+    });
+    counts.reset();
+
+    /*
+     * Sort the addresses for each page and find the size of the encoded
+     * form, then encode them all.
+     */
+    _slotStarts.resize(numSlots + 1, 0);
+    Parallelism::ForEach(numSlots, [&](size_t slot) {
+      auto runBegin = sources.begin() + runStarts[slot];
+      auto runEnd = sources.begin() + runStarts[slot + 1];
+      std::sort(runBegin, runEnd);
+      uint64_t size = 0;
+      Offset previous = 0;
+      for (auto it = runBegin; it != runEnd; ++it) {
+        size += EncodedSize(*it - previous);
+        previous = *it;
+      }
+      _slotStarts[slot + 1] = size;
+    });
+    Parallelism::InclusiveScan(_slotStarts);
+    _encoded.resize(_slotStarts[numSlots]);
+    Parallelism::ForEach(numSlots, [&](size_t slot) {
+      unsigned char* out = _encoded.data() + _slotStarts[slot];
+      Offset previous = 0;
+      for (uint64_t i = runStarts[slot]; i < runStarts[slot + 1]; i++) {
+        out = EncodeVarint(sources[i] - previous, out);
+        previous = sources[i];
+      }
+    });
+  }
+};
+}  // namespace VirtualAddressMapCommands
+}  // namespace chap
@@ -0,0 +1,134 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+// This compares the cost of Directory::AllocationIndexOf, which uses the page
+// index when it is available, with the cost of the plain binary search over
+// all the allocations, using as candidates the pointer-aligned values found
+// in the used allocations of the given core.  These are the same lookups done
+// while finding the edges of the allocation graph.
+//
+// Usage: allocation-index-benchmark <core> [<candidates-file>]
+//
+// If the candidates file exists, the candidates are read from it rather than
+// gathered from the core, so that the same set of candidates can be used
+// across versions of chap.  Otherwise, if a path is given, the candidates
+// gathered from the core are recorded there.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "Linux/ELFImage.h"
+#include "Linux/LinuxProcessImage.h"
+
+namespace {
+using namespace chap;
+
+template <class Offset>
+void GatherCandidates(const VirtualAddressMap<Offset> &addressMap,
+                      const Allocations::Directory<Offset> &directory,
+                      std::vector<Offset> &candidates) {
+  Allocations::ContiguousImage<Offset> contiguousImage(addressMap, directory);
+  for (typename Allocations::Directory<Offset>::AllocationIndex i = 0;
+       i < directory.NumAllocations(); i++) {
+    if (!directory.AllocationAt(i)->IsUsed()) {
+      continue;
+    }
+    contiguousImage.SetIndex(i);
+    candidates.insert(candidates.end(), contiguousImage.FirstOffset(),
+                      contiguousImage.OffsetLimit());
+  }
+}
+
+template <class Offset, class Lookup>
+double NanosecondsPerLookup(const std::vector<Offset> &candidates,
+                            Lookup lookup, uint64_t &checksum) {
+  auto start = std::chrono::steady_clock::now();
+  checksum = 0;
+  for (Offset candidate : candidates) {
+    checksum += lookup(candidate);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         (candidates.empty() ? 1 : candidates.size());
+}
+
+template <class ElfImage>
+int Run(const FileImage &fileImage, const char *candidatesPath) {
+  typedef typename ElfImage::Offset Offset;
+  ElfImage elfImage(fileImage);
+  Linux::LinuxProcessImage<ElfImage> processImage(elfImage, false);
+  const Allocations::Directory<Offset> &directory =
+      processImage.GetAllocationDirectory();
+
+  std::vector<Offset> candidates;
+  std::ifstream recorded;
+  if (candidatesPath != nullptr) {
+    recorded.open(candidatesPath, std::ios::binary);
+  }
+  if (recorded.is_open()) {
+    Offset candidate;
+    while (recorded.read((char *)&candidate, sizeof(candidate))) {
+      candidates.push_back(candidate);
+    }
+  } else {
+    GatherCandidates(processImage.GetVirtualAddressMap(), directory,
+                     candidates);
+    if (candidatesPath != nullptr) {
+      std::ofstream record(candidatesPath, std::ios::binary);
+      record.write((const char *)candidates.data(),
+                   candidates.size() * sizeof(Offset));
+    }
+  }
+
+  std::cout << std::dec << directory.NumAllocations() << " allocations, "
+            << candidates.size() << " candidates, page index "
+            << (directory.HasPageIndex() ? "built" : "not built") << "\n";
+  uint64_t searchChecksum;
+  double searchCost = NanosecondsPerLookup(
+      candidates,
+      [&](Offset addr) { return directory.SearchAllocationIndexOf(addr); },
+      searchChecksum);
+  uint64_t indexChecksum;
+  double indexCost = NanosecondsPerLookup(
+      candidates,
+      [&](Offset addr) { return directory.AllocationIndexOf(addr); },
+      indexChecksum);
+  std::cout << "binary search: " << searchCost << " ns per lookup\n"
+            << "page index:    " << indexCost << " ns per lookup\n";
+
+  size_t numMismatches = 0;
+  for (Offset candidate : candidates) {
+    if (directory.SearchAllocationIndexOf(candidate) !=
+        directory.AllocationIndexOf(candidate)) {
+      numMismatches++;
+    }
+  }
+  if (numMismatches != 0 || searchChecksum != indexChecksum) {
+    std::cout << numMismatches << " lookups gave different results.\n";
+    return 1;
+  }
+  return 0;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: allocation-index-benchmark <core> "
+                 "[<candidates-file>]\n";
+    return 1;
+  }
+  try {
+    FileImage fileImage(argv[1]);
+    const char *candidatesPath = (argc == 3) ? argv[2] : nullptr;
+    try {
+      return Run<Linux::Elf64>(fileImage, candidatesPath);
+    } catch (Linux::WrongElfClassException &) {
+      return Run<Linux::Elf32>(fileImage, candidatesPath);
+    }
+  } catch (...) {
+    std::cerr << "Failed to analyze " << argv[1] << "\n";
+  }
+  return 1;
+}
@@ -0,0 +1,350 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+// This builds a heap of a requested size and shape then crashes, so that the
+// resulting core can be used to measure how the cost of the analysis done by
+// chap grows with the number of allocations, the number of pointers between
+// them and the mix of containers recognized by the taggers.  Unlike the
+// programs under test/generators, which create small cores with known
+// contents, the contents here are only meant to be realistic in aggregate.
+//
+// Usage: synthetic-core-generator [-allocations <count>] [-pointers <density>]
+//            [-mix <kind>=<weight>[,<kind>=<weight>]...] [-arenas <count>]
+//            [-leaked <fraction>] [-seed <seed>]
+//
+// -allocations  approximate number of allocations to create (default 1000000)
+// -pointers     average number of pointers to other allocations held by
+//               each plain allocation (default 2)
+// -mix          relative numbers of objects of each kind to create, where
+//               each kind is one of plain, map, unordered_map, deque, list,
+//               vector or string and a container counts as one object
+//               regardless of how many allocations it uses (default
+//               plain=40,map=1,unordered_map=1,deque=1,list=1,vector=1,
+//               string=1)
+// -arenas       number of threads that do the allocation; with glibc malloc
+//               each thread normally gets its own arena (default 1)
+// -leaked       fraction of the plain allocations that are not reachable
+//               from any anchor (default 0.01)
+// -seed         seed for the choices of sizes and targets (default 1)
+//
+// The core is written wherever the kernel puts cores for the process, which
+// is normally controlled by "ulimit -c" and /proc/sys/kernel/core_pattern.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+enum Kind { PLAIN, MAP, UNORDERED_MAP, DEQUE, LIST, VECTOR, STRING, NUM_KINDS };
+
+const char *kindNames[NUM_KINDS] = {"plain", "map",  "unordered_map", "deque",
+                                    "list",  "vector", "string"};
+
+struct Parameters {
+  uint64_t _numAllocations = 1000000;
+  double _pointerDensity = 2.0;
+  double _weights[NUM_KINDS] = {40, 1, 1, 1, 1, 1, 1};
+  size_t _numArenas = 1;
+  double _leakedFraction = 0.01;
+  uint64_t _seed = 1;
+};
+
+/*
+ * The anchored plain allocations are held in blocks, each of which is itself
+ * an allocation, so that the graph has some fan-out from the anchors but
+ * most of the edges come from the pointers between the plain allocations.
+ */
+const size_t POINTERS_PER_BLOCK = 1024;
+
+/*
+ * Targets of pointers from plain allocations are chosen among the most
+ * recent plain allocations made by the same thread, which keeps the memory
+ * used by the generator itself proportional to the core size.
+ */
+const size_t TARGET_WINDOW = 1 << 16;
+
+/*
+ * The containers are held by allocated objects, one per thread, so that
+ * they are reachable from the static anchor below.
+ */
+struct Heap {
+  std::vector<void **> _blocks;
+  std::vector<std::map<uint64_t, std::string> *> _maps;
+  std::vector<std::unordered_map<uint64_t, void *> *> _unorderedMaps;
+  std::vector<std::deque<uint64_t> *> _deques;
+  std::vector<std::list<void *> *> _lists;
+  std::vector<std::vector<void *> *> _vectors;
+  std::vector<std::string *> _strings;
+  uint64_t _numAllocations = 0;
+};
+
+std::vector<Heap *> heaps;
+std::mutex readyMutex;
+std::condition_variable readyCondition;
+size_t numReady = 0;
+
+/*
+ * Each container is given between 1 and 64 elements, which for node-based
+ * containers is also the number of allocations for the elements.
+ */
+size_t ContainerSize(std::mt19937_64 &random) { return 1 + (random() & 0x3f); }
+
+class Builder {
+ public:
+  Builder(const Parameters &parameters, Heap &heap, uint64_t quota,
+          uint64_t seed)
+      : _parameters(parameters),
+        _heap(heap),
+        _quota(quota),
+        _random(seed),
+        _kinds(parameters._weights, parameters._weights + NUM_KINDS),
+        _window(TARGET_WINDOW, nullptr),
+        _nextInWindow(0),
+        _block(nullptr),
+        _numInBlock(POINTERS_PER_BLOCK) {}
+
+  void Build() {
+    while (_heap._numAllocations < _quota) {
+      switch (_kinds(_random)) {
+        case PLAIN:
+          AddPlain();
+          break;
+        case MAP:
+          AddMap();
+          break;
+        case UNORDERED_MAP:
+          AddUnorderedMap();
+          break;
+        case DEQUE:
+          AddDeque();
+          break;
+        case LIST:
+          AddList();
+          break;
+        case VECTOR:
+          AddVector();
+          break;
+        case STRING:
+          AddString();
+          break;
+      }
+    }
+  }
+
+ private:
+  const Parameters &_parameters;
+  Heap &_heap;
+  uint64_t _quota;
+  std::mt19937_64 _random;
+  std::discrete_distribution<int> _kinds;
+  std::vector<void *> _window;
+  size_t _nextInWindow;
+  void **_block;
+  size_t _numInBlock;
+
+  void *RandomTarget() {
+    return _window[_random() % TARGET_WINDOW];
+  }
+
+  void AddPlain() {
+    size_t numPointers = (size_t)_parameters._pointerDensity;
+    double fraction = _parameters._pointerDensity - numPointers;
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(_random) <
+        fraction) {
+      numPointers++;
+    }
+    size_t numWords = numPointers + 1 + (_random() % 30);
+    void **allocation = (void **)malloc(numWords * sizeof(void *));
+    memset(allocation, 0, numWords * sizeof(void *));
+    for (size_t i = 0; i < numPointers; i++) {
+      allocation[1 + (_random() % (numWords - 1))] = RandomTarget();
+    }
+    _heap._numAllocations++;
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(_random) <
+        _parameters._leakedFraction) {
+      return;
+    }
+    if (_numInBlock == POINTERS_PER_BLOCK) {
+      _block = (void **)calloc(POINTERS_PER_BLOCK, sizeof(void *));
+      _heap._blocks.push_back(_block);
+      _heap._numAllocations++;
+      _numInBlock = 0;
+    }
+    _block[_numInBlock++] = allocation;
+    _window[_nextInWindow] = allocation;
+    _nextInWindow = (_nextInWindow + 1) % TARGET_WINDOW;
+  }
+
+  void AddMap() {
+    auto *map = new std::map<uint64_t, std::string>();
+    size_t size = ContainerSize(_random);
+    for (size_t i = 0; i < size; i++) {
+      (*map)[_random()] = "value";
+    }
+    _heap._maps.push_back(map);
+    _heap._numAllocations += 1 + size;
+  }
+
+  void AddUnorderedMap() {
+    auto *map = new std::unordered_map<uint64_t, void *>();
+    size_t size = ContainerSize(_random);
+    for (size_t i = 0; i < size; i++) {
+      (*map)[_random()] = RandomTarget();
+    }
+    _heap._unorderedMaps.push_back(map);
+    _heap._numAllocations += 2 + size;
+  }
+
+  void AddDeque() {
+    auto *deque = new std::deque<uint64_t>();
+    size_t size = ContainerSize(_random) * 16;
+    for (size_t i = 0; i < size; i++) {
+      deque->push_back(i);
+    }
+    _heap._deques.push_back(deque);
+    _heap._numAllocations += 2 + size / 64 + 1;
+  }
+
+  void AddList() {
+    auto *list = new std::list<void *>();
+    size_t size = ContainerSize(_random);
+    for (size_t i = 0; i < size; i++) {
+      list->push_back(RandomTarget());
+    }
+    _heap._lists.push_back(list);
+    _heap._numAllocations += 1 + size;
+  }
+
+  void AddVector() {
+    auto *vector = new std::vector<void *>();
+    vector->reserve(ContainerSize(_random));
+    while (vector->size() < vector->capacity()) {
+      vector->push_back(RandomTarget());
+    }
+    _heap._vectors.push_back(vector);
+    _heap._numAllocations += 2;
+  }
+
+  void AddString() {
+    _heap._strings.push_back(
+        new std::string(16 + (_random() % 200), 'a' + (_random() % 26)));
+    _heap._numAllocations += 2;
+  }
+};
+
+void Build(const Parameters &parameters, size_t arena) {
+  Heap *heap = new Heap();
+  heaps[arena] = heap;
+  Builder builder(parameters, *heap,
+                  parameters._numAllocations / parameters._numArenas,
+                  parameters._seed * 1000003 + arena);
+  builder.Build();
+  std::unique_lock<std::mutex> lock(readyMutex);
+  numReady++;
+  readyCondition.notify_all();
+  if (arena != 0) {
+    // Keep the thread, and so its stack and arena, until the crash.
+    readyCondition.wait(lock, [] { return false; });
+  }
+}
+
+bool ParseMix(const char *mix, Parameters &parameters) {
+  for (double &weight : parameters._weights) {
+    weight = 0;
+  }
+  std::string remaining(mix);
+  while (!remaining.empty()) {
+    size_t comma = remaining.find(',');
+    std::string term = remaining.substr(0, comma);
+    remaining = (comma == std::string::npos) ? "" : remaining.substr(comma + 1);
+    size_t equals = term.find('=');
+    if (equals == std::string::npos) {
+      return false;
+    }
+    std::string name = term.substr(0, equals);
+    int kind = 0;
+    while (kind < NUM_KINDS && name != kindNames[kind]) {
+      kind++;
+    }
+    if (kind == NUM_KINDS) {
+      return false;
+    }
+    parameters._weights[kind] = strtod(term.c_str() + equals + 1, nullptr);
+  }
+  for (double weight : parameters._weights) {
+    if (weight > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseArguments(int argc, char **argv, Parameters &parameters) {
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 == argc) {
+      return false;
+    }
+    std::string option(argv[i]);
+    const char *value = argv[i + 1];
+    if (option == "-allocations") {
+      parameters._numAllocations = strtoull(value, nullptr, 0);
+    } else if (option == "-pointers") {
+      parameters._pointerDensity = strtod(value, nullptr);
+    } else if (option == "-mix") {
+      if (!ParseMix(value, parameters)) {
+        return false;
+      }
+    } else if (option == "-arenas") {
+      parameters._numArenas = strtoul(value, nullptr, 0);
+    } else if (option == "-leaked") {
+      parameters._leakedFraction = strtod(value, nullptr);
+    } else if (option == "-seed") {
+      parameters._seed = strtoull(value, nullptr, 0);
+    } else {
+      return false;
+    }
+  }
+  return parameters._numArenas > 0 && parameters._pointerDensity >= 0;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  Parameters parameters;
+  if (!ParseArguments(argc, argv, parameters)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [-allocations <count>] [-pointers <density>]\n"
+                 "    [-mix <kind>=<weight>[,<kind>=<weight>]...]"
+                 " [-arenas <count>]\n"
+                 "    [-leaked <fraction>] [-seed <seed>]\n";
+    return 1;
+  }
+  heaps.resize(parameters._numArenas, nullptr);
+  std::vector<std::thread> threads;
+  for (size_t arena = 1; arena < parameters._numArenas; arena++) {
+    threads.emplace_back(Build, std::cref(parameters), arena);
+  }
+  Build(parameters, 0);
+  {
+    std::unique_lock<std::mutex> lock(readyMutex);
+    readyCondition.wait(
+        lock, [&parameters] { return numReady == parameters._numArenas; });
+  }
+  uint64_t numAllocations = 0;
+  for (Heap *heap : heaps) {
+    numAllocations += heap->_numAllocations;
+  }
+  std::cerr << "Created about " << numAllocations << " allocations.\n";
+  *((int *)(0)) = 92;
+}
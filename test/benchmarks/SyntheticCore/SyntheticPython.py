@@ -0,0 +1,59 @@
+# Copyright (c) 2024 Broadcom. All Rights Reserved.
+# The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+# SPDX-License-Identifier: GPL-2.0
+
+# This builds a python heap of roughly the requested number of objects, as a
+# mix of dicts, lists, tuples, strings and instances of a small class, then
+# aborts, so that the resulting core can be used to measure the cost of the
+# python-specific parts of the analysis done by chap.
+#
+# Usage: python3 SyntheticPython.py [<objects> [<seed>]]
+
+import os
+import random
+import sys
+
+
+class Node:
+    def __init__(self, value, next):
+        self.value = value
+        self.next = next
+
+
+def build(numObjects, seed):
+    rng = random.Random(seed)
+    roots = []
+    recent = [None]
+    made = 0
+    while made < numObjects:
+        kind = rng.randrange(5)
+        if kind == 0:
+            size = rng.randrange(1, 32)
+            obj = {"k%d" % i: rng.choice(recent) for i in range(size)}
+            made += 1 + size
+        elif kind == 1:
+            size = rng.randrange(1, 64)
+            obj = [rng.choice(recent) for i in range(size)]
+            made += 2
+        elif kind == 2:
+            obj = (rng.random(), rng.choice(recent), made)
+            made += 2
+        elif kind == 3:
+            obj = "s" * rng.randrange(1, 300)
+            made += 1
+        else:
+            obj = Node(made, rng.choice(recent))
+            made += 2
+        roots.append(obj)
+        recent.append(obj)
+        if len(recent) > 65536:
+            recent = recent[32768:]
+    return roots
+
+
+if __name__ == "__main__":
+    numObjects = int(sys.argv[1]) if len(sys.argv) > 1 else 1000000
+    seed = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+    heap = build(numObjects, seed)
+    sys.stderr.write("Created about %d objects.\n" % numObjects)
+    os.abort()
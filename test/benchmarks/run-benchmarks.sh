@@ -0,0 +1,104 @@
+#!/bin/bash
+# Copyright (c) 2024 Broadcom. All Rights Reserved.
+# The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+# SPDX-License-Identifier: GPL-2.0
+
+# This is run by the chap-bench target.  It creates any synthetic cores that
+# are not already present under the work directory, then runs each command
+# script under scripts against each core, reporting the time taken by each
+# phase of the analysis and by each command, with and without compression of
+# the edges of the allocation graph.  See README for the variables that
+# control which cores are created.
+#
+# Usage: run-benchmarks.sh <chap> <synthetic-core-generator> <work-directory>
+
+chap=$1
+generator=$2
+workDir=$3
+scriptDir=$(cd "$(dirname "$0")" && pwd)
+
+if [ -z "$chap" ] || [ -z "$generator" ] || [ -z "$workDir" ]; then
+  echo "Usage: $0 <chap> <synthetic-core-generator> <work-directory>" >&2
+  exit 1
+fi
+
+allocationCounts=${CHAP_BENCH_ALLOCATIONS:-1000000}
+pointerDensity=${CHAP_BENCH_POINTERS:-2}
+mix=${CHAP_BENCH_MIX:-plain=40,map=1,unordered_map=1,deque=1,list=1,vector=1,string=1}
+arenas=${CHAP_BENCH_ARENAS:-1}
+pythonObjects=${CHAP_BENCH_PYTHON_OBJECTS:-}
+jobs=${CHAP_BENCH_JOBS:-1}
+
+mkdir -p "$workDir" || exit 1
+report="$workDir/report.txt"
+: > "$report"
+
+# Run the given command in the given directory with cores enabled, then
+# move the core it leaves there to the given path.  This assumes that
+# /proc/sys/kernel/core_pattern names a file in the current directory, which
+# is the default.
+makeCore() {
+  local dir=$1 core=$2
+  shift 2
+  (cd "$dir" && ulimit -c unlimited && "$@")
+  local found=$(ls -t "$dir"/core* 2> /dev/null | grep -v '\.chapcache' |
+                head -1)
+  if [ -z "$found" ]; then
+    echo "No core was created by $*; check ulimit -c and" \
+         "/proc/sys/kernel/core_pattern." >&2
+    return 1
+  fi
+  if [ "$found" != "$core" ]; then
+    mv "$found" "$core"
+  fi
+}
+
+cores=()
+for count in $allocationCounts; do
+  name="native-$count-p$pointerDensity-a$arenas-$(echo "$mix" | tr ',=' '_-')"
+  dir="$workDir/$name"
+  mkdir -p "$dir"
+  if [ ! -f "$dir/core" ]; then
+    echo "Creating $name ..."
+    makeCore "$dir" "$dir/core" "$generator" -allocations "$count" \
+      -pointers "$pointerDensity" -mix "$mix" -arenas "$arenas" || continue
+  fi
+  cores+=("$dir/core")
+done
+
+for count in $pythonObjects; do
+  name="python-$count"
+  dir="$workDir/$name"
+  mkdir -p "$dir"
+  if [ ! -f "$dir/core" ]; then
+    echo "Creating $name ..."
+    makeCore "$dir" "$dir/core" python3 \
+      "$scriptDir/SyntheticCore/SyntheticPython.py" "$count" || continue
+  fi
+  cores+=("$dir/core")
+done
+
+# Cores that cannot be generated here, such as those of Go processes, can
+# be given explicitly.
+for core in $CHAP_BENCH_CORES; do
+  cores+=("$core")
+done
+
+# Each script is run once with plain edge lists and once with compressed
+# edge lists (the -z switch), so that the report compares the time and peak
+# RSS of the two forms.
+for core in "${cores[@]}"; do
+  for script in "$scriptDir"/scripts/*.chap; do
+    for compression in "" -z; do
+      label="$core $(basename "$script")"
+      if [ -n "$compression" ]; then
+        label="$label (compressed edges)"
+      fi
+      {
+        echo "=== $label"
+        "$chap" -j "$jobs" $compression "$core" < "$script" 2>&1
+      } | tee -a "$report"
+    done
+  done
+done
+echo "The report is in $report."
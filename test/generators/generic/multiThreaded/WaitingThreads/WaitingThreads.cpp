@@ -0,0 +1,56 @@
+// Copyright (c) 2024 Broadcom. All Rights Reserved.
+// The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * This is intended to be analyzed while it is still running, using chap -p,
+ * rather than from a core.  It makes a known number of allocations of an
+ * unusual size, starts two threads that wait forever and then creates the
+ * file named by its only argument, so that whatever started it knows that
+ * it is ready to be looked at.  It runs until it is killed.
+ * Here is a sample command line to compile it:
+ * g++ -pthread -o WaitingThreads --std=c++11 WaitingThreads.cpp
+ */
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <unistd.h>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+static const int NUM_ALLOCATIONS = 7;
+static const size_t ALLOCATION_SIZE = 0x1238;
+static void *allocations[NUM_ALLOCATIONS];
+static std::mutex waitMutex;
+static std::condition_variable neverNotified;
+
+static void WaitForever() {
+  std::unique_lock<std::mutex> lock(waitMutex);
+  while (true) {
+    neverNotified.wait(lock);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    return 1;
+  }
+#ifdef __linux__
+  // Allow a process that is not an ancestor of this one to attach.
+  prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0);
+#endif
+  for (int i = 0; i < NUM_ALLOCATIONS; i++) {
+    allocations[i] = malloc(ALLOCATION_SIZE);
+  }
+  std::thread t1(WaitForever);
+  std::thread t2(WaitForever);
+  std::ofstream(argv[1]) << "ready\n";
+  while (true) {
+    pause();
+  }
+  return 0;
+}